@@ -7,6 +7,31 @@ describe("Testing cli", () => {
     fs.mkdirSync(".cache");
   }
 
+  /** Runs cli with output file name suffix, returns stdout and output file */
+  function compileWithCli(args: string[], outName: string) {
+    const outFileName = `${tmpFileName}.${outName}`;
+    if (fs.existsSync(outFileName)) {
+      fs.unlinkSync(outFileName);
+    }
+    const result = child_process.spawnSync(`./rocco`, [...args, outFileName]);
+
+    expect(result.status).toBe(0);
+
+    const output = fs.readFileSync(outFileName);
+    fs.unlinkSync(outFileName);
+    return { stdout: result.stdout.toString(), output };
+  }
+
+  function getModule(output: Buffer) {
+    return new WebAssembly.Module(output);
+  }
+
+  function getExportNames(output: Buffer) {
+    return WebAssembly.Module.exports(getModule(output)).map(
+      (item) => item.name
+    );
+  }
+
   it(`Compiles test file`, () => {
     if (fs.existsSync(tmpFileName)) {
       fs.unlinkSync(tmpFileName);
@@ -22,4 +47,88 @@ describe("Testing cli", () => {
     expect(fData.length > 1000).toBe(true);
     fs.unlinkSync(tmpFileName);
   });
+
+  it(`Compiles test file into binary`, () => {
+    const { output } = compileWithCli([`test/emitter.crc32.c`], "wasm");
+    expect(WebAssembly.validate(output)).toBe(true);
+  });
+
+  it(`Compiles with optimizations and prints statistics`, () => {
+    const { stdout } = compileWithCli(
+      [`-O2`, `--stats`, `test/emitter.crc32.c`],
+      "O2.wasm"
+    );
+    expect(stdout).toContain("constant-folding");
+  });
+
+  it(`Vectorizes loops`, () => {
+    const { stdout } = compileWithCli(
+      [`-O2`, `--simd`, `--stats`, `test/emitter14.c`],
+      "simd.wasm"
+    );
+    expect(stdout).toContain("vectorized-loops");
+  });
+
+  it(`Runs pre-initializers`, () => {
+    const { output } = compileWithCli(
+      [`--preinit=crc32_init_table`, `test/emitter.crc32.c`],
+      "preinit.wasm"
+    );
+    // Second entry of the table is saved into data segment
+    expect(output.indexOf(Buffer.from([0x96, 0x30, 0x07, 0x77]))).not.toBe(-1);
+  });
+
+  it(`Compiles with runtime library`, () => {
+    const { output } = compileWithCli(
+      [`--runtime=malloc`, `test/emitter17.c`],
+      "runtime.wasm"
+    );
+    expect(getExportNames(output)).toContain("malloc");
+  });
+
+  it(`Reports memory size`, () => {
+    const { stdout, output } = compileWithCli(
+      [
+        `--stack-size=4096`,
+        `--heap-size=65536`,
+        `--export-memory`,
+        `test/emitter22.c`,
+      ],
+      "memory.wasm"
+    );
+    expect(stdout).toContain("Memory: 5 pages");
+    expect(getExportNames(output)).toContain("memory");
+  });
+
+  it(`Writes source map`, () => {
+    const mapFileName = `${tmpFileName}.sourcemap.wasm.map`;
+    if (fs.existsSync(mapFileName)) {
+      fs.unlinkSync(mapFileName);
+    }
+    const { output } = compileWithCli(
+      [`--source-map`, `test/emitter.crc32.c`],
+      "sourcemap.wasm"
+    );
+    const sections = WebAssembly.Module.customSections(
+      getModule(output),
+      "sourceMappingURL"
+    );
+    expect(sections.length).toBe(1);
+
+    const map = JSON.parse(fs.readFileSync(mapFileName).toString());
+    expect(map.version).toBe(3);
+    expect(map.sources).toStrictEqual(["../test/emitter.crc32.c"]);
+    expect(map.mappings.length > 0).toBe(true);
+    fs.unlinkSync(mapFileName);
+  });
+
+  it(`Compiles instrumented module`, () => {
+    const { output } = compileWithCli(
+      [`--instrument=time`, `test/emitter24.c`],
+      "instrument.wasm"
+    );
+    expect(getExportNames(output)).toContain("_prof_dump");
+    const imports = WebAssembly.Module.imports(getModule(output));
+    expect(imports.map((item) => item.name)).toContain("_prof_now");
+  });
 });
@@ -1,26 +1,153 @@
 import fs from "fs";
+import path from "path";
 import { Scanner } from "./scanner";
-import { createScannerFunc } from "./scanner.func";
 import { readTranslationUnit } from "./parser";
 import { emit } from "./emitter";
+import { printModuleWat } from "./emitter.module.wat";
+import {
+  encodeModuleBinary,
+  encodeModuleBinaryWithSourceMap,
+} from "./emitter.module.binary";
+import { preinitializeModule } from "./emitter.preinit";
+import {
+  OptimizationLevel,
+  formatPassStatistics,
+} from "./emitter.ir.passmanager";
+import {
+  RuntimeLibrary,
+  RUNTIME_LIBRARIES,
+  createScannerFuncWithRuntime,
+} from "./runtime";
+import { getMemoryLayout } from "./emitter.memory";
 
-const args = process.argv.slice(2);
+const allArgs = process.argv.slice(2);
+const args = allArgs.filter((arg) => !arg.startsWith("-"));
+const flags = allArgs.filter((arg) => arg.startsWith("-"));
+
+let optimizationLevel: OptimizationLevel = 0;
+let showStatistics = false;
+let exportsList: string[] | undefined = undefined;
+let inlineBudget: number | undefined = undefined;
+let preinitializers: string[] = [];
+let simd = false;
+let tailCalls = false;
+let runtime: RuntimeLibrary[] = [];
+let stackSize: number | undefined = undefined;
+let heapSize: number | undefined = undefined;
+let exportMemory = false;
+let maxMemoryPages: number | undefined = undefined;
+let sourceMap = false;
+let instrument: "calls" | "time" | undefined = undefined;
+
+function parseSizeFlag(flag: string, name: string) {
+  const value = parseInt(flag.slice(name.length));
+  if (isNaN(value) || value < 0) {
+    console.info(`Wrong value in ${flag}`);
+    process.exit(1);
+  }
+  return value;
+}
+
+for (const flag of flags) {
+  if (flag === "-O0" || flag === "-O1" || flag === "-O2") {
+    optimizationLevel = parseInt(flag.slice(2)) as OptimizationLevel;
+  } else if (flag === "--stats") {
+    showStatistics = true;
+  } else if (flag.startsWith("--export=")) {
+    exportsList = flag
+      .slice("--export=".length)
+      .split(",")
+      .filter((name) => name);
+  } else if (flag.startsWith("--inline-budget=")) {
+    inlineBudget = parseInt(flag.slice("--inline-budget=".length));
+    if (isNaN(inlineBudget) || inlineBudget < 0) {
+      console.info(`Wrong inline budget in ${flag}`);
+      process.exit(1);
+    }
+  } else if (flag === "--simd") {
+    simd = true;
+  } else if (flag === "--tail-calls") {
+    tailCalls = true;
+  } else if (flag.startsWith("--preinit=")) {
+    preinitializers = flag
+      .slice("--preinit=".length)
+      .split(",")
+      .filter((name) => name);
+  } else if (flag.startsWith("--runtime=")) {
+    const libraries = flag
+      .slice("--runtime=".length)
+      .split(",")
+      .filter((name) => name);
+    for (const library of libraries) {
+      if (RUNTIME_LIBRARIES.indexOf(library as RuntimeLibrary) === -1) {
+        console.info(`Unknown runtime library ${library}`);
+        process.exit(1);
+      }
+    }
+    runtime = libraries as RuntimeLibrary[];
+  } else if (flag.startsWith("--stack-size=")) {
+    stackSize = parseSizeFlag(flag, "--stack-size=");
+    if (stackSize === 0 || stackSize % 16 !== 0) {
+      console.info(`Stack size must be a positive multiple of 16`);
+      process.exit(1);
+    }
+  } else if (flag.startsWith("--heap-size=")) {
+    heapSize = parseSizeFlag(flag, "--heap-size=");
+  } else if (flag === "--export-memory") {
+    exportMemory = true;
+  } else if (flag.startsWith("--max-memory-pages=")) {
+    maxMemoryPages = parseSizeFlag(flag, "--max-memory-pages=");
+  } else if (flag === "--source-map") {
+    sourceMap = true;
+  } else if (flag === "--instrument") {
+    instrument = "calls";
+  } else if (flag === "--instrument=time") {
+    instrument = "time";
+  } else {
+    console.info(`Unknown flag ${flag}`);
+    process.exit(1);
+  }
+}
 
 const inFileName = args[0];
 const outFileName = args[1];
 if (!inFileName || !outFileName) {
-  console.info("Usage: ./rocco <in file> <out file>");
+  console.info(
+    "Usage: ./rocco [-O0|-O1|-O2] [--stats] [--export=func1,func2] [--inline-budget=N] [--preinit=func1,func2] [--simd] [--tail-calls] [--runtime=malloc,arena] [--stack-size=BYTES] [--heap-size=BYTES] [--export-memory] [--max-memory-pages=N] [--source-map] [--instrument[=time]] <in file> <out file.wat|out file.wasm>"
+  );
   process.exit(1);
 }
+if (sourceMap && !outFileName.endsWith(".wasm")) {
+  console.info(`Source map is written only for .wasm output`);
+  process.exit(1);
+}
+const sourceMapFileName = `${outFileName}.map`;
 
 const inFileData = fs.readFileSync(inFileName).toString();
 
-try {
-  const scanner = new Scanner(createScannerFunc(inFileData));
+async function compile() {
+  const scanner = new Scanner(
+    createScannerFuncWithRuntime(
+      inFileData,
+      runtime,
+      getMemoryLayout(stackSize)
+    )
+  );
 
   const unit = readTranslationUnit(scanner);
 
-  const emitted = emit(unit);
+  const emitted = emit(unit, {
+    optimizationLevel,
+    exports: exportsList,
+    inlineBudget,
+    simd,
+    tailCalls,
+    stackSize,
+    heapSize,
+    exportMemory,
+    maxMemoryPages,
+    instrument,
+  });
 
   if (emitted.warnings.length > 0) {
     console.info("Warnings:");
@@ -29,17 +156,57 @@ try {
     );
   }
 
-  console.info(" ");
+  if (showStatistics) {
+    console.info("Optimization passes:");
+    formatPassStatistics(emitted.optimizationStatistics).forEach((line) =>
+      console.info(line)
+    );
+  }
+
+  // Initializers are executed on compilation time and memory is saved
+  const module =
+    preinitializers.length > 0
+      ? await preinitializeModule(emitted.module, preinitializers)
+      : emitted.module;
+
+  const memoryUsage = emitted.memoryUsage;
+  console.info(
+    `Memory: ${module.memory.minPages} pages (stack ${memoryUsage.stackSize}, globals ${memoryUsage.globalsSize}, heap ${memoryUsage.heapSize} bytes)` +
+      (module.memory.maxPages !== null
+        ? `, maximum ${module.memory.maxPages} pages`
+        : "")
+  );
 
-  const outData = emitted.moduleCode.join("\n") + "\n";
+  console.info(" ");
 
   if (fs.existsSync(outFileName)) {
     console.error(`Outfile '${outFileName} exists`);
     process.exit(1);
   }
 
+  if (sourceMap) {
+    // Map is placed near the module, so url is relative
+    const encoded = encodeModuleBinaryWithSourceMap(module, {
+      sourceMapUrl: path.basename(sourceMapFileName),
+      sourceFileName: path.relative(
+        path.dirname(sourceMapFileName),
+        inFileName
+      ),
+    });
+    fs.writeFileSync(outFileName, encoded.binary);
+    fs.writeFileSync(sourceMapFileName, JSON.stringify(encoded.sourceMap));
+    return;
+  }
+
+  // Text format is a debug view, binary is written for .wasm files
+  const outData = outFileName.endsWith(".wasm")
+    ? encodeModuleBinary(module)
+    : printModuleWat(module).join("\n") + "\n";
+
   fs.writeFileSync(outFileName, outData);
-} catch (e: any) {
+}
+
+compile().catch((e) => {
   const err = {
     name: e.name,
     message: e.message,
@@ -53,4 +220,4 @@ try {
   console.info("");
   console.info(e.stack);
   process.exit(1);
-}
+});
@@ -0,0 +1,95 @@
+import { EmitterHelpers } from "./emitter.helpers";
+import { ExpressionNode, Node } from "./parser.definitions";
+import {
+  ExpressionInfo,
+  WAInstuctionWhenMemoryIsReady,
+} from "./emitter.definitions";
+import { BuiltinFunction } from "./parser.builtins";
+import { getRegisterForTypename } from "./emitter.utils";
+import { convertScalarRegister } from "./emitter.scalar";
+
+/**
+ * Calls of builtin functions, every call is one instruction.
+ * Lane numbers are instruction immediates so they must be constants
+ */
+export function createBuiltinCalls(
+  helpers: EmitterHelpers,
+  getExpressionInfo: (expression: ExpressionNode) => ExpressionInfo
+) {
+  function error(node: Node, msg: string): never {
+    helpers.error(node, msg);
+  }
+
+  /** Arguments can have builtin calls too, so every call have own local */
+  let callId = 0;
+
+  function getBuiltinCallInfo(
+    expression: Extract<ExpressionNode, { type: "function call" }>,
+    builtin: BuiltinFunction
+  ): ExpressionInfo {
+    if (expression.args.length !== builtin.args.length) {
+      error(
+        expression,
+        `Builtin ${builtin.instruction} expects ${builtin.args.length} arguments`
+      );
+    }
+
+    const lanes: number[] = [];
+    const operands: WAInstuctionWhenMemoryIsReady[] = [];
+    builtin.args.forEach((param, idx) => {
+      const arg = expression.args[idx];
+      const argInfo = getExpressionInfo(arg);
+      if (param === "lane") {
+        const lane = argInfo.staticValue;
+        if (lane === null || lane < 0 || lane >= builtin.lanesCount) {
+          error(
+            arg,
+            `Lane must be a constant from 0 to ${builtin.lanesCount - 1}`
+          );
+        }
+        lanes.push(lane);
+        return;
+      }
+
+      const argValue = argInfo.value;
+      if (!argValue || !getRegisterForTypename(argInfo.type)) {
+        error(arg, "Must have a value");
+      }
+      if (param.type === "vector" && argInfo.type.type !== "vector") {
+        error(arg, "Expected v128_t value");
+      }
+      if (param.type !== "vector" && argInfo.type.type === "vector") {
+        error(arg, "Unexpected v128_t value");
+      }
+      if (param.type === "pointer" && argInfo.type.type !== "pointer") {
+        error(arg, "Expected pointer");
+      }
+      const conversion = convertScalarRegister(argInfo.type, param);
+      operands.push(() => [...argValue(), ...conversion]);
+    });
+
+    const saved = builtin.returnsFirstArgument
+      ? helpers.getScratchLocal("i32", `builtin${callId++}`)
+      : null;
+
+    return {
+      type: builtin.returnType,
+      staticValue: null,
+      address: null,
+      value: () => [
+        ...operands.reduce<string[]>(
+          (code, operand, idx) => [
+            ...code,
+            ...operand(),
+            ...(saved && idx === 0 ? [`local.tee ${saved}`] : []),
+          ],
+          []
+        ),
+        [builtin.instruction, ...lanes].join(" "),
+        ...(saved ? [`local.get ${saved} ;; First argument`] : []),
+      ],
+    };
+  }
+
+  return { getBuiltinCallInfo };
+}
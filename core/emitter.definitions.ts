@@ -3,7 +3,21 @@ import { TokenLocation } from "./error";
 
 export type WAInstuction = string;
 
-export type RegisterType = "i32" | "i64" | "f32" | "f64";
+/**
+ * Instruction with opcode and immediates separated.
+ * Expression code is generated as text and then parsed once per function,
+ * optimization passes and binary encoder work with this form
+ */
+export interface WAStructuredInstruction {
+  op: string;
+  /** Immediates, for example ["offset=4", "align=2"] or ["(result i32)"] */
+  args: string[];
+  comment: string | null;
+  /** Source code location for source map, see getLocationMarker */
+  location?: TokenLocation;
+}
+
+export type RegisterType = "i32" | "i64" | "f32" | "f64" | "v128";
 
 export type WAInstuctionWhenMemoryIsReady = () => WAInstuction[];
 export interface ExpressionInfo {
@@ -19,8 +33,104 @@ export interface ExpressionInfo {
   address: null | WAInstuctionWhenMemoryIsReady;
 
   staticValue: number | null;
+
+  /**
+   * Only for variables which are kept in WebAssembly locals.
+   * They have no address, so lvalue is changed via this function.
+   * Generated code saves provided value and leaves saved value on the stack
+   */
+  assignValue?: (value: WAInstuction[]) => WAInstuction[];
 }
 
 export interface CheckerWarning extends TokenLocation {
   msg: string;
 }
+
+/**
+ * Structured WebAssembly module, it can be printed as text or encoded as binary
+ */
+
+export interface WAFunctionType {
+  /** Text format name, like $FUNCSIGii */
+  name: string;
+  params: RegisterType[];
+  /** Empty for void, more than one for small structs */
+  results: RegisterType[];
+}
+
+export interface WALocal {
+  /** Text format name, like $P0001 */
+  name: string;
+  type: RegisterType;
+  /** Variable name in source code, for name section */
+  sourceName?: string;
+}
+
+export interface WAFunction {
+  /** Text format name, like $F0001 */
+  name: string;
+  /** Name of WAFunctionType */
+  typeName: string;
+  params: WALocal[];
+  results: RegisterType[];
+  locals: WALocal[];
+  body: WAStructuredInstruction[];
+  exportName: string | null;
+  /** Function name in source code, for name section */
+  sourceName: string | null;
+  /** Only for text format */
+  comment: string | null;
+}
+
+export interface WAImportedFunction {
+  /** Text format name, like $_prof_now */
+  name: string;
+  /** Name of WAFunctionType */
+  typeName: string;
+  importFrom: WAImportName;
+}
+
+export interface WAGlobal {
+  /** Text format name, like $__stack_pointer */
+  name: string;
+  type: RegisterType;
+  mutable: boolean;
+  /** If set then global is imported and initValue is ignored */
+  importFrom: WAImportName | null;
+  initValue: number;
+  exportName: string | null;
+}
+
+export interface WAImportName {
+  module: string;
+  name: string;
+}
+
+export interface WADataSegment {
+  offset: number;
+  bytes: number[];
+  /** Only for text format */
+  comment: string | null;
+}
+
+export interface WAMemory {
+  /** If set then memory is imported, otherwise module defines it */
+  importFrom: WAImportName | null;
+  /** Limits in 64KB pages */
+  minPages: number;
+  maxPages: number | null;
+  exportName: string | null;
+}
+
+export interface WAModule {
+  memory: WAMemory;
+  types: WAFunctionType[];
+  /** Elements of table starting from 0. Function names */
+  table: string[];
+  /** Imported globals must be first */
+  globals: WAGlobal[];
+  /** Imported functions have indexes before defined functions */
+  importedFunctions: WAImportedFunction[];
+  functions: WAFunction[];
+  data: WADataSegment[];
+}
@@ -0,0 +1,304 @@
+import {
+  CompoundStatementBody,
+  DeclaratorId,
+  DeclaratorNode,
+  ExpressionNode,
+  FunctionDefinition,
+  InitializerNode,
+} from "./parser.definitions";
+import { assertNever } from "./assertNever";
+import { findAddressTakenDeclarations } from "./emitter.functionscode.addresstaken";
+
+/*
+
+Devirtualization: calls through function pointers with known values.
+
+Function pointer variable which address is never taken can be changed only
+  by assignments to its identifier. If every value which is ever stored
+  into it is a function designator, then the pointer can point only
+  to those functions, and call through the pointer is emitted as
+  a chain of direct calls guarded by comparison of table indexes.
+  The last branch is still a call_indirect, so null pointer keeps trapping.
+
+Guard is not needed when pointer can hold only one function:
+  - it has an initializer and no other values, const pointers are this case
+  - it is an automatic variable, reading it before assignment is undefined
+
+Elements of array of const function pointers are known from its initializer.
+  Call with constant index is a direct call, call with dynamic index
+  is guarded by all functions from the array, as well as call through
+  a pointer which is assigned from such array.
+
+ */
+
+export interface KnownFunctionPointer {
+  /** Functions which can be a value of the pointer, null pointer is not here */
+  targets: DeclaratorId[];
+  /** Pointer can hold only the single target, call needs no guard */
+  exact: boolean;
+}
+
+export interface KnownFunctionPointers {
+  pointers: Map<DeclaratorId, KnownFunctionPointer>;
+  /** Elements of arrays of const function pointers, null is a null pointer */
+  tables: Map<DeclaratorId, (DeclaratorId | null)[]>;
+}
+
+function isFunctionPointer(declaration: DeclaratorNode) {
+  return (
+    declaration.typename.type === "pointer" &&
+    declaration.typename.pointsTo.type === "function"
+  );
+}
+
+export function findKnownFunctionPointers(
+  definitions: FunctionDefinition[],
+  globalDeclarations: DeclaratorNode[],
+  getDeclaration: (declaratorId: DeclaratorId) => DeclaratorNode
+): KnownFunctionPointers {
+  /** Assigned values for every identifier, initializers are here too */
+  const values = new Map<DeclaratorId, ExpressionNode[]>();
+  /** Identifiers which are changed not by plain assignment */
+  const modified = new Set<DeclaratorId>();
+  const automaticVariables = new Set<DeclaratorId>();
+  const declarations: DeclaratorNode[] = [...globalDeclarations];
+
+  function addValue(declaratorId: DeclaratorId, value: ExpressionNode) {
+    const list = values.get(declaratorId);
+    if (list) {
+      list.push(value);
+    } else {
+      values.set(declaratorId, [value]);
+    }
+  }
+
+  function addInitializer(declaration: DeclaratorNode) {
+    const initializer = declaration.initializer;
+    if (initializer && initializer.type === "assigmnent-expression") {
+      addValue(declaration.declaratorId, initializer.expression);
+    }
+  }
+
+  function checkExpression(expression: ExpressionNode): void {
+    if (
+      expression.type === "identifier" ||
+      expression.type === "const" ||
+      expression.type === "string-literal" ||
+      expression.type === "sizeof typename" ||
+      expression.type === "sizeof expression"
+    ) {
+      return;
+    } else if (expression.type === "subscript operator") {
+      checkExpression(expression.target);
+      checkExpression(expression.index);
+    } else if (expression.type === "function call") {
+      checkExpression(expression.target);
+      expression.args.forEach((arg) => checkExpression(arg));
+    } else if (
+      expression.type === "postfix ++" ||
+      expression.type === "postfix --" ||
+      expression.type === "prefix ++" ||
+      expression.type === "prefix --"
+    ) {
+      if (expression.target.type === "identifier") {
+        modified.add(expression.target.declaratorNodeId);
+      }
+      checkExpression(expression.target);
+    } else if (
+      expression.type === "struct access" ||
+      expression.type === "struct pointer access" ||
+      expression.type === "cast" ||
+      expression.type === "unary-operator"
+    ) {
+      checkExpression(expression.target);
+    } else if (expression.type === "binary operator") {
+      checkExpression(expression.left);
+      checkExpression(expression.right);
+    } else if (expression.type === "conditional expression") {
+      checkExpression(expression.condition);
+      checkExpression(expression.iftrue);
+      checkExpression(expression.iffalse);
+    } else if (expression.type === "assignment") {
+      if (expression.lvalue.type === "identifier") {
+        addValue(expression.lvalue.declaratorNodeId, expression.rvalue);
+      }
+      checkExpression(expression.lvalue);
+      checkExpression(expression.rvalue);
+    } else if (expression.type === "expression with sideeffect") {
+      checkExpression(expression.sizeeffect);
+      checkExpression(expression.effectiveValue);
+    } else {
+      assertNever(expression);
+    }
+  }
+
+  function checkInitializer(initializer: InitializerNode): void {
+    if (initializer.type === "assigmnent-expression") {
+      checkExpression(initializer.expression);
+    } else {
+      initializer.items.forEach((item) => checkInitializer(item));
+    }
+  }
+
+  function checkBlock(block: CompoundStatementBody[]): void {
+    for (const statement of block) {
+      if (statement.type === "declarator") {
+        if (statement.storageSpecifier !== "static") {
+          automaticVariables.add(statement.declaratorId);
+          declarations.push(statement);
+        }
+        if (statement.initializer) {
+          checkInitializer(statement.initializer);
+        }
+      } else if (
+        statement.type === "noop" ||
+        statement.type === "break" ||
+        statement.type === "continue"
+      ) {
+        // Nothing here
+      } else if (statement.type === "return") {
+        if (statement.expression) {
+          checkExpression(statement.expression);
+        }
+      } else if (statement.type === "expression") {
+        checkExpression(statement.expression);
+      } else if (statement.type === "compound-statement") {
+        checkBlock(statement.body);
+      } else if (statement.type === "if") {
+        checkExpression(statement.condition);
+        checkBlock([statement.iftrue]);
+        if (statement.iffalse) {
+          checkBlock([statement.iffalse]);
+        }
+      } else if (statement.type === "while" || statement.type === "dowhile") {
+        checkExpression(statement.condition);
+        checkBlock([statement.body]);
+      } else if (statement.type === "switch") {
+        checkExpression(statement.expression);
+        checkBlock([statement.body]);
+      } else if (statement.type === "case" || statement.type === "default") {
+        checkBlock([statement.body]);
+      } else {
+        assertNever(statement);
+      }
+    }
+  }
+
+  for (const declaration of globalDeclarations) {
+    if (declaration.initializer) {
+      checkInitializer(declaration.initializer);
+    }
+  }
+  // Globals are declarators too, their initializers can take address
+  const addressTaken = findAddressTakenDeclarations(globalDeclarations);
+  for (const definition of definitions) {
+    checkBlock(definition.body);
+    findAddressTakenDeclarations(definition.body).forEach((declaratorId) =>
+      addressTaken.add(declaratorId)
+    );
+  }
+  declarations.forEach(addInitializer);
+
+  const pointers = new Map<DeclaratorId, KnownFunctionPointer>();
+  const tables = new Map<DeclaratorId, (DeclaratorId | null)[]>();
+
+  /** Functions which can be a value of expression, null if it is unknown */
+  function resolveTargets(
+    expression: ExpressionNode
+  ): (DeclaratorId | null)[] | null {
+    if (expression.type === "identifier") {
+      const declaration = getDeclaration(expression.declaratorNodeId);
+      return declaration.typename.type === "function" &&
+        !declaration.isBuiltin
+        ? [declaration.declaratorId]
+        : null;
+    } else if (
+      expression.type === "unary-operator" &&
+      expression.operator === "&" &&
+      expression.target.type === "identifier"
+    ) {
+      return resolveTargets(expression.target);
+    } else if (expression.type === "cast") {
+      return resolveTargets(expression.target);
+    } else if (expression.type === "const" && expression.value === 0) {
+      return [null];
+    } else if (expression.type === "conditional expression") {
+      const iftrue = resolveTargets(expression.iftrue);
+      const iffalse = resolveTargets(expression.iffalse);
+      return iftrue && iffalse ? [...iftrue, ...iffalse] : null;
+    } else if (
+      expression.type === "subscript operator" &&
+      expression.target.type === "identifier"
+    ) {
+      // Array can be longer than its initializer
+      const elements = tables.get(expression.target.declaratorNodeId);
+      return elements ? [...elements, null] : null;
+    }
+    return null;
+  }
+
+  for (const declaration of declarations) {
+    if (
+      declaration.typename.type === "array" &&
+      declaration.typename.elementsTypename.type === "pointer" &&
+      declaration.typename.elementsTypename.const &&
+      declaration.typename.elementsTypename.pointsTo.type === "function" &&
+      declaration.initializer &&
+      declaration.initializer.type === "initializer-list"
+    ) {
+      const elements: (DeclaratorId | null)[] = [];
+      for (const item of declaration.initializer.items) {
+        const itemTargets =
+          item.type === "assigmnent-expression"
+            ? resolveTargets(item.expression)
+            : null;
+        if (!itemTargets || itemTargets.length !== 1) {
+          break;
+        }
+        elements.push(itemTargets[0]);
+      }
+      if (elements.length === declaration.initializer.items.length) {
+        tables.set(declaration.declaratorId, elements);
+      }
+    }
+  }
+
+  for (const declaration of declarations) {
+    const declaratorId = declaration.declaratorId;
+    if (
+      !isFunctionPointer(declaration) ||
+      addressTaken.has(declaratorId) ||
+      modified.has(declaratorId)
+    ) {
+      continue;
+    }
+    const resolved: (DeclaratorId | null)[] = [];
+    let isKnown = true;
+    for (const value of values.get(declaratorId) || []) {
+      const valueTargets = resolveTargets(value);
+      if (!valueTargets) {
+        isKnown = false;
+        break;
+      }
+      resolved.push(...valueTargets);
+    }
+    const targets: DeclaratorId[] = [];
+    for (const target of resolved) {
+      if (target !== null && targets.indexOf(target) === -1) {
+        targets.push(target);
+      }
+    }
+    if (!isKnown || targets.length === 0) {
+      continue;
+    }
+    pointers.set(declaratorId, {
+      targets,
+      exact:
+        targets.length === 1 &&
+        resolved.indexOf(null) === -1 &&
+        (!!declaration.initializer || automaticVariables.has(declaratorId)),
+    });
+  }
+
+  return { pointers, tables };
+}
@@ -1,10 +1,33 @@
-import { ExpressionNode, Typename, Node } from "./parser.definitions";
-import { ExpressionInfo, WAInstuction } from "./emitter.definitions";
+import {
+  ExpressionNode,
+  Typename,
+  Node,
+  DeclaratorNode,
+  DeclaratorId,
+} from "./parser.definitions";
+import {
+  ExpressionInfo,
+  RegisterType,
+  WAInstuction,
+} from "./emitter.definitions";
 import { assertNever } from "./assertNever";
 import { EmitterHelpers } from "./emitter.helpers";
-import { getRegisterForTypename } from "./emitter.utils";
-import { storeScalar, loadScalar } from "./emitter.scalar.storeload";
-import { isScalar } from "./emitter.scalar";
+import {
+  getRegisterForTypename,
+  getRegistersForTypename,
+  getFunctionWaName,
+  isFloatingRegister,
+} from "./emitter.utils";
+import {
+  storeScalar,
+  loadScalar,
+  narrowScalarInRegister,
+} from "./emitter.scalar.storeload";
+import { convertScalarRegister, scalarToCondition } from "./emitter.scalar";
+import { getBuiltinFunction } from "./parser.builtins";
+import { createBuiltinCalls } from "./emitter.builtins";
+import { createStructs, Structs } from "./emitter.structs";
+import { KnownFunctionPointers } from "./emitter.devirtualization";
 
 export type TypeSize =
   | {
@@ -28,10 +51,12 @@ export type ExpressionInfoGetter = (
 export interface ExpressionAndTypes {
   getTypeSize: TypeSizeGetter;
   getExpressionInfo: ExpressionInfoGetter;
+  structs: Structs;
 }
 
 export function createExpressionAndTypes(
-  helpers: EmitterHelpers
+  helpers: EmitterHelpers,
+  knownFunctionPointers: KnownFunctionPointers
 ): ExpressionAndTypes {
   const { warn, cloneLocation, getDeclaration } = helpers;
 
@@ -39,6 +64,17 @@ export function createExpressionAndTypes(
     helpers.error(node, msg);
   }
 
+  const { getBuiltinCallInfo } = createBuiltinCalls(helpers, (expression) =>
+    getExpressionInfo(expression)
+  );
+
+  /** Vectors have no operators, only builtins work with them */
+  const checkNotVector = (node: Node, register: RegisterType) => {
+    if (register === "v128") {
+      error(node, "Operator is not allowed for v128_t, use builtins");
+    }
+  };
+
   const getTypeSize: TypeSizeGetter = (typename) => {
     // Fixed size = number
     // Depended size = expression
@@ -60,6 +96,13 @@ export function createExpressionAndTypes(
         return staticSize(1);
       } else if (typename.arithmeticType === "int") {
         return staticSize(4);
+      } else if (
+        typename.arithmeticType === "long long" ||
+        typename.arithmeticType === "double"
+      ) {
+        return staticSize(8);
+      } else if (typename.arithmeticType === "float") {
+        return staticSize(4);
       } else {
         error(typename, "Not supported yet");
       }
@@ -83,7 +126,12 @@ export function createExpressionAndTypes(
           "Dynamic arrays are not supported yet. Todo: return created expression for size if possible"
         );
       }
-    } else if (typename.type === "enum" || typename.type === "struct") {
+    } else if (typename.type === "struct") {
+      if (!typename.definition.members) {
+        return incomleteSize;
+      }
+      return staticSize(structs.getStructLayout(typename).size);
+    } else if (typename.type === "enum") {
       error(typename, "Not supported yet");
     } else if (
       typename.type === "function" ||
@@ -95,6 +143,8 @@ export function createExpressionAndTypes(
       );
     } else if (typename.type === "pointer") {
       return staticSize(4);
+    } else if (typename.type === "vector") {
+      return staticSize(16);
     } else if (typename.type === "void") {
       error(typename, "Void have no size");
     } else {
@@ -102,6 +152,76 @@ export function createExpressionAndTypes(
     }
   };
 
+  const structs = createStructs(helpers, (typename) => getTypeSize(typename));
+
+  /**
+   * Usual arithmetic conversions (6.3.1.8): floating type wins,
+   *  otherwise bigger integer type is used
+   */
+  const getCommonArithmeticType = (left: Typename, right: Typename) => {
+    const getFloatingRank = (typename: Typename) =>
+      typename.type !== "arithmetic"
+        ? 0
+        : typename.arithmeticType === "double"
+        ? 2
+        : typename.arithmeticType === "float"
+        ? 1
+        : 0;
+    const leftRank = getFloatingRank(left);
+    const rightRank = getFloatingRank(right);
+    if (leftRank > 0 || rightRank > 0) {
+      return leftRank >= rightRank ? left : right;
+    }
+
+    const leftSize = getTypeSize(left);
+    const rightSize = getTypeSize(right);
+    if (leftSize.type !== "static") {
+      error(left, "Inernal error final type left");
+    }
+    if (rightSize.type !== "static") {
+      error(right, "Inernal error final type left");
+    }
+    if (leftSize.value >= rightSize.value) {
+      // TODO: Signed or unsigned!
+      return left;
+    } else {
+      return right;
+    }
+  };
+
+  const getFloatingOperator = (expression: ExpressionNode) => {
+    if (expression.type !== "binary operator") {
+      throw new Error("Internal error: expecting binary operator");
+    }
+    const op = expression.operator;
+    const operator =
+      op === "*"
+        ? "mul"
+        : op === "/"
+        ? "div"
+        : op === "+"
+        ? "add"
+        : op === "-"
+        ? "sub"
+        : op === "=="
+        ? "eq"
+        : op === "!="
+        ? "ne"
+        : op === "<"
+        ? "lt"
+        : op === "<="
+        ? "le"
+        : op === ">"
+        ? "gt"
+        : op === ">="
+        ? "ge"
+        : null;
+    if (!operator) {
+      error(expression, `Operator ${op} is not allowed for floating types`);
+    }
+    return operator;
+  };
+
   const isArrayStaticSize = (node: Typename) => {
     if (node.type !== "array") {
       throw new Error("Internal error: isArrayStaticSize called for non-array");
@@ -114,6 +234,144 @@ export function createExpressionAndTypes(
     }
   };
 
+  /**
+   * Scalar variable which is kept in WebAssembly local
+   */
+  const getWasmLocalInfo = (
+    declaration: DeclaratorNode,
+    staticValue: number | null
+  ): ExpressionInfo => {
+    const localName = declaration.wasmLocalName;
+    if (!localName) {
+      throw new Error("Internal error: declaration is not in local");
+    }
+    return {
+      type: declaration.typename,
+      staticValue: staticValue,
+      value: () => [`local.get ${localName}`],
+      address: null,
+      assignValue: (value) => [
+        ...value,
+        ...narrowScalarInRegister(declaration.typename),
+        `local.tee ${localName}`,
+      ],
+    };
+  };
+
+  /** Guarded calls are emitted only for few targets */
+  const MAX_GUARDED_CALL_TARGETS = 8;
+
+  /**
+   * Functions which can be called by expression like "(*p)" or "(*table[i])",
+   *   see emitter.devirtualization. Only functions from table are returned
+   */
+  const getKnownCallTargets = (
+    target: ExpressionNode
+  ): { targets: DeclaratorNode[]; exact: boolean } | null => {
+    if (target.type !== "unary-operator" || target.operator !== "*") {
+      return null;
+    }
+    const pointer = target.target;
+    let targets: DeclaratorId[] = [];
+    let exact = false;
+    if (pointer.type === "identifier") {
+      const known = knownFunctionPointers.pointers.get(
+        pointer.declaratorNodeId
+      );
+      if (!known) {
+        return null;
+      }
+      targets = known.targets;
+      exact = known.exact;
+    } else if (
+      pointer.type === "subscript operator" &&
+      pointer.target.type === "identifier"
+    ) {
+      const elements = knownFunctionPointers.tables.get(
+        pointer.target.declaratorNodeId
+      );
+      if (!elements) {
+        return null;
+      }
+      const index = getExpressionInfo(pointer.index).staticValue;
+      if (index !== null) {
+        const element = elements[index];
+        if (!element) {
+          return null;
+        }
+        targets = [element];
+        exact = true;
+      } else {
+        for (const element of elements) {
+          if (element && targets.indexOf(element) === -1) {
+            targets.push(element);
+          }
+        }
+      }
+    } else {
+      return null;
+    }
+    const declarations = targets
+      .map(getDeclaration)
+      .filter((declaration) => declaration.memoryOffset !== undefined);
+    if (
+      declarations.length === 0 ||
+      (exact && declarations.length !== targets.length) ||
+      declarations.length > MAX_GUARDED_CALL_TARGETS
+    ) {
+      return null;
+    }
+    return { targets: declarations, exact };
+  };
+
+  /**
+   * Compares pointer with table index of every target and calls it directly,
+   *   call_indirect is the last branch. Pointer and arguments are evaluated
+   *   once before the first comparison and kept in scratch locals.
+   *   Only the first "if" is marked, tail call replaces all calls after it
+   */
+  const getGuardedCallCode = (
+    targets: DeclaratorNode[],
+    getPointer: () => WAInstuction[],
+    argsValueGetters: (() => WAInstuction[])[],
+    argsRegisters: RegisterType[],
+    results: RegisterType[],
+    waTypeName: string
+  ): WAInstuction[] => {
+    const pointerLocal = helpers.getScratchLocal("i32", "callee");
+    const argsLocals = argsRegisters.map((register, idx) =>
+      helpers.getScratchLocal(register, `arg${idx}`)
+    );
+    const code: WAInstuction[] = [...getPointer()];
+    argsValueGetters.forEach((f) => code.push(...f()));
+    code.push(
+      ...argsLocals.map((local) => `local.set ${local}`).reverse(),
+      `local.set ${pointerLocal}`
+    );
+    const getArgs = () => argsLocals.map((local) => `local.get ${local}`);
+    const blockType = results.length > 0 ? ` (result ${results[0]})` : "";
+    const getBranch = (idx: number): WAInstuction[] =>
+      idx === targets.length
+        ? [
+            ...getArgs(),
+            `local.get ${pointerLocal}`,
+            `call_indirect (type ${waTypeName})`,
+          ]
+        : [
+            `local.get ${pointerLocal}`,
+            `i32.const ${targets[idx].memoryOffset}`,
+            `i32.eq`,
+            idx === 0 ? `if${blockType} ;; Guarded call` : `if${blockType}`,
+            ...getArgs(),
+            `call ${getFunctionWaName(targets[idx].declaratorId)}`,
+            `else`,
+            ...getBranch(idx + 1),
+            `end`,
+          ];
+    code.push(...getBranch(0));
+    return code;
+  };
+
   const getExpressionInfo = (expression: ExpressionNode): ExpressionInfo => {
     if (expression.type === "const") {
       // TODO: Change ExperssionNode type to hold stringified value instead of number
@@ -170,15 +428,56 @@ export function createExpressionAndTypes(
             staticValue: expression.value,
           };
         }
-      } else if (expression.subtype === "float") {
-        error(expression, "Floats are not supported yet");
+      } else if (expression.subtype === "long long") {
+        const typeNode: Typename = {
+          type: "arithmetic",
+          arithmeticType: "long long",
+          const: true,
+          signedUnsigned: null,
+        };
+        cloneLocation(expression, typeNode);
+        return {
+          type: typeNode,
+          // Text keeps all 64 bits, number is exact only up to 2^53
+          value: () => [`i64.const ${expression.text}`],
+          address: null,
+          staticValue: Number.isSafeInteger(expression.value)
+            ? expression.value
+            : null,
+        };
+      } else if (
+        expression.subtype === "float" ||
+        expression.subtype === "double"
+      ) {
+        const typeNode: Typename = {
+          type: "arithmetic",
+          arithmeticType: expression.subtype,
+          const: true,
+          signedUnsigned: null,
+        };
+        cloneLocation(expression, typeNode);
+        const register = expression.subtype === "float" ? "f32" : "f64";
+        return {
+          type: typeNode,
+          value: () => [`${register}.const ${expression.value}`],
+          address: null,
+          // Static values are integers
+          staticValue: null,
+        };
       }
     } else if (expression.type === "identifier") {
       const declaration = getDeclaration(expression.declaratorNodeId);
-      if (declaration.typename.type === "arithmetic") {
+      if (
+        declaration.typename.type === "arithmetic" ||
+        declaration.typename.type === "vector"
+      ) {
+        const register = getRegisterForTypename(declaration.typename);
         if (
-          declaration.typename.arithmeticType === "char" ||
-          declaration.typename.arithmeticType === "int"
+          register &&
+          !(
+            declaration.typename.type === "arithmetic" &&
+            declaration.typename.arithmeticType === "short"
+          )
         ) {
           let staticValue: number | null = null;
           if (
@@ -193,6 +492,9 @@ export function createExpressionAndTypes(
               staticValue = initializerInfo.staticValue;
             }
           }
+          if (declaration.wasmLocalName) {
+            return getWasmLocalInfo(declaration, staticValue);
+          }
           return {
             type: declaration.typename,
             staticValue: staticValue,
@@ -200,13 +502,13 @@ export function createExpressionAndTypes(
               declaration.memoryIsGlobal
                 ? [
                     `i32.const ${declaration.memoryOffset}`,
-                    loadScalar(declaration.typename, "i32", 0, 2),
+                    loadScalar(declaration.typename, register, 0, 2),
                   ]
                 : [
                     `local.get $ebp`,
                     loadScalar(
                       declaration.typename,
-                      "i32",
+                      register,
                       declaration.memoryOffset,
                       2
                     ),
@@ -220,11 +522,6 @@ export function createExpressionAndTypes(
                     `i32.add`,
                   ],
           };
-        } else if (
-          declaration.typename.arithmeticType === "double" ||
-          declaration.typename.arithmeticType === "float"
-        ) {
-          error(expression, "Floats are not supported yet");
         } else {
           error(expression, "TODO support other types");
         }
@@ -234,15 +531,30 @@ export function createExpressionAndTypes(
           "Internal error: K&R notations should be replated to this point"
         );
       } else if (declaration.typename.type === "function") {
+        if (declaration.isBuiltin) {
+          error(expression, "Builtin function can only be called");
+        }
+        // Value of function is index in table
+        const getTableIndex = () => {
+          if (declaration.memoryOffset === undefined) {
+            throw new Error(
+              `Internal error: function ${declaration.identifier} is not in table`
+            );
+          }
+          return [`i32.const ${declaration.memoryOffset}`];
+        };
         return {
           type: declaration.typename,
           staticValue: declaration.memoryOffset
             ? declaration.memoryOffset
             : null,
-          value: () => [`i32.const ${declaration.memoryOffset}`],
-          address: () => [`i32.const ${declaration.memoryOffset}`],
+          value: getTableIndex,
+          address: getTableIndex,
         };
       } else if (declaration.typename.type === "pointer") {
+        if (declaration.wasmLocalName) {
+          return getWasmLocalInfo(declaration, null);
+        }
         return {
           type: declaration.typename,
           staticValue: null,
@@ -289,10 +601,31 @@ export function createExpressionAndTypes(
                 ];
           },
         };
-      } else if (
-        declaration.typename.type === "enum" ||
-        declaration.typename.type === "struct"
-      ) {
+      } else if (declaration.typename.type === "struct") {
+        if (getTypeSize(declaration.typename).type !== "static") {
+          error(expression, "Struct is incomplete");
+        }
+        if (declaration.wasmLocalName) {
+          return structs.getLocalStructInfo(declaration);
+        }
+        const getStructAddress = () =>
+          declaration.memoryIsGlobal
+            ? [`i32.const ${declaration.memoryOffset}`]
+            : [
+                `local.get $ebp`,
+                `i32.const ${declaration.memoryOffset}`,
+                `i32.add`,
+              ];
+        return {
+          type: declaration.typename,
+          staticValue: null,
+          value: structs.getStructValueFromAddress(
+            declaration.typename,
+            getStructAddress
+          ),
+          address: getStructAddress,
+        };
+      } else if (declaration.typename.type === "enum") {
         error(declaration, "TODO, not implemented yett");
       } else if (declaration.typename.type === "void") {
         error(declaration, "Used void declaration");
@@ -310,10 +643,14 @@ export function createExpressionAndTypes(
       }
       if (
         indexInfo.type.arithmeticType !== "int" &&
-        indexInfo.type.arithmeticType !== "char"
+        indexInfo.type.arithmeticType !== "char" &&
+        indexInfo.type.arithmeticType !== "long long"
       ) {
-        error(index, "Only int/char are supported now");
+        error(index, "Only int/char/long long are supported now");
       }
+      // Addresses are 32-bits, so 64-bits index is wrapped
+      const indexToAddressCode =
+        indexInfo.type.arithmeticType === "long long" ? [`i32.wrap_i64`] : [];
       if (targetInfo.type.type === "array") {
         const elementsSize = getTypeSize(targetInfo.type.elementsTypename);
         if (elementsSize.type !== "static") {
@@ -342,19 +679,26 @@ export function createExpressionAndTypes(
         const getArrayElementAddress = () => {
           const indexOffset: WAInstuction[] = [
             ...getIndexValue(),
+            ...indexToAddressCode,
             ...elementSizeMultiply,
           ];
           return [...getArrayAddress(), ...indexOffset, `i32.add`];
         };
 
         const elementsTypename = targetInfo.type.elementsTypename;
-        const getArrayElementValue = isScalar(elementsTypename)
+        const elementsRegister = getRegisterForTypename(elementsTypename);
+        const getArrayElementValue = elementsRegister
           ? () => [
               ...getArrayElementAddress(),
               // We might know alignment if we know array size
               // For example, if elements size >= 4, then alignment could be equal 2
-              loadScalar(elementsTypename, "i32", 0, 0),
+              loadScalar(elementsTypename, elementsRegister, 0, 0),
             ]
+          : elementsTypename.type === "struct"
+          ? structs.getStructValueFromAddress(
+              elementsTypename,
+              getArrayElementAddress
+            )
           : null;
 
         return {
@@ -391,19 +735,26 @@ export function createExpressionAndTypes(
         const getArrayElementAddress = () => {
           const indexOffset: WAInstuction[] = [
             ...getIndexValue(),
+            ...indexToAddressCode,
             ...elementSizeMultiply,
           ];
           return [...getPointerTargetAddress(), ...indexOffset, `i32.add`];
         };
 
         const elementsTypename = targetInfo.type.pointsTo;
-        const getArrayElementValue = isScalar(elementsTypename)
+        const elementsRegister = getRegisterForTypename(elementsTypename);
+        const getArrayElementValue = elementsRegister
           ? () => [
               ...getArrayElementAddress(),
               // We might know alignment if we know array size
               // For example, if elements size >= 4, then alignment could be equal 2
-              loadScalar(elementsTypename, "i32", 0, 0),
+              loadScalar(elementsTypename, elementsRegister, 0, 0),
             ]
+          : elementsTypename.type === "struct"
+          ? structs.getStructValueFromAddress(
+              elementsTypename,
+              getArrayElementAddress
+            )
           : null;
 
         return {
@@ -416,6 +767,17 @@ export function createExpressionAndTypes(
         error(target, "Must be array or pointer type");
       }
     } else if (expression.type === "function call") {
+      const builtinDeclaration =
+        expression.target.type === "identifier"
+          ? getDeclaration(expression.target.declaratorNodeId)
+          : undefined;
+      const builtin =
+        builtinDeclaration && builtinDeclaration.isBuiltin
+          ? getBuiltinFunction(builtinDeclaration.identifier)
+          : undefined;
+      if (builtin) {
+        return getBuiltinCallInfo(expression, builtin);
+      }
       const targetInfo = getExpressionInfo(expression.target);
       if (targetInfo.type.type !== "function") {
         error(expression.target, "Must be a function");
@@ -437,6 +799,7 @@ export function createExpressionAndTypes(
       }
 
       const argsValueGetters: (() => WAInstuction[])[] = [];
+      const argsRegisters: RegisterType[] = [];
       for (let idx = 0; idx < expression.args.length; idx++) {
         const arg = expression.args[idx];
         const paramDefinition = func.parameters[idx];
@@ -447,37 +810,70 @@ export function createExpressionAndTypes(
           error(arg, `Non-register params are not supported yet`);
         }
 
-        const paramDefinitionRegister = getRegisterForTypename(
+        const paramTypename =
           paramDefinition.type === "declarator"
             ? paramDefinition.typename
-            : paramDefinition
-        );
+            : paramDefinition;
+        const paramDefinitionRegister = getRegisterForTypename(paramTypename);
         if (!paramDefinitionRegister) {
           error(arg, `Non-register params are not supportetd yet1`);
         }
-        if (paramDefinitionRegister !== funcArgRegister) {
-          error(arg, `Register promotion is not supported yet`);
-        }
 
         const argValue = argInfo.value;
         if (!argValue) {
           error(arg, `Must have a value for register param`);
         }
-        argsValueGetters.push(argValue);
+        // Argument is converted as if by assignment (6.5.2.2)
+        const argConversion = convertScalarRegister(
+          argInfo.type,
+          paramTypename
+        );
+        argsValueGetters.push(() => [...argValue(), ...argConversion]);
+        argsRegisters.push(paramDefinitionRegister);
       }
 
       const waTypeName = helpers.functionSignatures.getFunctionTypeName(func);
 
+      // Call by function name is a direct call, the same rule is used
+      //  in reachability analysis
+      const targetDeclaration =
+        expression.target.type === "identifier"
+          ? getDeclaration(expression.target.declaratorNodeId)
+          : null;
+      const knownTargets =
+        targetDeclaration && targetDeclaration.typename.type === "function"
+          ? { targets: [targetDeclaration], exact: true }
+          : getKnownCallTargets(expression.target);
+      const directCallTarget =
+        knownTargets && knownTargets.exact ? knownTargets.targets[0] : null;
+      const results = getRegistersForTypename(func.returnType);
+      const guardedCallTargets =
+        knownTargets && !knownTargets.exact && results && results.length <= 1
+          ? knownTargets.targets
+          : null;
+
       return {
         type: func.returnType,
         address: null,
         staticValue: null,
         value: () => {
+          if (guardedCallTargets && results) {
+            return getGuardedCallCode(
+              guardedCallTargets,
+              targetInfoValue,
+              argsValueGetters,
+              argsRegisters,
+              results,
+              waTypeName
+            );
+          }
           const functionValueCode: WAInstuction[] = [];
           argsValueGetters.forEach((f) => functionValueCode.push(...f()));
 
-          if (targetInfo.staticValue) {
-            functionValueCode.push(`call ${targetInfo.staticValue}`);
+          if (directCallTarget) {
+            functionValueCode.push(
+              `call ${getFunctionWaName(directCallTarget.declaratorId)}`
+            );
           } else {
             functionValueCode.push(...targetInfoValue());
             functionValueCode.push(`call_indirect (type ${waTypeName})`);
@@ -508,13 +904,8 @@ export function createExpressionAndTypes(
       if (!rightRegister) {
         error(expression.right, "Must have a value");
       }
-      if (leftRegister !== "i32") {
-        error(expression.left, "TODO: Not suppoertted yet");
-      }
-      if (rightRegister !== "i32") {
-        error(expression.right, "TODO: Not suppoertted yet");
-      }
-
+      checkNotVector(expression.left, leftRegister);
+      checkNotVector(expression.right, rightRegister);
       const finalType = (() => {
         if (leftInfo.type.type === "pointer") {
           return leftInfo.type;
@@ -522,23 +913,18 @@ export function createExpressionAndTypes(
         if (rightInfo.type.type === "pointer") {
           return rightInfo.type;
         }
-
-        const leftSize = getTypeSize(leftInfo.type);
-        const rightSize = getTypeSize(leftInfo.type);
-        if (leftSize.type !== "static") {
-          error(expression.left, "Inernal error final type left");
-        }
-        if (rightSize.type !== "static") {
-          error(expression.right, "Inernal error final type left");
-        }
-        if (leftSize.value >= rightSize.value) {
-          // TODO: Signed or unsigned!
-          return leftInfo.type;
-        } else {
-          return rightInfo.type;
-        }
+        return getCommonArithmeticType(leftInfo.type, rightInfo.type);
       })();
 
+      // Result of comparison and logical operators is int 0 or 1
+      const booleanType: Typename = {
+        type: "arithmetic",
+        arithmeticType: "int",
+        signedUnsigned: null,
+        const: true,
+      };
+      cloneLocation(expression, booleanType);
+
       if (
         op === "*" ||
         op === "/" ||
@@ -557,8 +943,39 @@ export function createExpressionAndTypes(
         op === ">=" ||
         op === "^"
       ) {
+        const isComparison =
+          op === "==" ||
+          op === "!=" ||
+          op === "<" ||
+          op === "<=" ||
+          op === ">" ||
+          op === ">=";
+        const isFloating =
+          isFloatingRegister(leftRegister) || isFloatingRegister(rightRegister);
+        if (
+          isFloating &&
+          (leftInfo.type.type === "pointer" ||
+            rightInfo.type.type === "pointer")
+        ) {
+          error(expression, "Invalid operands, pointer and floating type");
+        }
+        // Shift have type of left operand, other operators are done
+        //  in common type of both operands
+        const operandsType =
+          op === "<<" || op === ">>" ? leftInfo.type : finalType;
+        const register = getRegisterForTypename(operandsType) as RegisterType;
+        const leftConversion = convertScalarRegister(
+          leftInfo.type,
+          operandsType
+        );
+        const rightConversion = convertScalarRegister(
+          rightInfo.type,
+          operandsType
+        );
+
+        // Compilation-time values are 32-bits only
         const staticValue =
-          leftInfo.staticValue && rightInfo.staticValue
+          register === "i32" && leftInfo.staticValue && rightInfo.staticValue
             ? op === "*"
               ? leftInfo.staticValue * rightInfo.staticValue
               : op === "/"
@@ -618,54 +1035,55 @@ export function createExpressionAndTypes(
           finalType.type === "arithmetic" &&
           finalType.signedUnsigned === "signed";
 
-        const operatorInstructions: WAInstuction[] =
-          op === "*"
-            ? ["i32.mul"]
-            : op === "/"
-            ? finalSigned
-              ? ["i32.div_s"]
-              : ["i32.div_u"]
-            : op === "%"
-            ? finalSigned
-              ? ["i32.rem_s"]
-              : ["i32.rem_u"]
-            : op === "+"
-            ? ["i32.add"]
-            : op === "-"
-            ? ["i32.sub"]
-            : op === "&"
-            ? ["i32.and"]
-            : op === "|"
-            ? ["i32.or"]
-            : op === "<<"
-            ? ["i32.shl"]
-            : op === ">>"
-            ? leftSigned
-              ? ["i32.shr_s"]
-              : ["i32.shr_u"]
-            : op === "=="
-            ? ["i32.eq"]
-            : op === "!="
-            ? ["i32.ne"]
-            : op === "<"
-            ? anySigned
-              ? ["i32.lt_s"]
-              : ["i32.lt_u"]
-            : op === "<="
-            ? anySigned
-              ? ["i32.le_s"]
-              : ["i32.le_u"]
-            : op === ">"
-            ? anySigned
-              ? ["i32.gt_s"]
-              : ["i32.gt_u"]
-            : op === ">="
-            ? anySigned
-              ? ["i32.ge_s"]
-              : ["i32.ge_u"]
-            : op === "^"
-            ? ["i32.xor"]
-            : assertNever(op);
+        const operatorInstructions: WAInstuction[] = isFloating
+          ? [`${register}.${getFloatingOperator(expression)}`]
+          : op === "*"
+          ? [`${register}.mul`]
+          : op === "/"
+          ? finalSigned
+            ? [`${register}.div_s`]
+            : [`${register}.div_u`]
+          : op === "%"
+          ? finalSigned
+            ? [`${register}.rem_s`]
+            : [`${register}.rem_u`]
+          : op === "+"
+          ? [`${register}.add`]
+          : op === "-"
+          ? [`${register}.sub`]
+          : op === "&"
+          ? [`${register}.and`]
+          : op === "|"
+          ? [`${register}.or`]
+          : op === "<<"
+          ? [`${register}.shl`]
+          : op === ">>"
+          ? leftSigned
+            ? [`${register}.shr_s`]
+            : [`${register}.shr_u`]
+          : op === "=="
+          ? [`${register}.eq`]
+          : op === "!="
+          ? [`${register}.ne`]
+          : op === "<"
+          ? anySigned
+            ? [`${register}.lt_s`]
+            : [`${register}.lt_u`]
+          : op === "<="
+          ? anySigned
+            ? [`${register}.le_s`]
+            : [`${register}.le_u`]
+          : op === ">"
+          ? anySigned
+            ? [`${register}.gt_s`]
+            : [`${register}.gt_u`]
+          : op === ">="
+          ? anySigned
+            ? [`${register}.ge_s`]
+            : [`${register}.ge_u`]
+          : op === "^"
+          ? [`${register}.xor`]
+          : assertNever(op);
 
         let rightMultiplyForPointerAddOrSub: WAInstuction[] = [];
         if (
@@ -696,13 +1114,15 @@ export function createExpressionAndTypes(
         }
 
         return {
-          type: finalType,
+          type: isComparison ? booleanType : operandsType,
           staticValue: staticValue,
           address: null,
           value: () => {
             return [
               ...getLeftValue(),
+              ...leftConversion,
               ...getRightValue(),
+              ...rightConversion,
               ...rightMultiplyForPointerAddOrSub,
               ...operatorInstructions,
             ];
@@ -710,7 +1130,7 @@ export function createExpressionAndTypes(
         };
       } else if (op === "||") {
         return {
-          type: finalType,
+          type: booleanType,
           staticValue: null,
           address: null,
           value: () => {
@@ -720,8 +1140,10 @@ export function createExpressionAndTypes(
               "i32.const 1",
 
               ...getLeftValue(),
+              ...scalarToCondition(leftInfo.type),
               "br_if 0",
               ...getRightValue(),
+              ...scalarToCondition(rightInfo.type),
               "br_if 0",
 
               // Not very optimal
@@ -735,7 +1157,7 @@ export function createExpressionAndTypes(
         };
       } else if (op === "&&") {
         return {
-          type: finalType,
+          type: booleanType,
           staticValue: null,
           address: null,
           value: () => {
@@ -745,9 +1167,11 @@ export function createExpressionAndTypes(
               "i32.const 0",
 
               ...getLeftValue(),
+              ...scalarToCondition(leftInfo.type),
               "i32.eqz",
               "br_if 0",
               ...getRightValue(),
+              ...scalarToCondition(rightInfo.type),
               "i32.eqz",
               "br_if 0",
 
@@ -763,10 +1187,99 @@ export function createExpressionAndTypes(
       } else {
         assertNever(op);
       }
+    } else if (
+      expression.type === "struct access" ||
+      expression.type === "struct pointer access"
+    ) {
+      const targetInfo = getExpressionInfo(expression.target);
+      if (expression.type === "struct access") {
+        if (targetInfo.type.type !== "struct") {
+          error(expression.target, "Must be a struct");
+        }
+        if (
+          expression.target.type === "identifier" &&
+          getDeclaration(expression.target.declaratorNodeId).wasmLocalName
+        ) {
+          return structs.getLocalMemberInfo(
+            expression,
+            getDeclaration(expression.target.declaratorNodeId),
+            expression.identifier
+          );
+        }
+        return structs.getMemberInfo(
+          expression,
+          targetInfo.type,
+          expression.identifier,
+          targetInfo.address,
+          targetInfo.value
+        );
+      }
+      if (
+        targetInfo.type.type !== "pointer" ||
+        targetInfo.type.pointsTo.type !== "struct"
+      ) {
+        error(expression.target, "Must be a pointer to struct");
+      }
+      if (!targetInfo.value) {
+        error(expression.target, "Must have a value");
+      }
+      return structs.getMemberInfo(
+        expression,
+        targetInfo.type.pointsTo,
+        expression.identifier,
+        targetInfo.value,
+        null
+      );
     } else if (expression.type === "assignment") {
       const lvalueInfo = getExpressionInfo(expression.lvalue);
       const rvalueInfo = getExpressionInfo(expression.rvalue);
 
+      if (lvalueInfo.type.type === "struct") {
+        const structTypename = lvalueInfo.type;
+        if (structTypename.const) {
+          error(expression.lvalue, "Have const modifier, unable to change");
+        }
+        structs.checkSameStruct(expression, structTypename, rvalueInfo.type);
+
+        const newTypeNode: Typename = { ...structTypename, const: true };
+        cloneLocation(structTypename, newTypeNode);
+
+        const assignLvalue = lvalueInfo.assignValue;
+        if (assignLvalue) {
+          // Struct is in WebAssembly locals
+          const getRvalueValue = rvalueInfo.value;
+          if (!getRvalueValue) {
+            error(expression.rvalue, "Struct must have a value");
+          }
+          return {
+            type: newTypeNode,
+            staticValue: null,
+            address: null,
+            value: () => assignLvalue(getRvalueValue()),
+          };
+        }
+
+        const getLvalueAddress = lvalueInfo.address;
+        if (!getLvalueAddress) {
+          error(expression.lvalue, "Lvalue must have an address");
+        }
+        const getAddress = () => [
+          ...structs.getStructCopyCode(
+            expression,
+            structTypename,
+            getLvalueAddress,
+            rvalueInfo
+          ),
+          ...getLvalueAddress(),
+        ];
+        return {
+          type: newTypeNode,
+          staticValue: null,
+          address: getAddress,
+          value: structs.getStructValueFromAddress(structTypename, getAddress),
+        };
+      }
+
       const lvalueIsInRegister = getRegisterForTypename(lvalueInfo.type);
       if (!lvalueIsInRegister) {
         error(
@@ -775,8 +1288,7 @@ export function createExpressionAndTypes(
         );
       }
 
-      if (lvalueIsInRegister !== getRegisterForTypename(rvalueInfo.type)) {
-        // For example, i32 -> i64
+      if (!getRegisterForTypename(rvalueInfo.type)) {
         error(
           expression.rvalue,
           `Type assigment ${rvalueInfo.type} to ${lvalueInfo.type} is not supported yet`
@@ -787,6 +1299,32 @@ export function createExpressionAndTypes(
         error(expression.lvalue, "Have const modifier, unable to change");
       }
 
+      const getRvalueOwnValue = rvalueInfo.value;
+      if (!getRvalueOwnValue) {
+        error(expression.rvalue, "rvalue must have a value, at least for now");
+      }
+      // For example, i32 -> i64
+      const rvalueConversion = convertScalarRegister(
+        rvalueInfo.type,
+        lvalueInfo.type
+      );
+      const getRvalueValue = () => [...getRvalueOwnValue(), ...rvalueConversion];
+
+      // not modifiable anymore
+      const newTypeNode: Typename = { ...lvalueInfo.type, const: true };
+      cloneLocation(lvalueInfo.type, newTypeNode);
+
+      const assignLvalue = lvalueInfo.assignValue;
+      if (assignLvalue) {
+        // Lvalue is in WebAssembly local, no memory access at all
+        return {
+          address: null,
+          value: () => assignLvalue(getRvalueValue()),
+          staticValue: null,
+          type: newTypeNode,
+        };
+      }
+
       const getLvalueAddress = lvalueInfo.address;
       if (!getLvalueAddress) {
         error(expression.lvalue, "Lvalue must have an address");
@@ -800,11 +1338,6 @@ export function createExpressionAndTypes(
         );
       }
 
-      const getRvalueValue = rvalueInfo.value;
-      if (!getRvalueValue) {
-        error(expression.rvalue, "rvalue must have a value, at least for now");
-      }
-
       const sideEffect = () => {
         return [
           ...getLvalueAddress(),
@@ -815,10 +1348,6 @@ export function createExpressionAndTypes(
         ];
       };
 
-      // not modifiable anymore
-      const newTypeNode: Typename = { ...lvalueInfo.type, const: true };
-      cloneLocation(lvalueInfo.type, newTypeNode);
-
       return {
         address: () => {
           // This should be never used because we add "const" modifier
@@ -852,7 +1381,9 @@ export function createExpressionAndTypes(
         return {
           type: returnType,
           address: null,
-          staticValue: null,
+          // Address of function is its index in table
+          staticValue:
+            targetInfo.type.type === "function" ? targetInfo.staticValue : null,
           value: getTargetAddress,
         };
       } else if (expression.operator === "*") {
@@ -878,6 +1409,8 @@ export function createExpressionAndTypes(
                 ...targetValue(),
                 loadScalar(pointsToType, pointsToRegister),
               ]
+            : pointsToType.type === "struct"
+            ? structs.getStructValueFromAddress(pointsToType, targetValue)
             : null;
         return {
           type: pointsToType,
@@ -896,30 +1429,43 @@ export function createExpressionAndTypes(
         if (!targetRegister) {
           error(expression.target, "Must be a value");
         }
-        if (targetRegister !== "i32") {
-          error(
-            expression.target,
-            `Register ${targetRegister} is not supported yet`
-          );
-        }
+        checkNotVector(expression, targetRegister);
         const targetValue = targetInfo.value;
         if (!targetValue) {
           error(expression.target, "Must have a value");
         }
-        const whatReallyToDo: WAInstuction[] =
-          expression.operator === "~"
-            ? [`i32.const 4294967295`, `i32.xor`]
+        const r = targetRegister;
+        const whatReallyToDo: WAInstuction[] = isFloatingRegister(r)
+          ? expression.operator === "~"
+            ? error(expression, "Operator ~ is not allowed for floating types")
             : expression.operator === "!"
-            ? [`i32.eqz`]
+            ? [`${r}.const 0`, `${r}.eq`]
             : expression.operator === "+"
             ? []
             : expression.operator === "-"
-            ? [`i32.const 4294967295`, `i32.xor`, `i32.const 1`, `i32.add`]
-            : assertNever(expression.operator);
+            ? [`${r}.neg`]
+            : assertNever(expression.operator)
+          : expression.operator === "~"
+          ? [`${r}.const -1`, `${r}.xor`]
+          : expression.operator === "!"
+          ? [`${r}.eqz`]
+          : expression.operator === "+"
+          ? []
+          : expression.operator === "-"
+          ? [`${r}.const -1`, `${r}.xor`, `${r}.const 1`, `${r}.add`]
+          : assertNever(expression.operator);
+
+        const booleanType: Typename = {
+          type: "arithmetic",
+          arithmeticType: "int",
+          signedUnsigned: null,
+          const: true,
+        };
+        cloneLocation(expression, booleanType);
 
         return {
           // TODO: Add a "signed" if operator is "-"
-          type: targetInfo.type,
+          type: expression.operator === "!" ? booleanType : targetInfo.type,
           address: null,
           // TODO
           staticValue: null,
@@ -1001,17 +1547,29 @@ export function createExpressionAndTypes(
       };
     } else if (expression.type === "cast") {
       const targetInfo = getExpressionInfo(expression.target);
-      // TODO: Other casts, change register if needed
+      // TODO: Other casts
       const targetRegister = getRegisterForTypename(targetInfo.type);
-      if (targetRegister !== "i32") {
+      if (!targetRegister) {
         error(expression.target, "TODO: Such casts are not supported yet");
       }
-      if (targetRegister !== getRegisterForTypename(expression.typename)) {
+      const castRegister = getRegisterForTypename(expression.typename);
+      if (!castRegister) {
         error(expression.typename, "TODO: Register change for casting");
       }
+      if ((targetRegister === "v128") !== (castRegister === "v128")) {
+        error(expression, "Vector can be casted only to vector");
+      }
+      if (
+        (targetInfo.type.type === "pointer" ||
+          expression.typename.type === "pointer") &&
+        (isFloatingRegister(targetRegister) || isFloatingRegister(castRegister))
+      ) {
+        error(expression, "Pointer can not be casted to or from floating type");
+      }
       if (
         expression.typename.type === "arithmetic" &&
-        expression.typename.arithmeticType !== "int"
+        (expression.typename.arithmeticType === "char" ||
+          expression.typename.arithmeticType === "short")
       ) {
         error(
           expression.typename,
@@ -1019,11 +1577,29 @@ export function createExpressionAndTypes(
         );
       }
 
+      if (targetRegister !== castRegister) {
+        const targetValue = targetInfo.value;
+        if (!targetValue) {
+          error(expression.target, "Must have a value");
+        }
+        const conversion = convertScalarRegister(
+          targetInfo.type,
+          expression.typename
+        );
+        return {
+          type: expression.typename,
+          staticValue: null,
+          value: () => [...targetValue(), ...conversion],
+          address: null,
+        };
+      }
+
       return {
         type: expression.typename,
         staticValue: targetInfo.staticValue,
         value: targetInfo.value,
         address: targetInfo.address,
+        assignValue: targetInfo.assignValue,
       };
     } else if (
       expression.type === "postfix ++" ||
@@ -1036,6 +1612,7 @@ export function createExpressionAndTypes(
       if (!targetRegister) {
         error(target, "Must be a real type or pointer");
       }
+      checkNotVector(target, targetRegister);
       let howManyToAdd: number;
       if (targetInfo.type.type === "pointer") {
         const pointsToSize = getTypeSize(targetInfo.type.pointsTo);
@@ -1050,15 +1627,30 @@ export function createExpressionAndTypes(
       if (!targetValue) {
         error(target, "Must have a vakue");
       }
-      const targetAddress = targetInfo.address;
-      if (!targetAddress) {
-        error(target, "Not an lvalue");
-      }
       if (targetInfo.type.const) {
         error(target, "A const modifier is here");
       }
-      if (targetRegister !== "i32") {
-        error(target, "Such register is not supported yet");
+      const assignTarget = targetInfo.assignValue;
+      if (assignTarget) {
+        return {
+          type: targetInfo.type,
+          address: null,
+          staticValue: null,
+          value: () => [
+            // Old value is a result
+            ...targetValue(),
+            ...assignTarget([
+              ...targetValue(),
+              `${targetRegister}.const ${howManyToAdd}`,
+              isPlus ? `${targetRegister}.add` : `${targetRegister}.sub`,
+            ]),
+            "drop",
+          ],
+        };
+      }
+      const targetAddress = targetInfo.address;
+      if (!targetAddress) {
+        error(target, "Not an lvalue");
       }
       return {
         type: targetInfo.type,
@@ -1080,8 +1672,8 @@ export function createExpressionAndTypes(
           ...targetAddress(),
           // So, reading value from address above
           loadScalar(targetInfo.type, targetRegister),
-          `i32.const ${howManyToAdd}`,
-          isPlus ? `i32.add` : "i32.sub",
+          `${targetRegister}.const ${howManyToAdd}`,
+          isPlus ? `${targetRegister}.add` : `${targetRegister}.sub`,
 
           storeScalar(targetInfo.type, targetRegister),
         ],
@@ -1097,6 +1689,7 @@ export function createExpressionAndTypes(
       if (!targetRegister) {
         error(target, "Must be a real type or pointer");
       }
+      checkNotVector(target, targetRegister);
       let howManyToAdd: number;
       if (targetInfo.type.type === "pointer") {
         const pointsToSize = getTypeSize(targetInfo.type.pointsTo);
@@ -1111,15 +1704,26 @@ export function createExpressionAndTypes(
       if (!targetValue) {
         error(target, "Must have a vakue");
       }
-      const targetAddress = targetInfo.address;
-      if (!targetAddress) {
-        error(target, "Not an lvalue");
-      }
       if (targetInfo.type.const) {
         error(target, "A const modifier is here");
       }
-      if (targetRegister !== "i32") {
-        error(target, "Such register is not supported yet");
+      const assignTarget = targetInfo.assignValue;
+      if (assignTarget) {
+        return {
+          type: targetInfo.type,
+          address: null,
+          staticValue: null,
+          value: () =>
+            assignTarget([
+              ...targetValue(),
+              `${targetRegister}.const ${howManyToAdd}`,
+              isPlus ? `${targetRegister}.add` : `${targetRegister}.sub`,
+            ]),
+        };
+      }
+      const targetAddress = targetInfo.address;
+      if (!targetAddress) {
+        error(target, "Not an lvalue");
       }
       return {
         type: targetInfo.type,
@@ -1138,8 +1742,8 @@ export function createExpressionAndTypes(
           ...targetAddress(),
           // So, reading value from address above
           loadScalar(targetInfo.type, targetRegister),
-          `i32.const ${howManyToAdd}`,
-          isPlus ? `i32.add` : "i32.sub",
+          `${targetRegister}.const ${howManyToAdd}`,
+          isPlus ? `${targetRegister}.add` : `${targetRegister}.sub`,
 
           storeScalar(targetInfo.type, targetRegister),
 
@@ -1167,33 +1771,29 @@ export function createExpressionAndTypes(
         error(expression.iftrue, "Iffalse part must have a value");
       }
 
-      if (getRegisterForTypename(conditionInfo.type) !== "i32") {
+      if (!getRegisterForTypename(conditionInfo.type)) {
         error(expression.condition, "Register is not supported");
       }
-      if (getRegisterForTypename(iftrueInfo.type) !== "i32") {
+      if (!getRegisterForTypename(iftrueInfo.type)) {
         error(expression.condition, "Register is not supported");
       }
-      if (getRegisterForTypename(iffalseInfo.type) !== "i32") {
+      if (!getRegisterForTypename(iffalseInfo.type)) {
         error(expression.condition, "Register is not supported");
       }
 
-      const finalType = (() => {
-        // todo: checks
-        const leftSize = getTypeSize(iftrueInfo.type);
-        const rightSize = getTypeSize(iffalseInfo.type);
-        if (leftSize.type !== "static") {
-          error(expression.iftrue, "Inernal error final type left");
-        }
-        if (rightSize.type !== "static") {
-          error(expression.iffalse, "Inernal error final type left");
-        }
-        if (leftSize.value >= rightSize.value) {
-          // TODO: Signed or unsigned!
-          return iftrueInfo.type;
-        } else {
-          return iffalseInfo.type;
-        }
-      })();
+      // todo: checks
+      const finalType = getCommonArithmeticType(
+        iftrueInfo.type,
+        iffalseInfo.type
+      );
+      const iftrueConversion = convertScalarRegister(
+        iftrueInfo.type,
+        finalType
+      );
+      const iffalseConversion = convertScalarRegister(
+        iffalseInfo.type,
+        finalType
+      );
 
       return {
         type: finalType,
@@ -1201,10 +1801,13 @@ export function createExpressionAndTypes(
         staticValue: null,
         value: () => [
           ...conditionValue(),
-          `if (result i32)`,
+          ...scalarToCondition(conditionInfo.type),
+          `if (result ${getRegisterForTypename(finalType)})`,
           ...iftrueValue(),
+          ...iftrueConversion,
           "else",
           ...iffalseValue(),
+          ...iffalseConversion,
           "end",
         ],
       };
@@ -1219,5 +1822,7 @@ export function createExpressionAndTypes(
     getTypeSize,
 
     getExpressionInfo,
+
+    structs,
   };
 }
@@ -0,0 +1,144 @@
+import {
+  CompoundStatementBody,
+  DeclaratorId,
+  ExpressionNode,
+  InitializerNode,
+} from "./parser.definitions";
+import { assertNever } from "./assertNever";
+
+/**
+ * Returns declarators which address might be taken inside function body.
+ * Only those variables must live in memory, all other scalars can be kept
+ *   in WebAssembly locals.
+ *
+ * It is a conservative check: we do not know types here, so
+ *   everything which can be a source of address for unary "&" is marked
+ */
+export function findAddressTakenDeclarations(
+  body: CompoundStatementBody[]
+): Set<DeclaratorId> {
+  const addressTaken = new Set<DeclaratorId>();
+
+  /** Marks declarations which address is a result of this expression */
+  function markAddressSource(expression: ExpressionNode) {
+    if (expression.type === "identifier") {
+      addressTaken.add(expression.declaratorNodeId);
+    } else if (expression.type === "cast") {
+      markAddressSource(expression.target);
+    } else if (expression.type === "assignment") {
+      markAddressSource(expression.lvalue);
+    } else if (expression.type === "subscript operator") {
+      markAddressSource(expression.target);
+    } else if (
+      expression.type === "struct access" ||
+      expression.type === "struct pointer access"
+    ) {
+      markAddressSource(expression.target);
+    } else if (expression.type === "expression with sideeffect") {
+      markAddressSource(expression.effectiveValue);
+    }
+    // Other expressions have no address or their address is a value of pointer
+  }
+
+  function checkExpression(expression: ExpressionNode): void {
+    if (
+      expression.type === "identifier" ||
+      expression.type === "const" ||
+      expression.type === "string-literal" ||
+      expression.type === "sizeof typename"
+    ) {
+      return;
+    } else if (expression.type === "subscript operator") {
+      checkExpression(expression.target);
+      checkExpression(expression.index);
+    } else if (expression.type === "function call") {
+      checkExpression(expression.target);
+      expression.args.forEach((arg) => checkExpression(arg));
+    } else if (
+      expression.type === "struct access" ||
+      expression.type === "struct pointer access" ||
+      expression.type === "postfix ++" ||
+      expression.type === "postfix --" ||
+      expression.type === "prefix ++" ||
+      expression.type === "prefix --" ||
+      expression.type === "cast"
+    ) {
+      checkExpression(expression.target);
+    } else if (expression.type === "unary-operator") {
+      if (expression.operator === "&") {
+        markAddressSource(expression.target);
+      }
+      checkExpression(expression.target);
+    } else if (expression.type === "sizeof expression") {
+      checkExpression(expression.expression);
+    } else if (expression.type === "binary operator") {
+      checkExpression(expression.left);
+      checkExpression(expression.right);
+    } else if (expression.type === "conditional expression") {
+      checkExpression(expression.condition);
+      checkExpression(expression.iftrue);
+      checkExpression(expression.iffalse);
+    } else if (expression.type === "assignment") {
+      checkExpression(expression.lvalue);
+      checkExpression(expression.rvalue);
+    } else if (expression.type === "expression with sideeffect") {
+      checkExpression(expression.sizeeffect);
+      checkExpression(expression.effectiveValue);
+    } else {
+      assertNever(expression);
+    }
+  }
+
+  function checkInitializer(initializer: InitializerNode): void {
+    if (initializer.type === "assigmnent-expression") {
+      checkExpression(initializer.expression);
+    } else {
+      initializer.items.forEach((item) => checkInitializer(item));
+    }
+  }
+
+  function checkBlock(block: CompoundStatementBody[]): void {
+    for (const statement of block) {
+      if (statement.type === "declarator") {
+        if (statement.initializer) {
+          checkInitializer(statement.initializer);
+        }
+      } else if (
+        statement.type === "noop" ||
+        statement.type === "break" ||
+        statement.type === "continue"
+      ) {
+        // Nothing here
+      } else if (statement.type === "return") {
+        if (statement.expression) {
+          checkExpression(statement.expression);
+        }
+      } else if (statement.type === "expression") {
+        checkExpression(statement.expression);
+      } else if (statement.type === "compound-statement") {
+        checkBlock(statement.body);
+      } else if (statement.type === "if") {
+        checkExpression(statement.condition);
+        checkBlock([statement.iftrue]);
+        if (statement.iffalse) {
+          checkBlock([statement.iffalse]);
+        }
+      } else if (statement.type === "while" || statement.type === "dowhile") {
+        checkExpression(statement.condition);
+        checkBlock([statement.body]);
+      } else if (statement.type === "switch") {
+        checkExpression(statement.expression);
+        checkBlock([statement.body]);
+      } else if (statement.type === "case" || statement.type === "default") {
+        // Case value is a constant expression
+        checkBlock([statement.body]);
+      } else {
+        assertNever(statement);
+      }
+    }
+  }
+
+  checkBlock(body);
+
+  return addressTaken;
+}
@@ -4,19 +4,47 @@ import {
   FunctionDefinition,
   CompoundStatementBody,
   Statement,
+  Typename,
+  SwitchStatement,
+  CaseStatement,
+  DefaultStatement,
+  DeclaratorNode,
+  ExpressionNode,
 } from "./parser.definitions";
-import { WAInstuction } from "./emitter.definitions";
+import {
+  WAInstuction,
+  WAFunction,
+  WALocal,
+  RegisterType,
+  ExpressionInfo,
+} from "./emitter.definitions";
 import {
   getRegisterForTypename as getRegisterFromTypename,
+  getRegistersForTypename,
   writeEspCode,
   readEspCode,
+  getFunctionWaName,
 } from "./emitter.utils";
 import {
   TypeSizeGetter,
   ExpressionInfoGetter,
 } from "./emitter.expressionsandtypes";
+import { Structs } from "./emitter.structs";
 import { assertNever } from "./assertNever";
-import { storeScalar } from "./emitter.scalar.storeload";
+import { parseInstructions } from "./emitter.instructions";
+import {
+  storeScalar,
+  narrowScalarInRegister,
+} from "./emitter.scalar.storeload";
+import { convertScalarRegister, scalarToCondition } from "./emitter.scalar";
+import { findAddressTakenDeclarations } from "./emitter.functionscode.addresstaken";
+import { createInitializers } from "./emitter.initializers";
+import {
+  Instrumentation,
+  getInstrumentationLocals,
+  getInstrumentationPrologue,
+  getInstrumentationEpilogue,
+} from "./emitter.instrumentation";
 
 /**
  * Small helper to unwrap compound-statement
@@ -31,28 +59,104 @@ function statementToCompoundStatementBody(
   }
 }
 
+/** Bigger initializers are copied by memory.copy or memory.fill */
+const MAX_UNROLLED_COPY_WORDS = 8;
+
+/**
+ * Only those types are supported by narrowScalarInRegister
+ */
+function canBeKeptInWasmLocal(typename: Typename) {
+  return (
+    typename.type === "pointer" ||
+    typename.type === "vector" ||
+    (typename.type === "arithmetic" && typename.arithmeticType !== "short")
+  );
+}
+
+export interface FunctionCodeOptions {
+  /** Calls in return statements of frameless functions are tail calls */
+  tailCalls?: boolean;
+  /** Adds profiling hooks, tail calls are not used then */
+  instrumentation?: Instrumentation;
+}
+
 export function createFunctionCodeGenerator(
   helpers: EmitterHelpers,
   getTypeSize: TypeSizeGetter,
-  getExpressionInfo: ExpressionInfoGetter
+  getExpressionInfo: ExpressionInfoGetter,
+  /** Places bytes into global memory and returns address */
+  allocateTemplate: (bytes: number[], comment: string) => number,
+  structs: Structs,
+  options: FunctionCodeOptions = {}
 ) {
   const { warn, getDeclaration } = helpers;
+  const { completeArraySize, getInitializerData } = createInitializers(
+    helpers,
+    getTypeSize,
+    getExpressionInfo,
+    structs
+  );
 
   function error(node: Node, msg: string): never {
     helpers.error(node, msg);
   }
 
-  function createFunctionCode(func: FunctionDefinition): WAInstuction[] {
+  function createFunctionCode(func: FunctionDefinition): WAFunction {
     const functionTypename = helpers.functionSignatures.getFunctionTypeName(
       func.declaration.typename
     );
 
+    // Drop leftovers, for example from global initializers
+    helpers.takeScratchLocals();
+
+    const addressTakenDeclarations = findAddressTakenDeclarations(func.body);
+    const paramsDeclarationIds = new Set(
+      func.declaration.typename.parameters.map((param) =>
+        param.type === "declarator" ? param.declaratorId : null
+      )
+    );
+    const wasmLocals: WALocal[] = [];
+
     let functionDataStackOffset = 0;
     for (const declarationId of func.declaredVariables) {
       const declaration = getDeclaration(declarationId);
-      if (declaration.storageSpecifier === "typedef") {
+      if (
+        declaration.storageSpecifier === "typedef" ||
+        declaration.memoryIsGlobal
+      ) {
+        // Static variables are already placed into global memory
+        continue;
+      }
+
+      completeArraySize(declaration);
+      if (
+        !addressTakenDeclarations.has(declarationId) &&
+        declaration.typename.type === "struct" &&
+        getRegistersForTypename(declaration.typename)
+      ) {
+        // Every member of small struct is a separate WebAssembly local
+        declaration.wasmLocalName = `$L${declarationId}`;
+        wasmLocals.push(...structs.getMemberLocals(declaration));
+        continue;
+      }
+      if (
+        !addressTakenDeclarations.has(declarationId) &&
+        canBeKeptInWasmLocal(declaration.typename)
+      ) {
+        if (paramsDeclarationIds.has(declarationId)) {
+          // Parameter is already a WebAssembly local
+          declaration.wasmLocalName = `$P${declarationId}`;
+        } else {
+          declaration.wasmLocalName = `$L${declarationId}`;
+          wasmLocals.push({
+            name: declaration.wasmLocalName,
+            type: getRegisterFromTypename(declaration.typename) as RegisterType,
+            sourceName: declaration.identifier,
+          });
+        }
         continue;
       }
+
       const size = getTypeSize(declaration.typename);
       if (size.type !== "static") {
         error(declaration, "Dynamic or incomplete size is not supported yet");
@@ -73,26 +177,70 @@ export function createFunctionCodeGenerator(
       functionDataStackOffset += alignedFunctionStackOffset;
     }
 
-    const functionReturnsInRegister = getRegisterFromTypename(
-      func.declaration.typename.returnType
-    );
-    if (
-      functionReturnsInRegister === null &&
-      func.declaration.typename.returnType.type !== "void"
-    ) {
-      error(
-        func.declaration.typename.returnType,
-        "This return type is not supported yet"
+    const returnType = func.declaration.typename.returnType;
+    const functionResults = getRegistersForTypename(returnType);
+    if (!functionResults) {
+      error(returnType, "This return type is not supported yet");
+    }
+    const functionReturnsInRegister =
+      functionResults.length === 1 ? functionResults[0] : null;
+    /**
+     * Small struct is returned as multiple values. Block with multiple
+     *   results needs a type, so values are kept in locals until the end
+     */
+    const resultLocals: WALocal[] =
+      functionResults.length > 1
+        ? functionResults.map((type, index) => ({ name: `$R${index}`, type }))
+        : [];
+
+    /**
+     * Call in return statement is a tail call if there is no frame to release
+     *   and callee returns value in the same register, so no conversion.
+     * Builtins are not calls, they are left as is
+     */
+    function getTailCallCode(
+      expression: ExpressionNode,
+      info: ExpressionInfo
+    ): WAInstuction[] | null {
+      if (
+        !options.tailCalls ||
+        options.instrumentation ||
+        functionDataStackOffset > 0 ||
+        expression.type !== "function call" ||
+        !info.value ||
+        (info.type.type === "struct"
+          ? returnType.type !== "struct" ||
+            info.type.definition !== returnType.definition
+          : getRegisterFromTypename(info.type) !== functionReturnsInRegister)
+      ) {
+        return null;
+      }
+      const code = info.value();
+      const call = code[code.length - 1];
+      if (/^call(_indirect)? /.test(call)) {
+        return [...code.slice(0, -1), `return_${call} ;; Tail call`];
+      }
+      // Every branch of guarded call ends with a call
+      let guardIndex = code.length - 1;
+      while (guardIndex >= 0 && !/;; Guarded call$/.test(code[guardIndex])) {
+        guardIndex--;
+      }
+      if (call !== "end" || guardIndex < 0) {
+        return null;
+      }
+      return code.map((instruction, index) =>
+        index > guardIndex && /^call(_indirect)? /.test(instruction)
+          ? `return_${instruction} ;; Tail call`
+          : instruction
       );
     }
 
     function createFunctionCodeForBlock(
       body: CompoundStatementBody[],
       returnBrDepth: number,
-      continueBrDepth: number | null
+      continueBrDepth: number | null,
+      breakBrDepth: number | null
     ): WAInstuction[] {
-      const breakBrDepth =
-        continueBrDepth !== null ? continueBrDepth + 1 : null;
       const code: WAInstuction[] = [];
       let returnFound = false;
       for (const statement of body) {
@@ -100,26 +248,90 @@ export function createFunctionCodeGenerator(
           warn(statement, "Unreachable code detected");
           continue;
         }
+        code.push(...helpers.getLocationMarker(statement));
 
         if (statement.type === "noop") {
           code.push("nop ;; noop statement");
         } else if (statement.type === "declarator") {
           // TODO: Dynamic arrays case
 
+          if (statement.memoryIsGlobal) {
+            // Initialized by data segment
+            continue;
+          }
           if (statement.initializer) {
-            if (statement.initializer.type === "initializer-list") {
-              error(statement.initializer, "Not supported yet");
+            if (
+              statement.initializer.type === "initializer-list" &&
+              statement.wasmLocalName
+            ) {
+              code.push(...createLocalStructInitializerCode(statement));
+            } else if (statement.initializer.type === "initializer-list") {
+              code.push(...createInitializerListCode(statement));
             } else if (statement.initializer.type === "assigmnent-expression") {
-              if (statement.memoryIsGlobal) {
-                continue;
-              }
               const initializerInfo = getExpressionInfo(
                 statement.initializer.expression
               );
 
+              if (
+                statement.typename.type === "struct" &&
+                statement.wasmLocalName
+              ) {
+                structs.checkSameStruct(
+                  statement.initializer.expression,
+                  statement.typename,
+                  initializerInfo.type
+                );
+                if (!initializerInfo.value) {
+                  error(statement.initializer.expression, "Must be a value");
+                }
+                code.push(
+                  `;; Initializer for local ${statement.identifier} id=${statement.declaratorId}`,
+                  ...initializerInfo.value(),
+                  ...structs
+                    .getMemberLocals(statement)
+                    .map((local) => `local.set ${local.name}`)
+                    .reverse()
+                );
+                continue;
+              }
+              if (statement.typename.type === "struct") {
+                const memoryOffset = statement.memoryOffset;
+                code.push(
+                  `;; Initializer for local ${statement.identifier} id=${statement.declaratorId}`,
+                  ...structs.getStructCopyCode(
+                    statement.initializer.expression,
+                    statement.typename,
+                    () => [
+                      "local.get $ebp",
+                      `i32.const ${memoryOffset}`,
+                      "i32.add",
+                    ],
+                    initializerInfo
+                  )
+                );
+                continue;
+              }
               if (!initializerInfo.value) {
                 error(statement.initializer.expression, "Must return a value");
               }
+              const register = getRegisterFromTypename(statement.typename);
+              if (!register) {
+                error(statement, "TODO: Only scalars can be initialized");
+              }
+              const conversion = convertScalarRegister(
+                initializerInfo.type,
+                statement.typename
+              );
+              if (statement.wasmLocalName) {
+                code.push(
+                  `;; Initializer for local ${statement.identifier} id=${statement.declaratorId}`,
+                  ...initializerInfo.value(),
+                  ...conversion,
+                  ...narrowScalarInRegister(statement.typename),
+                  `local.set ${statement.wasmLocalName}`
+                );
+                continue;
+              }
               if (statement.memoryOffset === undefined) {
                 throw new Error(
                   `Internal error: statement.memoryOffset is undefined`
@@ -132,8 +344,14 @@ export function createFunctionCodeGenerator(
                 `local.get $ebp ;;  address, first part`,
 
                 ...initializerInfo.value(),
-                // Everything have 4-bytes alignment, so it is ok to load 8 bytes as i32
-                `i32.store offset=${statement.memoryOffset} align=2 `
+                ...conversion,
+                // Everything have 4-bytes alignment
+                storeScalar(
+                  statement.typename,
+                  register,
+                  statement.memoryOffset,
+                  2
+                )
               );
             } else {
               assertNever(statement.initializer);
@@ -161,17 +379,41 @@ export function createFunctionCodeGenerator(
               returnExpressionInfo.type
             );
 
-            if (
-              expressionRegisterType &&
-              expressionRegisterType === functionReturnsInRegister
-            ) {
+            const tailCallCode = getTailCallCode(
+              statement.expression,
+              returnExpressionInfo
+            );
+            if (tailCallCode) {
+              code.push(...tailCallCode);
+            } else if (resultLocals.length > 0) {
+              structs.checkSameStruct(
+                statement.expression,
+                returnType,
+                returnExpressionInfo.type
+              );
+              if (!returnExpressionInfo.value) {
+                error(statement.expression, "Struct must have a value");
+              }
+              code.push(
+                ...returnExpressionInfo.value(),
+                ...resultLocals
+                  .map((local) => `local.set ${local.name}`)
+                  .reverse()
+              );
+            } else if (expressionRegisterType && functionReturnsInRegister) {
               if (!returnExpressionInfo.value) {
                 error(
                   statement.expression,
                   `Internal error: Type ${returnExpressionInfo.type.type} must have value`
                 );
               }
-              code.push(...returnExpressionInfo.value());
+              code.push(
+                ...returnExpressionInfo.value(),
+                ...convertScalarRegister(
+                  returnExpressionInfo.type,
+                  func.declaration.typename.returnType
+                )
+              );
             } else {
               error(
                 statement.expression,
@@ -184,20 +426,23 @@ export function createFunctionCodeGenerator(
           returnFound = true;
         } else if (statement.type === "expression") {
           const info = getExpressionInfo(statement.expression);
-          // Here we need only side effects
-          if (info.value) {
+          // Here we need only side effects.
+          //  Struct address is one value while struct value can be many
+          const valueRegisters = getRegistersForTypename(info.type);
+          if (info.value && !(info.type.type === "struct" && info.address)) {
             code.push(...info.value());
+            const valuesCount = valueRegisters ? valueRegisters.length : 1;
+            for (let i = 0; i < valuesCount; i++) {
+              code.push("drop");
+            }
           } else if (info.address) {
-            code.push(...info.address());
+            code.push(...info.address(), "drop");
           } else {
             error(
               statement.expression,
               "Internal error: expression must have value or address"
             );
           }
-          if (info.type.type !== "void") {
-            code.push("drop");
-          }
         } else if (statement.type === "compound-statement") {
           // Here is no need to create a block, but we do this just for simplicity
           code.push("block ;; compound-statement");
@@ -205,7 +450,8 @@ export function createFunctionCodeGenerator(
             ...createFunctionCodeForBlock(
               statement.body,
               returnBrDepth + 1,
-              continueBrDepth !== null ? continueBrDepth + 1 : null
+              continueBrDepth !== null ? continueBrDepth + 1 : null,
+              breakBrDepth !== null ? breakBrDepth + 1 : null
             )
           );
           code.push("end ;; compound-statement");
@@ -215,7 +461,7 @@ export function createFunctionCodeGenerator(
           if (!conditionInfo.value) {
             error(statement.condition, "Condition must have a value");
           }
-          if (conditionRegister !== "i32") {
+          if (!conditionRegister) {
             error(
               statement.condition,
               "TODO: register change is not supported yet"
@@ -224,11 +470,13 @@ export function createFunctionCodeGenerator(
 
           code.push(
             ...conditionInfo.value(),
+            ...scalarToCondition(conditionInfo.type),
             "if",
             ...createFunctionCodeForBlock(
               statementToCompoundStatementBody(statement.iftrue),
               returnBrDepth + 1,
-              continueBrDepth !== null ? continueBrDepth + 1 : null
+              continueBrDepth !== null ? continueBrDepth + 1 : null,
+              breakBrDepth !== null ? breakBrDepth + 1 : null
             )
           );
           if (statement.iffalse) {
@@ -237,7 +485,8 @@ export function createFunctionCodeGenerator(
               ...createFunctionCodeForBlock(
                 statementToCompoundStatementBody(statement.iffalse),
                 returnBrDepth + 1,
-                continueBrDepth !== null ? continueBrDepth + 1 : null
+                continueBrDepth !== null ? continueBrDepth + 1 : null,
+                breakBrDepth !== null ? breakBrDepth + 1 : null
               )
             );
           }
@@ -248,7 +497,7 @@ export function createFunctionCodeGenerator(
           if (!conditionInfo.value) {
             error(statement.condition, "Condition must have a value");
           }
-          if (conditionRegister !== "i32") {
+          if (!conditionRegister) {
             error(
               statement.condition,
               "TODO: This register type is not supported yet"
@@ -257,7 +506,10 @@ export function createFunctionCodeGenerator(
           code.push("block ;; while loop 1", "loop ;; while loop 2 ");
 
           code.push(";; Check while condition");
-          code.push(...conditionInfo.value());
+          code.push(
+            ...conditionInfo.value(),
+            ...scalarToCondition(conditionInfo.type)
+          );
           // zero is false, non-zero is true
           // We should break if condition was falsy, so invert it
           code.push("i32.eqz ;; Revert boolean");
@@ -268,7 +520,8 @@ export function createFunctionCodeGenerator(
               statementToCompoundStatementBody(statement.body),
               returnBrDepth + 2,
               // A new loop is here
-              0
+              0,
+              1
             )
           );
 
@@ -279,9 +532,15 @@ export function createFunctionCodeGenerator(
           );
         } else if (statement.type === "dowhile") {
           error(statement, "TODO: Do-while is not implemented yet");
+        } else if (statement.type === "switch") {
+          code.push(
+            ...createSwitchCode(statement, returnBrDepth, continueBrDepth)
+          );
+        } else if (statement.type === "case" || statement.type === "default") {
+          error(statement, "Case label must be directly in switch body");
         } else if (statement.type === "break") {
           if (breakBrDepth === null) {
-            error(statement, `Unable to break - no loop`);
+            error(statement, `Unable to break - no loop or switch`);
           }
           code.push(`br ${breakBrDepth}`);
         } else if (statement.type === "continue") {
@@ -297,32 +556,357 @@ export function createFunctionCodeGenerator(
       return code;
     }
 
+    /**
+     * Local array is copied from read-only template in global memory,
+     *   then values which are not constant are written one by one.
+     *   Zero template is not allocated, the frame is just filled with zeros
+     */
+    function createInitializerListCode(
+      declaration: DeclaratorNode
+    ): WAInstuction[] {
+      if (!declaration.initializer || declaration.memoryOffset === undefined) {
+        error(declaration, "Initializer list is supported only for arrays");
+      }
+      const data = getInitializerData(
+        declaration.typename,
+        declaration.initializer
+      );
+
+      const code: WAInstuction[] = [
+        `;; Initializer for local ${declaration.identifier} id=${declaration.declaratorId}`,
+      ];
+      // Frame and template are both aligned to 4 bytes
+      const wordsCount = Math.ceil(data.bytes.length / 4);
+      const isZero = data.bytes.every((byte) => byte === 0);
+      if (wordsCount > MAX_UNROLLED_COPY_WORDS && isZero) {
+        code.push(
+          "local.get $ebp",
+          `i32.const ${declaration.memoryOffset}`,
+          "i32.add",
+          "i32.const 0",
+          `i32.const ${data.bytes.length}`,
+          "memory.fill"
+        );
+      } else {
+        const templateOffset = allocateTemplate(
+          data.bytes,
+          `Template for local ${declaration.identifier} id=${declaration.declaratorId}`
+        );
+        if (wordsCount <= MAX_UNROLLED_COPY_WORDS) {
+          for (let i = 0; i < wordsCount; i++) {
+            code.push(
+              "local.get $ebp",
+              `i32.const ${templateOffset + i * 4}`,
+              "i32.load align=2",
+              `i32.store offset=${declaration.memoryOffset + i * 4} align=2`
+            );
+          }
+        } else {
+          code.push(
+            "local.get $ebp",
+            `i32.const ${declaration.memoryOffset}`,
+            "i32.add",
+            `i32.const ${templateOffset}`,
+            `i32.const ${data.bytes.length}`,
+            "memory.copy"
+          );
+        }
+      }
+
+      for (const value of data.dynamicValues) {
+        const valueInfo = getExpressionInfo(value.expression);
+        if (!valueInfo.value) {
+          error(value.expression, "Must return a value");
+        }
+        const register = getRegisterFromTypename(value.typename);
+        if (!register) {
+          error(
+            value.expression,
+            "TODO: This register type is not supported yet"
+          );
+        }
+        code.push(
+          "local.get $ebp",
+          ...valueInfo.value(),
+          ...convertScalarRegister(valueInfo.type, value.typename),
+          storeScalar(
+            value.typename,
+            register,
+            declaration.memoryOffset + value.offset
+          )
+        );
+      }
+
+      return code;
+    }
+
+    /**
+     * Members of struct in WebAssembly locals are set one by one,
+     *   missing initializers are zeros
+     */
+    function createLocalStructInitializerCode(
+      declaration: DeclaratorNode
+    ): WAInstuction[] {
+      const initializer = declaration.initializer;
+      if (
+        !initializer ||
+        initializer.type !== "initializer-list" ||
+        declaration.typename.type !== "struct"
+      ) {
+        throw new Error("Internal error: expecting struct initializer list");
+      }
+      const members = structs.getStructLayout(declaration.typename).members;
+      if (initializer.items.length > members.length) {
+        error(initializer.items[members.length], "Too many initializers");
+      }
+      const code: WAInstuction[] = [
+        `;; Initializer for local ${declaration.identifier} id=${declaration.declaratorId}`,
+      ];
+      structs.getMemberLocals(declaration).forEach((local, index) => {
+        const item = initializer.items[index];
+        if (!item) {
+          code.push(
+            ...(local.type === "v128"
+              ? ["i32.const 0", "i32x4.splat"]
+              : [`${local.type}.const 0`]),
+            `local.set ${local.name}`
+          );
+          return;
+        }
+        if (item.type !== "assigmnent-expression") {
+          error(item, "TODO: Braces around scalar initializer");
+        }
+        const memberTypename = members[index].declaration.typename;
+        const valueInfo = getExpressionInfo(item.expression);
+        if (!valueInfo.value || !getRegisterFromTypename(valueInfo.type)) {
+          error(item.expression, "Must be a value");
+        }
+        code.push(
+          ...valueInfo.value(),
+          ...convertScalarRegister(valueInfo.type, memberTypename),
+          ...narrowScalarInRegister(memberTypename),
+          `local.set ${local.name}`
+        );
+      });
+      return code;
+    }
+
+    let switchLocalsCount = 0;
+
+    /**
+     * Switch body is split into segments by case labels. Every segment is
+     *  placed after the end of its own block, so branch out of this block
+     *  jumps to the segment and segments fall through to the next one:
+     *
+     *    block ;; switch, "break" target
+     *      block
+     *        block ;; dispatch
+     *          (br to segment N or to default)
+     *        end
+     *        (segment 0)
+     *      end
+     *      (segment 1)
+     *    end
+     */
+    function createSwitchCode(
+      statement: SwitchStatement,
+      returnBrDepth: number,
+      continueBrDepth: number | null
+    ): WAInstuction[] {
+      const valueInfo = getExpressionInfo(statement.expression);
+      if (!valueInfo.value) {
+        error(statement.expression, "Switch expression must have a value");
+      }
+      if (getRegisterFromTypename(valueInfo.type) !== "i32") {
+        error(
+          statement.expression,
+          "TODO: This register type is not supported yet"
+        );
+      }
+
+      const segments: {
+        labels: (CaseStatement | DefaultStatement)[];
+        body: CompoundStatementBody[];
+      }[] = [];
+      for (const item of statementToCompoundStatementBody(statement.body)) {
+        if (item.type === "case" || item.type === "default") {
+          // "case 1: case 2: x();" is a case with case inside
+          const labels: (CaseStatement | DefaultStatement)[] = [];
+          let labeled: Statement = item;
+          while (labeled.type === "case" || labeled.type === "default") {
+            labels.push(labeled);
+            labeled = labeled.body;
+          }
+          segments.push({ labels, body: [labeled] });
+        } else if (segments.length > 0) {
+          segments[segments.length - 1].body.push(item);
+        } else if (item.type !== "declarator") {
+          warn(item, "Unreachable code detected");
+        }
+      }
+
+      const cases: { value: number; segment: number }[] = [];
+      let defaultSegment: number | null = null;
+      for (
+        let segmentIndex = 0;
+        segmentIndex < segments.length;
+        segmentIndex++
+      ) {
+        for (const label of segments[segmentIndex].labels) {
+          if (label.type === "default") {
+            if (defaultSegment !== null) {
+              error(label, "Duplicate default label");
+            }
+            defaultSegment = segmentIndex;
+            continue;
+          }
+          const labelInfo = getExpressionInfo(label.expression);
+          // Switch value is compared as i32, wider labels are not truncated
+          if (getRegisterFromTypename(labelInfo.type) !== "i32") {
+            error(label.expression, "Case label must be an int constant");
+          }
+          const staticValue = labelInfo.staticValue;
+          if (staticValue === null) {
+            error(label.expression, "Case label must be a constant");
+          }
+          const value = staticValue | 0;
+          if (cases.some((existing) => existing.value === value)) {
+            error(label, `Duplicate case value ${value}`);
+          }
+          cases.push({ value, segment: segmentIndex });
+        }
+      }
+      cases.sort((a, b) => a.value - b.value);
+
+      const switchLocalName = `$switch${switchLocalsCount++}`;
+      wasmLocals.push({ name: switchLocalName, type: "i32" });
+
+      const code: WAInstuction[] = [
+        ";; switch",
+        ...valueInfo.value(),
+        `local.set ${switchLocalName}`,
+      ];
+      if (segments.length === 0) {
+        return code;
+      }
+
+      // From dispatch block segment N is "br N" and exit is "br segments.length"
+      const defaultTarget =
+        defaultSegment !== null ? defaultSegment : segments.length;
+
+      const createCompareTree = (
+        from: number,
+        to: number,
+        depth: number
+      ): WAInstuction[] => {
+        if (to - from <= 3) {
+          const tree: WAInstuction[] = [];
+          for (let i = from; i < to; i++) {
+            tree.push(
+              `local.get ${switchLocalName}`,
+              `i32.const ${cases[i].value}`,
+              "i32.eq",
+              `br_if ${cases[i].segment + depth} ;; case ${cases[i].value}`
+            );
+          }
+          tree.push(`br ${defaultTarget + depth} ;; default`);
+          return tree;
+        }
+        const middle = Math.floor((from + to) / 2);
+        return [
+          `local.get ${switchLocalName}`,
+          `i32.const ${cases[middle].value}`,
+          "i32.lt_s",
+          "if",
+          ...createCompareTree(from, middle, depth + 1),
+          "end",
+          ...createCompareTree(middle, to, depth),
+        ];
+      };
+
+      const minValue = cases.length > 0 ? cases[0].value : 0;
+      const range =
+        cases.length > 0 ? cases[cases.length - 1].value - minValue + 1 : 0;
+      const isDense = cases.length >= 4 && range <= cases.length * 3;
+
+      let dispatch: WAInstuction[];
+      if (isDense) {
+        const targets: number[] = [];
+        for (let i = 0; i < range; i++) {
+          targets.push(defaultTarget);
+        }
+        for (const switchCase of cases) {
+          targets[switchCase.value - minValue] = switchCase.segment;
+        }
+        dispatch = [
+          `local.get ${switchLocalName}`,
+          `i32.const ${minValue}`,
+          // Values below minimum become big unsigned numbers and go to default
+          "i32.sub",
+          `br_table ${targets.join(" ")} ${defaultTarget}`,
+        ];
+      } else {
+        dispatch = createCompareTree(0, cases.length, 0);
+      }
+
+      code.push("block ;; switch");
+      for (let i = 1; i < segments.length; i++) {
+        code.push("block ;; switch segment");
+      }
+      code.push("block ;; switch dispatch", ...dispatch, "end");
+      segments.forEach((segment, segmentIndex) => {
+        // Segment is inside blocks of next segments and inside exit block
+        const blocksAround = segments.length - segmentIndex;
+        code.push(
+          ...createFunctionCodeForBlock(
+            segment.body,
+            returnBrDepth + blocksAround,
+            continueBrDepth !== null ? continueBrDepth + blocksAround : null,
+            blocksAround - 1
+          ),
+          segmentIndex === segments.length - 1
+            ? "end ;; switch end"
+            : "end ;; switch segment"
+        );
+      });
+
+      return code;
+    }
+
     const funcCode: WAInstuction[] = createFunctionCodeForBlock(
       func.body,
       0,
+      null,
       null
     );
 
-    const saveEsp: WAInstuction[] = [
-      ...readEspCode,
-      `local.set $ebp ;; Save esp -> ebp`,
-    ];
-    const restoreEsp: WAInstuction[] = [
-      `;; Restore esp`,
-      ...writeEspCode([
-        `local.get $ebp ;;`,
-        `i32.const ${functionDataStackOffset}`,
-        `i32.add ;; `,
-      ]),
-    ];
-
-    const subLocalsSizeFromEsp = writeEspCode([
-      ...readEspCode,
-      `i32.const ${functionDataStackOffset}`,
-      `i32.sub ;; Sub all locals size from esp`,
-    ]);
-
-    const functionParamsDeclarations: WAInstuction[] = [];
+    /**
+     * Function needs a stack frame only if something lives in memory.
+     * Otherwise we do not touch ESP at all, callees take care of their frames
+     */
+    const functionHaveFrame = functionDataStackOffset > 0;
+
+    const subLocalsSizeFromEspAndSaveEbp: WAInstuction[] = functionHaveFrame
+      ? writeEspCode([
+          ...readEspCode,
+          `i32.const ${functionDataStackOffset}`,
+          `i32.sub ;; Sub all locals size from esp`,
+          `local.tee $ebp ;; Save esp -> ebp`,
+        ])
+      : [];
+
+    const restoreEsp: WAInstuction[] = functionHaveFrame
+      ? [
+          `;; Restore esp`,
+          ...writeEspCode([
+            `local.get $ebp ;;`,
+            `i32.const ${functionDataStackOffset}`,
+            `i32.add ;; `,
+          ]),
+        ]
+      : [];
+
+    const functionParams: WALocal[] = [];
     const functionParamsInitializers: WAInstuction[] = [`;; Initialize params`];
     for (const param of func.declaration.typename.parameters) {
       if (param.type !== "declarator") {
@@ -335,9 +919,23 @@ export function createFunctionCodeGenerator(
       if (!paramRegisterType) {
         error(param, "TODO: Currently this type of parameter is not supported");
       }
-      functionParamsDeclarations.push(
-        `  (param $P${param.declaratorId} ${paramRegisterType}) `
-      );
+      functionParams.push({
+        name: `$P${param.declaratorId}`,
+        type: paramRegisterType,
+        sourceName: param.identifier,
+      });
+
+      if (param.wasmLocalName) {
+        const narrowCode = narrowScalarInRegister(param.typename);
+        if (narrowCode.length > 0) {
+          functionParamsInitializers.push(
+            `local.get ${param.wasmLocalName} ;; Param ${param.identifier} value`,
+            ...narrowCode,
+            `local.set ${param.wasmLocalName}`
+          );
+        }
+        continue;
+      }
 
       functionParamsInitializers.push(
         // Parameter address. They are always on stack
@@ -351,46 +949,62 @@ export function createFunctionCodeGenerator(
       );
     }
 
-    // Why is this? It works without this too
-    const funcTypeHint = `(type ${functionTypename})`;
-
-    const functionHeader =
-      `(func $F${func.declaration.declaratorId} ` +
-      funcTypeHint +
-      functionParamsDeclarations.join(" ") +
-      (functionReturnsInRegister
-        ? ` (result ${functionReturnsInRegister})`
-        : "") +
-      `  (local $ebp i32)`;
-
     const mainFunctionBlock = `block ${
       functionReturnsInRegister ? `(result ${functionReturnsInRegister})` : ""
     };; main function block `;
-    const mainFunctionBlockDefaultValue = functionReturnsInRegister
-      ? `${functionReturnsInRegister}.const 0 ;; function default value`
-      : "";
+    const mainFunctionBlockDefaultValue =
+      functionReturnsInRegister === "v128"
+        ? // Binary encoder have no v128.const, so splat the zero
+          ["i32.const 0 ;; function default value", "i32x4.splat"]
+        : functionReturnsInRegister
+        ? [`${functionReturnsInRegister}.const 0 ;; function default value`]
+        : [];
     const mainFunctionBlockEnd = "end ;; main function block end";
 
-    return [
-      `;; Function ${func.declaration.identifier} localSize=${functionDataStackOffset}`,
-      functionHeader,
-
-      ...subLocalsSizeFromEsp,
-      ...saveEsp,
-
-      ...functionParamsInitializers,
-
-      mainFunctionBlock,
-      ...funcCode,
-      mainFunctionBlockDefaultValue,
-      mainFunctionBlockEnd,
-
-      ...restoreEsp,
-      `)`,
-      "",
-      `(export "${func.declaration.identifier}" (func $F${func.declaration.declaratorId}))`,
-      "",
-    ];
+    const instrumentation = options.instrumentation;
+    const profileRecord = instrumentation
+      ? instrumentation.getRecordAddress(func.declaration.declaratorId)
+      : 0;
+
+    return {
+      name: getFunctionWaName(func.declaration.declaratorId),
+      typeName: functionTypename,
+      params: functionParams,
+      results: functionResults,
+      locals: [
+        ...(functionHaveFrame ? [{ name: "$ebp", type: "i32" as const }] : []),
+        ...wasmLocals,
+        ...resultLocals,
+        ...helpers.takeScratchLocals(),
+        ...(instrumentation ? getInstrumentationLocals(instrumentation) : []),
+      ],
+      body: parseInstructions([
+        ...helpers.getLocationMarker(func),
+        ...(instrumentation
+          ? getInstrumentationPrologue(instrumentation, profileRecord)
+          : []),
+        ...subLocalsSizeFromEspAndSaveEbp,
+
+        ...functionParamsInitializers,
+
+        mainFunctionBlock,
+        ...funcCode,
+        ...mainFunctionBlockDefaultValue,
+        mainFunctionBlockEnd,
+
+        ...helpers.getLocationMarker(func),
+        ...(instrumentation
+          ? getInstrumentationEpilogue(instrumentation, profileRecord)
+          : []),
+        ...restoreEsp,
+        ...resultLocals.map((local) => `local.get ${local.name} ;; Result`),
+      ]),
+      exportName: func.declaration.identifier,
+      sourceName: func.declaration.identifier,
+      comment:
+        `Function ${func.declaration.identifier} localSize=${functionDataStackOffset}` +
+        (functionHaveFrame ? "" : " frameless"),
+    };
   }
 
   return {
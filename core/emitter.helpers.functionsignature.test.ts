@@ -63,4 +63,22 @@ describe("generateFunctionWaTypeName", () => {
     "$FUNCSIGififdi",
     "(func (param f32 i32 f32 f64 i32) (result i32))"
   );
+
+  describeTypename(
+    `v128_t f(v128_t a, int lane);`,
+    "$FUNCSIGVVi",
+    "(func (param v128 i32) (result v128))"
+  );
+
+  describeTypename(
+    `struct pair { int x; double y; } f(long long a);`,
+    "$FUNCSIGid_j",
+    "(func (param i64) (result i32 f64))"
+  );
+
+  describeTypename(
+    `struct { char *p; } f();`,
+    "$FUNCSIGi",
+    "(func (result i32))"
+  );
 });
@@ -1,7 +1,9 @@
 import { FunctionTypename } from "./parser.definitions";
-import { getRegisterForTypename } from "./emitter.utils";
-import { RegisterType, WAInstuction } from "./emitter.definitions";
-import { type } from "os";
+import {
+  getRegisterForTypename,
+  getRegistersForTypename,
+} from "./emitter.utils";
+import { RegisterType, WAFunctionType } from "./emitter.definitions";
 
 function registerToShortname(register: RegisterType) {
   return {
@@ -9,29 +11,26 @@ function registerToShortname(register: RegisterType) {
     i64: "j",
     f32: "f",
     f64: "d",
+    v128: "V",
   }[register];
 }
 
-/** Exported only for autotests, do not use it */
-export function generateFunctionWaTypeName(func: FunctionTypename) {
-  const returnRegister = getRegisterForTypename(func.returnType);
-
-  const returnTypeNamePart =
-    func.returnType.type === "void"
-      ? "v"
-      : returnRegister
-      ? registerToShortname(returnRegister)
-      : null;
-
-  if (!returnTypeNamePart) {
+function getFunctionWaType(func: FunctionTypename): WAFunctionType {
+  const results = getRegistersForTypename(func.returnType);
+  if (!results) {
     // No locator here
     throw new Error("Return of non-register value is not supported yet");
   }
-  const waTypeDefinitionResult = returnRegister
-    ? ` (result ${returnRegister})`
-    : "";
 
-  let waTypeDefinitionParams = "";
+  // Single result names have no separator, so "_" marks multiple results
+  const returnTypeNamePart =
+    results.length === 0
+      ? "v"
+      : results.length === 1
+      ? registerToShortname(results[0])
+      : results.map(registerToShortname).join("") + "_";
+
+  const params: RegisterType[] = [];
 
   let waTypeName = "$FUNCSIG" + returnTypeNamePart;
   for (const param of func.parameters) {
@@ -48,20 +47,35 @@ export function generateFunctionWaTypeName(func: FunctionTypename) {
     const paramRegisterTypeNamePart = registerToShortname(paramRegister);
 
     waTypeName += paramRegisterTypeNamePart;
-    waTypeDefinitionParams += ` ${paramRegister}`;
+    params.push(paramRegister);
   }
 
   if (func.haveEndingEllipsis) {
     throw new Error("'...' is not implemened yed");
   }
 
-  const waTypeDefinition =
+  return {
+    name: waTypeName,
+    params,
+    results,
+  };
+}
+
+export function getWaTypeDefinition(waType: WAFunctionType) {
+  return (
     "(func" +
-    (waTypeDefinitionParams ? ` (param${waTypeDefinitionParams})` : "") +
-    waTypeDefinitionResult +
-    ")";
+    (waType.params.length > 0 ? ` (param ${waType.params.join(" ")})` : "") +
+    (waType.results.length > 0
+      ? ` (result ${waType.results.join(" ")})`
+      : "") +
+    ")"
+  );
+}
 
-  return [waTypeName, waTypeDefinition];
+/** Exported only for autotests, do not use it */
+export function generateFunctionWaTypeName(func: FunctionTypename) {
+  const waType = getFunctionWaType(func);
+  return [waType.name, getWaTypeDefinition(waType)];
 }
 
 export class FunctionSignatures {
@@ -71,21 +85,19 @@ export class FunctionSignatures {
    * A map, something like this
    *
    * $FUNCSIG$iij -> (func (param i32 i64) (result i32)))
+   * $FUNCSIG$ii_j -> (func (param i64) (result i32 i32)))
    */
-  private readonly seenFunctionTypes = new Map<string, string>();
+  private readonly seenFunctionTypes = new Map<string, WAFunctionType>();
 
   getFunctionTypeName(func: FunctionTypename) {
-    const [waTypeName, waTypeDefinition] = generateFunctionWaTypeName(func);
-    if (!this.seenFunctionTypes.has(waTypeName)) {
-      this.seenFunctionTypes.set(waTypeName, waTypeDefinition);
+    const waType = getFunctionWaType(func);
+    if (!this.seenFunctionTypes.has(waType.name)) {
+      this.seenFunctionTypes.set(waType.name, waType);
     }
-    return waTypeName;
+    return waType.name;
   }
 
-  getTypesWAInstructions(): WAInstuction[] {
-    return [...this.seenFunctionTypes.entries()].map(
-      ([waTypeName, waTypeDefinition]) =>
-        `(type ${waTypeName} ${waTypeDefinition})`
-    );
+  getTypes(): WAFunctionType[] {
+    return [...this.seenFunctionTypes.values()];
   }
 }
@@ -1,6 +1,7 @@
 import { FunctionTypename } from "./parser.definitions";
-import { WAInstuction } from "./emitter.definitions";
+import { WAFunction } from "./emitter.definitions";
 import { FunctionSignatures } from "./emitter.helpers.functionsignature";
+import { createInstruction } from "./emitter.instructions";
 
 const trapFunctionType: FunctionTypename = {
   type: "function",
@@ -14,9 +15,19 @@ const trapFunctionType: FunctionTypename = {
 };
 
 export const trapFunctionName = "$null";
-export function getTrapFunctionCode(
+export function getTrapFunction(
   functionSignatures: FunctionSignatures
-): WAInstuction[] {
+): WAFunction {
   const waTypeName = functionSignatures.getFunctionTypeName(trapFunctionType);
-  return [`(func ${trapFunctionName} (type ${waTypeName})`, `unreachable`, `)`];
+  return {
+    name: trapFunctionName,
+    typeName: waTypeName,
+    params: [],
+    results: [],
+    locals: [],
+    body: [createInstruction("unreachable")],
+    exportName: null,
+    sourceName: null,
+    comment: null,
+  };
 }
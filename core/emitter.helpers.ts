@@ -6,16 +6,30 @@ import {
   Node,
 } from "./parser.definitions";
 import { CheckerError } from "./error";
-import { CheckerWarning } from "./emitter.definitions";
+import {
+  CheckerWarning,
+  RegisterType,
+  WAInstuction,
+  WALocal,
+} from "./emitter.definitions";
 import { FunctionSignatures } from "./emitter.helpers.functionsignature";
+import { getLocationMarker as getLocationMarkerInstruction } from "./emitter.instructions";
 
 export interface EmitterHelpers {
   error(node: Node, msg: string): never;
   warn(node: Node, msg: string): void;
   cloneLocation(fromNode: Node, toNode: Node): void;
+  /** Location marker for the code of the node, see getLocationMarker */
+  getLocationMarker(node: Node): WAInstuction[];
   getDeclaration(declaratorId: DeclaratorId): DeclaratorNode;
   warnings: CheckerWarning[];
   functionSignatures: FunctionSignatures;
+  /**
+   * Returns name of temporary local for generated code.
+   *   Locals are collected by takeScratchLocals when function is ready
+   */
+  getScratchLocal(register: RegisterType, purpose: string): string;
+  takeScratchLocals(): WALocal[];
 }
 
 export function createHelpers(
@@ -43,6 +57,15 @@ export function createHelpers(
     locator.set(toNode, location);
   }
 
+  function getLocationMarker(node: Node): WAInstuction[] {
+    const location = locator.get(node);
+    // Runtime libraries have line 0, their code is not mapped
+    if (!location || location.line === 0) {
+      return [];
+    }
+    return [getLocationMarkerInstruction(location)];
+  }
+
   function warn(node: Node, msg: string) {
     const location = locator.get(node);
     if (!location) {
@@ -74,12 +97,30 @@ export function createHelpers(
 
   const functionSignatures = new FunctionSignatures();
 
+  const scratchLocals = new Map<string, RegisterType>();
+  function getScratchLocal(register: RegisterType, purpose: string) {
+    const name = `$S${purpose}_${register}`;
+    scratchLocals.set(name, register);
+    return name;
+  }
+  function takeScratchLocals(): WALocal[] {
+    const locals = [...scratchLocals.entries()].map(([name, type]) => ({
+      name,
+      type,
+    }));
+    scratchLocals.clear();
+    return locals;
+  }
+
   return {
     error,
     warn,
     cloneLocation,
+    getLocationMarker,
     getDeclaration,
     warnings,
     functionSignatures,
+    getScratchLocal,
+    takeScratchLocals,
   };
 }
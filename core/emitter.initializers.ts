@@ -0,0 +1,301 @@
+import { EmitterHelpers } from "./emitter.helpers";
+import {
+  DeclaratorNode,
+  ExpressionNode,
+  InitializerNode,
+  Node,
+  Typename,
+} from "./parser.definitions";
+import {
+  TypeSizeGetter,
+  ExpressionInfoGetter,
+} from "./emitter.expressionsandtypes";
+import { Structs } from "./emitter.structs";
+import { int4Bytes, int8Bytes } from "./emitter.utils";
+import { parseInt64 } from "./emitter.module.binary";
+
+export interface InitializerData {
+  /** Object bytes, zeros where initializer have no value */
+  bytes: number[];
+  /** Scalars which values are not known on compilation time */
+  dynamicValues: {
+    typename: Typename;
+    offset: number;
+    expression: ExpressionNode;
+  }[];
+}
+
+type ScalarCallback = (
+  typename: Typename,
+  offset: number,
+  expression: ExpressionNode
+) => void;
+
+/**
+ * Constant evaluation of initializers (6.7.8).
+ * Nested arrays and structs can be written with or without inner braces
+ */
+export function createInitializers(
+  helpers: EmitterHelpers,
+  getTypeSize: TypeSizeGetter,
+  getExpressionInfo: ExpressionInfoGetter,
+  structs: Structs
+) {
+  function error(node: Node, msg: string): never {
+    helpers.error(node, msg);
+  }
+
+  function getStaticSize(typename: Typename) {
+    const size = getTypeSize(typename);
+    if (size.type !== "static") {
+      error(typename, "Initialized object must have known size");
+    }
+    return size.value;
+  }
+
+  /** Returns number of initialized array elements */
+  function fillArray(
+    typename: Typename,
+    items: InitializerNode[],
+    position: { index: number },
+    offset: number,
+    onScalar: ScalarCallback
+  ): number {
+    if (typename.type !== "array") {
+      throw new Error("Internal error: expecting array");
+    }
+    if (typename.size === "*") {
+      error(typename, "Star in array is not supported");
+    }
+    // Array of unknown size takes all items
+    const length =
+      typename.size === null
+        ? Infinity
+        : getStaticSize(typename) / getStaticSize(typename.elementsTypename);
+    const elementSize = getStaticSize(typename.elementsTypename);
+    let index = 0;
+    while (index < length && position.index < items.length) {
+      fillElement(
+        typename.elementsTypename,
+        items,
+        position,
+        offset + index * elementSize,
+        onScalar
+      );
+      index++;
+    }
+    return index;
+  }
+
+  /** Members are initialized in order, returns number of initialized */
+  function fillStruct(
+    typename: Typename,
+    items: InitializerNode[],
+    position: { index: number },
+    offset: number,
+    onScalar: ScalarCallback
+  ): number {
+    if (typename.type !== "struct") {
+      throw new Error("Internal error: expecting struct");
+    }
+    const members = structs.getStructLayout(typename).members;
+    let index = 0;
+    while (index < members.length && position.index < items.length) {
+      fillElement(
+        members[index].declaration.typename,
+        items,
+        position,
+        offset + members[index].offset,
+        onScalar
+      );
+      index++;
+    }
+    return index;
+  }
+
+  function fillElement(
+    typename: Typename,
+    items: InitializerNode[],
+    position: { index: number },
+    offset: number,
+    onScalar: ScalarCallback
+  ) {
+    const item = items[position.index];
+    if (item.type === "initializer-list") {
+      position.index++;
+      fillBraced(typename, item, offset, onScalar);
+    } else if (typename.type === "array") {
+      // Braces are elided, so inner array takes items from the same list
+      fillArray(typename, items, position, offset, onScalar);
+    } else if (typename.type === "struct") {
+      fillStruct(typename, items, position, offset, onScalar);
+    } else {
+      position.index++;
+      onScalar(typename, offset, item.expression);
+    }
+  }
+
+  function fillBraced(
+    typename: Typename,
+    initializer: InitializerNode,
+    offset: number,
+    onScalar: ScalarCallback
+  ): number {
+    if (initializer.type === "assigmnent-expression") {
+      if (typename.type === "array") {
+        error(initializer, "Array must be initialized with initializer list");
+      }
+      if (typename.type === "struct") {
+        error(initializer, "Struct must be initialized with initializer list");
+      }
+      onScalar(typename, offset, initializer.expression);
+      return 1;
+    }
+    const position = { index: 0 };
+    let length = 0;
+    if (typename.type === "array") {
+      length = fillArray(typename, initializer.items, position, offset, onScalar);
+    } else if (typename.type === "struct") {
+      length = fillStruct(
+        typename,
+        initializer.items,
+        position,
+        offset,
+        onScalar
+      );
+    } else if (initializer.items.length > 0) {
+      fillElement(typename, initializer.items, position, offset, onScalar);
+      length = 1;
+    }
+    if (position.index < initializer.items.length) {
+      error(initializer.items[position.index], "Too many initializers");
+    }
+    return length;
+  }
+
+  /**
+   * Array of unknown size "int a[] = {1, 2}" gets size from initializer
+   */
+  function completeArraySize(declaration: DeclaratorNode) {
+    const typename = declaration.typename;
+    if (
+      typename.type !== "array" ||
+      typename.size !== null ||
+      !declaration.initializer
+    ) {
+      return;
+    }
+    const length = fillBraced(typename, declaration.initializer, 0, () => {});
+    const size: ExpressionNode = {
+      type: "const",
+      subtype: "int",
+      value: length,
+    };
+    helpers.cloneLocation(declaration.initializer, size);
+    const completeTypename: Typename = { ...typename, size };
+    helpers.cloneLocation(declaration, completeTypename);
+    declaration.typename = completeTypename;
+  }
+
+  /**
+   * Static values are integers only, so floating constants are evaluated here
+   */
+  function getFloatingValue(expression: ExpressionNode): number | null {
+    if (expression.type === "const") {
+      return expression.value;
+    }
+    if (
+      expression.type === "unary-operator" &&
+      (expression.operator === "-" || expression.operator === "+")
+    ) {
+      const value = getFloatingValue(expression.target);
+      return value === null || expression.operator === "+" ? value : -value;
+    }
+    return getExpressionInfo(expression).staticValue;
+  }
+
+  function floatingBytes(value: number, size: 4 | 8) {
+    const view = new DataView(new ArrayBuffer(size));
+    if (size === 4) {
+      view.setFloat32(0, value, true);
+    } else {
+      view.setFloat64(0, value, true);
+    }
+    return Array.from(new Uint8Array(view.buffer));
+  }
+
+  function getInitializerData(
+    typename: Typename,
+    initializer: InitializerNode
+  ): InitializerData {
+    const bytes: number[] = [];
+    const size = getStaticSize(typename);
+    for (let i = 0; i < size; i++) {
+      bytes.push(0);
+    }
+    const dynamicValues: InitializerData["dynamicValues"] = [];
+
+    fillBraced(typename, initializer, 0, (scalarTypename, offset, expression) => {
+      if (
+        scalarTypename.type === "arithmetic" &&
+        scalarTypename.arithmeticType === "long long" &&
+        expression.type === "const" &&
+        expression.subtype === "long long"
+      ) {
+        // Literal text have all 64 bits, static value might be not exact
+        bytes.splice(offset, 8, ...int8Bytes(...parseInt64(expression.text)));
+        return;
+      }
+      if (
+        scalarTypename.type === "arithmetic" &&
+        (scalarTypename.arithmeticType === "float" ||
+          scalarTypename.arithmeticType === "double")
+      ) {
+        const value = getFloatingValue(expression);
+        if (value === null) {
+          dynamicValues.push({ typename: scalarTypename, offset, expression });
+          return;
+        }
+        const size = scalarTypename.arithmeticType === "float" ? 4 : 8;
+        bytes.splice(offset, size, ...floatingBytes(value, size));
+        return;
+      }
+      const staticValue = getExpressionInfo(expression).staticValue;
+      if (staticValue === null) {
+        dynamicValues.push({ typename: scalarTypename, offset, expression });
+        return;
+      }
+      if (
+        scalarTypename.type === "arithmetic" &&
+        scalarTypename.arithmeticType === "char"
+      ) {
+        bytes[offset] = staticValue & 0xff;
+      } else if (
+        (scalarTypename.type === "arithmetic" &&
+          scalarTypename.arithmeticType === "int") ||
+        scalarTypename.type === "pointer"
+      ) {
+        bytes.splice(offset, 4, ...int4Bytes(staticValue));
+      } else if (
+        scalarTypename.type === "arithmetic" &&
+        scalarTypename.arithmeticType === "long long"
+      ) {
+        // Static values are exact integers, so division is exact too
+        const hi = Math.floor(staticValue / 2 ** 32);
+        bytes.splice(offset, 8, ...int8Bytes(staticValue >>> 0, hi));
+      } else {
+        error(
+          expression,
+          "TODO: Only arithmetic or pointer is supported for initializers"
+        );
+      }
+    });
+
+    return { bytes, dynamicValues };
+  }
+
+  return {
+    completeArraySize,
+    getInitializerData,
+  };
+}
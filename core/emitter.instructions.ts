@@ -0,0 +1,106 @@
+import { WAInstuction, WAStructuredInstruction } from "./emitter.definitions";
+import { TokenLocation } from "./error";
+
+/** Returns null for empty lines and lines with only comment */
+export function parseInstruction(
+  instruction: WAInstuction
+): WAStructuredInstruction | null {
+  const commentPos = instruction.indexOf(";;");
+  const code =
+    commentPos === -1 ? instruction : instruction.slice(0, commentPos);
+  const comment =
+    commentPos === -1 ? null : instruction.slice(commentPos + 2).trim() || null;
+  // Parenthesized parts like "(result i32)" are kept as one immediate
+  const tokens = code.match(/\([^)]*\)|[^\s()]+/g);
+  if (!tokens) {
+    return null;
+  }
+  const [op, ...args] = tokens;
+  return { op, args, comment };
+}
+
+const LOCATION_MARKER = /^;; @(\d+):(\d+):(\d+)$/;
+
+/**
+ * Comment line which sets source location for the following instructions,
+ *   so text code keeps locations until it is parsed
+ */
+export function getLocationMarker(location: TokenLocation): WAInstuction {
+  return `;; @${location.line}:${location.pos}:${location.length}`;
+}
+
+export function parseInstructions(
+  code: WAInstuction[]
+): WAStructuredInstruction[] {
+  const result: WAStructuredInstruction[] = [];
+  let location: TokenLocation | null = null;
+  for (const line of code) {
+    const marker = line.match(LOCATION_MARKER);
+    if (marker) {
+      location = {
+        line: parseInt(marker[1]),
+        pos: parseInt(marker[2]),
+        length: parseInt(marker[3]),
+      };
+      continue;
+    }
+    const instruction = parseInstruction(line);
+    if (instruction) {
+      result.push(location ? { ...instruction, location } : instruction);
+    }
+  }
+  return result;
+}
+
+export function printInstruction(
+  instruction: WAStructuredInstruction
+): WAInstuction {
+  return (
+    [instruction.op, ...instruction.args].join(" ") +
+    (instruction.comment ? ` ;; ${instruction.comment}` : "")
+  );
+}
+
+export function createInstruction(
+  op: string,
+  args: string[] = [],
+  comment: string | null = null
+): WAStructuredInstruction {
+  return { op, args, comment };
+}
+
+/** Instructions which push a value and have no side effects */
+export const PURE_VALUE = /^(local\.get|global\.get|[if](32|64)\.const)$/;
+
+/** Binary operations which never trap, integer division is not here */
+export const PURE_BINARY = /^i(32|64)\.(add|sub|mul|and|or|xor|shl|shr_[su]|rotl|rotr|eq|ne|[lg][te]_[su])$|^f(32|64)\.(add|sub|mul|div|min|max|copysign|eq|ne|[lg][te])$/;
+
+export const PURE_UNARY = /^i(32|64)\.(eqz|clz|ctz|popcnt|extend(8|16|32)_s)$|^i64\.extend_i32_[su]$|^i32\.wrap_i64$|^f(32|64)\.(abs|neg|ceil|floor|trunc|nearest|sqrt|convert_i(32|64)_[su])$|^f32\.demote_f64$|^f64\.promote_f32$|^i(32|64)\.trunc_sat_f(32|64)_[su]$/;
+
+export const LOAD = /^[if](32|64)\.load(8_[su]|16_[su]|32_[su])?$/;
+
+/**
+ * Returns how many values instruction takes from the stack and how many pushes,
+ * or null if it is not known without types
+ */
+export function getStackEffect(op: string): [number, number] | null {
+  if (PURE_VALUE.test(op)) {
+    return [0, 1];
+  } else if (op === "local.set" || op === "global.set" || op === "drop") {
+    return [1, 0];
+  } else if (op === "local.tee" || PURE_UNARY.test(op) || LOAD.test(op)) {
+    return [1, 1];
+  } else if (
+    PURE_BINARY.test(op) ||
+    /^i(32|64)\.(div|rem)_[su]$/.test(op)
+  ) {
+    return [2, 1];
+  } else if (/^[if](32|64)\.store(8|16|32)?$/.test(op)) {
+    return [2, 0];
+  } else if (op === "memory.copy" || op === "memory.fill") {
+    return [3, 0];
+  } else if (op === "nop") {
+    return [0, 0];
+  }
+  return null;
+}
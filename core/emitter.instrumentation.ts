@@ -0,0 +1,223 @@
+import { DeclaratorId, FunctionTypename } from "./parser.definitions";
+import {
+  WAFunction,
+  WAImportedFunction,
+  WAInstuction,
+  WALocal,
+} from "./emitter.definitions";
+import { FunctionSignatures } from "./emitter.helpers.functionsignature";
+import { parseInstructions } from "./emitter.instructions";
+
+/*
+
+Instrumentation build mode: every function counts its calls and,
+  if host timer is imported, measures its time.
+
+Profile is a reserved region in globals memory, 8-bytes aligned:
+  +0  i32 count of functions
+  +4  i32 address of names, array of pointers to zero-terminated strings
+  +8  f64 time of finished calls of the current function's callees
+  +16 records of functions, PROFILE_RECORD_SIZE bytes each:
+        +0  i64 calls
+        +8  f64 inclusive time
+        +16 f64 exclusive time, i.e. without callees
+
+Prologue saves time of callees of the caller and starts from zero,
+  epilogue adds own time to it, so caller knows the time of callees.
+  Recursive calls are counted in inclusive time of every frame.
+
+Epilogue is after main function block, so returns do not skip it,
+  and tail calls are not used. Inlined function keeps hooks which write
+  into the record of inlined function. If function traps then epilogue
+  is not executed, so times are valid again only after _prof_reset.
+
+Timer is imported from "js", it have no parameters and returns f64,
+  for example performance.now() in milliseconds.
+
+ */
+
+export const PROFILE_HEADER_SIZE = 16;
+export const PROFILE_RECORD_SIZE = 24;
+export const PROFILE_TIMER_IMPORT_NAME = "_prof_now";
+export const PROFILE_DUMP_EXPORT_NAME = "_prof_dump";
+export const PROFILE_RESET_EXPORT_NAME = "_prof_reset";
+
+const PROFILE_TIMER_FUNCTION = "$_prof_now";
+
+export interface Instrumentation {
+  /** Address of the record of function, see layout above */
+  getRecordAddress(declaratorId: DeclaratorId): number;
+  /** Profile region address */
+  profileAddress: number;
+  timer: boolean;
+}
+
+const timerType: FunctionTypename = {
+  type: "function",
+  returnType: {
+    type: "arithmetic",
+    arithmeticType: "double",
+    signedUnsigned: null,
+    const: true,
+  },
+  const: true,
+  haveEndingEllipsis: false,
+  parameters: [],
+};
+
+const resetType: FunctionTypename = {
+  type: "function",
+  returnType: {
+    type: "void",
+    const: true,
+  },
+  const: true,
+  haveEndingEllipsis: false,
+  parameters: [],
+};
+
+const dumpType: FunctionTypename = {
+  type: "function",
+  returnType: {
+    type: "arithmetic",
+    arithmeticType: "int",
+    signedUnsigned: null,
+    const: true,
+  },
+  const: true,
+  haveEndingEllipsis: false,
+  parameters: [],
+};
+
+/** Bytes of profile region with header, records are zeros */
+export function getProfileSize(functionsCount: number) {
+  return PROFILE_HEADER_SIZE + functionsCount * PROFILE_RECORD_SIZE;
+}
+
+export function getProfileTimerImport(
+  functionSignatures: FunctionSignatures
+): WAImportedFunction {
+  return {
+    name: PROFILE_TIMER_FUNCTION,
+    typeName: functionSignatures.getFunctionTypeName(timerType),
+    importFrom: { module: "js", name: PROFILE_TIMER_IMPORT_NAME },
+  };
+}
+
+/** Locals which are used by hooks */
+export function getInstrumentationLocals(
+  instrumentation: Instrumentation
+): WALocal[] {
+  return instrumentation.timer
+    ? [
+        { name: "$prof_start", type: "f64" },
+        { name: "$prof_callees", type: "f64" },
+        { name: "$prof_elapsed", type: "f64" },
+      ]
+    : [];
+}
+
+export function getInstrumentationPrologue(
+  instrumentation: Instrumentation,
+  record: number
+): WAInstuction[] {
+  const code: WAInstuction[] = [
+    `i32.const ${record} ;; Profile record`,
+    `i32.const ${record}`,
+    `i64.load offset=0 align=2 ;; Calls`,
+    `i64.const 1`,
+    `i64.add`,
+    `i64.store offset=0 align=2`,
+  ];
+  if (instrumentation.timer) {
+    const profile = instrumentation.profileAddress;
+    code.push(
+      `call ${PROFILE_TIMER_FUNCTION}`,
+      `local.set $prof_start`,
+      `i32.const ${profile}`,
+      `f64.load offset=8 align=2 ;; Callees time of caller`,
+      `local.set $prof_callees`,
+      `i32.const ${profile}`,
+      `f64.const 0`,
+      `f64.store offset=8 align=2`
+    );
+  }
+  return code;
+}
+
+/** Instructions are balanced, so function result can be on the stack */
+export function getInstrumentationEpilogue(
+  instrumentation: Instrumentation,
+  record: number
+): WAInstuction[] {
+  if (!instrumentation.timer) {
+    return [];
+  }
+  const profile = instrumentation.profileAddress;
+  return [
+    `call ${PROFILE_TIMER_FUNCTION}`,
+    `local.get $prof_start`,
+    `f64.sub`,
+    `local.set $prof_elapsed`,
+    `i32.const ${record} ;; Profile record`,
+    `i32.const ${record}`,
+    `f64.load offset=8 align=2 ;; Inclusive time`,
+    `local.get $prof_elapsed`,
+    `f64.add`,
+    `f64.store offset=8 align=2`,
+    `i32.const ${record}`,
+    `i32.const ${record}`,
+    `f64.load offset=16 align=2 ;; Exclusive time`,
+    `local.get $prof_elapsed`,
+    `i32.const ${profile}`,
+    `f64.load offset=8 align=2`,
+    `f64.sub`,
+    `f64.add`,
+    `f64.store offset=16 align=2`,
+    `i32.const ${profile}`,
+    `local.get $prof_callees`,
+    `local.get $prof_elapsed`,
+    `f64.add`,
+    `f64.store offset=8 align=2 ;; Callees time of caller`,
+  ];
+}
+
+/**
+ * _prof_dump returns profile address, host reads the profile from memory.
+ *   _prof_reset clears counters and times
+ */
+export function getProfileFunctions(
+  functionSignatures: FunctionSignatures,
+  profileAddress: number,
+  functionsCount: number
+): WAFunction[] {
+  return [
+    {
+      name: "$_prof_dump",
+      typeName: functionSignatures.getFunctionTypeName(dumpType),
+      params: [],
+      results: ["i32"],
+      locals: [],
+      body: parseInstructions([`i32.const ${profileAddress}`]),
+      exportName: PROFILE_DUMP_EXPORT_NAME,
+      sourceName: null,
+      comment: null,
+    },
+    {
+      name: "$_prof_reset",
+      typeName: functionSignatures.getFunctionTypeName(resetType),
+      params: [],
+      results: [],
+      locals: [],
+      body: parseInstructions([
+        `i32.const ${profileAddress + 8}`,
+        `i32.const 0`,
+        `i32.const ${getProfileSize(functionsCount) - 8}`,
+        `memory.fill ;; Callees time and records`,
+      ]),
+      exportName: PROFILE_RESET_EXPORT_NAME,
+      sourceName: null,
+      comment: null,
+    },
+  ];
+}
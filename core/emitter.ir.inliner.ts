@@ -0,0 +1,238 @@
+import {
+  WAFunction,
+  WALocal,
+  WAStructuredInstruction,
+} from "./emitter.definitions";
+import { createInstruction } from "./emitter.instructions";
+
+export interface InlinerOptions {
+  /** Functions with body up to this number of instructions are inlined */
+  budget: number;
+  /** Budget for functions with "inline" specifier */
+  inlineSpecifierBudget: number;
+  /**
+   * How many times inlined code can be inlined again,
+   *   it limits growth on recursive and deep call chains
+   */
+  maxDepth: number;
+  /** Caller is not grown above this number of instructions */
+  maxCallerSize: number;
+}
+
+export const DEFAULT_INLINE_BUDGET = 20;
+
+export function getDefaultInlinerOptions(
+  budget = DEFAULT_INLINE_BUDGET
+): InlinerOptions {
+  return {
+    budget,
+    inlineSpecifierBudget: budget * 8,
+    maxDepth: 3,
+    maxCallerSize: 5000,
+  };
+}
+
+export interface InlinerResult {
+  functions: WAFunction[];
+  /** Number of call sites where function body was inlined */
+  inlinedCalls: number;
+  /** Names of functions which were changed */
+  changed: Set<string>;
+}
+
+function isTailCall(instruction: WAStructuredInstruction) {
+  return (
+    instruction.op === "return_call" ||
+    instruction.op === "return_call_indirect"
+  );
+}
+
+/**
+ * Callee body is placed into a block which have the same label depth
+ *   as function body, so branches inside are kept as is.
+ * Only "return" is replaced with branch to this block
+ */
+function createInlinedBody(
+  callee: WAFunction,
+  inlineId: number
+): { code: WAStructuredInstruction[]; locals: WALocal[] } {
+  const renamed = new Map<string, string>();
+  const locals: WALocal[] = [];
+  for (const local of [...callee.params, ...callee.locals]) {
+    const name = `${local.name}_i${inlineId}`;
+    renamed.set(local.name, name);
+    // Source name is kept, so inlined variables are named in debugger
+    locals.push({ ...local, name });
+  }
+
+  const code: WAStructuredInstruction[] = [];
+  // Arguments are on the stack, last one is on the top
+  for (let i = callee.params.length - 1; i >= 0; i--) {
+    code.push(
+      createInstruction(
+        "local.set",
+        [renamed.get(callee.params[i].name) as string],
+        i === callee.params.length - 1 ? `inlined ${callee.name}` : null
+      )
+    );
+  }
+  // Locals are zero-initialized on every call
+  for (const local of callee.locals) {
+    if (local.type === "v128") {
+      // Binary encoder have no v128.const, so splat the zero
+      code.push(
+        createInstruction("i32.const", ["0"]),
+        createInstruction("i32x4.splat", [])
+      );
+    } else {
+      code.push(createInstruction(`${local.type}.const`, ["0"]));
+    }
+    code.push(
+      createInstruction("local.set", [renamed.get(local.name) as string])
+    );
+  }
+
+  code.push(
+    createInstruction(
+      "block",
+      callee.results.length > 0 ? [`(result ${callee.results[0]})`] : [],
+      `inlined ${callee.name}`
+    )
+  );
+  let depth = 0;
+  for (const instruction of callee.body) {
+    if (
+      instruction.op === "block" ||
+      instruction.op === "loop" ||
+      instruction.op === "if"
+    ) {
+      depth++;
+    } else if (instruction.op === "end") {
+      depth--;
+    }
+    if (instruction.op === "return") {
+      code.push(createInstruction("br", [`${depth}`], instruction.comment));
+    } else if (
+      /^local\.(get|set|tee)$/.test(instruction.op) &&
+      renamed.has(instruction.args[0])
+    ) {
+      code.push({
+        ...instruction,
+        args: [renamed.get(instruction.args[0]) as string],
+      });
+    } else {
+      code.push(instruction);
+    }
+  }
+  code.push(createInstruction("end", [], `inlined ${callee.name} end`));
+
+  return { code, locals };
+}
+
+/**
+ * Replaces direct calls of small functions with their bodies.
+ * Recursive calls are never inlined, so function is not inlined into itself
+ */
+export function inlineFunctions(
+  functions: WAFunction[],
+  isInlineSpecified: (func: WAFunction) => boolean,
+  options: InlinerOptions
+): InlinerResult {
+  let inlineId = 0;
+  let inlinedCalls = 0;
+  const changed = new Set<string>();
+
+  let current = functions;
+  for (let round = 0; round < options.maxDepth; round++) {
+    // Bodies are taken from previous round, so every round adds one level
+    const byName = new Map<string, WAFunction>();
+    current.forEach((func) => byName.set(func.name, func));
+
+    // Tail call in inlined body would return from the caller.
+    //  Block for multiple results needs a type, so such callees are kept
+    const isCandidate = (callee: WAFunction | undefined, caller: WAFunction) =>
+      !!callee &&
+      callee.name !== caller.name &&
+      callee.results.length <= 1 &&
+      !callee.body.some((instruction) => isTailCall(instruction)) &&
+      callee.body.length <=
+        (isInlineSpecified(callee)
+          ? options.inlineSpecifierBudget
+          : options.budget);
+
+    let changedInRound = false;
+    current = current.map((caller) => {
+      if (
+        !caller.body.some(
+          (instruction) =>
+            instruction.op === "call" &&
+            isCandidate(byName.get(instruction.args[0]), caller)
+        )
+      ) {
+        return caller;
+      }
+      const body: WAStructuredInstruction[] = [];
+      const locals = [...caller.locals];
+      for (const instruction of caller.body) {
+        const callee =
+          instruction.op === "call" ? byName.get(instruction.args[0]) : undefined;
+        if (
+          callee &&
+          isCandidate(callee, caller) &&
+          body.length + callee.body.length <= options.maxCallerSize
+        ) {
+          inlineId++;
+          const inlined = createInlinedBody(callee, inlineId);
+          body.push(...inlined.code);
+          locals.push(...inlined.locals);
+          inlinedCalls++;
+          changedInRound = true;
+          changed.add(caller.name);
+        } else {
+          body.push(instruction);
+        }
+      }
+      return { ...caller, body, locals };
+    });
+    if (!changedInRound) {
+      break;
+    }
+  }
+
+  return { functions: current, inlinedCalls, changed };
+}
+
+/**
+ * Keeps functions which are exported, in the table or called from kept ones
+ */
+export function removeUnreferencedFunctions(
+  functions: WAFunction[],
+  table: string[]
+): WAFunction[] {
+  const byName = new Map<string, WAFunction>();
+  functions.forEach((func) => byName.set(func.name, func));
+
+  const used = new Set<string>();
+  const queue = [
+    ...table,
+    ...functions.filter((func) => func.exportName).map((func) => func.name),
+  ];
+  while (queue.length > 0) {
+    const name = queue.pop() as string;
+    if (used.has(name)) {
+      continue;
+    }
+    used.add(name);
+    const func = byName.get(name);
+    if (!func) {
+      continue;
+    }
+    for (const instruction of func.body) {
+      if (instruction.op === "call" || instruction.op === "return_call") {
+        queue.push(instruction.args[0]);
+      }
+    }
+  }
+
+  return functions.filter((func) => used.has(func.name));
+}
@@ -0,0 +1,191 @@
+import { WAFunction } from "./emitter.definitions";
+import { buildIR, lowerIR } from "./emitter.ir";
+import { IRPass } from "./emitter.ir.passes";
+import { parseInstructions, printInstruction } from "./emitter.instructions";
+import {
+  loopInvariantCodeMotion,
+  inductionVariableStrengthReduction,
+} from "./emitter.ir.loops";
+
+function runPass(pass: IRPass, code: string[]) {
+  const func: WAFunction = {
+    name: "$test",
+    typeName: "$FUNCSIGvii",
+    params: [
+      { name: "$P1", type: "i32" },
+      { name: "$P2", type: "i32" },
+    ],
+    results: [],
+    locals: [{ name: "$L1", type: "i32" }],
+    body: parseInstructions(code),
+    exportName: null,
+    sourceName: null,
+    comment: null,
+  };
+  const ir = buildIR(func);
+  const counters: { [name: string]: number } = {};
+  pass.run(ir, {
+    count: (counter) => {
+      counters[counter] = (counters[counter] || 0) + 1;
+    },
+  });
+  const lowered = lowerIR(func, ir);
+  return {
+    code: lowered.body.map((instruction) =>
+      printInstruction({ ...instruction, comment: null })
+    ),
+    locals: lowered.locals.map((local) => local.name),
+    counters,
+  };
+}
+
+describe("Loop optimizations", () => {
+  it(`Hoists invariant expressions`, () => {
+    // while (i < 10) { p[i] = p2 * 4 + 8; i++ }
+    const result = runPass(loopInvariantCodeMotion, [
+      "block",
+      "loop",
+      "local.get $L1",
+      "i32.const 10",
+      "i32.ge_u",
+      "br_if 1",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "local.get $P2",
+      "i32.const 4",
+      "i32.mul",
+      "i32.const 8",
+      "i32.add",
+      "i32.store8",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.add",
+      "local.set $L1",
+      "br 0",
+      "end",
+      "end",
+    ]);
+    expect(result.code).toStrictEqual([
+      "block",
+      "local.get $P2",
+      "i32.const 4",
+      "i32.mul",
+      "i32.const 8",
+      "i32.add",
+      "local.set $H1",
+      "loop",
+      "local.get $L1",
+      "i32.const 10",
+      "i32.ge_u",
+      "br_if 1",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "local.get $H1",
+      "i32.store8",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.add",
+      "local.set $L1",
+      "br 0",
+      "end",
+      "end",
+    ]);
+    expect(result.locals).toStrictEqual(["$L1", "$H1"]);
+    expect(result.counters).toStrictEqual({ "hoisted-expressions": 1 });
+  });
+
+  it(`Does not hoist expressions with changed locals`, () => {
+    const code = [
+      "loop",
+      "local.get $P2",
+      "i32.const 4",
+      "i32.mul",
+      "local.get $P1",
+      "i32.add",
+      "local.set $P2",
+      "local.get $P2",
+      "br_if 0",
+      "end",
+    ];
+    expect(runPass(loopInvariantCodeMotion, code).code).toStrictEqual(code);
+  });
+
+  it(`Replaces array subscripts with incremented pointer`, () => {
+    // while (i < 10) { p[i] = 0; i++ } for int p[]
+    const result = runPass(inductionVariableStrengthReduction, [
+      "block",
+      "loop",
+      "local.get $L1",
+      "i32.const 10",
+      "i32.ge_u",
+      "br_if 1",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "i32.const 0",
+      "i32.store",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.add",
+      "local.set $L1",
+      "br 0",
+      "end",
+      "end",
+    ]);
+    expect(result.code).toStrictEqual([
+      "block",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "local.set $IV1",
+      "loop",
+      "local.get $L1",
+      "i32.const 10",
+      "i32.ge_u",
+      "br_if 1",
+      "local.get $IV1",
+      "i32.const 0",
+      "i32.store",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.add",
+      "local.set $L1",
+      "local.get $IV1",
+      "i32.const 4",
+      "i32.add",
+      "local.set $IV1",
+      "br 0",
+      "end",
+      "end",
+    ]);
+    expect(result.counters).toStrictEqual({ "reduced-subscripts": 1 });
+  });
+
+  it(`Keeps subscripts when index is not an induction variable`, () => {
+    // Index is changed twice inside the loop
+    const code = [
+      "loop",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "i32.load8_u",
+      "local.set $L1",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.add",
+      "local.set $L1",
+      "local.get $L1",
+      "br_if 0",
+      "end",
+    ];
+    expect(runPass(inductionVariableStrengthReduction, code).code).toStrictEqual(
+      code
+    );
+  });
+});
@@ -0,0 +1,379 @@
+import { WAStructuredInstruction } from "./emitter.definitions";
+import {
+  IRFunction,
+  IRNode,
+  IRRegion,
+  IRBasicBlock,
+  forEachBasicBlock,
+  normalizeNodes,
+} from "./emitter.ir";
+import { IRPass, IRPassContext } from "./emitter.ir.passes";
+import {
+  createInstruction,
+  PURE_BINARY,
+  PURE_UNARY,
+  getStackEffect,
+  printInstruction,
+} from "./emitter.instructions";
+
+/*
+
+Loop optimizations. Loop is a "loop" region, its preheader is the place
+  right before the region: code there is executed once before the loop is entered.
+  Branches to "loop" label keep iterating, so they never go through preheader.
+
+ */
+
+export function countWrites(nodes: IRNode[]) {
+  const writes = new Map<string, number>();
+  forEachBasicBlock(nodes, (basicBlock) => {
+    for (const instruction of basicBlock.instructions) {
+      if (instruction.op === "local.set" || instruction.op === "local.tee") {
+        const name = instruction.args[0];
+        writes.set(name, (writes.get(name) || 0) + 1);
+      }
+    }
+  });
+  return writes;
+}
+
+export function getLocalType(func: IRFunction, name: string) {
+  const local = [...func.params, ...func.locals].find(
+    (local) => local.name === name
+  );
+  return local ? local.type : null;
+}
+
+function addLocal(func: IRFunction, prefix: string): string {
+  // Pipeline can run several times and locals can be removed between runs
+  let id = func.locals.length;
+  while (getLocalType(func, `$${prefix}${id}`)) {
+    id++;
+  }
+  const name = `$${prefix}${id}`;
+  func.locals.push({ name, type: "i32" });
+  return name;
+}
+
+/**
+ * Walks regions and calls callback for every loop, inner loops go first.
+ * Callback returns code for loop preheader
+ */
+function transformLoops(
+  nodes: IRNode[],
+  callback: (loop: IRRegion) => WAStructuredInstruction[]
+): IRNode[] {
+  const result: IRNode[] = [];
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      result.push(node);
+      continue;
+    }
+    node.body = transformLoops(node.body, callback);
+    if (node.elseBody) {
+      node.elseBody = transformLoops(node.elseBody, callback);
+    }
+    if (node.kind === "loop") {
+      const preheader = callback(node);
+      if (preheader.length > 0) {
+        result.push({ type: "basic-block", instructions: preheader });
+      }
+    }
+    result.push(node);
+  }
+  return result;
+}
+
+interface StackEntry {
+  /** Index of first instruction which computes this value */
+  start: number;
+  invariant: boolean;
+}
+
+/**
+ * Finds ranges of instructions in basic block which compute i32 value
+ *  only from constants and locals which are not changed inside the loop.
+ * Only maximal ranges are returned, i.e. not part of other invariant range
+ */
+function findInvariantRanges(
+  instructions: WAStructuredInstruction[],
+  isInvariantLocal: (name: string) => boolean
+): [number, number][] {
+  const ranges: [number, number][] = [];
+  let stack: StackEntry[] = [];
+  const pop = (): StackEntry =>
+    stack.pop() || { start: -1, invariant: false };
+  const consume = (entry: StackEntry, end: number) => {
+    // Single instruction is not worth a local
+    if (entry.invariant && end - entry.start >= 3) {
+      ranges.push([entry.start, end]);
+    }
+  };
+
+  instructions.forEach((instruction, index) => {
+    const op = instruction.op;
+    if (
+      op === "i32.const" ||
+      (op === "local.get" && isInvariantLocal(instruction.args[0]))
+    ) {
+      stack.push({ start: index, invariant: true });
+      return;
+    }
+    const isI32 = op.startsWith("i32.");
+    if (isI32 && PURE_BINARY.test(op)) {
+      const b = pop();
+      const a = pop();
+      if (a.invariant && b.invariant) {
+        stack.push({ start: a.start, invariant: true });
+        return;
+      }
+      consume(a, b.start);
+      consume(b, index);
+      stack.push({ start: a.start, invariant: false });
+      return;
+    }
+    if (isI32 && PURE_UNARY.test(op)) {
+      const a = pop();
+      if (a.invariant) {
+        stack.push({ start: a.start, invariant: true });
+        return;
+      }
+      stack.push({ start: a.start, invariant: false });
+      return;
+    }
+    const effect = getStackEffect(op);
+    if (!effect) {
+      // Calls and other instructions, we do not know how many values are taken
+      for (let i = stack.length - 1; i >= 0; i--) {
+        consume(stack[i], i === stack.length - 1 ? index : stack[i + 1].start);
+      }
+      stack = [];
+      return;
+    }
+    const [pops, pushes] = effect;
+    const popped: StackEntry[] = [];
+    for (let i = 0; i < pops; i++) {
+      popped.unshift(pop());
+    }
+    popped.forEach((entry, idx) =>
+      consume(entry, idx === popped.length - 1 ? index : popped[idx + 1].start)
+    );
+    for (let i = 0; i < pushes; i++) {
+      stack.push({
+        start: popped.length > 0 ? popped[0].start : index,
+        invariant: false,
+      });
+    }
+  });
+  // Values which are left on the stack are used by region end or branches
+  for (let i = stack.length - 1; i >= 0; i--) {
+    consume(
+      stack[i],
+      i === stack.length - 1 ? instructions.length : stack[i + 1].start
+    );
+  }
+
+  return ranges;
+}
+
+/**
+ * Pure computations which do not depend on values changed inside the loop
+ *  are moved into loop preheader and saved into local
+ */
+export const loopInvariantCodeMotion: IRPass = {
+  name: "loop-invariant-code-motion",
+  run(func, context) {
+    func.body = normalizeNodes(
+      transformLoops(func.body, (loop) => {
+        const writes = countWrites(loop.body);
+        const isInvariantLocal = (name: string) =>
+          !writes.has(name) && getLocalType(func, name) === "i32";
+
+        const preheader: WAStructuredInstruction[] = [];
+        const hoisted = new Map<string, string>();
+        forEachBasicBlock(loop.body, (basicBlock) => {
+          const ranges = findInvariantRanges(
+            basicBlock.instructions,
+            isInvariantLocal
+          ).sort((a, b) => b[0] - a[0]);
+          for (const [start, end] of ranges) {
+            const code = basicBlock.instructions.slice(start, end);
+            const key = code
+              .map((instruction) =>
+                printInstruction({ ...instruction, comment: null })
+              )
+              .join(";");
+            let localName = hoisted.get(key);
+            if (!localName) {
+              localName = addLocal(func, "H");
+              hoisted.set(key, localName);
+              preheader.push(
+                ...code,
+                createInstruction("local.set", [localName], "loop invariant")
+              );
+            }
+            basicBlock.instructions.splice(
+              start,
+              end - start,
+              createInstruction("local.get", [localName])
+            );
+            context.count("hoisted-expressions");
+          }
+        });
+        return preheader;
+      })
+    );
+  },
+};
+
+interface InductionVariable {
+  name: string;
+  /** How value is changed on every update */
+  step: number;
+  basicBlock: IRBasicBlock;
+  update: WAStructuredInstruction;
+}
+
+/**
+ * Finds locals which are changed only once inside loop as "i = i + step"
+ */
+function findInductionVariables(loop: IRRegion): Map<string, InductionVariable> {
+  const writes = countWrites(loop.body);
+  const variables = new Map<string, InductionVariable>();
+  forEachBasicBlock(loop.body, (basicBlock) => {
+    const code = basicBlock.instructions;
+    code.forEach((instruction, index) => {
+      if (
+        (instruction.op !== "local.set" && instruction.op !== "local.tee") ||
+        writes.get(instruction.args[0]) !== 1 ||
+        index < 3
+      ) {
+        return;
+      }
+      const [get, step, op] = code.slice(index - 3, index);
+      if (
+        get.op === "local.get" &&
+        get.args[0] === instruction.args[0] &&
+        step.op === "i32.const" &&
+        (op.op === "i32.add" || op.op === "i32.sub")
+      ) {
+        const stepValue = parseInt(step.args[0]) | 0;
+        variables.set(instruction.args[0], {
+          name: instruction.args[0],
+          step: op.op === "i32.add" ? stepValue : -stepValue | 0,
+          basicBlock,
+          update: instruction,
+        });
+      }
+    });
+  });
+  return variables;
+}
+
+function strengthReduceLoop(
+  func: IRFunction,
+  loop: IRRegion,
+  context: IRPassContext
+): WAStructuredInstruction[] {
+  const inductionVariables = findInductionVariables(loop);
+  if (inductionVariables.size === 0) {
+    return [];
+  }
+  const writes = countWrites(loop.body);
+  const isInvariantBase = (instruction: WAStructuredInstruction) =>
+    instruction.op === "i32.const" ||
+    (instruction.op === "local.get" &&
+      !writes.has(instruction.args[0]) &&
+      getLocalType(func, instruction.args[0]) === "i32");
+
+  const preheader: WAStructuredInstruction[] = [];
+  /** Pointer locals for every (base, variable, element size) */
+  const pointers = new Map<string, string>();
+  const pointerUpdates: {
+    variable: InductionVariable;
+    pointer: string;
+    elementSize: number;
+  }[] = [];
+
+  forEachBasicBlock(loop.body, (basicBlock) => {
+    const code = basicBlock.instructions;
+    for (let i = 0; i + 2 < code.length; i++) {
+      const [base, index] = code.slice(i, i + 2);
+      const variable =
+        index.op === "local.get" ? inductionVariables.get(index.args[0]) : null;
+      if (!variable || !isInvariantBase(base)) {
+        continue;
+      }
+      // Address is "base + index * elementSize", multiply by 1 is removed by peephole
+      let elementSize: number;
+      let length: number;
+      if (code[i + 2].op === "i32.add") {
+        elementSize = 1;
+        length = 3;
+      } else if (
+        i + 4 < code.length &&
+        code[i + 2].op === "i32.const" &&
+        code[i + 3].op === "i32.mul" &&
+        code[i + 4].op === "i32.add"
+      ) {
+        elementSize = parseInt(code[i + 2].args[0]) | 0;
+        length = 5;
+      } else {
+        continue;
+      }
+
+      const key = `${printInstruction({ ...base, comment: null })};${
+        variable.name
+      };${elementSize}`;
+      let pointer = pointers.get(key);
+      if (!pointer) {
+        pointer = addLocal(func, "IV");
+        pointers.set(key, pointer);
+        preheader.push(
+          base,
+          createInstruction("local.get", [variable.name]),
+          createInstruction("i32.const", [`${elementSize}`]),
+          createInstruction("i32.mul"),
+          createInstruction("i32.add"),
+          createInstruction("local.set", [pointer], "induction pointer")
+        );
+        pointerUpdates.push({ variable, pointer, elementSize });
+      }
+      code.splice(i, length, createInstruction("local.get", [pointer]));
+      context.count("reduced-subscripts");
+    }
+  });
+
+  for (const { variable, pointer, elementSize } of pointerUpdates) {
+    const code = variable.basicBlock.instructions;
+    const updateIndex = code.indexOf(variable.update);
+    if (updateIndex === -1) {
+      throw new Error("Internal error: induction variable update is lost");
+    }
+    code.splice(
+      updateIndex + 1,
+      0,
+      createInstruction("local.get", [pointer]),
+      createInstruction("i32.const", [`${Math.imul(variable.step, elementSize)}`]),
+      createInstruction("i32.add"),
+      createInstruction("local.set", [pointer], "induction pointer step")
+    );
+  }
+
+  return preheader;
+}
+
+/**
+ * Array subscripts "base[i]" where "i" is changed by constant step
+ *   are replaced by pointer which is incremented together with "i"
+ */
+export const inductionVariableStrengthReduction: IRPass = {
+  name: "induction-variables",
+  run(func, context) {
+    func.body = normalizeNodes(
+      transformLoops(func.body, (loop) =>
+        strengthReduceLoop(func, loop, context)
+      )
+    );
+  },
+};
@@ -0,0 +1,448 @@
+import { WAStructuredInstruction } from "./emitter.definitions";
+import {
+  IRFunction,
+  IRNode,
+  IRRegion,
+  UNCONDITIONAL_BRANCHES,
+  forEachBasicBlock,
+  normalizeNodes,
+} from "./emitter.ir";
+
+export interface IRPassContext {
+  /** Increases named counter which is shown in pass statistics */
+  count(counter: string): void;
+}
+
+export interface IRPass {
+  name: string;
+  run(func: IRFunction, context: IRPassContext): void;
+}
+
+function i32(value: number) {
+  return value | 0;
+}
+
+function u32(value: number) {
+  return value >>> 0;
+}
+
+/**
+ * Evaluates i32 binary operation. Returns null if result is not known
+ * on compilation time, for example on division by zero which must trap
+ */
+function evalI32Binary(op: string, a: number, b: number): number | null {
+  switch (op) {
+    case "i32.add":
+      return i32(a + b);
+    case "i32.sub":
+      return i32(a - b);
+    case "i32.mul":
+      return Math.imul(a, b);
+    case "i32.and":
+      return a & b;
+    case "i32.or":
+      return a | b;
+    case "i32.xor":
+      return a ^ b;
+    case "i32.shl":
+      return a << (b & 31);
+    case "i32.shr_s":
+      return a >> (b & 31);
+    case "i32.shr_u":
+      return i32(u32(a) >>> (b & 31));
+    case "i32.div_s":
+      return b === 0 || (a === -0x80000000 && b === -1) ? null : i32(a / b);
+    case "i32.div_u":
+      return b === 0 ? null : i32(Math.floor(u32(a) / u32(b)));
+    case "i32.rem_s":
+      return b === 0 ? null : b === -1 ? 0 : i32(a % b);
+    case "i32.rem_u":
+      return b === 0 ? null : i32(u32(a) % u32(b));
+    case "i32.eq":
+      return a === b ? 1 : 0;
+    case "i32.ne":
+      return a !== b ? 1 : 0;
+    case "i32.lt_s":
+      return a < b ? 1 : 0;
+    case "i32.le_s":
+      return a <= b ? 1 : 0;
+    case "i32.gt_s":
+      return a > b ? 1 : 0;
+    case "i32.ge_s":
+      return a >= b ? 1 : 0;
+    case "i32.lt_u":
+      return u32(a) < u32(b) ? 1 : 0;
+    case "i32.le_u":
+      return u32(a) <= u32(b) ? 1 : 0;
+    case "i32.gt_u":
+      return u32(a) > u32(b) ? 1 : 0;
+    case "i32.ge_u":
+      return u32(a) >= u32(b) ? 1 : 0;
+  }
+  return null;
+}
+
+function evalI32Unary(op: string, a: number): number | null {
+  switch (op) {
+    case "i32.eqz":
+      return a === 0 ? 1 : 0;
+    case "i32.extend8_s":
+      return (a << 24) >> 24;
+    case "i32.extend16_s":
+      return (a << 16) >> 16;
+  }
+  return null;
+}
+
+function getI32Const(instruction: WAStructuredInstruction | undefined): number | null {
+  if (!instruction || instruction.op !== "i32.const") {
+    return null;
+  }
+  return i32(parseInt(instruction.args[0]));
+}
+
+function i32Const(value: number, comment: string | null): WAStructuredInstruction {
+  return { op: "i32.const", args: [`${value}`], comment };
+}
+
+/**
+ * Replaces operations on constants with the result.
+ * Works on the operand stack of basic block, so it also folds
+ * values which appeared after other passes
+ */
+export const constantFolding: IRPass = {
+  name: "constant-folding",
+  run(func) {
+    forEachBasicBlock(func.body, (basicBlock) => {
+      const result: WAStructuredInstruction[] = [];
+      for (const instruction of basicBlock.instructions) {
+        const a = getI32Const(result[result.length - 2]);
+        const b = getI32Const(result[result.length - 1]);
+        if (a !== null && b !== null) {
+          const value = evalI32Binary(instruction.op, a, b);
+          if (value !== null) {
+            result.splice(result.length - 2, 2, i32Const(value, "folded"));
+            continue;
+          }
+        }
+        if (b !== null) {
+          const value = evalI32Unary(instruction.op, b);
+          if (value !== null) {
+            result.splice(result.length - 1, 1, i32Const(value, "folded"));
+            continue;
+          }
+        }
+        result.push(instruction);
+      }
+      basicBlock.instructions = result;
+    });
+  },
+};
+
+function foldBranches(nodes: IRNode[]): IRNode[] {
+  const result: IRNode[] = [];
+  for (const node of nodes) {
+    const last = result[result.length - 1];
+    const lastInstructions =
+      last && last.type === "basic-block" ? last.instructions : null;
+    const condition = lastInstructions
+      ? getI32Const(lastInstructions[lastInstructions.length - 1])
+      : null;
+
+    if (node.type === "basic-block") {
+      const br = node.instructions[node.instructions.length - 1];
+      if (br && br.op === "br_if") {
+        const brCondition = getI32Const(
+          node.instructions[node.instructions.length - 2]
+        );
+        if (brCondition !== null) {
+          node.instructions.splice(node.instructions.length - 2, 2);
+          if (brCondition !== 0) {
+            node.instructions.push({ ...br, op: "br" });
+          }
+        }
+      }
+      result.push(node);
+      continue;
+    }
+
+    node.body = foldBranches(node.body);
+    if (node.elseBody) {
+      node.elseBody = foldBranches(node.elseBody);
+    }
+
+    if (node.kind === "if" && lastInstructions && condition !== null) {
+      lastInstructions.pop();
+      const taken = condition !== 0 ? node.body : node.elseBody;
+      if (taken || node.blockType) {
+        // Keep a block because branches inside use its label
+        result.push({
+          type: "region",
+          kind: "block",
+          blockType: node.blockType,
+          comment: node.comment,
+          body: taken || [],
+          elseBody: null,
+        });
+      }
+      continue;
+    }
+    result.push(node);
+  }
+  return result;
+}
+
+/**
+ * Conditional branches on constant conditions become unconditional
+ * or are removed
+ */
+export const branchFolding: IRPass = {
+  name: "branch-folding",
+  run(func) {
+    func.body = normalizeNodes(foldBranches(func.body));
+  },
+};
+
+function removeDeadCode(nodes: IRNode[]): IRNode[] {
+  const result: IRNode[] = [];
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      result.push(node);
+      const last = node.instructions[node.instructions.length - 1];
+      if (last && UNCONDITIONAL_BRANCHES.indexOf(last.op) !== -1) {
+        // Rest of this block is never reached
+        break;
+      }
+    } else {
+      node.body = removeDeadCode(node.body);
+      if (node.elseBody) {
+        node.elseBody = removeDeadCode(node.elseBody);
+      }
+      if (
+        !node.blockType &&
+        node.body.length === 0 &&
+        (!node.elseBody || node.elseBody.length === 0)
+      ) {
+        if (node.kind === "if") {
+          // Condition is still on the stack
+          result.push({
+            type: "basic-block",
+            instructions: [{ op: "drop", args: [], comment: "empty if" }],
+          });
+        }
+        continue;
+      }
+      result.push(node);
+    }
+  }
+  return result;
+}
+
+/**
+ * Removes code after unconditional branches and empty regions
+ */
+export const deadCodeElimination: IRPass = {
+  name: "dead-code-elimination",
+  run(func) {
+    func.body = normalizeNodes(removeDeadCode(func.body));
+  },
+};
+
+/** Returns labels of branch instruction, labels are relative depths */
+function getBranchLabels(instruction: WAStructuredInstruction): number[] {
+  if (
+    instruction.op === "br" ||
+    instruction.op === "br_if" ||
+    instruction.op === "br_table"
+  ) {
+    return instruction.args.map((arg) => parseInt(arg));
+  }
+  return [];
+}
+
+/** Checks if any branch inside region body have this region as target */
+function isRegionTargeted(region: IRRegion) {
+  let targeted = false;
+  const walk = (nodes: IRNode[], depth: number) => {
+    for (const node of nodes) {
+      if (node.type === "basic-block") {
+        for (const instruction of node.instructions) {
+          if (getBranchLabels(instruction).indexOf(depth) !== -1) {
+            targeted = true;
+          }
+        }
+      } else {
+        walk(node.body, depth + 1);
+        if (node.elseBody) {
+          walk(node.elseBody, depth + 1);
+        }
+      }
+    }
+  };
+  walk(region.body, 0);
+  return targeted;
+}
+
+/** Decreases labels which point outside of region which is being removed */
+function unwrapRegionLabels(nodes: IRNode[], depth: number) {
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      for (const instruction of node.instructions) {
+        if (getBranchLabels(instruction).length > 0) {
+          instruction.args = getBranchLabels(instruction).map(
+            (label) => `${label > depth ? label - 1 : label}`
+          );
+        }
+      }
+    } else {
+      unwrapRegionLabels(node.body, depth + 1);
+      if (node.elseBody) {
+        unwrapRegionLabels(node.elseBody, depth + 1);
+      }
+    }
+  }
+}
+
+function flattenBlocks(nodes: IRNode[]): IRNode[] {
+  const result: IRNode[] = [];
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      result.push(node);
+      continue;
+    }
+    node.body = flattenBlocks(node.body);
+    if (node.elseBody) {
+      node.elseBody = flattenBlocks(node.elseBody);
+    }
+    if (node.kind !== "if" && !isRegionTargeted(node)) {
+      unwrapRegionLabels(node.body, 0);
+      result.push(...node.body);
+    } else {
+      result.push(node);
+    }
+  }
+  return result;
+}
+
+/**
+ * Blocks and loops which are never used as branch target are replaced
+ * by their bodies. Compound statements produce a lot of them
+ */
+export const blockFlattening: IRPass = {
+  name: "block-flattening",
+  run(func) {
+    func.body = normalizeNodes(flattenBlocks(func.body));
+  },
+};
+
+function countLocalsUsage(func: IRFunction) {
+  const reads = new Map<string, number>();
+  const writes = new Map<string, number>();
+  forEachBasicBlock(func.body, (basicBlock) => {
+    for (const instruction of basicBlock.instructions) {
+      const map =
+        instruction.op === "local.get"
+          ? reads
+          : instruction.op === "local.set" || instruction.op === "local.tee"
+          ? writes
+          : null;
+      if (map) {
+        const name = instruction.args[0];
+        map.set(name, (map.get(name) || 0) + 1);
+      }
+    }
+  });
+  return { reads, writes };
+}
+
+function isConst(instruction: WAStructuredInstruction | undefined) {
+  return !!instruction && /^[if](32|64)\.const$/.test(instruction.op);
+}
+
+/**
+ * Locals (but not params) which are assigned only once with a constant
+ * are replaced by this constant.
+ * Reading a local before assignment is reading uninitialized variable,
+ * so it is fine to see constant value there too
+ */
+export const localConstantPropagation: IRPass = {
+  name: "local-constant-propagation",
+  run(func) {
+    const { writes } = countLocalsUsage(func);
+    const constants = new Map<string, WAStructuredInstruction>();
+    forEachBasicBlock(func.body, (basicBlock) => {
+      basicBlock.instructions.forEach((instruction, index) => {
+        if (
+          (instruction.op === "local.set" || instruction.op === "local.tee") &&
+          writes.get(instruction.args[0]) === 1 &&
+          func.locals.some((local) => local.name === instruction.args[0]) &&
+          isConst(basicBlock.instructions[index - 1])
+        ) {
+          constants.set(
+            instruction.args[0],
+            basicBlock.instructions[index - 1]
+          );
+        }
+      });
+    });
+    if (constants.size === 0) {
+      return;
+    }
+    forEachBasicBlock(func.body, (basicBlock) => {
+      basicBlock.instructions = basicBlock.instructions.map((instruction) => {
+        const constant =
+          instruction.op === "local.get"
+            ? constants.get(instruction.args[0])
+            : undefined;
+        return constant
+          ? { ...constant, comment: `${instruction.args[0]} is constant` }
+          : instruction;
+      });
+    });
+  },
+};
+
+/**
+ * Removes writes into locals which are never read
+ */
+export const deadStoreElimination: IRPass = {
+  name: "dead-store-elimination",
+  run(func) {
+    const { reads } = countLocalsUsage(func);
+    forEachBasicBlock(func.body, (basicBlock) => {
+      const result: WAStructuredInstruction[] = [];
+      for (const instruction of basicBlock.instructions) {
+        if (
+          (instruction.op === "local.set" || instruction.op === "local.tee") &&
+          !reads.get(instruction.args[0])
+        ) {
+          if (instruction.op === "local.tee") {
+            // Value stays on the stack
+            continue;
+          }
+          if (isConst(result[result.length - 1])) {
+            result.pop();
+          } else {
+            result.push({ op: "drop", args: [], comment: instruction.comment });
+          }
+          continue;
+        }
+        result.push(instruction);
+      }
+      basicBlock.instructions = result;
+    });
+  },
+};
+
+/**
+ * Removes declarations of locals which are not used anymore
+ */
+export const unusedLocalsElimination: IRPass = {
+  name: "unused-locals",
+  run(func) {
+    const { reads, writes } = countLocalsUsage(func);
+    func.locals = func.locals.filter(
+      (local) => reads.has(local.name) || writes.has(local.name)
+    );
+  },
+};
@@ -0,0 +1,190 @@
+import { WAFunction } from "./emitter.definitions";
+import { buildIR, lowerIR, countInstructions } from "./emitter.ir";
+import {
+  IRPass,
+  constantFolding,
+  branchFolding,
+  deadCodeElimination,
+  blockFlattening,
+  localConstantPropagation,
+  deadStoreElimination,
+  unusedLocalsElimination,
+} from "./emitter.ir.passes";
+import { peephole } from "./emitter.ir.peephole";
+import {
+  loopInvariantCodeMotion,
+  inductionVariableStrengthReduction,
+} from "./emitter.ir.loops";
+import { loopVectorization } from "./emitter.ir.vectorizer";
+import {
+  inlineFunctions,
+  removeUnreferencedFunctions,
+  getDefaultInlinerOptions,
+  DEFAULT_INLINE_BUDGET,
+} from "./emitter.ir.inliner";
+
+export type OptimizationLevel = 0 | 1 | 2;
+
+/**
+ * Ordered passes for each level, same pass can appear several times.
+ * SIMD code is generated only on level 2 and only if requested
+ */
+export function getPassPipeline(
+  level: OptimizationLevel,
+  simd = false
+): IRPass[] {
+  if (level === 0) {
+    return [];
+  } else if (level === 1) {
+    return [constantFolding, peephole, branchFolding, deadCodeElimination];
+  } else {
+    return [
+      constantFolding,
+      peephole,
+      branchFolding,
+      deadCodeElimination,
+      blockFlattening,
+      localConstantPropagation,
+      loopInvariantCodeMotion,
+      ...(simd ? [loopVectorization] : []),
+      inductionVariableStrengthReduction,
+      constantFolding,
+      branchFolding,
+      deadStoreElimination,
+      peephole,
+      deadCodeElimination,
+      unusedLocalsElimination,
+    ];
+  }
+}
+
+export interface PassStatistics {
+  name: string;
+  timeMs: number;
+  instructionsBefore: number;
+  instructionsAfter: number;
+  /** Pass specific counters, for example how many times peephole rule fired */
+  counters: { [counter: string]: number };
+}
+
+function now() {
+  // Node before v16 have no global performance
+  return typeof performance !== "undefined" ? performance.now() : Date.now();
+}
+
+export function createPassManager(passes: IRPass[]) {
+  const statistics: PassStatistics[] = passes.map((pass) => ({
+    name: pass.name,
+    timeMs: 0,
+    instructionsBefore: 0,
+    instructionsAfter: 0,
+    counters: {},
+  }));
+
+  function runOnFunction(func: WAFunction): WAFunction {
+    if (passes.length === 0) {
+      return func;
+    }
+    const ir = buildIR(func);
+    passes.forEach((pass, index) => {
+      const passStatistics = statistics[index];
+      passStatistics.instructionsBefore += countInstructions(ir.body);
+      const started = now();
+      pass.run(ir, {
+        count: (counter) => {
+          passStatistics.counters[counter] =
+            (passStatistics.counters[counter] || 0) + 1;
+        },
+      });
+      passStatistics.timeMs += now() - started;
+      passStatistics.instructionsAfter += countInstructions(ir.body);
+    });
+    return lowerIR(func, ir);
+  }
+
+  return {
+    runOnFunction,
+    /** Per-pass statistics summed over all functions, in pipeline order */
+    getStatistics: () => statistics,
+  };
+}
+
+export interface OptimizationOptions {
+  level: OptimizationLevel;
+  /** Inliner is used only on level 2, zero budget disables it */
+  inlineBudget?: number;
+  isInlineSpecified(func: WAFunction): boolean;
+  /** Functions in table are never removed */
+  table: string[];
+  simd?: boolean;
+}
+
+function countBodies(functions: WAFunction[]) {
+  return functions.reduce((sum, func) => sum + func.body.length, 0);
+}
+
+/**
+ * Runs function passes and then module-wide ones.
+ * Functions which were changed by the inliner get function passes again
+ */
+export function optimizeFunctions(
+  functions: WAFunction[],
+  options: OptimizationOptions
+) {
+  const passes = getPassPipeline(options.level, options.simd);
+  const passManager = createPassManager(passes);
+  let optimized = functions.map(passManager.runOnFunction);
+  const statistics = [...passManager.getStatistics()];
+
+  const inlineBudget =
+    options.inlineBudget !== undefined
+      ? options.inlineBudget
+      : DEFAULT_INLINE_BUDGET;
+  if (options.level >= 2 && inlineBudget > 0) {
+    const instructionsBefore = countBodies(optimized);
+    const started = now();
+    const inlined = inlineFunctions(
+      optimized,
+      options.isInlineSpecified,
+      getDefaultInlinerOptions(inlineBudget)
+    );
+    optimized = removeUnreferencedFunctions(inlined.functions, options.table);
+    statistics.push({
+      name: "inliner",
+      timeMs: now() - started,
+      instructionsBefore,
+      instructionsAfter: countBodies(optimized),
+      counters: {
+        "inlined-calls": inlined.inlinedCalls,
+        "removed-functions": inlined.functions.length - optimized.length,
+      },
+    });
+
+    const cleanupPassManager = createPassManager(passes);
+    optimized = optimized.map((func) =>
+      inlined.changed.has(func.name)
+        ? cleanupPassManager.runOnFunction(func)
+        : func
+    );
+    statistics.push(...cleanupPassManager.getStatistics());
+  }
+
+  return { functions: optimized, statistics };
+}
+
+export function formatPassStatistics(statistics: PassStatistics[]): string[] {
+  const lines: string[] = [];
+  for (const pass of statistics) {
+    lines.push(
+      `  ${pass.name}: ${pass.timeMs.toFixed(2)}ms, instructions ${
+        pass.instructionsBefore
+      } -> ${pass.instructionsAfter} (${
+        pass.instructionsAfter - pass.instructionsBefore
+      })`
+    );
+    for (const counter of Object.keys(pass.counters).sort()) {
+      lines.push(`    ${counter}: ${pass.counters[counter]}`);
+    }
+  }
+  return lines;
+}
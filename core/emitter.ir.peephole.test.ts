@@ -0,0 +1,174 @@
+import { WAFunction } from "./emitter.definitions";
+import { buildIR, lowerIR } from "./emitter.ir";
+import { parseInstructions, printInstruction } from "./emitter.instructions";
+import { peephole } from "./emitter.ir.peephole";
+
+function runPeephole(code: string[]) {
+  const func: WAFunction = {
+    name: "$test",
+    typeName: "$FUNCSIGv",
+    params: [],
+    results: [],
+    locals: [{ name: "$L1", type: "i32" }],
+    body: parseInstructions(code),
+    exportName: null,
+    sourceName: null,
+    comment: null,
+  };
+  const ir = buildIR(func);
+  const counters: { [name: string]: number } = {};
+  peephole.run(ir, {
+    count: (counter) => {
+      counters[counter] = (counters[counter] || 0) + 1;
+    },
+  });
+  return {
+    code: lowerIR(func, ir).body.map((instruction) =>
+      printInstruction({ ...instruction, comment: null })
+    ),
+    counters,
+  };
+}
+
+describe("Peephole", () => {
+  it(`Uses local.tee`, () => {
+    expect(
+      runPeephole(["i32.const 1", "local.set $L1", "local.get $L1", "call 1"])
+    ).toStrictEqual({
+      code: ["i32.const 1", "local.tee $L1", "call 1"],
+      counters: { "set-get-to-tee": 1 },
+    });
+  });
+
+  it(`Removes nop and neutral constants`, () => {
+    expect(
+      runPeephole([
+        "nop",
+        "local.get $L1",
+        "i32.const 0",
+        "i32.add",
+        "i32.const 1",
+        "i32.mul",
+        "local.set $L1",
+      ]).code
+    ).toStrictEqual(["local.get $L1", "local.set $L1"]);
+  });
+
+  it(`Widens constants on compilation time`, () => {
+    expect(
+      runPeephole([
+        "i32.const -1",
+        "i64.extend_i32_u",
+        "i32.const 4294967295",
+        "i64.extend_i32_s",
+        "i64.add",
+        "call 1",
+      ]).code
+    ).toStrictEqual([
+      "i64.const 4294967295",
+      "i64.const -1",
+      "i64.add",
+      "call 1",
+    ]);
+  });
+
+  it(`Simplifies conditions`, () => {
+    expect(
+      runPeephole([
+        "block",
+        "local.get $L1",
+        "i32.eqz",
+        "i32.eqz",
+        "br_if 0",
+        "local.get $L1",
+        "i32.const 10",
+        "i32.lt_u",
+        "i32.eqz",
+        "br_if 0",
+        "end",
+      ]).code
+    ).toStrictEqual([
+      "block",
+      "local.get $L1",
+      "br_if 0",
+      "local.get $L1",
+      "i32.const 10",
+      "i32.ge_u",
+      "br_if 0",
+      "end",
+    ]);
+  });
+
+  it(`Removes double negation of if condition`, () => {
+    expect(
+      runPeephole([
+        "local.get $L1",
+        "i32.const 10",
+        "i32.lt_u",
+        "i32.eqz",
+        "i32.eqz",
+        "if",
+        "local.get $L1",
+        "i32.eqz",
+        "i32.eqz",
+        "i32.eqz",
+        "if",
+        "nop",
+        "end",
+        "end",
+      ])
+    ).toStrictEqual({
+      code: [
+        "local.get $L1",
+        "i32.const 10",
+        "i32.lt_u",
+        "if",
+        "local.get $L1",
+        "i32.eqz",
+        "if",
+        "end",
+        "end",
+      ],
+      counters: { "double-eqz": 2, "remove-nop": 1 },
+    });
+  });
+
+  it(`Removes reload after assignment statement`, () => {
+    // *(p + 4) = 5;
+    const result = runPeephole([
+      "local.get $L1",
+      "i32.const 4",
+      "i32.add",
+      "i32.const 5",
+      "i32.store offset=0 align=1",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.add",
+      "i32.load offset=0 align=1",
+      "drop",
+    ]);
+    expect(result.code).toStrictEqual([
+      "local.get $L1",
+      "i32.const 4",
+      "i32.add",
+      "i32.const 5",
+      "i32.store offset=0 align=1",
+    ]);
+    expect(result.counters["load-drop"]).toBe(1);
+  });
+
+  it(`Removes unused old value of postfix increment`, () => {
+    // i++;
+    expect(
+      runPeephole([
+        "local.get $L1",
+        "local.get $L1",
+        "i32.const 1",
+        "i32.add",
+        "local.tee $L1",
+        "drop",
+        "drop",
+      ]).code
+    ).toStrictEqual(["local.get $L1", "i32.const 1", "i32.add", "local.set $L1"]);
+  });
+});
@@ -0,0 +1,246 @@
+import { WAStructuredInstruction } from "./emitter.definitions";
+import { forEachBasicBlock, IRNode } from "./emitter.ir";
+import { IRPass } from "./emitter.ir.passes";
+import {
+  createInstruction,
+  PURE_VALUE,
+  PURE_BINARY,
+  PURE_UNARY,
+  LOAD,
+  getStackEffect,
+} from "./emitter.instructions";
+
+type InstructionMatcher = string | RegExp;
+
+export interface PeepholeRule {
+  name: string;
+  /** Opcodes of instructions which follow each other */
+  pattern: InstructionMatcher[];
+  /** Returns replacement for matched instructions or null if not applicable */
+  replace(matched: WAStructuredInstruction[]): WAStructuredInstruction[] | null;
+}
+
+const INVERTED_COMPARE: { [op: string]: string } = {
+  eq: "ne",
+  ne: "eq",
+  lt_s: "ge_s",
+  ge_s: "lt_s",
+  gt_s: "le_s",
+  le_s: "gt_s",
+  lt_u: "ge_u",
+  ge_u: "lt_u",
+  gt_u: "le_u",
+  le_u: "gt_u",
+};
+
+function drop(comment: string | null) {
+  return createInstruction("drop", [], comment);
+}
+
+export const PEEPHOLE_RULES: PeepholeRule[] = [
+  {
+    name: "remove-nop",
+    pattern: ["nop"],
+    replace: () => [],
+  },
+  {
+    name: "set-get-to-tee",
+    pattern: ["local.set", "local.get"],
+    replace: ([set, get]) =>
+      set.args[0] === get.args[0]
+        ? [createInstruction("local.tee", set.args, set.comment)]
+        : null,
+  },
+  {
+    name: "tee-drop-to-set",
+    pattern: ["local.tee", "drop"],
+    replace: ([tee]) => [createInstruction("local.set", tee.args, tee.comment)],
+  },
+  {
+    name: "add-zero",
+    pattern: ["i32.const", /^i32\.(add|sub|or|xor|shl|shr_[su])$/],
+    replace: ([value]) => (parseInt(value.args[0]) === 0 ? [] : null),
+  },
+  {
+    name: "mul-one",
+    pattern: ["i32.const", /^i32\.(mul|div_[su])$/],
+    replace: ([value]) => (parseInt(value.args[0]) === 1 ? [] : null),
+  },
+  {
+    name: "double-eqz",
+    pattern: ["i32.eqz", "i32.eqz", /^(br_if|i32\.eqz)$/],
+    replace: ([, , next]) => [next],
+  },
+  {
+    name: "inverted-compare",
+    pattern: [/^i(32|64)\.(eq|ne|[lg][te]_[su])$/, "i32.eqz"],
+    replace: ([compare, eqz]) => {
+      const [type, op] = compare.op.split(".");
+      return [
+        createInstruction(`${type}.${INVERTED_COMPARE[op]}`, [], eqz.comment),
+      ];
+    },
+  },
+  {
+    // Int constants are widened when they are used with long long values
+    name: "extend-const",
+    pattern: ["i32.const", /^i64\.extend_i32_[su]$/],
+    replace: ([value, extend]) => {
+      const i32 = parseInt(value.args[0]) | 0;
+      const i64 = extend.op === "i64.extend_i32_s" ? i32 : i32 >>> 0;
+      return [createInstruction("i64.const", [`${i64}`], value.comment)];
+    },
+  },
+  {
+    name: "mask-after-load8u",
+    pattern: ["i32.load8_u", "i32.const", "i32.and"],
+    replace: ([load, mask]) =>
+      (parseInt(mask.args[0]) & 0xff) === 0xff ? [load] : null,
+  },
+  {
+    // Assignment expression stores value and then loads it again,
+    //  when it is a statement this value is dropped
+    name: "load-drop",
+    pattern: [LOAD, "drop"],
+    replace: ([, dropped]) => [drop(dropped.comment)],
+  },
+  {
+    name: "pure-value-drop",
+    pattern: [PURE_VALUE, "drop"],
+    replace: () => [],
+  },
+  {
+    name: "pure-unary-drop",
+    pattern: [PURE_UNARY, "drop"],
+    replace: ([, dropped]) => [dropped],
+  },
+  {
+    name: "pure-binary-drop",
+    pattern: [PURE_BINARY, "drop"],
+    replace: ([, dropped]) => [dropped, drop(dropped.comment)],
+  },
+];
+
+function isMatched(
+  instruction: WAStructuredInstruction,
+  matcher: InstructionMatcher
+) {
+  return typeof matcher === "string"
+    ? instruction.op === matcher
+    : matcher.test(instruction.op);
+}
+
+/**
+ * Finds which instruction pushed the value dropped by "drop" at dropIndex.
+ * If it is a pure value then both are removed. It happens for example
+ *  with postfix increment as statement, where old value is dropped
+ *  after the new one is saved
+ */
+function removeUnusedPureValue(
+  code: WAStructuredInstruction[],
+  dropIndex: number
+) {
+  // Position of our value counting from the top of the stack
+  let depth = 0;
+  for (let i = dropIndex - 1; i >= 0; i--) {
+    const effect = getStackEffect(code[i].op);
+    if (!effect) {
+      return false;
+    }
+    const [pops, pushes] = effect;
+    if (depth < pushes) {
+      if (pops !== 0 || !PURE_VALUE.test(code[i].op)) {
+        return false;
+      }
+      code.splice(dropIndex, 1);
+      code.splice(i, 1);
+      return true;
+    }
+    depth = depth - pushes + pops;
+  }
+  return false;
+}
+
+function runRules(
+  code: WAStructuredInstruction[],
+  rules: PeepholeRule[],
+  count: (counter: string) => void
+) {
+  let changed = true;
+  while (changed) {
+    changed = false;
+    for (let i = 0; i < code.length; i++) {
+      for (const rule of rules) {
+        if (
+          i + rule.pattern.length > code.length ||
+          !rule.pattern.every((matcher, idx) =>
+            isMatched(code[i + idx], matcher)
+          )
+        ) {
+          continue;
+        }
+        const replacement = rule.replace(
+          code.slice(i, i + rule.pattern.length)
+        );
+        if (!replacement) {
+          continue;
+        }
+        code.splice(i, rule.pattern.length, ...replacement);
+        count(rule.name);
+        changed = true;
+        break;
+      }
+      if (code[i] && code[i].op === "drop" && removeUnusedPureValue(code, i)) {
+        count("unused-pure-value");
+        changed = true;
+      }
+    }
+  }
+}
+
+/**
+ * Condition of "if" is computed at the end of the previous basic block,
+ *  so rules do not see "if" and double negation is removed here
+ */
+function foldIfConditions(nodes: IRNode[], count: (counter: string) => void) {
+  nodes.forEach((node, idx) => {
+    if (node.type === "basic-block") {
+      return;
+    }
+    foldIfConditions(node.body, count);
+    if (node.elseBody) {
+      foldIfConditions(node.elseBody, count);
+    }
+    const previous = nodes[idx - 1];
+    if (node.kind !== "if" || !previous || previous.type !== "basic-block") {
+      return;
+    }
+    const code = previous.instructions;
+    while (
+      code.length >= 2 &&
+      code[code.length - 1].op === "i32.eqz" &&
+      code[code.length - 2].op === "i32.eqz"
+    ) {
+      code.splice(code.length - 2, 2);
+      count("double-eqz");
+    }
+  });
+}
+
+/**
+ * Local rewrites inside basic blocks. Rules are applied until nothing changes,
+ *  every fired rule is counted in statistics
+ */
+export function createPeepholePass(rules: PeepholeRule[]): IRPass {
+  return {
+    name: "peephole",
+    run(func, context) {
+      foldIfConditions(func.body, context.count);
+      forEachBasicBlock(func.body, (basicBlock) => {
+        runRules(basicBlock.instructions, rules, context.count);
+      });
+    },
+  };
+}
+
+export const peephole = createPeepholePass(PEEPHOLE_RULES);
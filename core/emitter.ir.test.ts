@@ -0,0 +1,243 @@
+import { WAFunction, WAInstuction } from "./emitter.definitions";
+import { buildIR, lowerIR, countInstructions } from "./emitter.ir";
+import { parseInstructions, printInstruction } from "./emitter.instructions";
+import {
+  IRPass,
+  constantFolding,
+  branchFolding,
+  deadCodeElimination,
+  blockFlattening,
+  localConstantPropagation,
+  deadStoreElimination,
+  unusedLocalsElimination,
+} from "./emitter.ir.passes";
+import { createPassManager, getPassPipeline } from "./emitter.ir.passmanager";
+
+function createFunction(body: WAInstuction[]): WAFunction {
+  return {
+    name: "$test",
+    typeName: "$FUNCSIGi",
+    params: [{ name: "$P1", type: "i32" }],
+    results: ["i32"],
+    locals: [
+      { name: "$L1", type: "i32" },
+      { name: "$L2", type: "i32" },
+    ],
+    body: parseInstructions(body),
+    exportName: null,
+    sourceName: null,
+    comment: null,
+  };
+}
+
+/** Runs passes and returns code without comments */
+function optimize(body: WAInstuction[], ...passes: IRPass[]) {
+  const func = createFunction(body);
+  const ir = buildIR(func);
+  for (const pass of passes) {
+    pass.run(ir);
+  }
+  const lowered = lowerIR(func, ir);
+  return {
+    body: lowered.body.map((instruction) =>
+      printInstruction({ ...instruction, comment: null })
+    ),
+    locals: lowered.locals.map((local) => local.name),
+  };
+}
+
+describe("Mid-level IR", () => {
+  it(`Builds regions and basic blocks`, () => {
+    const ir = buildIR(
+      createFunction([
+        "block (result i32) ;; main",
+        "local.get $P1",
+        "if",
+        "i32.const 1",
+        "br 1 ;; return",
+        "else",
+        ";; only comment",
+        "i32.const 2",
+        "br 1",
+        "end",
+        "local.get $P1",
+        "br_if 0",
+        "i32.const 3",
+        "end",
+      ])
+    );
+    expect(ir.body.length).toBe(1);
+    const main = ir.body[0];
+    if (main.type !== "region") {
+      throw new Error("Expected region");
+    }
+    expect(main.blockType).toBe("(result i32)");
+    expect(main.body.map((node) => node.type)).toStrictEqual([
+      "basic-block",
+      "region",
+      "basic-block",
+      "basic-block",
+    ]);
+    expect(countInstructions(ir.body)).toBe(13);
+  });
+
+  it(`Lowers back to the same code`, () => {
+    const code = [
+      "block (result i32) ;; main",
+      "loop",
+      "local.get $P1",
+      "br_if 1",
+      "br 0",
+      "end",
+      "i32.const 0",
+      "end",
+    ];
+    const func = createFunction(code);
+    expect(lowerIR(func, buildIR(func)).body.map(printInstruction)).toStrictEqual(
+      code
+    );
+  });
+
+  it(`Folds constants`, () => {
+    expect(
+      optimize(
+        [
+          "i32.const 250",
+          "i32.const 255",
+          "i32.and",
+          "i32.const 2",
+          "i32.mul",
+          "i32.eqz",
+          "i32.eqz",
+          "i32.const -1",
+          "i32.const 1",
+          "i32.shr_u",
+          "i32.const 1",
+          "i32.const 0",
+          "i32.div_s",
+        ],
+        constantFolding
+      ).body
+    ).toStrictEqual([
+      "i32.const 1",
+      "i32.const 2147483647",
+      "i32.const 1",
+      "i32.const 0",
+      "i32.div_s",
+    ]);
+  });
+
+  it(`Folds branches and removes dead code`, () => {
+    expect(
+      optimize(
+        [
+          "block (result i32)",
+          "i32.const 0",
+          "if",
+          "local.get $P1",
+          "drop",
+          "else",
+          "i32.const 1",
+          "br_if 1",
+          "end",
+          "local.get $P1",
+          "br 0",
+          "i32.const 0",
+          "end",
+        ],
+        branchFolding,
+        deadCodeElimination
+      ).body
+    ).toStrictEqual([
+      "block (result i32)",
+      "block",
+      "br 1",
+      "end",
+      "local.get $P1",
+      "br 0",
+      "end",
+    ]);
+  });
+
+  it(`Flattens blocks which are not branch targets`, () => {
+    expect(
+      optimize(
+        [
+          "block ;; outer",
+          "block ;; compound statement",
+          "loop",
+          "local.get $P1",
+          "br_if 2",
+          "br 0",
+          "end",
+          "end",
+          "end",
+        ],
+        blockFlattening
+      ).body
+    ).toStrictEqual([
+      "block",
+      "loop",
+      "local.get $P1",
+      "br_if 1",
+      "br 0",
+      "end",
+      "end",
+    ]);
+  });
+
+  it(`Propagates constant locals and removes dead stores`, () => {
+    expect(
+      optimize(
+        [
+          "i32.const 5",
+          "local.set $L1",
+          "local.get $P1",
+          "local.tee $L2",
+          "local.get $L1",
+          "i32.add",
+          "local.get $P1",
+          "local.set $L2",
+        ],
+        localConstantPropagation,
+        deadStoreElimination,
+        unusedLocalsElimination
+      )
+    ).toStrictEqual({
+      body: ["local.get $P1", "i32.const 5", "i32.add", "local.get $P1", "drop"],
+      locals: [],
+    });
+  });
+
+  it(`Pass manager reports statistics`, () => {
+    const passManager = createPassManager(getPassPipeline(2));
+    const func = passManager.runOnFunction(
+      createFunction([
+        "i32.const 2",
+        "i32.const 3",
+        "i32.add",
+        "br 0",
+        "i32.const 0",
+      ])
+    );
+    expect(
+      func.body.map((instruction) =>
+        printInstruction({ ...instruction, comment: null })
+      )
+    ).toStrictEqual(["i32.const 5", "br 0"]);
+    const statistics = passManager.getStatistics();
+    expect(statistics.map((pass) => pass.name)).toStrictEqual(
+      getPassPipeline(2).map((pass) => pass.name)
+    );
+    expect(statistics[0].instructionsBefore).toBe(5);
+    expect(statistics[0].instructionsAfter).toBe(3);
+    expect(statistics[statistics.length - 1].instructionsAfter).toBe(2);
+  });
+
+  it(`Level 0 does not change function`, () => {
+    const func = createFunction(["i32.const 1", "i32.const 2", "i32.add"]);
+    expect(createPassManager(getPassPipeline(0)).runOnFunction(func)).toBe(
+      func
+    );
+  });
+});
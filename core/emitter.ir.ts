@@ -0,0 +1,223 @@
+import {
+  WAFunction,
+  WALocal,
+  WAStructuredInstruction,
+} from "./emitter.definitions";
+import { createInstruction } from "./emitter.instructions";
+
+/*
+
+Mid-level representation of function body which is used by optimization passes.
+
+WebAssembly control flow is structured, so function body is a tree:
+  regions are "block", "loop" and "if" and leafs are basic blocks.
+
+Basic block is a straight-line list of instructions, it ends with
+  a branch instruction (br, br_if, br_table, return, tail calls,
+  unreachable) or at the region boundary.
+
+Values are never named, they live on the operand stack. Because basic block
+  have no joins inside every value on the stack is assigned only once,
+  so stack slots act as SSA temporaries while WebAssembly locals are variables.
+
+ */
+
+export interface IRBasicBlock {
+  type: "basic-block";
+  instructions: WAStructuredInstruction[];
+}
+
+export interface IRRegion {
+  type: "region";
+  kind: "block" | "loop" | "if";
+  /** Block type as text, for example "(result i32)" or null for empty */
+  blockType: string | null;
+  /** Comment on region start instruction */
+  comment: string | null;
+  body: IRNode[];
+  /** Only for "if" */
+  elseBody: IRNode[] | null;
+}
+
+export type IRNode = IRBasicBlock | IRRegion;
+
+export interface IRFunction {
+  params: WALocal[];
+  locals: WALocal[];
+  body: IRNode[];
+}
+
+/** Instructions after which code in the same block is never reached */
+export const UNCONDITIONAL_BRANCHES = [
+  "br",
+  "br_table",
+  "return",
+  "return_call",
+  "return_call_indirect",
+  "unreachable",
+];
+
+export const BRANCHES = [...UNCONDITIONAL_BRANCHES, "br_if"];
+
+export function buildIR(func: WAFunction): IRFunction {
+  const root: IRNode[] = [];
+  /** Stack of opened regions, current body is the last one */
+  const openedRegions: IRRegion[] = [];
+  let currentBody = root;
+  let currentBasicBlock: IRBasicBlock | null = null;
+
+  for (const instruction of func.body) {
+    if (
+      instruction.op === "block" ||
+      instruction.op === "loop" ||
+      instruction.op === "if"
+    ) {
+      const region: IRRegion = {
+        type: "region",
+        kind: instruction.op,
+        blockType: instruction.args.length > 0 ? instruction.args[0] : null,
+        comment: instruction.comment,
+        body: [],
+        elseBody: null,
+      };
+      currentBody.push(region);
+      openedRegions.push(region);
+      currentBody = region.body;
+      currentBasicBlock = null;
+    } else if (instruction.op === "else") {
+      const region = openedRegions[openedRegions.length - 1];
+      if (!region || region.kind !== "if" || region.elseBody) {
+        throw new Error("Internal error: else without if");
+      }
+      region.elseBody = [];
+      currentBody = region.elseBody;
+      currentBasicBlock = null;
+    } else if (instruction.op === "end") {
+      if (!openedRegions.pop()) {
+        throw new Error("Internal error: end without region");
+      }
+      const parent = openedRegions[openedRegions.length - 1];
+      currentBody = parent ? parent.elseBody || parent.body : root;
+      currentBasicBlock = null;
+    } else {
+      if (!currentBasicBlock) {
+        currentBasicBlock = {
+          type: "basic-block",
+          instructions: [],
+        };
+        currentBody.push(currentBasicBlock);
+      }
+      currentBasicBlock.instructions.push(instruction);
+      if (BRANCHES.indexOf(instruction.op) !== -1) {
+        currentBasicBlock = null;
+      }
+    }
+  }
+  if (openedRegions.length !== 0) {
+    throw new Error("Internal error: region is not closed");
+  }
+
+  return { params: func.params, locals: [...func.locals], body: root };
+}
+
+function lowerNodes(nodes: IRNode[], code: WAStructuredInstruction[]) {
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      code.push(...node.instructions);
+    } else {
+      code.push(
+        createInstruction(
+          node.kind,
+          node.blockType ? [node.blockType] : [],
+          node.comment
+        )
+      );
+      lowerNodes(node.body, code);
+      if (node.elseBody) {
+        code.push(createInstruction("else"));
+        lowerNodes(node.elseBody, code);
+      }
+      code.push(createInstruction("end"));
+    }
+  }
+}
+
+export function lowerIR(func: WAFunction, ir: IRFunction): WAFunction {
+  const code: WAStructuredInstruction[] = [];
+  lowerNodes(ir.body, code);
+  return {
+    ...func,
+    locals: ir.locals,
+    body: code,
+  };
+}
+
+/**
+ * Merges basic blocks which follow each other if first one does not end
+ * with a branch and removes empty basic blocks.
+ * Passes which change regions call it to keep the tree canonical.
+ */
+export function normalizeNodes(nodes: IRNode[]): IRNode[] {
+  const result: IRNode[] = [];
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      if (node.instructions.length === 0) {
+        continue;
+      }
+      const last = result[result.length - 1];
+      if (
+        last &&
+        last.type === "basic-block" &&
+        BRANCHES.indexOf(
+          last.instructions[last.instructions.length - 1].op
+        ) === -1
+      ) {
+        last.instructions.push(...node.instructions);
+      } else {
+        result.push(node);
+      }
+    } else {
+      node.body = normalizeNodes(node.body);
+      if (node.elseBody) {
+        node.elseBody = normalizeNodes(node.elseBody);
+      }
+      result.push(node);
+    }
+  }
+  return result;
+}
+
+/** Calls callback for every basic block, including nested */
+export function forEachBasicBlock(
+  nodes: IRNode[],
+  callback: (basicBlock: IRBasicBlock) => void
+) {
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      callback(node);
+    } else {
+      forEachBasicBlock(node.body, callback);
+      if (node.elseBody) {
+        forEachBasicBlock(node.elseBody, callback);
+      }
+    }
+  }
+}
+
+/** Number of instructions as they will be in lowered code */
+export function countInstructions(nodes: IRNode[]): number {
+  let count = 0;
+  for (const node of nodes) {
+    if (node.type === "basic-block") {
+      count += node.instructions.length;
+    } else {
+      // Region start and end
+      count += 2;
+      count += countInstructions(node.body);
+      if (node.elseBody) {
+        count += 1 + countInstructions(node.elseBody);
+      }
+    }
+  }
+  return count;
+}
@@ -0,0 +1,164 @@
+import { WAFunction } from "./emitter.definitions";
+import { buildIR, lowerIR } from "./emitter.ir";
+import { parseInstructions, printInstruction } from "./emitter.instructions";
+import { loopVectorization } from "./emitter.ir.vectorizer";
+
+function vectorize(code: string[]) {
+  const func: WAFunction = {
+    name: "$test",
+    typeName: "$FUNCSIGviii",
+    params: [
+      { name: "$P1", type: "i32" },
+      { name: "$P2", type: "i32" },
+      { name: "$P3", type: "i32" },
+    ],
+    results: [],
+    locals: [{ name: "$L1", type: "i32" }],
+    body: parseInstructions(code),
+    exportName: null,
+    sourceName: null,
+    comment: null,
+  };
+  const ir = buildIR(func);
+  const counters: { [name: string]: number } = {};
+  loopVectorization.run(ir, {
+    count: (counter) => {
+      counters[counter] = (counters[counter] || 0) + 1;
+    },
+  });
+  return {
+    code: lowerIR(func, ir).body.map((instruction) =>
+      printInstruction({ ...instruction, comment: null })
+    ),
+    counters,
+  };
+}
+
+/** while (i < n) { body; i++ } */
+function loop(body: string[]) {
+  return [
+    "block",
+    "loop",
+    "local.get $L1",
+    "local.get $P3",
+    "i32.ge_u",
+    "br_if 1",
+    ...body,
+    "local.get $L1",
+    "i32.const 1",
+    "i32.add",
+    "local.set $L1",
+    "br 0",
+    "end",
+    "end",
+  ];
+}
+
+describe("Loop vectorization", () => {
+  it(`Vectorizes word loop`, () => {
+    // p1[i] = p2[i] * 3 for int arrays
+    const code = loop([
+      "local.get $P1",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "local.get $P2",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "i32.load",
+      "i32.const 3",
+      "i32.mul",
+      "i32.store",
+    ]);
+    const result = vectorize(code);
+    expect(result.code).toStrictEqual([
+      "block",
+      "block",
+      "local.get $P1",
+      "local.get $P2",
+      "i32.sub",
+      "i32.const 15",
+      "i32.add",
+      "i32.const 30",
+      "i32.gt_u",
+      "local.get $P1",
+      "local.get $P2",
+      "i32.eq",
+      "i32.or",
+      "i32.eqz",
+      "br_if 0",
+      "loop",
+      "local.get $L1",
+      "local.get $P3",
+      "i32.ge_u",
+      "br_if 1",
+      "local.get $P3",
+      "local.get $L1",
+      "i32.sub",
+      "i32.const 4",
+      "i32.lt_u",
+      "br_if 1",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "local.get $P2",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.mul",
+      "i32.add",
+      "v128.load",
+      "i32.const 3",
+      "i32x4.splat",
+      "i32x4.mul",
+      "v128.store",
+      "local.get $L1",
+      "i32.const 4",
+      "i32.add",
+      "local.set $L1",
+      "br 0",
+      "end",
+      "end",
+      ...code.slice(1),
+    ]);
+    expect(result.counters).toStrictEqual({ "vectorized-loops": 1 });
+  });
+
+  it(`Does not vectorize loops with dependencies between iterations`, () => {
+    // p1[i] = p1[i - 1] for byte array
+    const code = loop([
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.const 1",
+      "i32.sub",
+      "i32.add",
+      "i32.load8_u",
+      "i32.store8",
+    ]);
+    expect(vectorize(code).code).toStrictEqual(code);
+  });
+
+  it(`Does not vectorize operations which differ for bytes`, () => {
+    // p1[i] = p1[i] >> 1 for byte array
+    const code = loop([
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "local.get $P1",
+      "local.get $L1",
+      "i32.add",
+      "i32.load8_u",
+      "i32.const 1",
+      "i32.shr_u",
+      "i32.store8",
+    ]);
+    expect(vectorize(code).code).toStrictEqual(code);
+  });
+});
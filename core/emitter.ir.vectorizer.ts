@@ -0,0 +1,508 @@
+import { WAStructuredInstruction } from "./emitter.definitions";
+import {
+  IRFunction,
+  IRNode,
+  IRRegion,
+  IRBasicBlock,
+  normalizeNodes,
+} from "./emitter.ir";
+import { IRPass } from "./emitter.ir.passes";
+import { countWrites, getLocalType } from "./emitter.ir.loops";
+import {
+  createInstruction,
+  PURE_BINARY,
+  PURE_UNARY,
+  printInstruction,
+} from "./emitter.instructions";
+
+/*
+
+Loop vectorizer. It works only with loops in canonical form:
+
+  loop
+    local.get $i
+    <invariant bound>
+    i32.ge_u | i32.ge_s
+    br_if 1
+    <stores into arrays indexed by $i>
+    local.get $i
+    i32.const 1
+    i32.add
+    local.set $i
+    br 0
+  end
+
+Array elements are bytes or 32-bit words, every array is accessed only
+  as "base[i]" and every value is computed lane-wise, so iterations are
+  independent. Vector copy of the loop is placed before the original one and
+  processes 16 bytes per iteration, original loop is kept and handles
+  the remaining elements.
+
+Pointers can overlap, so vector loop is executed only if arrays which are
+  written are at least one vector away from other arrays or exactly the same.
+
+ */
+
+const VECTOR_SIZE = 16;
+
+interface LaneShape {
+  /** Element size in bytes */
+  size: number;
+  load: string[];
+  store: string;
+  splat: string;
+  /** Scalar operation to lane-wise one */
+  operations: { [op: string]: string };
+  /** Shifts take scalar count as second operand */
+  shifts: string[];
+}
+
+const LANE_SHAPES: LaneShape[] = [
+  {
+    size: 1,
+    load: ["i32.load8_u", "i32.load8_s"],
+    store: "i32.store8",
+    splat: "i8x16.splat",
+    // Only operations which give the same low byte as scalar ones do
+    operations: {
+      "i32.add": "i8x16.add",
+      "i32.sub": "i8x16.sub",
+      "i32.and": "v128.and",
+      "i32.or": "v128.or",
+      "i32.xor": "v128.xor",
+    },
+    shifts: [],
+  },
+  {
+    size: 4,
+    load: ["i32.load"],
+    store: "i32.store",
+    splat: "i32x4.splat",
+    operations: {
+      "i32.add": "i32x4.add",
+      "i32.sub": "i32x4.sub",
+      "i32.mul": "i32x4.mul",
+      "i32.and": "v128.and",
+      "i32.or": "v128.or",
+      "i32.xor": "v128.xor",
+      "i32.shl": "i32x4.shl",
+      "i32.shr_s": "i32x4.shr_s",
+      "i32.shr_u": "i32x4.shr_u",
+    },
+    shifts: ["i32.shl", "i32.shr_s", "i32.shr_u"],
+  },
+];
+
+/** Address of "base[i]" */
+interface AddressValue {
+  kind: "address";
+  base: WAStructuredInstruction[];
+  scale: number;
+}
+
+type Value =
+  /** Loop invariant i32 */
+  | { kind: "scalar"; code: WAStructuredInstruction[] }
+  /** Induction variable, optionally multiplied by element size */
+  | { kind: "index"; scale: number }
+  | AddressValue
+  | { kind: "vector"; code: WAStructuredInstruction[] };
+
+interface VectorLoop {
+  code: WAStructuredInstruction[];
+  /** Bases of arrays, they are checked for overlapping */
+  loadBases: WAStructuredInstruction[][];
+  storeBases: WAStructuredInstruction[][];
+}
+
+function isPlainMemoryAccess(instruction: WAStructuredInstruction) {
+  // Alignment is only a hint, but offset changes address
+  return instruction.args.every((arg) => arg.startsWith("align="));
+}
+
+function getShape(code: WAStructuredInstruction[]): LaneShape | null {
+  let shape: LaneShape | null = null;
+  for (const instruction of code) {
+    const accessShape = LANE_SHAPES.find(
+      (candidate) =>
+        candidate.load.indexOf(instruction.op) !== -1 ||
+        candidate.store === instruction.op
+    );
+    if (!accessShape) {
+      continue;
+    }
+    if (shape && shape !== accessShape) {
+      return null;
+    }
+    shape = accessShape;
+  }
+  return shape;
+}
+
+function getAddressCode(
+  address: AddressValue,
+  inductionVariable: string
+): WAStructuredInstruction[] {
+  return [
+    ...address.base,
+    createInstruction("local.get", [inductionVariable]),
+    ...(address.scale !== 1
+      ? [
+          createInstruction("i32.const", [`${address.scale}`]),
+          createInstruction("i32.mul"),
+        ]
+      : []),
+    createInstruction("i32.add"),
+  ];
+}
+
+/**
+ * Translates loop body into vector code or returns null if it is not possible
+ */
+function vectorizeBody(
+  code: WAStructuredInstruction[],
+  shape: LaneShape,
+  inductionVariable: string,
+  isInvariantLocal: (name: string) => boolean
+): VectorLoop | null {
+  const result: VectorLoop = { code: [], loadBases: [], storeBases: [] };
+  const stack: Value[] = [];
+  const toVector = (value: Value): WAStructuredInstruction[] | null =>
+    value.kind === "vector"
+      ? value.code
+      : value.kind === "scalar"
+      ? [...value.code, createInstruction(shape.splat)]
+      : null;
+
+  for (const instruction of code) {
+    const op = instruction.op;
+    if (
+      op === "i32.const" ||
+      (op === "local.get" && isInvariantLocal(instruction.args[0]))
+    ) {
+      stack.push({ kind: "scalar", code: [instruction] });
+    } else if (
+      op === "local.get" &&
+      instruction.args[0] === inductionVariable
+    ) {
+      stack.push({ kind: "index", scale: 1 });
+    } else if (shape.load.indexOf(op) !== -1) {
+      const address = stack.pop();
+      if (
+        !address ||
+        address.kind !== "address" ||
+        address.scale !== shape.size ||
+        !isPlainMemoryAccess(instruction)
+      ) {
+        return null;
+      }
+      result.loadBases.push(address.base);
+      stack.push({
+        kind: "vector",
+        code: [
+          ...getAddressCode(address, inductionVariable),
+          createInstruction("v128.load"),
+        ],
+      });
+    } else if (op === shape.store) {
+      const value = stack.pop();
+      const address = stack.pop();
+      const valueCode = value ? toVector(value) : null;
+      if (
+        !valueCode ||
+        !address ||
+        address.kind !== "address" ||
+        address.scale !== shape.size ||
+        !isPlainMemoryAccess(instruction) ||
+        stack.length !== 0
+      ) {
+        return null;
+      }
+      result.storeBases.push(address.base);
+      result.code.push(
+        ...getAddressCode(address, inductionVariable),
+        ...valueCode,
+        createInstruction("v128.store")
+      );
+    } else if (op.startsWith("i32.") && PURE_UNARY.test(op)) {
+      const a = stack.pop();
+      if (!a || a.kind !== "scalar") {
+        return null;
+      }
+      stack.push({ kind: "scalar", code: [...a.code, instruction] });
+    } else if (op.startsWith("i32.") && PURE_BINARY.test(op)) {
+      const b = stack.pop();
+      const a = stack.pop();
+      if (!a || !b) {
+        return null;
+      }
+      if (a.kind === "scalar" && b.kind === "scalar") {
+        stack.push({
+          kind: "scalar",
+          code: [...a.code, ...b.code, instruction],
+        });
+      } else if (
+        op === "i32.mul" &&
+        a.kind === "index" &&
+        a.scale === 1 &&
+        b.kind === "scalar" &&
+        b.code.length === 1 &&
+        b.code[0].op === "i32.const"
+      ) {
+        stack.push({ kind: "index", scale: parseInt(b.code[0].args[0]) });
+      } else if (
+        op === "i32.add" &&
+        a.kind === "scalar" &&
+        b.kind === "index"
+      ) {
+        stack.push({ kind: "address", base: a.code, scale: b.scale });
+      } else if (shape.shifts.indexOf(op) !== -1) {
+        // Lane-wise shifts take count modulo lane width, same as scalar ones
+        if (a.kind !== "vector" || b.kind !== "scalar") {
+          return null;
+        }
+        stack.push({
+          kind: "vector",
+          code: [...a.code, ...b.code, createInstruction(shape.operations[op])],
+        });
+      } else if (op in shape.operations) {
+        const aCode = toVector(a);
+        const bCode = toVector(b);
+        if (!aCode || !bCode) {
+          return null;
+        }
+        stack.push({
+          kind: "vector",
+          code: [...aCode, ...bCode, createInstruction(shape.operations[op])],
+        });
+      } else {
+        return null;
+      }
+    } else {
+      return null;
+    }
+  }
+  if (stack.length !== 0 || result.storeBases.length === 0) {
+    return null;
+  }
+  return result;
+}
+
+/**
+ * Returns code which leaves non-zero if arrays are exactly the same or
+ *  do not overlap within one vector
+ */
+function getNoOverlapCheck(
+  a: WAStructuredInstruction[],
+  b: WAStructuredInstruction[]
+): WAStructuredInstruction[] {
+  return [
+    ...a,
+    ...b,
+    createInstruction("i32.sub"),
+    createInstruction("i32.const", [`${VECTOR_SIZE - 1}`]),
+    createInstruction("i32.add"),
+    createInstruction("i32.const", [`${2 * (VECTOR_SIZE - 1)}`]),
+    createInstruction("i32.gt_u"),
+    ...a,
+    ...b,
+    createInstruction("i32.eq"),
+    createInstruction("i32.or"),
+  ];
+}
+
+function getOverlapChecks(vectorLoop: VectorLoop): WAStructuredInstruction[] {
+  const getKey = (base: WAStructuredInstruction[]) =>
+    base
+      .map((instruction) => printInstruction({ ...instruction, comment: null }))
+      .join(";");
+  const checked = new Set<string>();
+  const checks: WAStructuredInstruction[] = [];
+  for (const storeBase of vectorLoop.storeBases) {
+    for (const base of [...vectorLoop.storeBases, ...vectorLoop.loadBases]) {
+      const storeKey = getKey(storeBase);
+      const key = getKey(base);
+      if (
+        storeKey === key ||
+        checked.has(`${storeKey}|${key}`) ||
+        checked.has(`${key}|${storeKey}`)
+      ) {
+        continue;
+      }
+      checked.add(`${storeKey}|${key}`);
+      checks.push(...getNoOverlapCheck(storeBase, base));
+      if (checked.size > 1) {
+        checks.push(createInstruction("i32.and"));
+      }
+    }
+  }
+  return checks;
+}
+
+function createBasicBlock(
+  instructions: WAStructuredInstruction[]
+): IRBasicBlock {
+  return { type: "basic-block", instructions };
+}
+
+/**
+ * Returns vectorized copy of the loop which must be placed before it
+ */
+function vectorizeLoop(func: IRFunction, loop: IRRegion): IRRegion | null {
+  if (
+    loop.blockType ||
+    loop.body.length !== 2 ||
+    loop.body[0].type !== "basic-block" ||
+    loop.body[1].type !== "basic-block"
+  ) {
+    return null;
+  }
+  const header = loop.body[0].instructions;
+  const body = loop.body[1].instructions;
+  if (header.length < 4 || body.length < 5) {
+    return null;
+  }
+
+  const inductionVariable = header[0].args[0];
+  const compare = header[header.length - 2].op;
+  const exit = header[header.length - 1];
+  const [get, step, add, set, repeat] = body.slice(body.length - 5);
+  if (
+    header[0].op !== "local.get" ||
+    getLocalType(func, inductionVariable) !== "i32" ||
+    (compare !== "i32.ge_u" && compare !== "i32.ge_s") ||
+    exit.op !== "br_if" ||
+    exit.args[0] !== "1" ||
+    get.op !== "local.get" ||
+    get.args[0] !== inductionVariable ||
+    step.op !== "i32.const" ||
+    step.args[0] !== "1" ||
+    add.op !== "i32.add" ||
+    set.op !== "local.set" ||
+    set.args[0] !== inductionVariable ||
+    repeat.op !== "br" ||
+    repeat.args[0] !== "0"
+  ) {
+    return null;
+  }
+
+  const writes = countWrites(loop.body);
+  if (writes.get(inductionVariable) !== 1) {
+    return null;
+  }
+  // Body can not have other writes to locals, it consists only of stores
+  const isInvariantLocal = (name: string) =>
+    !writes.has(name) && getLocalType(func, name) === "i32";
+
+  // Complex bounds are already moved into local by loop-invariant-code-motion
+  const bound = header.slice(1, header.length - 2);
+  if (
+    bound.length !== 1 ||
+    !(
+      bound[0].op === "i32.const" ||
+      (bound[0].op === "local.get" && isInvariantLocal(bound[0].args[0]))
+    )
+  ) {
+    return null;
+  }
+
+  const statements = body.slice(0, body.length - 5);
+  const shape = getShape(statements);
+  if (!shape) {
+    return null;
+  }
+  const vectorLoop = vectorizeBody(
+    statements,
+    shape,
+    inductionVariable,
+    isInvariantLocal
+  );
+  if (!vectorLoop) {
+    return null;
+  }
+
+  const lanes = VECTOR_SIZE / shape.size;
+  const checks = getOverlapChecks(vectorLoop);
+  const vectorBody: IRNode[] = [
+    createBasicBlock([
+      createInstruction("local.get", [inductionVariable]),
+      ...bound,
+      createInstruction(compare),
+      createInstruction("br_if", ["1"]),
+    ]),
+    // Difference is not negative here, so unsigned compare works for both
+    createBasicBlock([
+      ...bound,
+      createInstruction("local.get", [inductionVariable]),
+      createInstruction("i32.sub"),
+      createInstruction("i32.const", [`${lanes}`]),
+      createInstruction("i32.lt_u"),
+      createInstruction("br_if", ["1"], "Less than one vector left"),
+    ]),
+    createBasicBlock([
+      ...vectorLoop.code,
+      createInstruction("local.get", [inductionVariable]),
+      createInstruction("i32.const", [`${lanes}`]),
+      createInstruction("i32.add"),
+      createInstruction("local.set", [inductionVariable]),
+      createInstruction("br", ["0"], "vectorized loop, go to beginning"),
+    ]),
+  ];
+
+  return {
+    type: "region",
+    kind: "block",
+    blockType: null,
+    comment: "vectorized loop",
+    body: [
+      ...(checks.length > 0
+        ? [
+            createBasicBlock([
+              ...checks,
+              createInstruction("i32.eqz"),
+              createInstruction("br_if", ["0"], "Arrays are overlapping"),
+            ]),
+          ]
+        : []),
+      {
+        type: "region",
+        kind: "loop",
+        blockType: null,
+        comment: "vectorized loop",
+        body: vectorBody,
+        elseBody: null,
+      },
+    ],
+    elseBody: null,
+  };
+}
+
+/**
+ * Simple loops over bytes or words are copied into SIMD version
+ *  which processes 16 bytes per iteration
+ */
+export const loopVectorization: IRPass = {
+  name: "loop-vectorization",
+  run(func, context) {
+    const transform = (nodes: IRNode[]): IRNode[] => {
+      const result: IRNode[] = [];
+      for (const node of nodes) {
+        if (node.type === "region") {
+          node.body = transform(node.body);
+          if (node.elseBody) {
+            node.elseBody = transform(node.elseBody);
+          }
+          const vectorized =
+            node.kind === "loop" ? vectorizeLoop(func, node) : null;
+          if (vectorized) {
+            result.push(vectorized);
+            context.count("vectorized-loops");
+          }
+        }
+        result.push(node);
+      }
+      return result;
+    };
+    func.body = normalizeNodes(transform(func.body));
+  },
+};
@@ -4,13 +4,15 @@ Memory structure:
 
 0x0 - 0x4 : 4 bytes, reserved
 ..........: stack (starts from the top and grows downwards)
-..........: 4 bytes, ESP_ADDRESS
 ..........: 4 bytes, HEAP_BEGIN_ADDRESS
 ..........: globals
 ..........: <maybe something reserved>
 ..........: heap starts here
 
 
+ESP is not in memory, it is a mutable WebAssembly global STACK_POINTER_GLOBAL.
+It is exported and can be imported, so host and other modules can share it.
+
 Function call frame:
 $ebp = ESP - <function locals size>
 ESP = ESP - <function locals size>
@@ -22,12 +24,51 @@ In is possible to not to use $ebp and to directly use ESP,
 
 ESP might be subtracted more, for example for VLAs.
 
+If function have nothing in memory (all variables are in WebAssembly locals)
+  then it is frameless: it does not touch ESP and have no $ebp.
+
+Stack size is an emitter option, so addresses depend on it and
+  are taken from MemoryLayout. Constants below are for the default size.
+
+Memory have at least enough pages for stack, globals and heap reservation.
+
  */
-export const STACK_SIZE = 0x10000;
-export const ESP_ADDRESS = 4 + STACK_SIZE;
-/**
- * It happened that top of the stack is right before global of ESP
- */
-export const ESP_INITIAL_VALUE = ESP_ADDRESS;
-export const HEAP_BEGIN_ADDRESS = ESP_ADDRESS + 4;
-export const GLOBALS_BEGIN_ADDRESS = HEAP_BEGIN_ADDRESS + 4;
+export const PAGE_SIZE = 0x10000;
+export const DEFAULT_STACK_SIZE = 0x10000;
+
+export interface MemoryLayout {
+  stackSize: number;
+  /**
+   * Top of the stack, it is right before heapBeginAddress
+   */
+  espInitialValue: number;
+  heapBeginAddress: number;
+  globalsBeginAddress: number;
+}
+
+export function getMemoryLayout(stackSize = DEFAULT_STACK_SIZE): MemoryLayout {
+  if (stackSize <= 0 || stackSize % 16 !== 0) {
+    throw new Error(`Stack size must be a positive multiple of 16`);
+  }
+  const espInitialValue = 4 + stackSize;
+  return {
+    stackSize,
+    espInitialValue,
+    heapBeginAddress: espInitialValue,
+    globalsBeginAddress: espInitialValue + 4,
+  };
+}
+
+/** Layout of module which stack pointer starts from this value */
+export function getMemoryLayoutForStackPointer(espInitialValue: number) {
+  return getMemoryLayout(espInitialValue - 4);
+}
+
+export const STACK_SIZE = DEFAULT_STACK_SIZE;
+export const ESP_INITIAL_VALUE = getMemoryLayout().espInitialValue;
+export const HEAP_BEGIN_ADDRESS = getMemoryLayout().heapBeginAddress;
+export const GLOBALS_BEGIN_ADDRESS = getMemoryLayout().globalsBeginAddress;
+
+export const STACK_POINTER_GLOBAL = "$__stack_pointer";
+/** Name for both export and import */
+export const STACK_POINTER_EXTERNAL_NAME = "__stack_pointer";
@@ -0,0 +1,97 @@
+import {
+  encodeULEB128,
+  encodeSLEB128,
+  parseInt64,
+  encodeModuleBinary,
+} from "./emitter.module.binary";
+import { parseInstructions } from "./emitter.instructions";
+
+describe("Binary encoder", () => {
+  it(`Unsigned LEB128`, () => {
+    expect(encodeULEB128(0)).toStrictEqual([0]);
+    expect(encodeULEB128(127)).toStrictEqual([0x7f]);
+    expect(encodeULEB128(128)).toStrictEqual([0x80, 0x01]);
+    expect(encodeULEB128(624485)).toStrictEqual([0xe5, 0x8e, 0x26]);
+    expect(encodeULEB128(0xffffffff)).toStrictEqual([
+      0xff,
+      0xff,
+      0xff,
+      0xff,
+      0x0f,
+    ]);
+  });
+
+  it(`Signed LEB128`, () => {
+    expect(encodeSLEB128(0)).toStrictEqual([0]);
+    expect(encodeSLEB128(63)).toStrictEqual([0x3f]);
+    expect(encodeSLEB128(64)).toStrictEqual([0xc0, 0x00]);
+    expect(encodeSLEB128(-1)).toStrictEqual([0x7f]);
+    expect(encodeSLEB128(-123456)).toStrictEqual([0xc0, 0xbb, 0x78]);
+    // Unsigned values are wrapped into i32
+    expect(encodeSLEB128(0xffffffff)).toStrictEqual([0x7f]);
+  });
+
+  it(`Parses 64-bits integers`, () => {
+    expect(parseInt64("0")).toStrictEqual([0, 0]);
+    expect(parseInt64("-1")).toStrictEqual([0xffffffff, -1]);
+    expect(parseInt64("4294967296")).toStrictEqual([0, 1]);
+    expect(parseInt64("0x123456789abcdef0")).toStrictEqual([
+      0x9abcdef0,
+      0x12345678,
+    ]);
+    expect(parseInt64("-9223372036854775808")).toStrictEqual([
+      0,
+      -0x80000000,
+    ]);
+  });
+
+  it(`Encodes a module`, () => {
+    const binary = encodeModuleBinary({
+      memory: {
+        importFrom: { module: "js", name: "memory" },
+        minPages: 1,
+        maxPages: null,
+        exportName: null,
+      },
+      types: [{ name: "$FUNCSIGii", params: ["i32"], results: ["i32"] }],
+      table: ["$F1"],
+      globals: [],
+      importedFunctions: [],
+      functions: [
+        {
+          name: "$F1",
+          typeName: "$FUNCSIGii",
+          params: [{ name: "$P1", type: "i32" }],
+          results: ["i32"],
+          locals: [{ name: "$L1", type: "i32" }],
+          body: parseInstructions([
+            "local.get $P1 ;; comment",
+            "i32.extend8_s",
+            "local.tee $L1",
+            "",
+          ]),
+          exportName: "f",
+          sourceName: "f",
+          comment: null,
+        },
+      ],
+      data: [{ offset: 16, bytes: [1, 2, 3], comment: null }],
+    });
+    expect(Array.from(binary.slice(0, 8))).toStrictEqual([
+      0x00,
+      0x61,
+      0x73,
+      0x6d,
+      0x01,
+      0x00,
+      0x00,
+      0x00,
+    ]);
+    // Function body: locals, local.get 0, i32.extend8_s, local.tee 1, end
+    const body = [0x01, 0x01, 0x7f, 0x20, 0x00, 0xc0, 0x22, 0x01, 0x0b];
+    const bodyPos = Array.from(binary).findIndex((_, idx) =>
+      body.every((byte, i) => binary[idx + i] === byte)
+    );
+    expect(bodyPos).toBeGreaterThan(8);
+  });
+});
@@ -0,0 +1,860 @@
+import {
+  WAModule,
+  WAFunction,
+  WAStructuredInstruction,
+  RegisterType,
+} from "./emitter.definitions";
+import { printInstruction } from "./emitter.instructions";
+import {
+  BinaryLocation,
+  SourceMap,
+  createSourceMap,
+} from "./emitter.sourcemap";
+
+/*
+
+Binary encoding of WebAssembly module
+https://webassembly.github.io/spec/core/binary/index.html
+
+Function bodies are structured instructions with immediates as text,
+  so here every instruction is encoded with opcode and immediates.
+
+Custom "name" section have names of functions and locals from the source,
+  so they are shown in stack traces and in debugger. Offsets of instructions
+  with source locations are collected for the source map.
+
+ */
+
+type Bytes = number[];
+
+/**
+ * Same as target.push(...source) but works for big arrays
+ */
+function append(target: Bytes, source: Bytes) {
+  for (let i = 0; i < source.length; i++) {
+    target.push(source[i]);
+  }
+}
+
+export function encodeULEB128(value: number): Bytes {
+  if (value < 0 || Math.floor(value) !== value) {
+    throw new Error(`Internal error: wrong unsigned LEB128 value ${value}`);
+  }
+  const bytes: Bytes = [];
+  do {
+    let byte = value % 0x80;
+    value = Math.floor(value / 0x80);
+    if (value !== 0) {
+      byte |= 0x80;
+    }
+    bytes.push(byte);
+  } while (value !== 0);
+  return bytes;
+}
+
+/**
+ * Signed LEB128 for 64-bits value which is provided as two 32-bits parts
+ */
+function encodeSLEB128Pair(lo: number, hi: number): Bytes {
+  const bytes: Bytes = [];
+  lo = lo >>> 0;
+  hi = hi | 0;
+  while (true) {
+    const byte = lo & 0x7f;
+    // Arithmetic shift right by 7 bits
+    lo = ((lo >>> 7) | ((hi & 0x7f) << 25)) >>> 0;
+    hi = hi >> 7;
+    const signBitIsSet = (byte & 0x40) !== 0;
+    if (
+      (lo === 0 && hi === 0 && !signBitIsSet) ||
+      (lo === 0xffffffff && hi === -1 && signBitIsSet)
+    ) {
+      bytes.push(byte);
+      return bytes;
+    }
+    bytes.push(byte | 0x80);
+  }
+}
+
+/**
+ * Encodes 32-bits integer. Unsigned values are wrapped, i.e. 0xffffffff is -1
+ */
+export function encodeSLEB128(value: number): Bytes {
+  const i32 = value | 0;
+  return encodeSLEB128Pair(i32, i32 < 0 ? -1 : 0);
+}
+
+/**
+ * Parses decimal or hex 64-bits integer into two 32-bits parts.
+ * Values out of range are wrapped
+ */
+export function parseInt64(text: string): [number, number] {
+  let isNegative = false;
+  let digits = text.replace(/_/g, "");
+  if (digits[0] === "-" || digits[0] === "+") {
+    isNegative = digits[0] === "-";
+    digits = digits.slice(1);
+  }
+  let base = 10;
+  if (digits.slice(0, 2).toLowerCase() === "0x") {
+    base = 16;
+    digits = digits.slice(2);
+  }
+  if (digits.length === 0) {
+    throw new Error(`Internal error: wrong integer ${text}`);
+  }
+
+  // Four 16-bits limbs, lowest first
+  const limbs = [0, 0, 0, 0];
+  for (const char of digits) {
+    const digit = parseInt(char, base);
+    if (isNaN(digit)) {
+      throw new Error(`Internal error: wrong integer ${text}`);
+    }
+    let carry = digit;
+    for (let i = 0; i < limbs.length; i++) {
+      const limbValue = limbs[i] * base + carry;
+      limbs[i] = limbValue & 0xffff;
+      carry = Math.floor(limbValue / 0x10000);
+    }
+  }
+  if (isNegative) {
+    // Two's complement: invert and add one
+    let carry = 1;
+    for (let i = 0; i < limbs.length; i++) {
+      const limbValue = (~limbs[i] & 0xffff) + carry;
+      limbs[i] = limbValue & 0xffff;
+      carry = limbValue >> 16;
+    }
+  }
+  const lo = (limbs[0] | (limbs[1] << 16)) >>> 0;
+  const hi = limbs[2] | (limbs[3] << 16) | 0;
+  return [lo, hi];
+}
+
+function parseFloatLiteral(text: string) {
+  const value = text.replace(/_/g, "");
+  if (value === "inf" || value === "+inf") {
+    return Infinity;
+  } else if (value === "-inf") {
+    return -Infinity;
+  } else if (/^[+-]?nan/.test(value)) {
+    return NaN;
+  }
+  const parsed = Number(value);
+  if (isNaN(parsed)) {
+    throw new Error(`Internal error: wrong float ${text}`);
+  }
+  return parsed;
+}
+
+function encodeString(str: string): Bytes {
+  const bytes: Bytes = [];
+  const utf8 = unescape(encodeURIComponent(str));
+  for (let i = 0; i < utf8.length; i++) {
+    bytes.push(utf8.charCodeAt(i));
+  }
+  return [...encodeULEB128(bytes.length), ...bytes];
+}
+
+function encodeVector(items: Bytes[]): Bytes {
+  const bytes: Bytes = encodeULEB128(items.length);
+  for (const item of items) {
+    append(bytes, item);
+  }
+  return bytes;
+}
+
+const valueTypes: Record<RegisterType, number> = {
+  i32: 0x7f,
+  i64: 0x7e,
+  f32: 0x7d,
+  f64: 0x7c,
+  v128: 0x7b,
+};
+
+function getValueType(type: string) {
+  if (type in valueTypes) {
+    return valueTypes[type as RegisterType];
+  }
+  throw new Error(`Internal error: unknown value type ${type}`);
+}
+
+type ImmediateKind =
+  | "none"
+  | "blocktype"
+  | "label"
+  | "labels"
+  | "function"
+  | "type"
+  | "local"
+  | "global"
+  | "memory"
+  | "zero"
+  | "lanes"
+  | "i32"
+  | "i64"
+  | "f32"
+  | "f64";
+
+interface OpcodeInfo {
+  opcode: Bytes;
+  immediate: ImmediateKind;
+  /** Natural alignment for memory instructions, log2 */
+  alignment?: number;
+}
+
+const opcodes = new Map<string, OpcodeInfo>();
+function addOpcode(
+  name: string,
+  opcode: Bytes,
+  immediate: ImmediateKind,
+  alignment?: number
+) {
+  opcodes.set(name, { opcode, immediate, alignment });
+}
+
+addOpcode("unreachable", [0x00], "none");
+addOpcode("nop", [0x01], "none");
+addOpcode("block", [0x02], "blocktype");
+addOpcode("loop", [0x03], "blocktype");
+addOpcode("if", [0x04], "blocktype");
+addOpcode("else", [0x05], "none");
+addOpcode("end", [0x0b], "none");
+addOpcode("br", [0x0c], "label");
+addOpcode("br_if", [0x0d], "label");
+addOpcode("br_table", [0x0e], "labels");
+addOpcode("return", [0x0f], "none");
+addOpcode("call", [0x10], "function");
+addOpcode("call_indirect", [0x11], "type");
+addOpcode("return_call", [0x12], "function");
+addOpcode("return_call_indirect", [0x13], "type");
+addOpcode("drop", [0x1a], "none");
+addOpcode("select", [0x1b], "none");
+addOpcode("local.get", [0x20], "local");
+addOpcode("local.set", [0x21], "local");
+addOpcode("local.tee", [0x22], "local");
+addOpcode("global.get", [0x23], "global");
+addOpcode("global.set", [0x24], "global");
+
+[
+  ["i32.load", 2],
+  ["i64.load", 3],
+  ["f32.load", 2],
+  ["f64.load", 3],
+  ["i32.load8_s", 0],
+  ["i32.load8_u", 0],
+  ["i32.load16_s", 1],
+  ["i32.load16_u", 1],
+  ["i64.load8_s", 0],
+  ["i64.load8_u", 0],
+  ["i64.load16_s", 1],
+  ["i64.load16_u", 1],
+  ["i64.load32_s", 2],
+  ["i64.load32_u", 2],
+  ["i32.store", 2],
+  ["i64.store", 3],
+  ["f32.store", 2],
+  ["f64.store", 3],
+  ["i32.store8", 0],
+  ["i32.store16", 1],
+  ["i64.store8", 0],
+  ["i64.store16", 1],
+  ["i64.store32", 2],
+].forEach(([name, alignment], idx) =>
+  addOpcode(name as string, [0x28 + idx], "memory", alignment as number)
+);
+addOpcode("memory.size", [0x3f], "zero");
+addOpcode("memory.grow", [0x40], "zero");
+addOpcode("i32.const", [0x41], "i32");
+addOpcode("i64.const", [0x42], "i64");
+addOpcode("f32.const", [0x43], "f32");
+addOpcode("f64.const", [0x44], "f64");
+
+/** Instructions without immediates starting from 0x45, in opcode order */
+const numericInstructions = `
+i32.eqz i32.eq i32.ne i32.lt_s i32.lt_u i32.gt_s i32.gt_u i32.le_s i32.le_u i32.ge_s i32.ge_u
+i64.eqz i64.eq i64.ne i64.lt_s i64.lt_u i64.gt_s i64.gt_u i64.le_s i64.le_u i64.ge_s i64.ge_u
+f32.eq f32.ne f32.lt f32.gt f32.le f32.ge
+f64.eq f64.ne f64.lt f64.gt f64.le f64.ge
+i32.clz i32.ctz i32.popcnt i32.add i32.sub i32.mul i32.div_s i32.div_u i32.rem_s i32.rem_u
+i32.and i32.or i32.xor i32.shl i32.shr_s i32.shr_u i32.rotl i32.rotr
+i64.clz i64.ctz i64.popcnt i64.add i64.sub i64.mul i64.div_s i64.div_u i64.rem_s i64.rem_u
+i64.and i64.or i64.xor i64.shl i64.shr_s i64.shr_u i64.rotl i64.rotr
+f32.abs f32.neg f32.ceil f32.floor f32.trunc f32.nearest f32.sqrt
+f32.add f32.sub f32.mul f32.div f32.min f32.max f32.copysign
+f64.abs f64.neg f64.ceil f64.floor f64.trunc f64.nearest f64.sqrt
+f64.add f64.sub f64.mul f64.div f64.min f64.max f64.copysign
+i32.wrap_i64 i32.trunc_f32_s i32.trunc_f32_u i32.trunc_f64_s i32.trunc_f64_u
+i64.extend_i32_s i64.extend_i32_u i64.trunc_f32_s i64.trunc_f32_u i64.trunc_f64_s i64.trunc_f64_u
+f32.convert_i32_s f32.convert_i32_u f32.convert_i64_s f32.convert_i64_u f32.demote_f64
+f64.convert_i32_s f64.convert_i32_u f64.convert_i64_s f64.convert_i64_u f64.promote_f32
+i32.reinterpret_f32 i64.reinterpret_f64 f32.reinterpret_i32 f64.reinterpret_i64
+i32.extend8_s i32.extend16_s i64.extend8_s i64.extend16_s i64.extend32_s
+`
+  .split(/\s+/)
+  .filter((name) => name);
+numericInstructions.forEach((name, idx) =>
+  addOpcode(name, [0x45 + idx], "none")
+);
+
+/** Non-trapping float-to-int conversions, they have 0xfc prefix */
+`
+i32.trunc_sat_f32_s i32.trunc_sat_f32_u i32.trunc_sat_f64_s i32.trunc_sat_f64_u
+i64.trunc_sat_f32_s i64.trunc_sat_f32_u i64.trunc_sat_f64_s i64.trunc_sat_f64_u
+`
+  .split(/\s+/)
+  .filter((name) => name)
+  .forEach((name, idx) => addOpcode(name, [0xfc, idx], "none"));
+
+/** Bulk memory instructions, memory indexes are always zero */
+addOpcode("memory.copy", [0xfc, 10, 0x00, 0x00], "none");
+addOpcode("memory.fill", [0xfc, 11, 0x00], "none");
+
+/** SIMD instructions have 0xfd prefix and opcode as LEB128 */
+function addSimdOpcode(
+  name: string,
+  opcode: number,
+  immediate: ImmediateKind = "none",
+  alignment?: number
+) {
+  addOpcode(name, [0xfd, ...encodeULEB128(opcode)], immediate, alignment);
+}
+addSimdOpcode("v128.load", 0x00, "memory", 4);
+addSimdOpcode("v128.store", 0x0b, "memory", 4);
+addSimdOpcode("i8x16.shuffle", 0x0d, "lanes");
+[
+  ["i8x16.extract_lane_s", 0x15],
+  ["i8x16.extract_lane_u", 0x16],
+  ["i8x16.replace_lane", 0x17],
+  ["i16x8.extract_lane_s", 0x18],
+  ["i16x8.extract_lane_u", 0x19],
+  ["i16x8.replace_lane", 0x1a],
+  ["i32x4.extract_lane", 0x1b],
+  ["i32x4.replace_lane", 0x1c],
+  ["i64x2.extract_lane", 0x1d],
+  ["i64x2.replace_lane", 0x1e],
+  ["f32x4.extract_lane", 0x1f],
+  ["f32x4.replace_lane", 0x20],
+  ["f64x2.extract_lane", 0x21],
+  ["f64x2.replace_lane", 0x22],
+].forEach(([name, opcode]) =>
+  addSimdOpcode(name as string, opcode as number, "lanes")
+);
+[
+  ["i8x16.swizzle", 0x0e],
+  ["i8x16.splat", 0x0f],
+  ["i16x8.splat", 0x10],
+  ["i32x4.splat", 0x11],
+  ["i64x2.splat", 0x12],
+  ["f32x4.splat", 0x13],
+  ["f64x2.splat", 0x14],
+  ["v128.not", 0x4d],
+  ["v128.and", 0x4e],
+  ["v128.andnot", 0x4f],
+  ["v128.or", 0x50],
+  ["v128.xor", 0x51],
+  ["v128.bitselect", 0x52],
+  ["i8x16.add", 0x6e],
+  ["i8x16.sub", 0x71],
+  ["i16x8.shl", 0x8b],
+  ["i16x8.shr_s", 0x8c],
+  ["i16x8.shr_u", 0x8d],
+  ["i16x8.add", 0x8e],
+  ["i16x8.sub", 0x91],
+  ["i16x8.mul", 0x95],
+  ["i32x4.shl", 0xab],
+  ["i32x4.shr_s", 0xac],
+  ["i32x4.shr_u", 0xad],
+  ["i32x4.add", 0xae],
+  ["i32x4.sub", 0xb1],
+  ["i32x4.mul", 0xb5],
+  ["i64x2.add", 0xce],
+  ["i64x2.sub", 0xd1],
+  ["i64x2.mul", 0xd5],
+  ["f32x4.add", 0xe4],
+  ["f32x4.sub", 0xe5],
+  ["f32x4.mul", 0xe6],
+  ["f64x2.add", 0xf0],
+  ["f64x2.sub", 0xf1],
+  ["f64x2.mul", 0xf2],
+].forEach(([name, opcode]) => addSimdOpcode(name as string, opcode as number));
+
+interface FunctionEncodingContext {
+  functionIndexes: Map<string, number>;
+  globalIndexes: Map<string, number>;
+  typeIndexes: Map<string, number>;
+  localIndexes: Map<string, number>;
+}
+
+function resolveIndex(
+  name: string,
+  indexes: Map<string, number>,
+  what: string
+): number {
+  if (/^\d+$/.test(name)) {
+    return parseInt(name);
+  }
+  const idx = indexes.get(name);
+  if (idx === undefined) {
+    throw new Error(`Internal error: unknown ${what} ${name}`);
+  }
+  return idx;
+}
+
+function encodeInstruction(
+  instruction: WAStructuredInstruction,
+  context: FunctionEncodingContext
+): Bytes {
+  const args = instruction.args;
+  const info = opcodes.get(instruction.op);
+  if (!info) {
+    throw new Error(
+      `Internal error: unknown instruction '${printInstruction(instruction)}'`
+    );
+  }
+  const bytes: Bytes = [...info.opcode];
+
+  const getArg = (idx: number) => {
+    const arg = args[idx];
+    if (arg === undefined) {
+      throw new Error(
+        `Internal error: no immediate in '${printInstruction(instruction)}'`
+      );
+    }
+    return arg;
+  };
+
+  if (info.immediate === "none") {
+    // Nothing here
+  } else if (info.immediate === "blocktype") {
+    const blockType =
+      args.length > 0 ? args[0].match(/^\(result (\w+)\)$/) : null;
+    if (args.length > 0 && !blockType) {
+      throw new Error(
+        `Internal error: wrong block type in '${printInstruction(instruction)}'`
+      );
+    }
+    bytes.push(blockType ? getValueType(blockType[1]) : 0x40);
+  } else if (info.immediate === "label") {
+    bytes.push(...encodeULEB128(parseInt(getArg(0))));
+  } else if (info.immediate === "labels") {
+    if (args.length === 0) {
+      throw new Error(
+        `Internal error: no labels in '${printInstruction(instruction)}'`
+      );
+    }
+    const labels = args.map((arg) => parseInt(arg));
+    const defaultLabel = labels.pop() as number;
+    bytes.push(
+      ...encodeVector(labels.map((label) => encodeULEB128(label))),
+      ...encodeULEB128(defaultLabel)
+    );
+  } else if (info.immediate === "function") {
+    bytes.push(
+      ...encodeULEB128(
+        resolveIndex(getArg(0), context.functionIndexes, "function")
+      )
+    );
+  } else if (info.immediate === "type") {
+    const typeName = getArg(0).match(/^\(type (\S+)\)$/);
+    if (!typeName) {
+      throw new Error(
+        `Internal error: wrong type in '${printInstruction(instruction)}'`
+      );
+    }
+    bytes.push(
+      ...encodeULEB128(resolveIndex(typeName[1], context.typeIndexes, "type")),
+      // Table index
+      0x00
+    );
+  } else if (info.immediate === "local") {
+    bytes.push(
+      ...encodeULEB128(resolveIndex(getArg(0), context.localIndexes, "local"))
+    );
+  } else if (info.immediate === "global") {
+    bytes.push(
+      ...encodeULEB128(resolveIndex(getArg(0), context.globalIndexes, "global"))
+    );
+  } else if (info.immediate === "memory") {
+    let offset = 0;
+    let alignment = info.alignment as number;
+    for (const arg of args) {
+      const [key, value] = arg.split("=");
+      if (key === "offset") {
+        offset = parseInt(value);
+      } else if (key === "align") {
+        // Text format have bytes here, binary have power of two
+        alignment = Math.round(Math.log(parseInt(value)) / Math.LN2);
+      } else {
+        throw new Error(
+          `Internal error: wrong memarg in '${printInstruction(instruction)}'`
+        );
+      }
+    }
+    bytes.push(...encodeULEB128(alignment), ...encodeULEB128(offset));
+  } else if (info.immediate === "zero") {
+    bytes.push(0x00);
+  } else if (info.immediate === "lanes") {
+    if (args.length === 0) {
+      throw new Error(
+        `Internal error: no lanes in '${printInstruction(instruction)}'`
+      );
+    }
+    bytes.push(...args.map((arg) => parseInt(arg)));
+  } else if (info.immediate === "i32") {
+    bytes.push(...encodeSLEB128(Number(getArg(0).replace(/_/g, ""))));
+  } else if (info.immediate === "i64") {
+    const [lo, hi] = parseInt64(getArg(0));
+    bytes.push(...encodeSLEB128Pair(lo, hi));
+  } else if (info.immediate === "f32" || info.immediate === "f64") {
+    const size = info.immediate === "f32" ? 4 : 8;
+    const view = new DataView(new ArrayBuffer(size));
+    const value = parseFloatLiteral(getArg(0));
+    if (size === 4) {
+      view.setFloat32(0, value, true);
+    } else {
+      view.setFloat64(0, value, true);
+    }
+    for (let i = 0; i < size; i++) {
+      bytes.push(view.getUint8(i));
+    }
+  } else {
+    throw new Error(`Internal error: unknown immediate ${info.immediate}`);
+  }
+
+  return bytes;
+}
+
+/** Offsets of locations are relative to the beginning of the body */
+function encodeFunctionBody(
+  func: WAFunction,
+  context: Omit<FunctionEncodingContext, "localIndexes">
+): { bytes: Bytes; locations: BinaryLocation[] } {
+  const localIndexes = new Map<string, number>();
+  [...func.params, ...func.locals].forEach((local, idx) =>
+    localIndexes.set(local.name, idx)
+  );
+
+  // Locals are encoded as groups of same type
+  const localGroups: Bytes[] = [];
+  let groupType: RegisterType | null = null;
+  let groupCount = 0;
+  for (const local of [...func.locals, null]) {
+    if (local && local.type === groupType) {
+      groupCount++;
+      continue;
+    }
+    if (groupType) {
+      localGroups.push([...encodeULEB128(groupCount), valueTypes[groupType]]);
+    }
+    groupType = local ? local.type : null;
+    groupCount = 1;
+  }
+
+  const functionContext: FunctionEncodingContext = {
+    ...context,
+    localIndexes,
+  };
+  const code: Bytes = encodeVector(localGroups);
+  const codeLocations: BinaryLocation[] = [];
+  for (const instruction of func.body) {
+    if (instruction.location) {
+      codeLocations.push({
+        offset: code.length,
+        location: instruction.location,
+      });
+    }
+    append(code, encodeInstruction(instruction, functionContext));
+  }
+  code.push(0x0b);
+
+  const body = encodeULEB128(code.length);
+  const locations = codeLocations.map((item) => ({
+    ...item,
+    offset: item.offset + body.length,
+  }));
+  append(body, code);
+  return { bytes: body, locations };
+}
+
+function encodeSection(id: number, content: Bytes): Bytes {
+  const bytes = [id, ...encodeULEB128(content.length)];
+  append(bytes, content);
+  return bytes;
+}
+
+function encodeI32ConstExpression(value: number): Bytes {
+  return [0x41, ...encodeSLEB128(value), 0x0b];
+}
+
+const EXPORT_KIND_FUNCTION = 0x00;
+const EXPORT_KIND_MEMORY = 0x02;
+const EXPORT_KIND_GLOBAL = 0x03;
+const FUNCREF = 0x70;
+
+function getLocalName(local: { name: string; sourceName?: string | null }) {
+  return local.sourceName || local.name.replace(/^\$/, "");
+}
+
+function encodeNameSection(module: WAModule): Bytes {
+  const importsCount = module.importedFunctions.length;
+  const functionNames = encodeVector([
+    ...module.importedFunctions.map((func, idx) => [
+      ...encodeULEB128(idx),
+      ...encodeString(getLocalName(func)),
+    ]),
+    ...module.functions.map((func, idx) => [
+      ...encodeULEB128(importsCount + idx),
+      ...encodeString(getLocalName(func)),
+    ]),
+  ]);
+  const localNames = encodeVector(
+    module.functions.map((func, idx) => [
+      ...encodeULEB128(importsCount + idx),
+      ...encodeVector(
+        [...func.params, ...func.locals].map((local, localIdx) => [
+          ...encodeULEB128(localIdx),
+          ...encodeString(getLocalName(local)),
+        ])
+      ),
+    ])
+  );
+  const bytes = encodeString("name");
+  append(bytes, encodeSection(1, functionNames));
+  append(bytes, encodeSection(2, localNames));
+  return bytes;
+}
+
+/**
+ * WebAssembly binary module
+ */
+export function encodeModuleBinary(module: WAModule): Uint8Array {
+  return encodeModule(module, null).binary;
+}
+
+/**
+ * WebAssembly binary module with source map for it.
+ *   Module refers to the source map with sourceMappingURL custom section
+ */
+export function encodeModuleBinaryWithSourceMap(
+  module: WAModule,
+  options: { sourceMapUrl: string; sourceFileName: string }
+): { binary: Uint8Array; sourceMap: SourceMap } {
+  const { binary, locations } = encodeModule(module, options.sourceMapUrl);
+  return {
+    binary,
+    sourceMap: createSourceMap(locations, options.sourceFileName),
+  };
+}
+
+function encodeModule(
+  module: WAModule,
+  sourceMapUrl: string | null
+): { binary: Uint8Array; locations: BinaryLocation[] } {
+  const typeIndexes = new Map<string, number>();
+  module.types.forEach((waType, idx) => typeIndexes.set(waType.name, idx));
+
+  const functionIndexes = new Map<string, number>();
+  [...module.importedFunctions, ...module.functions].forEach((func, idx) =>
+    functionIndexes.set(func.name, idx)
+  );
+
+  const importedGlobals = module.globals.filter((global) => global.importFrom);
+  const definedGlobals = module.globals.filter((global) => !global.importFrom);
+  const globalIndexes = new Map<string, number>();
+  [...importedGlobals, ...definedGlobals].forEach((global, idx) =>
+    globalIndexes.set(global.name, idx)
+  );
+
+  const typeSection = encodeVector(
+    module.types.map((waType) => [
+      0x60,
+      ...encodeVector(waType.params.map((param) => [valueTypes[param]])),
+      ...encodeVector(waType.results.map((result) => [valueTypes[result]])),
+    ])
+  );
+
+  const memory = module.memory;
+  const memoryLimits =
+    memory.maxPages !== null
+      ? [
+          0x01,
+          ...encodeULEB128(memory.minPages),
+          ...encodeULEB128(memory.maxPages),
+        ]
+      : [0x00, ...encodeULEB128(memory.minPages)];
+
+  const importSection = encodeVector([
+    ...(memory.importFrom
+      ? [
+          [
+            ...encodeString(memory.importFrom.module),
+            ...encodeString(memory.importFrom.name),
+            EXPORT_KIND_MEMORY,
+            ...memoryLimits,
+          ],
+        ]
+      : []),
+    ...importedGlobals.map((global) => {
+      if (!global.importFrom) {
+        throw new Error("Internal error: global is not imported");
+      }
+      return [
+        ...encodeString(global.importFrom.module),
+        ...encodeString(global.importFrom.name),
+        EXPORT_KIND_GLOBAL,
+        valueTypes[global.type],
+        global.mutable ? 0x01 : 0x00,
+      ];
+    }),
+    ...module.importedFunctions.map((func) => [
+      ...encodeString(func.importFrom.module),
+      ...encodeString(func.importFrom.name),
+      EXPORT_KIND_FUNCTION,
+      ...encodeULEB128(resolveIndex(func.typeName, typeIndexes, "type")),
+    ]),
+  ]);
+
+  const functionSection = encodeVector(
+    module.functions.map((func) =>
+      encodeULEB128(resolveIndex(func.typeName, typeIndexes, "type"))
+    )
+  );
+
+  const tableSize = encodeULEB128(module.table.length);
+  const tableSection = encodeVector([
+    [
+      FUNCREF,
+      // Limits: minimum and maximum
+      0x01,
+      ...tableSize,
+      ...tableSize,
+    ],
+  ]);
+
+  const globalSection = encodeVector(
+    definedGlobals.map((global) => {
+      if (global.type !== "i32") {
+        throw new Error("Internal error: only i32 globals are supported");
+      }
+      return [
+        valueTypes[global.type],
+        global.mutable ? 0x01 : 0x00,
+        ...encodeI32ConstExpression(global.initValue),
+      ];
+    })
+  );
+
+  const memorySection = encodeVector(memory.importFrom ? [] : [memoryLimits]);
+
+  const exports: Bytes[] = [];
+  if (memory.exportName) {
+    exports.push([
+      ...encodeString(memory.exportName),
+      EXPORT_KIND_MEMORY,
+      // Memory index
+      0x00,
+    ]);
+  }
+  for (const global of [...importedGlobals, ...definedGlobals]) {
+    if (global.exportName) {
+      exports.push([
+        ...encodeString(global.exportName),
+        EXPORT_KIND_GLOBAL,
+        ...encodeULEB128(resolveIndex(global.name, globalIndexes, "global")),
+      ]);
+    }
+  }
+  for (const func of module.functions) {
+    if (func.exportName) {
+      exports.push([
+        ...encodeString(func.exportName),
+        EXPORT_KIND_FUNCTION,
+        ...encodeULEB128(resolveIndex(func.name, functionIndexes, "function")),
+      ]);
+    }
+  }
+  const exportSection = encodeVector(exports);
+
+  const elementSection = encodeVector([
+    [
+      // Active segment for table 0
+      0x00,
+      ...encodeI32ConstExpression(0),
+      ...encodeVector(
+        module.table.map((name) =>
+          encodeULEB128(resolveIndex(name, functionIndexes, "function"))
+        )
+      ),
+    ],
+  ]);
+
+  const functionBodies = module.functions.map((func) =>
+    encodeFunctionBody(func, { functionIndexes, globalIndexes, typeIndexes })
+  );
+  const codeSection = encodeVector(functionBodies.map((body) => body.bytes));
+
+  const dataSection = encodeVector(
+    module.data.map((data) => {
+      const segment = [
+        // Active segment for memory 0
+        0x00,
+        ...encodeI32ConstExpression(data.offset),
+        ...encodeULEB128(data.bytes.length),
+      ];
+      append(segment, data.bytes);
+      return segment;
+    })
+  );
+
+  const bytes: Bytes = [
+    // Magic "\0asm"
+    0x00,
+    0x61,
+    0x73,
+    0x6d,
+    // Version
+    0x01,
+    0x00,
+    0x00,
+    0x00,
+  ];
+  append(bytes, encodeSection(1, typeSection));
+  append(bytes, encodeSection(2, importSection));
+  append(bytes, encodeSection(3, functionSection));
+  append(bytes, encodeSection(4, tableSection));
+  append(bytes, encodeSection(5, memorySection));
+  append(bytes, encodeSection(6, globalSection));
+  append(bytes, encodeSection(7, exportSection));
+  append(bytes, encodeSection(9, elementSection));
+
+  // Bodies go after the section header and the count of bodies
+  let bodyOffset =
+    bytes.length +
+    1 +
+    encodeULEB128(codeSection.length).length +
+    encodeULEB128(functionBodies.length).length;
+  const locations: BinaryLocation[] = [];
+  for (const body of functionBodies) {
+    for (const item of body.locations) {
+      locations.push({ ...item, offset: item.offset + bodyOffset });
+    }
+    bodyOffset += body.bytes.length;
+  }
+  append(bytes, encodeSection(10, codeSection));
+  append(bytes, encodeSection(11, dataSection));
+  append(bytes, encodeSection(0, encodeNameSection(module)));
+  if (sourceMapUrl !== null) {
+    append(
+      bytes,
+      encodeSection(0, [
+        ...encodeString("sourceMappingURL"),
+        ...encodeString(sourceMapUrl),
+      ])
+    );
+  }
+
+  return { binary: new Uint8Array(bytes), locations };
+}
+
@@ -0,0 +1,105 @@
+import { WAModule, WAInstuction, WAFunction } from "./emitter.definitions";
+import { getWaTypeDefinition } from "./emitter.helpers.functionsignature";
+import { dataString } from "./emitter.utils";
+import { printInstruction } from "./emitter.instructions";
+
+function printFunction(func: WAFunction): WAInstuction[] {
+  const header =
+    `(func ${func.name} (type ${func.typeName})` +
+    func.params.map((param) => ` (param ${param.name} ${param.type})`).join("") +
+    (func.results.length > 0 ? ` (result ${func.results.join(" ")})` : "") +
+    func.locals.map((local) => ` (local ${local.name} ${local.type})`).join("");
+
+  return [
+    ...(func.comment ? [`;; ${func.comment}`] : []),
+    header,
+    ...func.body.map(printInstruction),
+    `)`,
+    ...(func.exportName
+      ? [`(export "${func.exportName}" (func ${func.name}))`]
+      : []),
+    "",
+  ];
+}
+
+/**
+ * WebAssembly text format of module. It is a debug view, use binary for real usage
+ */
+export function printModuleWat(module: WAModule): WAInstuction[] {
+  const memory = module.memory;
+  const memoryLimits =
+    memory.maxPages !== null
+      ? `${memory.minPages} ${memory.maxPages}`
+      : `${memory.minPages}`;
+  // Imports must be before any definition
+  const code: WAInstuction[] = ["(module"];
+  if (memory.importFrom) {
+    code.push(
+      `(import "${memory.importFrom.module}" "${memory.importFrom.name}" (memory ${memoryLimits}))`
+    );
+  }
+
+  for (const global of module.globals) {
+    if (global.importFrom) {
+      code.push(
+        `(import "${global.importFrom.module}" "${
+          global.importFrom.name
+        }" (global ${global.name} ${
+          global.mutable ? `(mut ${global.type})` : global.type
+        }))`
+      );
+    }
+  }
+
+  for (const func of module.importedFunctions) {
+    code.push(
+      `(import "${func.importFrom.module}" "${func.importFrom.name}" (func ${func.name} (type ${func.typeName})))`
+    );
+  }
+
+  if (!memory.importFrom) {
+    code.push(`(memory ${memoryLimits})`);
+  }
+  if (memory.exportName) {
+    code.push(`(export "${memory.exportName}" (memory 0))`);
+  }
+
+  for (const waType of module.types) {
+    code.push(`(type ${waType.name} ${getWaTypeDefinition(waType)})`);
+  }
+
+  code.push(
+    `(table ${module.table.length} ${module.table.length} anyfunc) ;; min and max length`,
+    `(elem (i32.const 0) ${module.table.join(" ")})`
+  );
+
+  for (const global of module.globals) {
+    if (!global.importFrom) {
+      code.push(
+        `(global ${global.name} ${
+          global.mutable ? `(mut ${global.type})` : global.type
+        } (${global.type}.const ${global.initValue}))`
+      );
+    }
+    if (global.exportName) {
+      code.push(`(export "${global.exportName}" (global ${global.name}))`);
+    }
+  }
+
+  for (const func of module.functions) {
+    code.push(...printFunction(func));
+  }
+
+  for (const data of module.data) {
+    if (data.comment) {
+      code.push(`;; ${data.comment}`);
+    }
+    code.push(
+      `(data (i32.const ${data.offset}) "${dataString.bytes(data.bytes)}")`
+    );
+  }
+
+  code.push(")");
+
+  return code;
+}
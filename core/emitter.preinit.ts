@@ -0,0 +1,173 @@
+import { WADataSegment, WAModule } from "./emitter.definitions";
+import { encodeModuleBinary } from "./emitter.module.binary";
+import {
+  PAGE_SIZE,
+  STACK_POINTER_GLOBAL,
+  STACK_POINTER_EXTERNAL_NAME,
+  getMemoryLayoutForStackPointer,
+} from "./emitter.memory";
+import {
+  PROFILE_TIMER_IMPORT_NAME,
+  PROFILE_RESET_EXPORT_NAME,
+} from "./emitter.instrumentation";
+
+/** Zero runs longer than this split snapshot into separate segments */
+const MIN_ZERO_GAP = 16;
+
+function readInt32(mem8: Uint8Array, offset: number) {
+  return (
+    (mem8[offset] |
+      (mem8[offset + 1] << 8) |
+      (mem8[offset + 2] << 16) |
+      (mem8[offset + 3] << 24)) >>>
+    0
+  );
+}
+
+/**
+ * Memory is zeroed on instantiation, so zero runs are not written
+ */
+export function createSnapshotSegments(
+  mem8: Uint8Array,
+  from: number,
+  to: number
+): WADataSegment[] {
+  const segments: WADataSegment[] = [];
+  let start: number | null = null;
+  let lastNonZero = 0;
+  for (let i = from; i <= to; i++) {
+    const isZero = i === to || mem8[i] === 0;
+    if (!isZero) {
+      if (start === null) {
+        start = i;
+      }
+      lastNonZero = i;
+    } else if (start !== null && (i === to || i - lastNonZero > MIN_ZERO_GAP)) {
+      segments.push({
+        offset: start,
+        bytes: Array.from(mem8.slice(start, lastNonZero + 1)),
+        comment: "Pre-initialized memory",
+      });
+      start = null;
+    }
+  }
+  return segments;
+}
+
+/**
+ * Instantiates module, calls exported initializers and replaces data segments
+ *   with the memory after them. Initializers must have no parameters
+ *   and must not leave anything on the stack
+ */
+export async function preinitializeModule(
+  module: WAModule,
+  initializers: string[]
+): Promise<WAModule> {
+  for (const name of initializers) {
+    const func = module.functions.find((func) => func.exportName === name);
+    if (!func) {
+      throw new Error(`Pre-initializer '${name}' is not exported`);
+    }
+    if (func.params.length > 0) {
+      throw new Error(`Pre-initializer '${name}' must have no parameters`);
+    }
+  }
+
+  const stackPointerGlobal = module.globals.find(
+    (global) => global.name === STACK_POINTER_GLOBAL
+  );
+  if (!stackPointerGlobal) {
+    throw new Error("Internal error: no stack pointer global");
+  }
+  const layout = getMemoryLayoutForStackPointer(stackPointerGlobal.initValue);
+
+  const importedMemory = module.memory.importFrom
+    ? new WebAssembly.Memory({
+        initial: module.memory.minPages,
+        ...(module.memory.maxPages !== null
+          ? { maximum: module.memory.maxPages }
+          : {}),
+      })
+    : null;
+  const importedStackPointer = stackPointerGlobal.importFrom
+    ? new WebAssembly.Global(
+        { value: "i32", mutable: true },
+        layout.espInitialValue
+      )
+    : null;
+
+  for (const func of module.importedFunctions) {
+    if (func.importFrom.name !== PROFILE_TIMER_IMPORT_NAME) {
+      throw new Error(
+        `Pre-initializers can not import ${func.importFrom.name}`
+      );
+    }
+  }
+
+  const { instance } = await WebAssembly.instantiate(
+    encodeModuleBinary(module),
+    {
+      js: {
+        // Time of pre-initializers is not measured
+        [PROFILE_TIMER_IMPORT_NAME]: () => 0,
+        ...(importedMemory ? { memory: importedMemory } : {}),
+        ...(importedStackPointer
+          ? { [STACK_POINTER_EXTERNAL_NAME]: importedStackPointer }
+          : {}),
+      },
+    }
+  );
+
+  for (const name of initializers) {
+    (instance.exports[name] as () => void)();
+  }
+  // Calls of pre-initializers are not kept in profile
+  const resetProfile = instance.exports[PROFILE_RESET_EXPORT_NAME];
+  if (resetProfile) {
+    (resetProfile as () => void)();
+  }
+
+  const stackPointer = instance.exports[
+    STACK_POINTER_EXTERNAL_NAME
+  ] as WebAssembly.Global;
+  if (stackPointer.value !== layout.espInitialValue) {
+    throw new Error("Stack pointer is not restored after pre-initializers");
+  }
+
+  const memory =
+    importedMemory || (instance.exports.memory as WebAssembly.Memory);
+  const mem8 = new Uint8Array(memory.buffer);
+  // Everything what was written above globals is kept, heap can be used too
+  let touchedEnd = readInt32(mem8, layout.heapBeginAddress);
+  for (let i = mem8.length - 1; i >= touchedEnd; i--) {
+    if (mem8[i] !== 0) {
+      touchedEnd = i + 1;
+      break;
+    }
+  }
+
+  // Heap could grow during initialization, snapshot must fit into memory
+  const minPages = Math.max(
+    module.memory.minPages,
+    memory.buffer.byteLength / PAGE_SIZE
+  );
+
+  return {
+    ...module,
+    memory: { ...module.memory, minPages },
+    data: [
+      {
+        offset: layout.heapBeginAddress,
+        bytes: Array.from(
+          mem8.slice(layout.heapBeginAddress, layout.globalsBeginAddress)
+        ),
+        comment: "Initializer for HEAP_BEGIN",
+      },
+      ...createSnapshotSegments(
+        mem8,
+        layout.globalsBeginAddress,
+        touchedEnd
+      ),
+    ],
+  };
+}
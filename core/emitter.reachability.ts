@@ -0,0 +1,190 @@
+import {
+  CompoundStatementBody,
+  DeclaratorId,
+  ExpressionNode,
+  FunctionDefinition,
+  InitializerNode,
+} from "./parser.definitions";
+import { assertNever } from "./assertNever";
+
+interface FunctionReferences {
+  /** Identifiers which are used as target of function call */
+  called: Set<DeclaratorId>;
+  /** Identifiers which are used as values, i.e. their address is taken */
+  used: Set<DeclaratorId>;
+}
+
+/**
+ * Collects identifiers used in function body. It does not know types,
+ *   so result contains variables too and caller must filter functions
+ */
+function findReferences(
+  body: CompoundStatementBody[],
+  initializers: InitializerNode[] = []
+): FunctionReferences {
+  const called = new Set<DeclaratorId>();
+  const used = new Set<DeclaratorId>();
+
+  function checkExpression(expression: ExpressionNode): void {
+    if (expression.type === "identifier") {
+      used.add(expression.declaratorNodeId);
+    } else if (
+      expression.type === "const" ||
+      expression.type === "string-literal" ||
+      expression.type === "sizeof typename"
+    ) {
+      return;
+    } else if (expression.type === "subscript operator") {
+      checkExpression(expression.target);
+      checkExpression(expression.index);
+    } else if (expression.type === "function call") {
+      // Same rule as in emitter: call by identifier is a direct call
+      if (expression.target.type === "identifier") {
+        called.add(expression.target.declaratorNodeId);
+      } else {
+        checkExpression(expression.target);
+      }
+      expression.args.forEach((arg) => checkExpression(arg));
+    } else if (
+      expression.type === "struct access" ||
+      expression.type === "struct pointer access" ||
+      expression.type === "postfix ++" ||
+      expression.type === "postfix --" ||
+      expression.type === "prefix ++" ||
+      expression.type === "prefix --" ||
+      expression.type === "cast" ||
+      expression.type === "unary-operator"
+    ) {
+      checkExpression(expression.target);
+    } else if (expression.type === "sizeof expression") {
+      // Not evaluated
+      return;
+    } else if (expression.type === "binary operator") {
+      checkExpression(expression.left);
+      checkExpression(expression.right);
+    } else if (expression.type === "conditional expression") {
+      checkExpression(expression.condition);
+      checkExpression(expression.iftrue);
+      checkExpression(expression.iffalse);
+    } else if (expression.type === "assignment") {
+      checkExpression(expression.lvalue);
+      checkExpression(expression.rvalue);
+    } else if (expression.type === "expression with sideeffect") {
+      checkExpression(expression.sizeeffect);
+      checkExpression(expression.effectiveValue);
+    } else {
+      assertNever(expression);
+    }
+  }
+
+  function checkInitializer(initializer: InitializerNode): void {
+    if (initializer.type === "assigmnent-expression") {
+      checkExpression(initializer.expression);
+    } else {
+      initializer.items.forEach((item) => checkInitializer(item));
+    }
+  }
+
+  function checkBlock(block: CompoundStatementBody[]): void {
+    for (const statement of block) {
+      if (statement.type === "declarator") {
+        if (statement.initializer) {
+          checkInitializer(statement.initializer);
+        }
+      } else if (
+        statement.type === "noop" ||
+        statement.type === "break" ||
+        statement.type === "continue"
+      ) {
+        // Nothing here
+      } else if (statement.type === "return") {
+        if (statement.expression) {
+          checkExpression(statement.expression);
+        }
+      } else if (statement.type === "expression") {
+        checkExpression(statement.expression);
+      } else if (statement.type === "compound-statement") {
+        checkBlock(statement.body);
+      } else if (statement.type === "if") {
+        checkExpression(statement.condition);
+        checkBlock([statement.iftrue]);
+        if (statement.iffalse) {
+          checkBlock([statement.iffalse]);
+        }
+      } else if (statement.type === "while" || statement.type === "dowhile") {
+        checkExpression(statement.condition);
+        checkBlock([statement.body]);
+      } else if (statement.type === "switch") {
+        checkExpression(statement.expression);
+        checkBlock([statement.body]);
+      } else if (statement.type === "case" || statement.type === "default") {
+        // Case value is a constant expression
+        checkBlock([statement.body]);
+      } else {
+        assertNever(statement);
+      }
+    }
+  }
+
+  checkBlock(body);
+  initializers.forEach((initializer) => checkInitializer(initializer));
+
+  return { called, used };
+}
+
+export interface Reachability {
+  /** Functions which are called or used from entry points */
+  reachable: Set<DeclaratorId>;
+  /** Reachable functions which are used as values, they must be in table */
+  addressTaken: Set<DeclaratorId>;
+}
+
+/**
+ * Walks call graph starting from entry points.
+ * Functions used in initializers of globals are reachable too
+ */
+export function findReachableFunctions(
+  definitions: FunctionDefinition[],
+  entryPoints: DeclaratorId[],
+  globalInitializers: InitializerNode[] = []
+): Reachability {
+  const definitionsMap = new Map<DeclaratorId, FunctionDefinition>();
+  for (const definition of definitions) {
+    definitionsMap.set(definition.declaration.declaratorId, definition);
+  }
+
+  const reachable = new Set<DeclaratorId>();
+  const addressTaken = new Set<DeclaratorId>();
+  const queue = [...entryPoints];
+  findReferences([], globalInitializers).used.forEach((usedId) => {
+    if (definitionsMap.has(usedId)) {
+      addressTaken.add(usedId);
+      queue.push(usedId);
+    }
+  });
+  while (queue.length > 0) {
+    const id = queue.pop() as DeclaratorId;
+    if (reachable.has(id)) {
+      continue;
+    }
+    reachable.add(id);
+    const definition = definitionsMap.get(id);
+    if (!definition) {
+      continue;
+    }
+    const { called, used } = findReferences(definition.body);
+    called.forEach((calledId) => {
+      if (definitionsMap.has(calledId)) {
+        queue.push(calledId);
+      }
+    });
+    used.forEach((usedId) => {
+      if (definitionsMap.has(usedId)) {
+        addressTaken.add(usedId);
+        queue.push(usedId);
+      }
+    });
+  }
+
+  return { reachable, addressTaken };
+}
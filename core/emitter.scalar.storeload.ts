@@ -54,16 +54,27 @@ export function storeScalar(
         );
       }
       return addOffsetAlign(`i64.store`, offset, align, 2);
-    } else if (
-      typename.arithmeticType === "double" ||
-      typename.arithmeticType === "float"
-    ) {
-      throw new Error("TOOD: Store float/double");
+    } else if (typename.arithmeticType === "float") {
+      if (fromRegister !== "f32") {
+        throw new Error(
+          `Internal error: unable to save float from ${fromRegister} register`
+        );
+      }
+      return addOffsetAlign(`f32.store`, offset, align, 2);
+    } else if (typename.arithmeticType === "double") {
+      if (fromRegister !== "f64") {
+        throw new Error(
+          `Internal error: unable to save double from ${fromRegister} register`
+        );
+      }
+      return addOffsetAlign(`f64.store`, offset, align, 2);
     } else {
       assertNever(typename.arithmeticType);
     }
   } else if (typename.type === "pointer") {
     return addOffsetAlign(`i32.store`, offset, align, 2);
+  } else if (typename.type === "vector") {
+    return addOffsetAlign(`v128.store`, offset, align, 2);
   }
   throw new Error(
     `Wrong usage, expecting only scalar types but got type=${typename.type}`
@@ -76,8 +87,30 @@ export function loadScalar(
   offset = 0,
   alignment = 0
 ): WAInstuction {
-  if (toRegister !== "i32") {
-    throw new Error("Not supported yet");
+  if (toRegister === "i64") {
+    if (t.type !== "arithmetic" || t.arithmeticType !== "long long") {
+      throw new Error("Internal error or not suppored yet");
+    }
+    return (
+      addOffsetAlign(`i64.load`, offset, alignment, 2) +
+      `;; readArithmetic long long`
+    );
+  }
+  if (toRegister === "v128") {
+    if (t.type !== "vector") {
+      throw new Error("Internal error or not suppored yet");
+    }
+    return addOffsetAlign(`v128.load`, offset, alignment, 2);
+  }
+  if (toRegister === "f32" || toRegister === "f64") {
+    const expectedType = toRegister === "f32" ? "float" : "double";
+    if (t.type !== "arithmetic" || t.arithmeticType !== expectedType) {
+      throw new Error("Internal error or not suppored yet");
+    }
+    return (
+      addOffsetAlign(`${toRegister}.load`, offset, alignment, 2) +
+      `;; readArithmetic ${expectedType}`
+    );
   }
   if (t.type === "pointer") {
     return addOffsetAlign(`i32.load`, offset, alignment, 2);
@@ -105,3 +138,37 @@ export function loadScalar(
   }
   throw new Error("Internal error or not suppored yet");
 }
+
+/**
+ * Returns code which makes the same with register value as store+load do,
+ * i.e. truncates value to typename range.
+ * Used for variables which are kept in WebAssembly locals
+ */
+export function narrowScalarInRegister(t: Typename): WAInstuction[] {
+  if (t.type === "pointer" || t.type === "vector") {
+    return [];
+  }
+  if (t.type !== "arithmetic") {
+    throw new Error("Internal error");
+  }
+  if (
+    t.arithmeticType === "int" ||
+    t.arithmeticType === "long long" ||
+    t.arithmeticType === "float" ||
+    t.arithmeticType === "double"
+  ) {
+    return [];
+  } else if (t.arithmeticType === "char") {
+    if (t.signedUnsigned === "signed") {
+      return [
+        `i32.const 24`,
+        `i32.shl`,
+        `i32.const 24`,
+        `i32.shr_s ;; narrow to signed char`,
+      ];
+    } else {
+      return [`i32.const 255`, `i32.and ;; narrow to unsigned char`];
+    }
+  }
+  throw new Error("Internal error or not suppored yet");
+}
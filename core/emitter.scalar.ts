@@ -1,4 +1,7 @@
 import { Typename } from "./parser.definitions";
+import { WAInstuction } from "./emitter.definitions";
+import { getRegisterForTypename, isFloatingRegister } from "./emitter.utils";
+import { narrowScalarInRegister } from "./emitter.scalar.storeload";
 
 /**
  * Returns true if typename is scalar = arithmetic||pointer
@@ -6,3 +9,79 @@ import { Typename } from "./parser.definitions";
 export function isScalar(typename: Typename) {
   return typename.type === "arithmetic" || typename.type === "pointer";
 }
+
+function isSigned(typename: Typename) {
+  return (
+    typename.type === "arithmetic" && typename.signedUnsigned === "signed"
+  );
+}
+
+/**
+ * Returns code which converts value of one scalar type into another one
+ *  when they are kept in different registers (6.3.1.3)
+ */
+export function convertScalarRegister(
+  from: Typename,
+  to: Typename
+): WAInstuction[] {
+  const fromRegister = getRegisterForTypename(from);
+  const toRegister = getRegisterForTypename(to);
+  if (!fromRegister || !toRegister) {
+    throw new Error("Internal error: conversion of non-scalar value");
+  }
+  if (fromRegister === toRegister) {
+    return [];
+  }
+  if (fromRegister === "v128" || toRegister === "v128") {
+    throw new Error("Vector can be converted only to vector");
+  }
+  if (
+    (from.type === "pointer" || to.type === "pointer") &&
+    (isFloatingRegister(fromRegister) || isFloatingRegister(toRegister))
+  ) {
+    throw new Error("Pointers can be converted only to integer types");
+  }
+  if (fromRegister === "i32" && toRegister === "i64") {
+    return [isSigned(from) ? `i64.extend_i32_s` : `i64.extend_i32_u`];
+  }
+  if (fromRegister === "i64" && toRegister === "i32") {
+    return [`i32.wrap_i64`, ...narrowScalarInRegister(to)];
+  }
+  if (fromRegister === "f32" && toRegister === "f64") {
+    return [`f64.promote_f32`];
+  }
+  if (fromRegister === "f64" && toRegister === "f32") {
+    return [`f32.demote_f64`];
+  }
+  if (isFloatingRegister(toRegister)) {
+    // Integer to floating
+    const suffix = isSigned(from) ? "s" : "u";
+    return [`${toRegister}.convert_${fromRegister}_${suffix}`];
+  }
+  // Floating to integer, fractional part is discarded (6.3.1.4).
+  // Values out of range are undefined behavior, so saturation is fine
+  const suffix = isSigned(to) ? "s" : "u";
+  return [
+    `${toRegister}.trunc_sat_${fromRegister}_${suffix}`,
+    ...narrowScalarInRegister(to),
+  ];
+}
+
+/**
+ * Returns code which turns scalar value into i32 which is zero for false.
+ * Used for conditions
+ */
+export function scalarToCondition(typename: Typename): WAInstuction[] {
+  const register = getRegisterForTypename(typename);
+  if (register === "i32") {
+    return [];
+  } else if (register === "i64") {
+    return [`i64.eqz`, `i32.eqz`];
+  } else if (isFloatingRegister(register)) {
+    return [`${register}.const 0`, `${register}.ne`];
+  }
+  if (register === "v128") {
+    throw new Error("Vector can not be used as condition");
+  }
+  throw new Error(`TODO: Condition of ${register} is not supported yet`);
+}
@@ -0,0 +1,51 @@
+import {
+  encodeVLQ,
+  decodeVLQ,
+  createSourceMap,
+  decodeMappings,
+  findSourceLocation,
+} from "./emitter.sourcemap";
+
+describe("Source map", () => {
+  it(`Encodes VLQ`, () => {
+    expect(encodeVLQ(0)).toBe("A");
+    expect(encodeVLQ(1)).toBe("C");
+    expect(encodeVLQ(-1)).toBe("D");
+    expect(encodeVLQ(16)).toBe("gB");
+    expect(encodeVLQ(123456)).toBe("gkxH");
+    for (const value of [0, 5, -5, 15, 16, -16, 1000, -123456, 1 << 28]) {
+      expect(decodeVLQ(encodeVLQ(value))).toStrictEqual([value]);
+    }
+  });
+
+  it(`Creates mappings`, () => {
+    const map = createSourceMap(
+      [
+        { offset: 120, location: { line: 5, pos: 3, length: 1 } },
+        { offset: 100, location: { line: 2, pos: 1, length: 1 } },
+        // Same location is not repeated
+        { offset: 125, location: { line: 5, pos: 3, length: 1 } },
+        { offset: 130, location: { line: 3, pos: 7, length: 1 } },
+      ],
+      "test.c"
+    );
+    expect(map.version).toBe(3);
+    expect(map.sources).toStrictEqual(["test.c"]);
+    expect(map.mappings).toBe("oGACA,oBAGE,UAFI");
+    expect(decodeMappings(map.mappings)).toStrictEqual([
+      { offset: 100, line: 2, pos: 1 },
+      { offset: 120, line: 5, pos: 3 },
+      { offset: 130, line: 3, pos: 7 },
+    ]);
+
+    expect(findSourceLocation(map.mappings, 99)).toBe(null);
+    expect(findSourceLocation(map.mappings, 127)).toStrictEqual({
+      line: 5,
+      pos: 3,
+    });
+    expect(findSourceLocation(map.mappings, 500)).toStrictEqual({
+      line: 3,
+      pos: 7,
+    });
+  });
+});
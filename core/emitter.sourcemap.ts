@@ -0,0 +1,139 @@
+import { TokenLocation } from "./error";
+
+/*
+
+Source map for WebAssembly binary
+https://sourcemaps.info/spec.html
+
+WebAssembly module is a single generated line, column is a byte offset
+  of the instruction in the module binary. Lines and columns of the source
+  are zero-based in source map, but TokenLocation have them one-based.
+
+ */
+
+export interface BinaryLocation {
+  /** Offset of instruction from the beginning of the module binary */
+  offset: number;
+  location: TokenLocation;
+}
+
+export interface SourceMap {
+  version: 3;
+  sources: string[];
+  names: string[];
+  mappings: string;
+}
+
+const BASE64 =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+export function encodeVLQ(value: number): string {
+  let vlq = value < 0 ? (-value << 1) | 1 : value << 1;
+  let result = "";
+  do {
+    let digit = vlq & 0x1f;
+    vlq = vlq >>> 5;
+    if (vlq > 0) {
+      digit |= 0x20;
+    }
+    result += BASE64[digit];
+  } while (vlq > 0);
+  return result;
+}
+
+export function decodeVLQ(segment: string): number[] {
+  const values: number[] = [];
+  let value = 0;
+  let shift = 0;
+  for (const char of segment) {
+    const digit = BASE64.indexOf(char);
+    if (digit === -1) {
+      throw new Error(`Wrong base64 symbol ${char}`);
+    }
+    value += (digit & 0x1f) << shift;
+    if (digit & 0x20) {
+      shift += 5;
+    } else {
+      values.push(value & 1 ? -(value >>> 1) : value >>> 1);
+      value = 0;
+      shift = 0;
+    }
+  }
+  return values;
+}
+
+/**
+ * Segments are [column, source index, source line, source column],
+ *   every field is relative to the same field of previous segment
+ */
+export function createSourceMap(
+  locations: BinaryLocation[],
+  sourceFileName: string
+): SourceMap {
+  const segments: string[] = [];
+  let offset = 0;
+  let line = 0;
+  let pos = 0;
+  let previous: TokenLocation | null = null;
+  for (const item of [...locations].sort((a, b) => a.offset - b.offset)) {
+    if (
+      previous &&
+      previous.line === item.location.line &&
+      previous.pos === item.location.pos
+    ) {
+      continue;
+    }
+    previous = item.location;
+    segments.push(
+      encodeVLQ(item.offset - offset) +
+        encodeVLQ(0) +
+        encodeVLQ(item.location.line - 1 - line) +
+        encodeVLQ(item.location.pos - 1 - pos)
+    );
+    offset = item.offset;
+    line = item.location.line - 1;
+    pos = item.location.pos - 1;
+  }
+  return {
+    version: 3,
+    sources: [sourceFileName],
+    names: [],
+    mappings: segments.join(","),
+  };
+}
+
+/** Returns absolute offsets with one-based lines and columns */
+export function decodeMappings(
+  mappings: string
+): { offset: number; line: number; pos: number }[] {
+  const result: { offset: number; line: number; pos: number }[] = [];
+  let offset = 0;
+  let line = 0;
+  let pos = 0;
+  for (const segment of mappings.split(",")) {
+    if (!segment) {
+      continue;
+    }
+    const [offsetDelta, , lineDelta, posDelta] = decodeVLQ(segment);
+    offset += offsetDelta;
+    line += lineDelta;
+    pos += posDelta;
+    result.push({ offset, line: line + 1, pos: pos + 1 });
+  }
+  return result;
+}
+
+/** Returns the source location of the instruction at binary offset */
+export function findSourceLocation(
+  mappings: string,
+  offset: number
+): { line: number; pos: number } | null {
+  let found: { line: number; pos: number } | null = null;
+  for (const item of decodeMappings(mappings)) {
+    if (item.offset > offset) {
+      break;
+    }
+    found = { line: item.line, pos: item.pos };
+  }
+  return found;
+}
@@ -0,0 +1,368 @@
+import {
+  Node,
+  Typename,
+  TypenameStruct,
+  StructDefinition,
+  DeclaratorNode,
+} from "./parser.definitions";
+import {
+  ExpressionInfo,
+  RegisterType,
+  WAInstuction,
+  WALocal,
+} from "./emitter.definitions";
+import { EmitterHelpers } from "./emitter.helpers";
+import {
+  getRegisterForTypename,
+  getRegistersForTypename,
+} from "./emitter.utils";
+import {
+  loadScalar,
+  storeScalar,
+  narrowScalarInRegister,
+} from "./emitter.scalar.storeload";
+import { TypeSize } from "./emitter.expressionsandtypes";
+
+/*
+
+Structs are always kept in memory, members are placed with natural alignment.
+
+Small structs (up to MAX_STRUCT_REGISTERS scalar members) also have a value:
+  every member is pushed on the stack, first member is the deepest.
+  Functions return such values as wasm multi-value, so there is no
+  memory round-trip between callee and caller.
+
+Store instruction needs address below the value, so values from the stack
+  are saved into scratch locals before they are written into memory.
+
+Small struct variable which address is not taken is not in memory at all,
+  every member is kept in its own WebAssembly local.
+
+ */
+
+export interface StructMember {
+  declaration: DeclaratorNode;
+  offset: number;
+}
+
+export interface StructLayout {
+  members: StructMember[];
+  size: number;
+  alignment: number;
+}
+
+export type Structs = ReturnType<typeof createStructs>;
+
+export function createStructs(
+  helpers: EmitterHelpers,
+  getTypeSize: (typename: Typename) => TypeSize
+) {
+  function error(node: Node, msg: string): never {
+    helpers.error(node, msg);
+  }
+
+  const layouts = new Map<StructDefinition, StructLayout>();
+  let copyId = 0;
+
+  function getStaticSize(typename: Typename) {
+    const size = getTypeSize(typename);
+    if (size.type !== "static") {
+      error(typename, "Struct member must have known size");
+    }
+    return size.value;
+  }
+
+  function getTypeAlignment(typename: Typename): number {
+    if (typename.type === "array") {
+      return getTypeAlignment(typename.elementsTypename);
+    } else if (typename.type === "struct") {
+      return getStructLayout(typename).alignment;
+    } else {
+      return getStaticSize(typename);
+    }
+  }
+
+  function getStructLayout(typename: TypenameStruct): StructLayout {
+    const cached = layouts.get(typename.definition);
+    if (cached) {
+      return cached;
+    }
+    const declarations = typename.definition.members;
+    if (!declarations) {
+      error(typename, "Struct is incomplete");
+    }
+    const members: StructMember[] = [];
+    let size = 0;
+    let alignment = 1;
+    for (const declaration of declarations) {
+      const memberAlignment = getTypeAlignment(declaration.typename);
+      const offset = Math.ceil(size / memberAlignment) * memberAlignment;
+      members.push({ declaration, offset });
+      size = offset + getStaticSize(declaration.typename);
+      alignment = Math.max(alignment, memberAlignment);
+    }
+    const layout: StructLayout = {
+      members,
+      size: Math.ceil(size / alignment) * alignment,
+      alignment,
+    };
+    layouts.set(typename.definition, layout);
+    return layout;
+  }
+
+  function getScalarMembers(typename: TypenameStruct) {
+    return getStructLayout(typename).members.map((member) => ({
+      ...member,
+      register: getRegisterForTypename(
+        member.declaration.typename
+      ) as RegisterType,
+    }));
+  }
+
+  /** Member type of const struct is const too */
+  function getMemberTypename(
+    structTypename: TypenameStruct,
+    member: StructMember
+  ) {
+    const typename = member.declaration.typename;
+    if (!structTypename.const || typename.const) {
+      return typename;
+    }
+    const constTypename = { ...typename, const: true } as Typename;
+    helpers.cloneLocation(typename, constTypename);
+    return constTypename;
+  }
+
+  function checkSameStruct(node: Node, to: Typename, from: Typename) {
+    if (
+      to.type !== "struct" ||
+      from.type !== "struct" ||
+      to.definition !== from.definition
+    ) {
+      error(node, "Incompatible struct types");
+    }
+  }
+
+  /** WebAssembly locals for members of struct variable, see wasmLocalName */
+  function getMemberLocals(declaration: DeclaratorNode): WALocal[] {
+    const localName = declaration.wasmLocalName;
+    if (!localName || declaration.typename.type !== "struct") {
+      throw new Error("Internal error: struct is not in locals");
+    }
+    return getScalarMembers(declaration.typename).map((member, index) => ({
+      name: `${localName}_${index}`,
+      type: member.register,
+      sourceName: `${declaration.identifier}.${member.declaration.identifier}`,
+    }));
+  }
+
+  /**
+   * Struct variable which is kept in WebAssembly locals.
+   *   Assigned value is the same struct, so it is already narrowed
+   */
+  function getLocalStructInfo(declaration: DeclaratorNode): ExpressionInfo {
+    const locals = getMemberLocals(declaration);
+    return {
+      type: declaration.typename,
+      staticValue: null,
+      address: null,
+      value: () => locals.map((local) => `local.get ${local.name}`),
+      assignValue: (value) => [
+        ...value,
+        ...locals.map((local) => `local.set ${local.name}`).reverse(),
+        ...locals.map((local) => `local.get ${local.name}`),
+      ],
+    };
+  }
+
+  function getLocalMemberInfo(
+    node: Node,
+    declaration: DeclaratorNode,
+    identifier: string
+  ): ExpressionInfo {
+    if (declaration.typename.type !== "struct") {
+      throw new Error("Internal error: expecting struct");
+    }
+    const member = getMember(node, declaration.typename, identifier);
+    const memberTypename = getMemberTypename(declaration.typename, member);
+    const index = getStructLayout(declaration.typename).members.indexOf(member);
+    const localName = getMemberLocals(declaration)[index].name;
+    return {
+      type: memberTypename,
+      staticValue: null,
+      address: null,
+      value: () => [`local.get ${localName} ;; Member ${identifier}`],
+      assignValue: (value) => [
+        ...value,
+        ...narrowScalarInRegister(memberTypename),
+        `local.tee ${localName}`,
+      ],
+    };
+  }
+
+  /** Members are loaded on the stack, null if struct is not small */
+  function getStructValueFromAddress(
+    typename: TypenameStruct,
+    getAddress: () => WAInstuction[]
+  ): null | (() => WAInstuction[]) {
+    if (!getRegistersForTypename(typename)) {
+      return null;
+    }
+    return () => {
+      const address = helpers.getScratchLocal("i32", "src");
+      const code: WAInstuction[] = [
+        ...getAddress(),
+        `local.set ${address} ;; Struct address`,
+      ];
+      for (const member of getScalarMembers(typename)) {
+        code.push(
+          `local.get ${address}`,
+          loadScalar(
+            member.declaration.typename,
+            member.register,
+            member.offset,
+            0
+          )
+        );
+      }
+      return code;
+    };
+  }
+
+  /** Moves struct value from the stack into scratch locals */
+  function saveStructValue(typename: TypenameStruct): WAInstuction[] {
+    return getScalarMembers(typename)
+      .map(
+        (member, index) =>
+          `local.set ${helpers.getScratchLocal(member.register, `${index}`)}`
+      )
+      .reverse();
+  }
+
+  /**
+   * Copies struct into memory from another struct in memory
+   *   or from struct value on the stack
+   */
+  function getStructCopyCode(
+    node: Node,
+    typename: TypenameStruct,
+    getTargetAddress: () => WAInstuction[],
+    source: ExpressionInfo
+  ): WAInstuction[] {
+    checkSameStruct(node, typename, source.type);
+    if (source.address) {
+      return [
+        ...getTargetAddress(),
+        ...source.address(),
+        `i32.const ${getStructLayout(typename).size}`,
+        `memory.copy ;; Copy struct`,
+      ];
+    }
+    if (!source.value) {
+      error(node, "Struct must have a value");
+    }
+    // Value can have another struct copy, so every copy have own address
+    const address = helpers.getScratchLocal("i32", `dst${copyId++}`);
+    const code: WAInstuction[] = [
+      ...getTargetAddress(),
+      `local.set ${address} ;; Struct address`,
+      ...source.value(),
+      ...saveStructValue(typename),
+    ];
+    getScalarMembers(typename).forEach((member, index) => {
+      code.push(
+        `local.get ${address}`,
+        `local.get ${helpers.getScratchLocal(member.register, `${index}`)}`,
+        storeScalar(
+          member.declaration.typename,
+          member.register,
+          member.offset,
+          0
+        )
+      );
+    });
+    return code;
+  }
+
+  function getMember(
+    node: Node,
+    typename: TypenameStruct,
+    identifier: string
+  ): StructMember {
+    const member = getStructLayout(typename).members.find(
+      (member) => member.declaration.identifier === identifier
+    );
+    if (!member) {
+      error(node, `Struct have no member ${identifier}`);
+    }
+    return member;
+  }
+
+  /**
+   * Member of struct, struct is given by address or by value.
+   *   Value is a result of function call, its members are taken
+   *   from scratch locals
+   */
+  function getMemberInfo(
+    node: Node,
+    typename: TypenameStruct,
+    identifier: string,
+    getStructAddress: null | (() => WAInstuction[]),
+    getStructValue: null | (() => WAInstuction[])
+  ): ExpressionInfo {
+    const member = getMember(node, typename, identifier);
+    const memberTypename = getMemberTypename(typename, member);
+    const register = getRegisterForTypename(memberTypename);
+
+    if (getStructAddress) {
+      const getAddress = () => [
+        ...getStructAddress(),
+        ...(member.offset > 0
+          ? [`i32.const ${member.offset}`, `i32.add ;; Member ${identifier}`]
+          : []),
+      ];
+      return {
+        type: memberTypename,
+        staticValue: null,
+        address: getAddress,
+        value: register
+          ? () => [
+              ...getStructAddress(),
+              loadScalar(memberTypename, register, member.offset, 0),
+            ]
+          : memberTypename.type === "struct"
+          ? getStructValueFromAddress(memberTypename, getAddress)
+          : null,
+      };
+    }
+
+    if (!getStructValue) {
+      error(node, "Struct must have a value or address");
+    }
+    if (!register) {
+      error(node, "Internal error: member of struct value must be scalar");
+    }
+    const index = getStructLayout(typename).members.indexOf(member);
+    return {
+      type: memberTypename,
+      staticValue: null,
+      address: null,
+      value: () => [
+        ...getStructValue(),
+        ...saveStructValue(typename),
+        `local.get ${helpers.getScratchLocal(register, `${index}`)}`,
+      ],
+    };
+  }
+
+  return {
+    getStructLayout,
+    getMemberLocals,
+    getLocalStructInfo,
+    getLocalMemberInfo,
+    getStructValueFromAddress,
+    getStructCopyCode,
+    getMemberInfo,
+    checkSameStruct,
+  };
+}
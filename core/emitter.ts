@@ -1,18 +1,51 @@
-import { TranslationUnit, Node } from "./parser.definitions";
+import {
+  TranslationUnit,
+  Node,
+  FunctionTypename,
+  FunctionDefinition,
+  DeclaratorNode,
+  DeclaratorId,
+  InitializerNode,
+} from "./parser.definitions";
 
-import { WAInstuction } from "./emitter.definitions";
-import { dataString, readEspCode } from "./emitter.utils";
 import {
-  ESP_ADDRESS,
-  GLOBALS_BEGIN_ADDRESS,
-  ESP_INITIAL_VALUE,
-  HEAP_BEGIN_ADDRESS,
+  WAFunction,
+  WAGlobal,
+  WADataSegment,
+  WAModule,
+} from "./emitter.definitions";
+import {
+  int4Bytes,
+  readEspCode,
+  getFunctionWaName,
+} from "./emitter.utils";
+import {
+  PAGE_SIZE,
+  getMemoryLayout,
+  STACK_POINTER_GLOBAL,
+  STACK_POINTER_EXTERNAL_NAME,
 } from "./emitter.memory";
 
 import { createHelpers } from "./emitter.helpers";
 import { createExpressionAndTypes } from "./emitter.expressionsandtypes";
 import { createFunctionCodeGenerator } from "./emitter.functionscode";
-import { getTrapFunctionCode } from "./emitter.helpers.trap";
+import { createInitializers } from "./emitter.initializers";
+import { getTrapFunction } from "./emitter.helpers.trap";
+import { parseInstructions } from "./emitter.instructions";
+import { findReachableFunctions } from "./emitter.reachability";
+import { findKnownFunctionPointers } from "./emitter.devirtualization";
+import {
+  Instrumentation,
+  PROFILE_HEADER_SIZE,
+  PROFILE_RECORD_SIZE,
+  getProfileSize,
+  getProfileFunctions,
+  getProfileTimerImport,
+} from "./emitter.instrumentation";
+import {
+  OptimizationLevel,
+  optimizeFunctions,
+} from "./emitter.ir.passmanager";
 
 function cacheFunc<T, U>(func: (param1: T) => U): (param1: T) => U {
   const cache = new Map<T, U>();
@@ -28,7 +61,67 @@ function cacheFunc<T, U>(func: (param1: T) => U): (param1: T) => U {
   };
 }
 
-export function emit(unit: TranslationUnit) {
+const debugHelperType: FunctionTypename = {
+  type: "function",
+  returnType: {
+    type: "arithmetic",
+    arithmeticType: "int",
+    signedUnsigned: null,
+    const: true,
+  },
+  const: true,
+  haveEndingEllipsis: false,
+  parameters: [],
+};
+
+export interface EmitterOptions {
+  /**
+   * Import stack pointer global from "js" instead of defining it in module.
+   * Host must initialize it with espInitialValue of memory layout
+   */
+  importStackPointer?: boolean;
+  /** Stack size in bytes, must be a multiple of 16. Default is 64KB */
+  stackSize?: number;
+  /** Bytes which are reserved for heap after globals in initial memory */
+  heapSize?: number;
+  /**
+   * Define memory in module and export it as "memory" instead of importing.
+   *   Its maximum is maxMemoryPages or, if it is not set, the minimum
+   */
+  exportMemory?: boolean;
+  /** Maximum memory size in pages, memory.grow fails above it */
+  maxMemoryPages?: number;
+  /** Default is 0, i.e. no optimization passes */
+  optimizationLevel?: OptimizationLevel;
+  /**
+   * Names of functions which are exported and used as entry points.
+   * By default all non-static functions are exported.
+   * Functions which are not reachable from entry points are dropped
+   */
+  exports?: string[];
+  /**
+   * Functions up to this size in instructions are inlined on level 2,
+   *   "inline" functions have bigger budget. Zero disables inlining
+   */
+  inlineBudget?: number;
+  /**
+   * Vectorize simple loops over arrays using WebAssembly SIMD,
+   *   works only with optimization level 2
+   */
+  simd?: boolean;
+  /**
+   * Use return_call for calls in return statements when function
+   *   have no stack frame, so such recursion runs in constant stack
+   */
+  tailCalls?: boolean;
+  /**
+   * Count calls of every function in profile memory region, "time" also
+   *   measures time with imported timer, see emitter.instrumentation
+   */
+  instrument?: "calls" | "time";
+}
+
+export function emit(unit: TranslationUnit, options: EmitterOptions = {}) {
   const locator = unit.locationMap();
   const declaratorMap = unit.declaratorMap();
 
@@ -41,28 +134,85 @@ export function emit(unit: TranslationUnit) {
     throw new Error("Typescript workaround");
   }
 
-  const { getTypeSize, getExpressionInfo } = createExpressionAndTypes(helpers);
+  const definitions: FunctionDefinition[] = [];
+  for (const statement of unit.body) {
+    if (statement.type === "function-declaration") {
+      definitions.push(statement);
+    }
+  }
 
-  const { createFunctionCode } = createFunctionCodeGenerator(
+  // Static variables of functions live in global memory too
+  const globalDeclarations = [
+    ...unit.declarations.map(getDeclaration),
+    ...definitions.reduce<DeclaratorNode[]>(
+      (staticDeclarations, definition) => [
+        ...staticDeclarations,
+        ...definition.declaredVariables
+          .map(getDeclaration)
+          .filter((declaration) => declaration.storageSpecifier === "static"),
+      ],
+      []
+    ),
+  ];
+
+  const {
+    getTypeSize,
+    getExpressionInfo,
+    structs,
+  } = createExpressionAndTypes(
+    helpers,
+    findKnownFunctionPointers(definitions, globalDeclarations, getDeclaration)
+  );
+
+  const { completeArraySize, getInitializerData } = createInitializers(
     helpers,
     getTypeSize,
-    getExpressionInfo
+    getExpressionInfo,
+    structs
   );
 
+  const layout = getMemoryLayout(options.stackSize);
+
   // Initial step: assign global memory
-  let memoryOffsetForGlobals = GLOBALS_BEGIN_ADDRESS;
+  let memoryOffsetForGlobals = layout.globalsBeginAddress;
 
-  let functionIdAddress = 1;
-  const globalDataInitializers: WAInstuction[] = [];
-  for (const declarationId of unit.declarations) {
-    const declaration = getDeclaration(declarationId);
+  function allocateGlobalMemory(size: number) {
+    if (memoryOffsetForGlobals % 4 !== 0) {
+      throw new Error("Self-check failed, wrong alignment");
+    }
+    const offset = memoryOffsetForGlobals;
+    memoryOffsetForGlobals += size;
+    const alignment = memoryOffsetForGlobals % 4;
+    if (alignment !== 0) {
+      memoryOffsetForGlobals += 4 - alignment;
+    }
+    return offset;
+  }
+
+  const globalData: WADataSegment[] = [];
+
+  /** Read-only copies of initializers for local arrays, same bytes are shared */
+  const templatesOffsets = new Map<string, number>();
+  function allocateTemplate(bytes: number[], comment: string) {
+    const key = bytes.join(",");
+    const existing = templatesOffsets.get(key);
+    if (existing !== undefined) {
+      return existing;
+    }
+    const offset = allocateGlobalMemory(bytes.length);
+    globalData.push({ offset, bytes, comment });
+    templatesOffsets.set(key, offset);
+    return offset;
+  }
+
+  const initializedGlobals: DeclaratorNode[] = [];
+  for (const declaration of globalDeclarations) {
     if (declaration.storageSpecifier === "typedef") {
       continue;
     }
 
     if (declaration.typename.type === "function") {
-      declaration.memoryOffset = functionIdAddress;
-      functionIdAddress++;
+      // Table index is assigned later, only if function address is taken
       continue;
     }
 
@@ -72,60 +222,68 @@ export function emit(unit: TranslationUnit) {
     if (declaration.typename.type === "void") {
       error(declaration, "Void for variable is not allowed");
     }
+    completeArraySize(declaration);
     const size = getTypeSize(declaration.typename);
     if (size.type !== "static") {
       error(declaration, `Globals must have known size`);
     }
-    if (memoryOffsetForGlobals % 4 !== 0) {
-      throw new Error("Self-check failed, wrong alignment");
-    }
-    declaration.memoryOffset = memoryOffsetForGlobals;
+    declaration.memoryOffset = allocateGlobalMemory(size.value);
     declaration.memoryIsGlobal = true;
-    memoryOffsetForGlobals += size.value;
-    const alignment = memoryOffsetForGlobals % 4;
-    if (alignment !== 0) {
-      memoryOffsetForGlobals += 4 - alignment;
-    }
 
     if (declaration.initializer) {
-      if (declaration.typename.type === "arithmetic") {
-        if (declaration.initializer.type !== "assigmnent-expression") {
-          error(
-            declaration.initializer,
-            "Wrong iniializer for arithmetic type"
-          );
-        }
-
-        const initializerExpressionInfo = getExpressionInfo(
-          declaration.initializer.expression
-        );
-        if (initializerExpressionInfo.type.type !== "arithmetic") {
-          error(declaration.initializer.expression, "Must be arithmetic");
-        }
-        if (initializerExpressionInfo.staticValue === null) {
-          error(
-            declaration.initializer.expression,
-            "Initializer value must be known on compilation time"
-          );
-        }
-        if (
-          initializerExpressionInfo.type.arithmeticType !== "int" &&
-          initializerExpressionInfo.type.arithmeticType !== "char"
-        ) {
-          error(
-            declaration.initializer.expression,
-            "TODO: Only int or char is supported for initializers"
-          );
-        }
+      initializedGlobals.push(declaration);
+    }
+  }
 
-        globalDataInitializers.push(
-          `;; Initializer for global ${declaration.identifier} id=${declaration.declaratorId}`,
-          `(data (i32.const ${declaration.memoryOffset}) "${dataString.int4(
-            initializerExpressionInfo.staticValue
-          )}")`
-        );
-      }
+  /** Reserves profile region and writes header and names of functions */
+  function allocateProfile(
+    instrumentedDefinitions: FunctionDefinition[]
+  ): Instrumentation {
+    if (memoryOffsetForGlobals % 8 !== 0) {
+      allocateGlobalMemory(4);
     }
+    const count = instrumentedDefinitions.length;
+    const profileAddress = allocateGlobalMemory(getProfileSize(count));
+    const namesAddress = allocateGlobalMemory(count * 4);
+    const names: number[] = [];
+    const records = new Map<DeclaratorId, number>();
+    instrumentedDefinitions.forEach((definition, index) => {
+      const name = definition.declaration.identifier;
+      const nameAddress = allocateGlobalMemory(name.length + 1);
+      globalData.push({
+        offset: nameAddress,
+        bytes: [...name.split("").map((c) => c.charCodeAt(0)), 0],
+        comment: `Profile name of ${name}`,
+      });
+      names.push(...int4Bytes(nameAddress));
+      records.set(
+        definition.declaration.declaratorId,
+        profileAddress + PROFILE_HEADER_SIZE + index * PROFILE_RECORD_SIZE
+      );
+    });
+    globalData.push(
+      {
+        offset: profileAddress,
+        bytes: [...int4Bytes(count), ...int4Bytes(namesAddress)],
+        comment: "Profile header",
+      },
+      {
+        offset: namesAddress,
+        bytes: names,
+        comment: "Profile names",
+      }
+    );
+    return {
+      getRecordAddress: (declaratorId) => {
+        const record = records.get(declaratorId);
+        if (record === undefined) {
+          throw new Error("Internal error: function have no profile record");
+        }
+        return record;
+      },
+      profileAddress,
+      timer: options.instrument === "time",
+    };
   }
 
   /*
@@ -136,81 +294,220 @@ export function emit(unit: TranslationUnit) {
   );
   */
 
-  // first function is trap function
+  const exportsList = options.exports;
+  if (exportsList) {
+    for (const name of exportsList) {
+      if (
+        !definitions.some(
+          (definition) => definition.declaration.identifier === name
+        )
+      ) {
+        throw new Error(`Exported function '${name}' is not defined`);
+      }
+    }
+  }
+  const entryPoints = definitions
+    .filter((definition) =>
+      exportsList
+        ? exportsList.indexOf(definition.declaration.identifier) !== -1
+        : definition.declaration.storageSpecifier !== "static"
+    )
+    .map((definition) => definition.declaration.declaratorId);
+
+  const { reachable, addressTaken } = findReachableFunctions(
+    definitions,
+    entryPoints,
+    initializedGlobals.map(
+      (declaration) => declaration.initializer as InitializerNode
+    )
+  );
 
-  const functionsCode: WAInstuction[] = [];
-  // Now create functions
-  for (const statement of unit.body) {
-    if (statement.type === "function-declaration") {
-      const lines = createFunctionCode(statement);
-      functionsCode.push(...lines);
+  // first function is trap function, it is also a first element in table
+  //  so call via null pointer traps
+  const trapFunction = getTrapFunction(helpers.functionSignatures);
+  const table = [trapFunction.name];
+  for (const definition of definitions) {
+    if (addressTaken.has(definition.declaration.declaratorId)) {
+      definition.declaration.memoryOffset = table.length;
+      table.push(getFunctionWaName(definition.declaration.declaratorId));
     }
   }
 
-  const setupEspData: WAInstuction[] = [
-    `;; Initializer for ESP`,
-    `(data (i32.const ${ESP_ADDRESS}) "${dataString.int4(ESP_INITIAL_VALUE)}")`,
-  ];
-  const setupHeapBeginAddress: WAInstuction[] = [
-    `;; Initializer for HEAP_BEGIN`,
-    `(data (i32.const ${HEAP_BEGIN_ADDRESS}) "${dataString.int4(
-      memoryOffsetForGlobals
-    )}")`,
-  ];
+  // Initializers can have functions, so they are evaluated after table is created
+  for (const declaration of initializedGlobals) {
+    if (!declaration.initializer || declaration.memoryOffset === undefined) {
+      throw new Error("Internal error: global must be initialized");
+    }
+    const data = getInitializerData(
+      declaration.typename,
+      declaration.initializer
+    );
+    if (data.dynamicValues.length > 0) {
+      error(
+        data.dynamicValues[0].expression,
+        "Initializer value must be known on compilation time"
+      );
+    }
+    globalData.push({
+      offset: declaration.memoryOffset,
+      bytes: data.bytes,
+      comment: `Initializer for global ${declaration.identifier} id=${declaration.declaratorId}`,
+    });
+  }
 
-  const debugHelpers: WAInstuction[] = [
-    `(func (export "_debug_get_esp") (result i32)`,
-    ...readEspCode,
-    ")",
-    `(func (export "_debug_get_heap_offset") (result i32)`,
-    `i32.const ${HEAP_BEGIN_ADDRESS} ;; Read heap begin address`,
-    "i32.load offset=0 align=2 ;; Read heap begin address",
-    ")",
-  ];
+  // Profile region is before templates, they are allocated with functions
+  const instrumentation = options.instrument
+    ? allocateProfile(
+        definitions.filter((definition) =>
+          reachable.has(definition.declaration.declaratorId)
+        )
+      )
+    : undefined;
 
-  const trapFunctionCode = getTrapFunctionCode(helpers.functionSignatures);
-
-  const functionTypes = helpers.functionSignatures.getTypesWAInstructions();
-
-  const functionTable: WAInstuction[] = [
-    `(table ${functionIdAddress} ${functionIdAddress} anyfunc) ;; min and max length`,
-    `(elem (i32.const 0) $null ` +
-      unit.body
-        .map((statement) => {
-          if (statement.type !== "function-declaration") {
-            return "";
-          }
-          return ` $F${statement.declaration.declaratorId}`;
-        })
-        .join("") +
-      ")",
-  ];
+  const { createFunctionCode } = createFunctionCodeGenerator(
+    helpers,
+    getTypeSize,
+    getExpressionInfo,
+    allocateTemplate,
+    structs,
+    { tailCalls: options.tailCalls, instrumentation }
+  );
+
+  const definedFunctions: WAFunction[] = [];
+  const inlineSpecified = new Set<string>();
+  // Now create functions
+  // Functions are in order of definition (not declaration?)
+  for (const definition of definitions) {
+    const declaratorId = definition.declaration.declaratorId;
+    if (!reachable.has(declaratorId)) {
+      continue;
+    }
+    const func = createFunctionCode(definition);
+    definedFunctions.push({
+      ...func,
+      exportName:
+        entryPoints.indexOf(declaratorId) !== -1
+          ? definition.declaration.identifier
+          : null,
+    });
+    if (definition.declaration.functionSpecifier === "inline") {
+      inlineSpecified.add(func.name);
+    }
+  }
 
-  const moduleCode: WAInstuction[] = [
-    "(module",
-    `(import "js" "memory" (memory 0))`,
+  const optimized = optimizeFunctions(definedFunctions, {
+    level: options.optimizationLevel || 0,
+    inlineBudget: options.inlineBudget,
+    simd: options.simd,
+    isInlineSpecified: (func) => inlineSpecified.has(func.name),
+    table,
+  });
 
-    ...functionTypes,
+  const functions: WAFunction[] = [trapFunction, ...optimized.functions];
 
-    ...functionTable,
+  const debugHelperTypeName = helpers.functionSignatures.getFunctionTypeName(
+    debugHelperType
+  );
+  functions.push(
+    {
+      name: "$_debug_get_esp",
+      typeName: debugHelperTypeName,
+      params: [],
+      results: ["i32"],
+      locals: [],
+      body: parseInstructions(readEspCode),
+      exportName: "_debug_get_esp",
+      sourceName: null,
+      comment: null,
+    },
+    {
+      name: "$_debug_get_heap_offset",
+      typeName: debugHelperTypeName,
+      params: [],
+      results: ["i32"],
+      locals: [],
+      body: parseInstructions([
+        `i32.const ${layout.heapBeginAddress} ;; Read heap begin address`,
+        "i32.load offset=0 align=2 ;; Read heap begin address",
+      ]),
+      exportName: "_debug_get_heap_offset",
+      sourceName: null,
+      comment: null,
+    }
+  );
 
-    //'(global $esp (import "js" "esp") (mut i32))',
-    //"(global $esp (mut i32))",
+  if (instrumentation) {
+    functions.push(
+      ...getProfileFunctions(
+        helpers.functionSignatures,
+        instrumentation.profileAddress,
+        definedFunctions.length
+      )
+    );
+  }
+  const importedFunctions =
+    instrumentation && instrumentation.timer
+      ? [getProfileTimerImport(helpers.functionSignatures)]
+      : [];
+
+  const stackPointerGlobal: WAGlobal = {
+    name: STACK_POINTER_GLOBAL,
+    type: "i32",
+    mutable: true,
+    importFrom: options.importStackPointer
+      ? { module: "js", name: STACK_POINTER_EXTERNAL_NAME }
+      : null,
+    initValue: layout.espInitialValue,
+    exportName: STACK_POINTER_EXTERNAL_NAME,
+  };
 
-    // Functions are in order of definition (not declaration?)
-    ...trapFunctionCode,
-    ...functionsCode,
+  const heapBeginData: WADataSegment = {
+    offset: layout.heapBeginAddress,
+    bytes: int4Bytes(memoryOffsetForGlobals),
+    comment: "Initializer for HEAP_BEGIN",
+  };
 
-    ...setupEspData,
-    ...setupHeapBeginAddress,
-    ...globalDataInitializers,
+  // Heap begins right after globals, reservation is counted from there
+  const heapSize = options.heapSize || 0;
+  const minPages = Math.ceil((memoryOffsetForGlobals + heapSize) / PAGE_SIZE);
+  const maxPages =
+    options.maxMemoryPages !== undefined
+      ? options.maxMemoryPages
+      : options.exportMemory
+      ? minPages
+      : null;
+  if (maxPages !== null && maxPages < minPages) {
+    throw new Error(
+      `Memory needs ${minPages} pages, maximum ${maxPages} is not enough`
+    );
+  }
 
-    ...debugHelpers,
-    ")",
-  ];
+  const module: WAModule = {
+    memory: {
+      importFrom: options.exportMemory
+        ? null
+        : { module: "js", name: "memory" },
+      minPages,
+      maxPages,
+      exportName: options.exportMemory ? "memory" : null,
+    },
+    types: helpers.functionSignatures.getTypes(),
+    table,
+    globals: [stackPointerGlobal],
+    importedFunctions,
+    functions,
+    data: [heapBeginData, ...globalData],
+  };
 
   return {
     warnings,
-    moduleCode,
+    module,
+    memoryUsage: {
+      stackSize: layout.stackSize,
+      globalsSize: memoryOffsetForGlobals - layout.globalsBeginAddress,
+      heapSize,
+      minPages,
+    },
+    optimizationStatistics: optimized.statistics,
   };
 }
@@ -1,7 +1,7 @@
-import { Typename } from "./parser.definitions";
+import { Typename, DeclaratorId } from "./parser.definitions";
 import { assertNever } from "./assertNever";
 import { RegisterType, WAInstuction } from "./emitter.definitions";
-import { ESP_ADDRESS } from "./emitter.memory";
+import { STACK_POINTER_GLOBAL } from "./emitter.memory";
 
 export function getRegisterForTypename(
   typename: Typename
@@ -24,20 +24,62 @@ export function getRegisterForTypename(
     }
   } else if (typename.type === "pointer") {
     return "i32" as const;
+  } else if (typename.type === "vector") {
+    return "v128" as const;
   } else {
     // TODO: enums are in registers too
     return null;
   }
 }
 
+/** Bigger structs are not passed by value */
+export const MAX_STRUCT_REGISTERS = 4;
+
+/**
+ * Registers which hold the value: none for void, one for scalars,
+ *   one per member for small structs of scalars (wasm multi-value).
+ *   Null if value does not fit into registers
+ */
+export function getRegistersForTypename(
+  typename: Typename
+): RegisterType[] | null {
+  if (typename.type === "void") {
+    return [];
+  }
+  if (typename.type === "struct") {
+    const members = typename.definition.members;
+    if (!members || members.length > MAX_STRUCT_REGISTERS) {
+      return null;
+    }
+    const registers: RegisterType[] = [];
+    for (const member of members) {
+      const register = getRegisterForTypename(member.typename);
+      if (!register) {
+        return null;
+      }
+      registers.push(register);
+    }
+    return registers;
+  }
+  const register = getRegisterForTypename(typename);
+  return register ? [register] : null;
+}
+
+export function isFloatingRegister(register: RegisterType | null) {
+  return register === "f32" || register === "f64";
+}
+
+/** Text format name of defined function, direct calls use it */
+export function getFunctionWaName(declaratorId: DeclaratorId) {
+  return `$F${declaratorId}`;
+}
+
 export const readEspCode: WAInstuction[] = [
-  `i32.const ${ESP_ADDRESS} ;; Read $esp`,
-  "i32.load offset=0 align=2 ;; Read $esp",
+  `global.get ${STACK_POINTER_GLOBAL} ;; Read $esp`,
 ];
 export const writeEspCode = (value: WAInstuction[]) => [
-  `i32.const ${ESP_ADDRESS} ;; Prepare $esp write - address`,
   ...value,
-  `i32.store offset=0 align=2 ;; Write $esp`,
+  `global.set ${STACK_POINTER_GLOBAL} ;; Write $esp`,
 ];
 
 /**
@@ -50,10 +92,27 @@ function paddedHex(i: number) {
 }
 export const dataString = {
   int4(i: number) {
-    const a = i & 0xff;
-    const b = (i >> 8) & 0xff;
-    const c = (i >> 16) & 0xff;
-    const d = (i >> 24) & 0xff;
-    return [a, b, c, d].map((i) => paddedHex(i)).join("");
+    return dataString.bytes(int4Bytes(i));
+  },
+  bytes(bytes: number[]) {
+    return bytes.map((i) => paddedHex(i)).join("");
   },
 };
+
+/**
+ * Little-endian bytes of 4-bytes number
+ */
+export function int4Bytes(i: number) {
+  const a = i & 0xff;
+  const b = (i >> 8) & 0xff;
+  const c = (i >> 16) & 0xff;
+  const d = (i >> 24) & 0xff;
+  return [a, b, c, d];
+}
+
+/**
+ * Little-endian bytes of 8-bytes number which is provided as two 32-bits parts
+ */
+export function int8Bytes(lo: number, hi: number) {
+  return [...int4Bytes(lo), ...int4Bytes(hi)];
+}
@@ -0,0 +1,174 @@
+import {
+  FunctionTypename,
+  Typename,
+  TypenameArithmetic,
+} from "./parser.definitions";
+
+/*
+
+Builtin functions are declared implicitly, they are known without any header.
+  Every builtin is lowered into one WebAssembly instruction,
+  so they can not be called by pointer.
+
+SIMD builtins have the same names as instructions:
+  "i32x4.extract_lane" is "__builtin_wasm_i32x4_extract_lane"
+
+Library functions memcpy, memmove and memset are bulk memory instructions.
+  Instructions leave nothing on the stack, so destination is saved before
+  the instruction and returned as in C library.
+  User function with the same name hides the builtin
+
+ */
+
+export const BUILTIN_PREFIX = "__builtin_wasm_";
+
+/**
+ * Stack operand of given type or
+ *  "lane" which is instruction immediate and must be a constant
+ */
+export type BuiltinArgument = Typename | "lane";
+
+export interface BuiltinFunction {
+  instruction: string;
+  args: BuiltinArgument[];
+  returnType: Typename;
+  /** Lane immediates must be less than this */
+  lanesCount: number;
+  /** Instruction have no result, value of the first argument is returned */
+  returnsFirstArgument?: boolean;
+}
+
+const vector: Typename = { type: "vector", const: false };
+const voidType: Typename = { type: "void", const: false };
+const arithmetic = (
+  arithmeticType: TypenameArithmetic["arithmeticType"],
+  signedUnsigned: TypenameArithmetic["signedUnsigned"] = null
+): Typename => ({
+  type: "arithmetic",
+  arithmeticType,
+  signedUnsigned,
+  const: false,
+});
+const int = arithmetic("int");
+const signedInt = arithmetic("int", "signed");
+const pointer = (isConst: boolean): Typename => ({
+  type: "pointer",
+  const: false,
+  pointsTo: { type: "void", const: isConst },
+});
+
+const SHAPES = [
+  { name: "i8x16", lanes: 16, scalar: int, mul: false },
+  { name: "i16x8", lanes: 8, scalar: int, mul: true },
+  { name: "i32x4", lanes: 4, scalar: int, mul: true },
+  { name: "i64x2", lanes: 2, scalar: arithmetic("long long"), mul: true },
+  { name: "f32x4", lanes: 4, scalar: arithmetic("float"), mul: true },
+  { name: "f64x2", lanes: 2, scalar: arithmetic("double"), mul: true },
+];
+
+function createBuiltins() {
+  const builtins = new Map<string, BuiltinFunction>();
+  const add = (
+    instruction: string,
+    args: BuiltinArgument[],
+    returnType: Typename,
+    lanesCount = 0
+  ) => {
+    builtins.set(BUILTIN_PREFIX + instruction.replace(".", "_"), {
+      instruction,
+      args,
+      returnType,
+      lanesCount,
+    });
+  };
+
+  for (const shape of SHAPES) {
+    add(`${shape.name}.splat`, [shape.scalar], vector);
+    if (shape.lanes > 4) {
+      // Narrow lanes are extended into i32
+      add(
+        `${shape.name}.extract_lane_s`,
+        [vector, "lane"],
+        signedInt,
+        shape.lanes
+      );
+      add(`${shape.name}.extract_lane_u`, [vector, "lane"], int, shape.lanes);
+    } else {
+      add(
+        `${shape.name}.extract_lane`,
+        [vector, "lane"],
+        shape.scalar,
+        shape.lanes
+      );
+    }
+    add(
+      `${shape.name}.replace_lane`,
+      [vector, "lane", shape.scalar],
+      vector,
+      shape.lanes
+    );
+    add(`${shape.name}.add`, [vector, vector], vector);
+    add(`${shape.name}.sub`, [vector, vector], vector);
+    if (shape.mul) {
+      add(`${shape.name}.mul`, [vector, vector], vector);
+    }
+  }
+
+  // Lanes of result are selected from 32 lanes of both operands
+  const shuffleLanes: BuiltinArgument[] = [];
+  for (let i = 0; i < 16; i++) {
+    shuffleLanes.push("lane");
+  }
+  add(`i8x16.shuffle`, [vector, vector, ...shuffleLanes], vector, 32);
+  add(`i8x16.swizzle`, [vector, vector], vector);
+
+  add(`v128.not`, [vector], vector);
+  for (const op of ["and", "andnot", "or", "xor"]) {
+    add(`v128.${op}`, [vector, vector], vector);
+  }
+  add(`v128.bitselect`, [vector, vector, vector], vector);
+
+  add(`v128.load`, [pointer(true)], vector);
+  add(`v128.store`, [pointer(false), vector], voidType);
+
+  add(`memory.size`, [], int);
+  // Returns previous size in pages or -1 if memory can not grow
+  add(`memory.grow`, [int], signedInt);
+
+  // memory.copy is fine with overlapping regions, so memcpy is memmove
+  const copy: BuiltinFunction = {
+    instruction: "memory.copy",
+    args: [pointer(false), pointer(true), int],
+    returnType: pointer(false),
+    lanesCount: 0,
+    returnsFirstArgument: true,
+  };
+  builtins.set("memcpy", copy);
+  builtins.set("memmove", copy);
+  builtins.set("memset", {
+    instruction: "memory.fill",
+    args: [pointer(false), int, int],
+    returnType: pointer(false),
+    lanesCount: 0,
+    returnsFirstArgument: true,
+  });
+
+  return builtins;
+}
+
+const BUILTINS = createBuiltins();
+
+export function getBuiltinFunction(name: string) {
+  return BUILTINS.get(name);
+}
+
+/** Type of builtin as it would be declared in header */
+export function getBuiltinTypename(builtin: BuiltinFunction): FunctionTypename {
+  return {
+    type: "function",
+    parameters: builtin.args.map((arg) => (arg === "lane" ? int : arg)),
+    haveEndingEllipsis: false,
+    returnType: builtin.returnType,
+    const: true,
+  };
+}
@@ -21,9 +21,16 @@ export type PrimaryExpressionNode =
   | IdentifierNode
   | {
       type: "const";
-      subtype: "int" | "float" | "char";
+      subtype: "int" | "float" | "double" | "char";
       value: number;
     }
+  | {
+      type: "const";
+      subtype: "long long";
+      /** Not exact for big values, use text to get all 64 bits */
+      value: number;
+      text: string;
+    }
   | {
       type: "string-literal";
       value: string;
@@ -171,14 +178,34 @@ export type TypenamePointer = {
 
 export type TypenameScalar = TypenameArithmetic | TypenamePointer;
 
+/** 128-bit SIMD value, "v128_t" */
+export type TypenameVector = {
+  type: "vector";
+  const: boolean;
+};
+
+/**
+ * Struct definition is shared between all typenames of the same tag,
+ *   so struct can point to itself and can be completed later
+ */
+export type StructDefinition = {
+  /** Null for anonymous struct */
+  identifier: string | null;
+  /** Null while struct is incomplete */
+  members: DeclaratorNode[] | null;
+};
+
+export type TypenameStruct = {
+  type: "struct";
+  const: boolean;
+  definition: StructDefinition;
+};
+
 export type Typename =
   | TypenameScalar
   | { type: "void"; const: boolean }
-  | {
-      type: "struct";
-      const: boolean;
-      // @TODO
-    }
+  | TypenameVector
+  | TypenameStruct
   | {
       type: "enum";
       const: boolean;
@@ -214,6 +241,15 @@ type DeclaratorNodeGeneric<T extends Typename> = {
    */
   memoryOffset?: number;
   memoryIsGlobal?: boolean;
+
+  /**
+   * Set by emitter if variable is kept in WebAssembly local instead of memory.
+   * Such variables have no address
+   */
+  wasmLocalName?: string;
+
+  /** Implicitly declared builtin function, see parser.builtins.ts */
+  isBuiltin?: boolean;
 };
 
 /**
@@ -251,6 +287,23 @@ export interface DoWhileStatement {
   condition: ExpressionNode;
   body: Statement;
 }
+export interface SwitchStatement {
+  type: "switch";
+  expression: ExpressionNode;
+  body: Statement;
+}
+
+/** Labels "case" and "default" are labeled statements, see 6.8.1 */
+export interface CaseStatement {
+  type: "case";
+  expression: ExpressionNode;
+  body: Statement;
+}
+export interface DefaultStatement {
+  type: "default";
+  body: Statement;
+}
+
 export interface ContinueStatement {
   type: "continue";
 }
@@ -275,6 +328,9 @@ export type Statement =
   | IfStatement
   | WhileStatement
   | DoWhileStatement
+  | SwitchStatement
+  | CaseStatement
+  | DefaultStatement
   | ContinueStatement
   | BreakStatement
   | ReturnStatement
@@ -289,7 +345,8 @@ export type InitializerNode =
     }
   | {
       type: "initializer-list";
-      // TODO
+      // Designators are not supported
+      items: InitializerNode[];
     };
 
 export type CompoundStatementBody = Statement | DeclaratorNode;
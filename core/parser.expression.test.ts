@@ -96,10 +96,22 @@ describe("Parser test", () => {
 
   checkExpression("123.5", {
     type: "const",
-    subtype: "float",
+    subtype: "double",
     value: 123.5,
   });
 
+  checkExpression("1.5f", {
+    type: "const",
+    subtype: "float",
+    value: 1.5,
+  });
+
+  checkExpression("2e-3", {
+    type: "const",
+    subtype: "double",
+    value: 0.002,
+  });
+
   checkExpression("'a'", {
     type: "const",
     subtype: "char",
@@ -14,9 +14,11 @@ import {
   Typename,
   NodeLocator,
   IdentifierNode,
+  DeclaratorNode,
 } from "./parser.definitions";
 import { ParserError } from "./error";
 import { SymbolTable } from "./parser.symboltable";
+import { getBuiltinFunction, getBuiltinTypename } from "./parser.builtins";
 
 const MAX_BINARY_OP_INDEX = 10;
 
@@ -69,12 +71,34 @@ export function createExpressionParser(
     throw new ParserError(`${info}`, scanner.current());
   }
 
+  /** Builtins are declared implicitly when they are used */
+  function declareBuiltin(name: string, token: Token) {
+    const builtin = getBuiltinFunction(name);
+    if (!builtin) {
+      return undefined;
+    }
+    const declaration: DeclaratorNode = {
+      type: "declarator",
+      functionSpecifier: null,
+      storageSpecifier: "extern",
+      identifier: name,
+      typename: getBuiltinTypename(builtin),
+      declaratorId: symbolTable.createDeclaratorId(),
+      isBuiltin: true,
+    };
+    locator.set(declaration, token);
+    symbolTable.addBuiltinEntry(declaration);
+    return declaration;
+  }
+
   function readPrimaryExpression(): ExpressionNode {
     const token = scanner.current();
     if (token.type === "identifier") {
       scanner.readNext();
 
-      const identifierDeclaration = symbolTable.lookupInScopes(token.text);
+      const identifierDeclaration =
+        symbolTable.lookupInScopes(token.text) ||
+        declareBuiltin(token.text, token);
       if (!identifierDeclaration) {
         throwError(`Unable to find declaration for '${token.text}'`);
       }
@@ -89,11 +113,19 @@ export function createExpressionParser(
       return node;
     } else if (token.type === "const-expression") {
       scanner.readNext();
-      const node: ExpressionNode = {
-        type: "const",
-        subtype: token.subtype,
-        value: token.value,
-      };
+      const node: ExpressionNode =
+        token.subtype === "long long"
+          ? {
+              type: "const",
+              subtype: token.subtype,
+              value: token.value,
+              text: token.text,
+            }
+          : {
+              type: "const",
+              subtype: token.subtype,
+              value: token.value,
+            };
       locator.set(node, token);
       return node;
     } else if (token.type === "string-literal") {
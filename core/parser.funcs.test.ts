@@ -52,6 +52,8 @@ describe("External declaration functions", () => {
 
   checkExternalDeclaration("int x, *p;");
 
+  checkExternalDeclaration("int x[2][2] = { {1, 2}, 3, };");
+
   checkExternalDeclaration(
     `
    void kek(int x) { 
@@ -77,6 +79,10 @@ describe("External declaration functions", () => {
 
   checkCompoundStatementBody("for (;;) { continue; break; return; return 2;}");
 
+  checkCompoundStatementBody(
+    "switch (2) { case 1: case 2: 3; break; default: 4; }"
+  );
+
   checkExternalDeclaration(`
   int add_eleven(int *p)
   {
@@ -25,11 +25,15 @@ import {
   ExpressionStatement,
   EmpryExpressionStatement,
   DoWhileStatement,
+  SwitchStatement,
+  CaseStatement,
+  DefaultStatement,
   ContinueStatement,
   BreakStatement,
   ReturnStatement,
   ExternalDeclarations,
   InitializerNode,
+  TypenameStruct,
 } from "./parser.definitions";
 import { ParserError } from "./error";
 import { SymbolTable } from "./parser.symboltable";
@@ -76,6 +80,10 @@ export function createParser(
     const token = scanner.current();
     return token.type === "void" ? token.type : undefined;
   }
+  function isCurrentTokenTypeVector() {
+    const token = scanner.current();
+    return token.type === "v128_t" ? token.type : undefined;
+  }
   function isCurrentTokenTypeArithmeticSpecifier() {
     const token = scanner.current();
     const arithmeticType = TYPE_SPECIFIERS_ARITHMETIC.find(
@@ -128,6 +136,7 @@ export function createParser(
 
     const isIt =
       isCurrentTokenTypeVoid() ||
+      isCurrentTokenTypeVector() ||
       isCurrentTokenTypeArithmeticSpecifier() ||
       isCurrentTokenTypeUnderscoreSpecifier() ||
       isCurrentTokenTypeQualifier() ||
@@ -170,6 +179,8 @@ export function createParser(
     let allowArithmeticTypeModification = true;
 
     let signedUnsigned: TypeSignedUnsigned | undefined;
+    let longsCount = 0;
+    let intsCount = 0;
 
     let storageClassSpecifier: StorageClass | null = null;
     let functionSpecifier: "inline" | null = null;
@@ -204,6 +215,16 @@ export function createParser(
           const: false,
         };
         allowArithmeticTypeModification = false;
+      } else if (isCurrentTokenTypeVector()) {
+        if (specifier) {
+          throwError("Already have type specifier");
+        }
+        scanner.readNext();
+        specifier = {
+          type: "vector",
+          const: false,
+        };
+        allowArithmeticTypeModification = false;
       } else if (maybeArithmeticSpecifier) {
         scanner.readNext();
 
@@ -215,12 +236,35 @@ export function createParser(
             throwError("Not allowed to add specifiers to this type");
           }
 
-          // Same as below, treating "long int" as "int"
+          // "long", "long int", "long long int" in any order
           if (
-            specifier.arithmeticType === "int" &&
-            maybeArithmeticSpecifier === "long"
+            (specifier.arithmeticType === "int" ||
+              specifier.arithmeticType === "long long") &&
+            (maybeArithmeticSpecifier === "long" ||
+              maybeArithmeticSpecifier === "int")
+          ) {
+            if (maybeArithmeticSpecifier === "long") {
+              longsCount++;
+            } else {
+              intsCount++;
+            }
+            if (longsCount > 2 || intsCount > 1) {
+              throwError("Too many type specifiers");
+            }
+            // Same as below, treating "long" as "int"
+            specifier.arithmeticType = longsCount === 2 ? "long long" : "int";
+          } else if (
+            // "long double" is treated as "double"
+            (specifier.arithmeticType === "double" &&
+              maybeArithmeticSpecifier === "long" &&
+              longsCount === 0) ||
+            (specifier.arithmeticType === "int" &&
+              maybeArithmeticSpecifier === "double" &&
+              longsCount === 1 &&
+              intsCount === 0)
           ) {
-            specifier.arithmeticType = "int";
+            longsCount = 1;
+            specifier.arithmeticType = "double";
           } else {
             throwError(
               `TODO: Add 'long long' and others, modify specifier ` +
@@ -228,6 +272,11 @@ export function createParser(
             );
           }
         } else {
+          if (maybeArithmeticSpecifier === "long") {
+            longsCount++;
+          } else if (maybeArithmeticSpecifier === "int") {
+            intsCount++;
+          }
           specifier = {
             type: "arithmetic",
             // Treating "long" as "int"
@@ -251,8 +300,11 @@ export function createParser(
         scanner.readNext();
         signedUnsigned = token.type;
       } else if (token.type === "struct") {
-        throwError("Not implemented yet");
-        // @TODO: Add into symbol table or lookup
+        if (specifier) {
+          throwError("Already have type specifier");
+        }
+        specifier = readStructSpecifier();
+        allowArithmeticTypeModification = false;
       } else if (token.type === "union") {
         throwError("Not implemented yet");
         // @TODO: Add into symbol table or lookup
@@ -325,6 +377,86 @@ export function createParser(
     return { specifier, storageClassSpecifier, functionSpecifier };
   }
 
+  /**
+   * Reads "struct tag", "struct tag { ... }" or "struct { ... }".
+   *   Unknown tag declares incomplete struct, it can be completed later
+   */
+  function readStructSpecifier(): TypenameStruct {
+    assertTokenAndReadNext("struct");
+
+    const identifierToken = scanner.current();
+    const identifier =
+      identifierToken.type === "identifier" ? identifierToken.text : null;
+    if (identifier) {
+      scanner.readNext();
+    }
+
+    if (scanner.current().type !== "{") {
+      if (!identifier) {
+        throwError("Expected struct tag or {");
+      }
+      let definition = symbolTable.lookupTagInScopes(identifier);
+      if (!definition) {
+        definition = { identifier, members: null };
+        symbolTable.addTag(definition);
+      }
+      return { type: "struct", const: false, definition };
+    }
+
+    let definition = identifier
+      ? symbolTable.lookupTagInCurrentScope(identifier)
+      : undefined;
+    if (definition && definition.members) {
+      throwError(`Struct ${identifier} is already defined`);
+    }
+    if (!definition) {
+      definition = { identifier, members: null };
+      if (identifier) {
+        // Added before members, so members can point to this struct
+        symbolTable.addTag(definition);
+      }
+    }
+    scanner.readNext();
+
+    const members: DeclaratorNode[] = [];
+    while (scanner.current().type !== "}") {
+      const {
+        specifier: baseSpecifier,
+        storageClassSpecifier,
+        functionSpecifier,
+      } = readDeclarationSpecifiers();
+      if (storageClassSpecifier || functionSpecifier) {
+        throwError("Only type is allowed in struct member declaration");
+      }
+      while (true) {
+        const declarator = readAbstractDeclaratorOrDeclaratorCoreless();
+        if (declarator.abstract) {
+          throwError("Expected struct member name");
+        }
+        const member = declarator.chain(baseSpecifier);
+        if (member.typename.type === "function") {
+          throwError("Struct member can not be a function");
+        }
+        if (members.some((other) => other.identifier === member.identifier)) {
+          throwError(`Duplicate struct member ${member.identifier}`);
+        }
+        members.push(member);
+        if (scanner.current().type !== ",") {
+          break;
+        }
+        scanner.readNext();
+      }
+      assertTokenAndReadNext(";");
+    }
+    if (members.length === 0) {
+      throwError("Struct must have members");
+    }
+    scanner.readNext();
+
+    definition.members = members;
+    return { type: "struct", const: false, definition };
+  }
+
   /**
    * Imagine this as nullable Typename, a chain of nested type where
    *   last part is null because it is unknown at this moment.
@@ -639,7 +771,10 @@ export function createParser(
   }
 
   function readParameterTypeList() {
-    if (scanner.current().type === "void") {
+    if (
+      scanner.current().type === "void" &&
+      scanner.nextToken().type === ")"
+    ) {
       scanner.readNext();
       return [[] as DeclaratorNode[], false] as const;
     }
@@ -697,6 +832,19 @@ export function createParser(
 
     const abstractDeclaratorOrDeclaratorCoreless = readAbstractDeclaratorOrDeclaratorCoreless();
 
+    if (
+      abstractDeclaratorOrDeclaratorCoreless.abstract &&
+      baseSpecifier.type === "struct" &&
+      abstractDeclaratorOrDeclaratorCoreless.chain(baseSpecifier) ===
+        baseSpecifier &&
+      !storageClassSpecifier &&
+      scanner.current().type === ";"
+    ) {
+      // Only struct declaration, like "struct point { int x, y; };"
+      scanner.readNext();
+      return [];
+    }
+
     if (abstractDeclaratorOrDeclaratorCoreless.abstract) {
       throwError("Abstract declarator is not expected here");
     }
@@ -729,8 +877,6 @@ export function createParser(
         if (scanner.current().type === "=") {
           scanner.readNext();
           // An initializer
-          const initializerTokenForLocation = scanner.current();
-
           if (!lastDeclaration) {
             throwError("Internal error: declaration list is empty");
           }
@@ -738,22 +884,7 @@ export function createParser(
             throwError("Internal error: already have initializer");
           }
 
-          if (scanner.current().type === "{") {
-            throwError("initializer-list is not supported yet");
-          }
-
-          const expression = expressionReader.readAssignmentExpression();
-
-          const initializer: InitializerNode = {
-            type: "assigmnent-expression",
-            expression: expression,
-          };
-          locator.set(initializer, {
-            ...initializerTokenForLocation,
-            length: scanner.current().pos - initializerTokenForLocation.pos,
-          });
-
-          lastDeclaration.initializer = initializer;
+          lastDeclaration.initializer = readInitializer();
         } else if ((scanner.current().type = ",")) {
           pushDeclaration();
 
@@ -869,11 +1000,83 @@ export function createParser(
     // Or even no need to do because it is in readStatemen
   }
 
+  function readInitializer(): InitializerNode {
+    const token = scanner.current();
+
+    if (token.type !== "{") {
+      const expression = expressionReader.readAssignmentExpression();
+
+      const initializer: InitializerNode = {
+        type: "assigmnent-expression",
+        expression: expression,
+      };
+      locator.set(initializer, {
+        ...token,
+        length: scanner.current().pos - token.pos,
+      });
+      return initializer;
+    }
+
+    scanner.readNext();
+    const items: InitializerNode[] = [];
+    while (scanner.current().type !== "}") {
+      if (scanner.current().type === "[" || scanner.current().type === ".") {
+        throwError("Designators are not supported yet");
+      }
+      items.push(readInitializer());
+      if (scanner.current().type === ",") {
+        // Trailing comma is allowed
+        scanner.readNext();
+      } else if (scanner.current().type !== "}") {
+        throwError("Expected , or }");
+      }
+    }
+    scanner.readNext();
+
+    const initializer: InitializerNode = {
+      type: "initializer-list",
+      items: items,
+    };
+    locator.set(initializer, {
+      ...token,
+      length: scanner.current().pos - token.pos,
+    });
+    return initializer;
+  }
+
   function readStatement(): Statement {
     const token = scanner.current();
 
-    if (token.type === "case" || token.type === "default") {
-      throwError("Case is not supported yet");
+    if (token.type === "case") {
+      scanner.readNext();
+      const expression = expressionReader.readConstantExpression();
+      assertTokenAndReadNext(":");
+      const body = readStatement();
+
+      const node: CaseStatement = {
+        type: "case",
+        expression: expression,
+        body: body,
+      };
+      locator.set(node, {
+        ...token,
+        length: scanner.current().pos - token.pos,
+      });
+      return node;
+    } else if (token.type === "default") {
+      scanner.readNext();
+      assertTokenAndReadNext(":");
+      const body = readStatement();
+
+      const node: DefaultStatement = {
+        type: "default",
+        body: body,
+      };
+      locator.set(node, {
+        ...token,
+        length: scanner.current().pos - token.pos,
+      });
+      return node;
     } else if (
       token.type === "identifier" &&
       scanner.nextToken().type === ":"
@@ -956,6 +1159,27 @@ export function createParser(
         length: scanner.current().pos - token.pos,
       });
       return node;
+    } else if (token.type === "switch") {
+      scanner.readNext();
+
+      assertTokenAndReadNext("(");
+
+      const expression = expressionReader.readExpression();
+
+      assertTokenAndReadNext(")");
+
+      const body = readStatement();
+
+      const node: SwitchStatement = {
+        type: "switch",
+        expression: expression,
+        body: body,
+      };
+      locator.set(node, {
+        ...token,
+        length: scanner.current().pos - token.pos,
+      });
+      return node;
     } else if (token.type === "do") {
       scanner.readNext();
 
@@ -5,6 +5,7 @@ import {
   NodeLocator,
   DeclaratorMap,
   DeclaratorId,
+  StructDefinition,
 } from "./parser.definitions";
 import pad from "pad";
 
@@ -24,8 +25,12 @@ export class SymbolTable {
 
   private readonly declarations: DeclaratorNode[][] = [];
 
+  /** Struct tags have their own name space (6.2.3) */
+  private readonly tags: Map<string, StructDefinition>[] = [];
+
   enterScope() {
     this.declarations.push([]);
+    this.tags.push(new Map());
   }
 
   enterFunctionScope() {
@@ -72,6 +77,16 @@ export class SymbolTable {
     this.declaratorIdToDeclaratorMap.set(declaration.declaratorId, declaration);
   }
 
+  /**
+   * Builtins are declared on first use in the outermost scope.
+   * They are not in the list of translation unit declarations because
+   *  emitter have nothing to allocate for them
+   */
+  addBuiltinEntry(declaration: DeclaratorNode) {
+    this.declarations[0].push(declaration);
+    this.declaratorIdToDeclaratorMap.set(declaration.declaratorId, declaration);
+  }
+
   /** Call me when parsing is complete */
   getTranslationUnittDeclarations() {
     return this.translationUnitDeclarations;
@@ -82,9 +97,11 @@ export class SymbolTable {
     if (!currentScope) {
       throw new Error("Unable to leave scope, no scope at all");
     }
+    this.tags.pop();
   }
 
   leaveFunctionScope() {
+    this.tags.pop();
     const currentScope = this.declarations.pop();
     if (!currentScope) {
       throw new Error("Unable to leave scope, no scope at all");
@@ -122,6 +139,27 @@ export class SymbolTable {
     return undefined;
   }
 
+  addTag(definition: StructDefinition) {
+    if (!definition.identifier) {
+      throw new Error("Internal error: anonymous struct have no tag");
+    }
+    this.tags[this.tags.length - 1].set(definition.identifier, definition);
+  }
+
+  lookupTagInScopes(identifier: string): StructDefinition | undefined {
+    for (const scope of this.tags.slice().reverse()) {
+      const definition = scope.get(identifier);
+      if (definition) {
+        return definition;
+      }
+    }
+    return undefined;
+  }
+
+  lookupTagInCurrentScope(identifier: string): StructDefinition | undefined {
+    return this.tags[this.tags.length - 1].get(identifier);
+  }
+
   isIdentifierAlreadyDefinedInCurrentScope(identifier: string) {
     const currentScope = this.declarations.slice().pop();
     if (!currentScope) {
@@ -101,6 +101,39 @@ describe("Parsing typename", () => {
   checkFailingType("void const");
   checkFailingType("void unsigned");
   checkFailingType("signed void");
+  checkFailingType("long long long");
+  checkFailingType("long int int");
+  checkFailingType("unsigned v128_t");
+  checkFailingType("v128_t int");
+
+  checkTypename("unsigned long long int", {
+    type: "arithmetic",
+    arithmeticType: "long long",
+    const: false,
+    signedUnsigned: "unsigned",
+  });
+  checkTypename("long int long", {
+    type: "arithmetic",
+    arithmeticType: "long long",
+    const: false,
+    signedUnsigned: null,
+  });
+  checkTypename("long double", {
+    type: "arithmetic",
+    arithmeticType: "double",
+    const: false,
+    signedUnsigned: null,
+  });
+  checkTypename("const v128_t", {
+    type: "vector",
+    const: true,
+  });
+  checkTypename("long int", {
+    type: "arithmetic",
+    arithmeticType: "int",
+    const: false,
+    signedUnsigned: null,
+  });
 
   checkTypename("const int", {
     type: "arithmetic",
@@ -239,6 +272,44 @@ describe("Parsing typename", () => {
     },
   });
 
+  checkTypename("void (void)", {
+    type: "function",
+    const: true,
+    haveEndingEllipsis: false,
+    parameters: [],
+    returnType: {
+      type: "void",
+      const: false,
+    },
+  });
+
+  checkTypename("void (void *p)", {
+    type: "function",
+    const: true,
+    haveEndingEllipsis: false,
+    parameters: [
+      {
+        type: "declarator",
+        functionSpecifier: null,
+        storageSpecifier: null,
+        identifier: "p",
+        typename: {
+          type: "pointer",
+          const: false,
+          pointsTo: {
+            type: "void",
+            const: false,
+          },
+        },
+        declaratorId: "0001" as DeclaratorId,
+      },
+    ],
+    returnType: {
+      type: "void",
+      const: false,
+    },
+  });
+
   checkTypename("char (int x)", {
     type: "function",
     const: true,
@@ -355,6 +426,37 @@ describe("Parsing typename", () => {
     },
   });
 
-  // TODO
-  describe.skip("Skipped", () => checkTypename("struct tag (*[5])(float)"));
+  checkTypename("struct tag (*[5])(float)", {
+    type: "array",
+    elementsTypename: {
+      type: "pointer",
+      pointsTo: {
+        type: "function",
+        returnType: {
+          type: "struct",
+          const: false,
+          definition: { identifier: "tag", members: null },
+        },
+      },
+    },
+  });
+
+  checkTypename("const struct { int x, *p; }", {
+    type: "struct",
+    const: true,
+    definition: {
+      identifier: null,
+      members: [
+        { identifier: "x", typename: { type: "arithmetic" } },
+        { identifier: "p", typename: { type: "pointer" } },
+      ],
+    },
+  });
+
+  checkFailingType("struct");
+  checkFailingType("struct { }");
+  checkFailingType("struct { int; }");
+  checkFailingType("struct { int x; char x; }");
+  checkFailingType("struct { static int x; }");
+  checkFailingType("unsigned struct tag");
 });
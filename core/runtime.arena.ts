@@ -0,0 +1,165 @@
+/*
+
+Arena allocator for request-scoped memory, chunks are taken from malloc.
+
+Arena is a handle to 6 words:
+  [0] first chunk
+  [1] current chunk
+  [2] address of next allocation in the current chunk
+  [3] end of the current chunk
+  [4] default chunk size
+  [5] bytes allocated since reset
+
+Chunk have 8-bytes header: next chunk and size of data after header.
+  Allocation bumps the pointer, when chunk is full the next one is used.
+  Reset only goes back to the first chunk, so chunks are kept for reuse
+  and objects are never freed one by one.
+
+ */
+
+export function getArenaSource() {
+  return `
+static unsigned int *__arena_chunk_create(unsigned int size)
+{
+  unsigned int *chunk = malloc(size + 8);
+  if (!chunk)
+  {
+    return 0;
+  }
+  chunk[0] = 0;
+  chunk[1] = size;
+  return chunk;
+}
+
+static void __arena_use_chunk(unsigned int *arena, unsigned int *chunk)
+{
+  arena[1] = (unsigned int)chunk;
+  arena[2] = (unsigned int)chunk + 8;
+  arena[3] = (unsigned int)chunk + 8 + chunk[1];
+}
+
+void arena_reset(void *handle)
+{
+  unsigned int *arena = handle;
+  __arena_use_chunk(arena, (unsigned int *)arena[0]);
+  arena[5] = 0;
+}
+
+void *arena_create(unsigned int chunk_size)
+{
+  if (!chunk_size)
+  {
+    chunk_size = 65536;
+  }
+  if (chunk_size > 2146435072)
+  {
+    return 0;
+  }
+  chunk_size = (chunk_size + 7) & ~7;
+  unsigned int *arena = malloc(24);
+  if (!arena)
+  {
+    return 0;
+  }
+  unsigned int *chunk = __arena_chunk_create(chunk_size);
+  if (!chunk)
+  {
+    free(arena);
+    return 0;
+  }
+  arena[0] = (unsigned int)chunk;
+  arena[4] = chunk_size;
+  arena_reset(arena);
+  return arena;
+}
+
+void *arena_alloc(void *handle, unsigned int n)
+{
+  unsigned int *arena = handle;
+  if (n > 2146435072)
+  {
+    return 0;
+  }
+  n = (n + 7) & ~7;
+  if (arena[3] - arena[2] < n)
+  {
+    unsigned int *current = (unsigned int *)arena[1];
+    unsigned int *next = (unsigned int *)current[0];
+    if (!next || next[1] < n)
+    {
+      unsigned int size = arena[4];
+      if (size < n)
+      {
+        size = n;
+      }
+      unsigned int *chunk = __arena_chunk_create(size);
+      if (!chunk)
+      {
+        return 0;
+      }
+      chunk[0] = (unsigned int)next;
+      current[0] = (unsigned int)chunk;
+      next = chunk;
+    }
+    __arena_use_chunk(arena, next);
+  }
+  unsigned int p = arena[2];
+  arena[2] = p + n;
+  arena[5] = arena[5] + n;
+  return (void *)p;
+}
+
+unsigned int arena_used(void *handle)
+{
+  unsigned int *arena = handle;
+  return arena[5];
+}
+
+void arena_destroy(void *handle)
+{
+  unsigned int *arena = handle;
+  unsigned int *chunk = (unsigned int *)arena[0];
+  while (chunk)
+  {
+    unsigned int *next = (unsigned int *)chunk[0];
+    free(chunk);
+    chunk = next;
+  }
+  free(arena);
+}
+`;
+}
+
+/** Exports of module which is compiled with arena runtime */
+export interface ArenaExports {
+  arena_create(chunkSize: number): number;
+  arena_alloc(arena: number, n: number): number;
+  arena_reset(arena: number): void;
+  arena_used(arena: number): number;
+  arena_destroy(arena: number): void;
+}
+
+/**
+ * Host helper for "instantiate once, handle many requests" pattern.
+ *   Arena is created once and reset after every request
+ */
+export function createRequestArena(exports: ArenaExports, chunkSize = 0) {
+  const arena = exports.arena_create(chunkSize);
+  if (!arena) {
+    throw new Error("Unable to create arena");
+  }
+  return {
+    arena,
+    /** Calls handler with the arena, it is reset even if handler throws */
+    handle<T>(handler: (arena: number) => T): T {
+      try {
+        return handler(arena);
+      } finally {
+        exports.arena_reset(arena);
+      }
+    },
+    destroy() {
+      exports.arena_destroy(arena);
+    },
+  };
+}
@@ -0,0 +1,313 @@
+import { HEAP_BEGIN_ADDRESS } from "./emitter.memory";
+
+/*
+
+Heap allocator, heap starts at the address which is saved in HEAP_BEGIN_ADDRESS
+  and grows using memory.grow
+
+Every block have 4-bytes header with block size and flags in lower bits:
+  bit 0 - block is used
+  bit 1 - block is small
+Headers are at 4 mod 8, so payloads are aligned to 8 bytes.
+
+Small blocks (up to 256 bytes with header) are segregated by size classes
+  of 8 bytes. Free blocks of every class are in singly-linked list,
+  new blocks are carved from 1KB slabs. Allocation and free are O(1),
+  slabs are never returned back.
+
+Large blocks (and slabs) also have footer with a copy of the header,
+  so neighbours can be found in both directions and coalesced on free.
+  Free large blocks are in doubly-linked list: next at +4, prev at +8.
+  Allocation is first-fit with split. Free block at the end of the heap
+  is not kept in the list, heap top is moved down instead.
+  The last block is resized in place by realloc.
+
+ */
+
+export function getMallocSource(heapBeginAddress = HEAP_BEGIN_ADDRESS) {
+  return `
+static unsigned int __malloc_heap_start;
+static unsigned int __malloc_heap_top;
+static unsigned int __malloc_large_free_list;
+static unsigned int __malloc_small_free_list[33];
+static unsigned int __malloc_slab_next[33];
+static unsigned int __malloc_slab_end[33];
+
+static unsigned int __malloc_stats_in_use;
+static unsigned int __malloc_stats_peak;
+static unsigned int __malloc_stats_allocations;
+
+static unsigned int *__malloc_heap_word(unsigned int address)
+{
+  return (unsigned int *)address;
+}
+
+static void __malloc_heap_init()
+{
+  if (__malloc_heap_start)
+  {
+    return;
+  }
+  __malloc_heap_start =
+      ((*__malloc_heap_word(${heapBeginAddress}) + 11) & ~7) - 4;
+  __malloc_heap_top = __malloc_heap_start;
+}
+
+static int __malloc_heap_reserve(unsigned int end)
+{
+  unsigned int available = __builtin_wasm_memory_size() * 65536;
+  if (end <= available)
+  {
+    return 1;
+  }
+  signed int grown =
+      __builtin_wasm_memory_grow((end - available + 65535) / 65536);
+  return grown >= 0;
+}
+
+static void __malloc_large_set(unsigned int h, unsigned int size,
+                               unsigned int flags)
+{
+  *__malloc_heap_word(h) = size | flags;
+  *__malloc_heap_word(h + size - 4) = size | flags;
+}
+
+static void __malloc_large_unlink(unsigned int h)
+{
+  unsigned int next = *__malloc_heap_word(h + 4);
+  unsigned int prev = *__malloc_heap_word(h + 8);
+  if (prev)
+  {
+    *__malloc_heap_word(prev + 4) = next;
+  }
+  else
+  {
+    __malloc_large_free_list = next;
+  }
+  if (next)
+  {
+    *__malloc_heap_word(next + 8) = prev;
+  }
+}
+
+static void __malloc_large_push(unsigned int h, unsigned int size)
+{
+  __malloc_large_set(h, size, 0);
+  *__malloc_heap_word(h + 4) = __malloc_large_free_list;
+  *__malloc_heap_word(h + 8) = 0;
+  if (__malloc_large_free_list)
+  {
+    *__malloc_heap_word(__malloc_large_free_list + 8) = h;
+  }
+  __malloc_large_free_list = h;
+}
+
+static unsigned int __malloc_large_alloc(unsigned int size)
+{
+  unsigned int h = __malloc_large_free_list;
+  while (h)
+  {
+    unsigned int available = *__malloc_heap_word(h) & ~7;
+    if (available >= size)
+    {
+      __malloc_large_unlink(h);
+      if (available - size >= 32)
+      {
+        __malloc_large_push(h + size, available - size);
+        available = size;
+      }
+      __malloc_large_set(h, available, 1);
+      return h;
+    }
+    h = *__malloc_heap_word(h + 4);
+  }
+  if (!__malloc_heap_reserve(__malloc_heap_top + size))
+  {
+    return 0;
+  }
+  h = __malloc_heap_top;
+  __malloc_heap_top = __malloc_heap_top + size;
+  __malloc_large_set(h, size, 1);
+  return h;
+}
+
+static void __malloc_large_release(unsigned int h)
+{
+  unsigned int size = *__malloc_heap_word(h) & ~7;
+  unsigned int next = h + size;
+  if (next < __malloc_heap_top && !(*__malloc_heap_word(next) & 1))
+  {
+    __malloc_large_unlink(next);
+    size = size + (*__malloc_heap_word(next) & ~7);
+  }
+  if (h > __malloc_heap_start && !(*__malloc_heap_word(h - 4) & 1))
+  {
+    unsigned int prev = h - (*__malloc_heap_word(h - 4) & ~7);
+    __malloc_large_unlink(prev);
+    size = size + (h - prev);
+    h = prev;
+  }
+  if (h + size == __malloc_heap_top)
+  {
+    __malloc_heap_top = h;
+  }
+  else
+  {
+    __malloc_large_push(h, size);
+  }
+}
+
+static unsigned int __malloc_small_alloc(unsigned int size)
+{
+  unsigned int index = size / 8;
+  unsigned int h = __malloc_small_free_list[index];
+  if (h)
+  {
+    __malloc_small_free_list[index] = *__malloc_heap_word(h + 4);
+  }
+  else
+  {
+    if (__malloc_slab_next[index] + size > __malloc_slab_end[index])
+    {
+      unsigned int slab_size = (1024 / size) * size;
+      unsigned int slab = __malloc_large_alloc(slab_size + 16);
+      if (!slab)
+      {
+        return 0;
+      }
+      __malloc_slab_next[index] = slab + 8;
+      __malloc_slab_end[index] = slab + 8 + slab_size;
+    }
+    h = __malloc_slab_next[index];
+    __malloc_slab_next[index] = h + size;
+  }
+  *__malloc_heap_word(h) = size | 3;
+  return h;
+}
+
+void *malloc(unsigned int n)
+{
+  __malloc_heap_init();
+  if (n > 2146435072)
+  {
+    return 0;
+  }
+  unsigned int size = (n + 11) & ~7;
+  unsigned int h = 0;
+  if (size <= 256)
+  {
+    h = __malloc_small_alloc(size);
+  }
+  else
+  {
+    h = __malloc_large_alloc((n + 15) & ~7);
+  }
+  if (!h)
+  {
+    return 0;
+  }
+  __malloc_stats_in_use = __malloc_stats_in_use + (*__malloc_heap_word(h) & ~7);
+  __malloc_stats_allocations = __malloc_stats_allocations + 1;
+  if (__malloc_stats_in_use > __malloc_stats_peak)
+  {
+    __malloc_stats_peak = __malloc_stats_in_use;
+  }
+  return (void *)(h + 4);
+}
+
+void free(void *p)
+{
+  if (!p)
+  {
+    return;
+  }
+  unsigned int h = (unsigned int)p - 4;
+  unsigned int header = *__malloc_heap_word(h);
+  unsigned int size = header & ~7;
+  __malloc_stats_in_use = __malloc_stats_in_use - size;
+  __malloc_stats_allocations = __malloc_stats_allocations - 1;
+  if (header & 2)
+  {
+    *__malloc_heap_word(h) = size | 2;
+    *__malloc_heap_word(h + 4) = __malloc_small_free_list[size / 8];
+    __malloc_small_free_list[size / 8] = h;
+  }
+  else
+  {
+    __malloc_large_release(h);
+  }
+}
+
+void *calloc(unsigned int count, unsigned int size)
+{
+  unsigned int n = count * size;
+  if (size && n / size != count)
+  {
+    return 0;
+  }
+  void *p = malloc(n);
+  if (p)
+  {
+    memset(p, 0, n);
+  }
+  return p;
+}
+
+void *realloc(void *p, unsigned int n)
+{
+  if (!p)
+  {
+    return malloc(n);
+  }
+  unsigned int h = (unsigned int)p - 4;
+  unsigned int header = *__malloc_heap_word(h);
+  unsigned int capacity = (header & ~7) - (header & 2 ? 4 : 8);
+  if (n <= capacity)
+  {
+    return p;
+  }
+  unsigned int size = (n + 15) & ~7;
+  if (!(header & 2) && h + (header & ~7) == __malloc_heap_top &&
+      n <= 2146435072 && __malloc_heap_reserve(h + size))
+  {
+    __malloc_stats_in_use = __malloc_stats_in_use + size - (header & ~7);
+    if (__malloc_stats_in_use > __malloc_stats_peak)
+    {
+      __malloc_stats_peak = __malloc_stats_in_use;
+    }
+    __malloc_heap_top = h + size;
+    __malloc_large_set(h, size, 1);
+    return p;
+  }
+  void *moved = malloc(n);
+  if (!moved)
+  {
+    return 0;
+  }
+  memcpy(moved, p, capacity);
+  free(p);
+  return moved;
+}
+
+unsigned int malloc_stats_in_use()
+{
+  return __malloc_stats_in_use;
+}
+
+unsigned int malloc_stats_peak()
+{
+  return __malloc_stats_peak;
+}
+
+unsigned int malloc_stats_allocations()
+{
+  return __malloc_stats_allocations;
+}
+
+unsigned int malloc_stats_heap_size()
+{
+  __malloc_heap_init();
+  return __malloc_heap_top - __malloc_heap_start;
+}
+`;
+}
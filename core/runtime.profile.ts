@@ -0,0 +1,100 @@
+import {
+  PROFILE_HEADER_SIZE,
+  PROFILE_RECORD_SIZE,
+  PROFILE_TIMER_IMPORT_NAME,
+} from "./emitter.instrumentation";
+
+/*
+
+Host side of instrumentation build mode: timer import and reporter
+  which reads profile from module memory, see emitter.instrumentation
+
+ */
+
+export interface ProfileExports {
+  _prof_dump(): number;
+  _prof_reset(): void;
+}
+
+export interface ProfileEntry {
+  name: string;
+  calls: number;
+  inclusiveTime: number;
+  exclusiveTime: number;
+}
+
+/** Imports for "js" module when module measures time */
+export function createProfileImports(now = () => performance.now()) {
+  return { [PROFILE_TIMER_IMPORT_NAME]: now };
+}
+
+function readString(mem8: Uint8Array, address: number) {
+  let str = "";
+  while (mem8[address] !== 0) {
+    str += String.fromCharCode(mem8[address]);
+    address++;
+  }
+  return str;
+}
+
+/**
+ * Functions which were called, sorted by exclusive time and then by calls
+ */
+export function readProfile(
+  memory: WebAssembly.Memory,
+  exports: ProfileExports
+): ProfileEntry[] {
+  const view = new DataView(memory.buffer);
+  const mem8 = new Uint8Array(memory.buffer);
+  const profile = exports._prof_dump();
+  const count = view.getUint32(profile, true);
+  const namesAddress = view.getUint32(profile + 4, true);
+
+  const entries: ProfileEntry[] = [];
+  for (let i = 0; i < count; i++) {
+    const record = profile + PROFILE_HEADER_SIZE + i * PROFILE_RECORD_SIZE;
+    const calls =
+      view.getUint32(record, true) +
+      view.getUint32(record + 4, true) * 0x100000000;
+    if (calls === 0) {
+      continue;
+    }
+    entries.push({
+      name: readString(mem8, view.getUint32(namesAddress + i * 4, true)),
+      calls,
+      inclusiveTime: view.getFloat64(record + 8, true),
+      exclusiveTime: view.getFloat64(record + 16, true),
+    });
+  }
+  return entries.sort(
+    (a, b) => b.exclusiveTime - a.exclusiveTime || b.calls - a.calls
+  );
+}
+
+function pad(str: string, width: number) {
+  while (str.length < width) {
+    str = " " + str;
+  }
+  return str;
+}
+
+/** Table with one line per function, hottest functions are first */
+export function formatProfile(entries: ProfileEntry[]): string[] {
+  const rows = [
+    ["calls", "exclusive ms", "inclusive ms", "function"],
+    ...entries.map((entry) => [
+      `${entry.calls}`,
+      entry.exclusiveTime.toFixed(3),
+      entry.inclusiveTime.toFixed(3),
+      entry.name,
+    ]),
+  ];
+  const widths = [0, 1, 2].map((column) =>
+    Math.max(...rows.map((row) => row[column].length))
+  );
+  return rows.map(
+    (row) =>
+      widths.map((width, column) => pad(row[column], width)).join("  ") +
+      `  ${row[3]}`
+  );
+}
@@ -0,0 +1,82 @@
+import { Token, createScannerFunc } from "./scanner.func";
+import { getMallocSource } from "./runtime.malloc";
+import { getArenaSource } from "./runtime.arena";
+import { MemoryLayout, getMemoryLayout } from "./emitter.memory";
+
+/*
+
+Runtime libraries are written in C and compiled together with the user code.
+  Their sources go before the user source, so user code can call them
+  (functions can not be declared and defined later).
+
+Library functions are regular functions: they are exported by default
+  and dropped if they are not reachable.
+
+Libraries which are required by other libraries are added automatically.
+
+ */
+
+export type RuntimeLibrary = "malloc" | "arena";
+
+export const RUNTIME_LIBRARIES: RuntimeLibrary[] = ["malloc", "arena"];
+
+function getLibrarySource(library: RuntimeLibrary, layout: MemoryLayout) {
+  if (library === "malloc") {
+    return getMallocSource(layout.heapBeginAddress);
+  } else if (library === "arena") {
+    return getArenaSource();
+  }
+  throw new Error(`Unknown runtime library ${library}`);
+}
+
+function getLibraryDependencies(library: RuntimeLibrary): RuntimeLibrary[] {
+  return library === "arena" ? ["malloc"] : [];
+}
+
+/** Returns libraries with dependencies, every one is after its dependencies */
+export function resolveRuntimeLibraries(
+  libraries: RuntimeLibrary[]
+): RuntimeLibrary[] {
+  const resolved: RuntimeLibrary[] = [];
+  const add = (library: RuntimeLibrary) => {
+    if (resolved.indexOf(library) !== -1) {
+      return;
+    }
+    getLibraryDependencies(library).forEach(add);
+    resolved.push(library);
+  };
+  libraries.forEach(add);
+  return resolved;
+}
+
+/**
+ * Returns scanner func which reads libraries and then the source.
+ *   Tokens of the source keep their locations, so errors have right lines.
+ *   Library tokens have line 0, so their code is not mapped to the source.
+ *   Layout must be the same as in emitter, libraries use heap address
+ */
+export function createScannerFuncWithRuntime(
+  source: string,
+  libraries: RuntimeLibrary[],
+  layout = getMemoryLayout()
+): () => Token {
+  const scanners = [
+    ...resolveRuntimeLibraries(libraries).map((library) =>
+      createScannerFunc(getLibrarySource(library, layout))
+    ),
+    createScannerFunc(source),
+  ];
+  let current = 0;
+  return () => {
+    while (true) {
+      const token = scanners[current]();
+      if (current === scanners.length - 1) {
+        return token;
+      }
+      if (token.type !== "end") {
+        return { ...token, line: 0 };
+      }
+      current++;
+    }
+  };
+}
@@ -79,6 +79,41 @@ describe("Scanner", () => {
     });
   });
 
+  it(`Scans integer suffixes`, () => {
+    const scanner = createScannerFunc("10u 0xcbf29ce484222325ULL 5LL 4294967296");
+    expect(scanner()).toMatchObject({
+      type: "const-expression",
+      subtype: "int",
+      value: 10,
+    });
+    expect(scanner()).toMatchObject({
+      type: "const-expression",
+      subtype: "long long",
+      text: "0xcbf29ce484222325",
+    });
+    expect(scanner()).toMatchObject({
+      type: "const-expression",
+      subtype: "long long",
+      value: 5,
+    });
+    expect(scanner()).toMatchObject({
+      type: "const-expression",
+      subtype: "long long",
+      value: 4294967296,
+    });
+  });
+
+  it(`Keeps all bits of binary constants`, () => {
+    const scanner = createScannerFunc(
+      "0b1000000000000000000000000000000000000000000000000000000000000001ULL"
+    );
+    expect(scanner()).toMatchObject({
+      type: "const-expression",
+      subtype: "long long",
+      text: "0x8000000000000001",
+    });
+  });
+
   it(`Scans with ellipsis`, () => {
     const scanner = createScannerFunc("int printf( const char* format, ... );");
     while (true) {
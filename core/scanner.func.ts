@@ -140,6 +140,8 @@ export const KEYWORDS = [
   "void",
   "while",
 
+  "v128_t",
+
   "inline",
 ] as const;
 
@@ -155,8 +157,15 @@ export type Token = (
     }
   | {
       type: "const-expression";
-      subtype: "int" | "float" | "char";
+      subtype: "int" | "float" | "double" | "char";
+      value: number;
+    }
+  | {
+      type: "const-expression";
+      subtype: "long long";
+      /** Not exact for big values, use text to get all 64 bits */
       value: number;
+      text: string;
     }
   | {
       type: "string-literal";
@@ -297,6 +306,41 @@ export function createScannerFunc(str: string) {
     }
   }
 
+  /**
+   * Reads integer suffix like "u", "l" or "ull". Constant gets "long long"
+   *  type if suffix says so or if value does not fit into 32 bits
+   */
+  function integerToken(value: number, text: string): Token {
+    let suffix = "";
+    while (
+      current() === "u" ||
+      current() === "U" ||
+      current() === "l" ||
+      current() === "L"
+    ) {
+      suffix += current();
+      incPos();
+    }
+    if (!/^([uU]?([lL]|ll|LL)?|([lL]|ll|LL)[uU])$/.test(suffix)) {
+      throwError(`Wrong integer suffix ${suffix}`);
+    }
+    if (/ll/i.test(suffix) || value > 0xffffffff) {
+      return {
+        type: "const-expression",
+        ...savedLocation(),
+        subtype: "long long",
+        value,
+        text,
+      };
+    }
+    return {
+      type: "const-expression",
+      ...savedLocation(),
+      subtype: "int",
+      value,
+    };
+  }
+
   function scanNumber(): Token {
     saveLocation();
 
@@ -307,12 +351,7 @@ export function createScannerFunc(str: string) {
         incPos();
       }
       const value = sliceFromSavedPoint().slice(2);
-      return {
-        type: "const-expression",
-        ...savedLocation(),
-        subtype: "int",
-        value: parseInt(value, 16),
-      };
+      return integerToken(parseInt(value, 16), `0x${value}`);
     }
 
     if (current() === "0" && next() === "b") {
@@ -322,13 +361,15 @@ export function createScannerFunc(str: string) {
       while (current() === "0" || current() === "1") {
         incPos();
       }
-      const value = sliceFromSavedPoint().slice(2);
-      return {
-        type: "const-expression",
-        ...savedLocation(),
-        subtype: "int",
-        value: parseInt(value, 2),
-      };
+      const digits = sliceFromSavedPoint().slice(2);
+      // Every four binary digits are one hex digit, so text keeps all bits
+      let hex = "";
+      for (let end = digits.length; end > 0; end -= 4) {
+        hex =
+          parseInt(digits.slice(Math.max(end - 4, 0), end), 2).toString(16) +
+          hex;
+      }
+      return integerToken(parseInt(digits, 2), `0x${hex}`);
     }
 
     let dotSeen = false;
@@ -346,21 +387,37 @@ export function createScannerFunc(str: string) {
         break;
       }
     }
+    let exponentSeen = false;
+    if (
+      (current() === "e" || current() === "E") &&
+      (isDigit(next()) ||
+        ((next() === "+" || next() === "-") && isDigit(lookAhead(2))))
+    ) {
+      exponentSeen = true;
+      incPos(2);
+      while (isDigit(current())) {
+        incPos();
+      }
+    }
     const value = sliceFromSavedPoint();
-    if (dotSeen) {
+    if (dotSeen || exponentSeen) {
+      // Floating constant without suffix have type double (6.4.4.2)
+      let subtype: "float" | "double" = "double";
+      if (current() === "f" || current() === "F") {
+        subtype = "float";
+        incPos();
+      } else if (current() === "l" || current() === "L") {
+        // "long double" is the same as double
+        incPos();
+      }
       return {
         type: "const-expression",
         ...savedLocation(),
-        subtype: "float",
+        subtype,
         value: parseFloat(value),
       };
     } else {
-      return {
-        type: "const-expression",
-        ...savedLocation(),
-        subtype: "int",
-        value: parseInt(value),
-      };
+      return integerToken(parseInt(value), value);
     }
   }
 
@@ -0,0 +1,126 @@
+import {
+  compileWithOptions,
+  emitWithOptions,
+  forEachOptimizationLevel,
+} from "./funcs";
+import { encodeModuleBinary } from "../core/emitter.module.binary";
+
+describe(`Optimizations`, () => {
+  const testFiles = [
+    "emitter1.c",
+    "emitter2.c",
+    "emitter3.c",
+    "emitter4.c",
+    "emitter5.c",
+    "emitter6.c",
+    "emitter7.c",
+    "emitter.crc32.c",
+    "emitter.aes.c",
+  ];
+
+  for (const fname of testFiles) {
+    it(`Optimized ${fname} is smaller`, () => {
+      const notOptimized = emitWithOptions({ optimizationLevel: 0 }, fname);
+      const optimized = emitWithOptions({ optimizationLevel: 2 }, fname);
+
+      const countInstructions = (emitted: typeof optimized) =>
+        emitted.module.functions.reduce(
+          (sum, func) => sum + func.body.length,
+          0
+        );
+      expect(countInstructions(optimized)).toBeLessThan(
+        countInstructions(notOptimized)
+      );
+      expect(encodeModuleBinary(optimized.module).length).toBeLessThan(
+        encodeModuleBinary(notOptimized.module).length
+      );
+
+      const peephole = optimized.optimizationStatistics.find(
+        (pass) => pass.name === "peephole"
+      );
+      expect(peephole && Object.keys(peephole.counters).length).toBeTruthy();
+    });
+  }
+});
+
+describe(`Optimizer regressions`, () => {
+  const testFiles = [
+    "emitter1.c",
+    "emitter2.c",
+    "emitter3.c",
+    "emitter4.c",
+    "emitter5.c",
+    "emitter6.c",
+    "emitter8.c",
+    "emitter9.c",
+    "emitter10.c",
+    "emitter11.c",
+    "emitter12.c",
+    "emitter13.c",
+    "emitter14.c",
+    "emitter15.c",
+    "emitter16.c",
+    "emitter.crc32.c",
+    "emitter.aes.c",
+  ];
+
+  const argumentSets = [
+    [0, 0, 0, 0],
+    [1, 2, 3, 4],
+    [7, 5, 3, 1],
+    [-3, 100, 17, 2],
+  ];
+
+  /**
+   * Long long parameters are BigInt, so all combinations of number and BigInt
+   *   are tried. TypeError is thrown before the call if types are wrong
+   */
+  function callWithArguments(func: Function, params: number[]) {
+    for (let mask = 0; mask < 1 << params.length; mask++) {
+      try {
+        return `${func(
+          ...params.map((param, idx) =>
+            mask & (1 << idx) ? BigInt(param) : param
+          )
+        )}`;
+      } catch (e) {
+        if (!(e instanceof TypeError)) {
+          return e.name;
+        }
+      }
+    }
+    return "TypeError";
+  }
+
+  /** Calls every exported function in the same order on every level */
+  function callExports(exports: WebAssembly.Exports) {
+    const calls: string[] = [];
+    for (const name of Object.keys(exports).sort()) {
+      const func = exports[name];
+      if (typeof func !== "function" || name.startsWith("_debug")) {
+        continue;
+      }
+      for (const args of argumentSets) {
+        const params = args.slice(0, func.length);
+        const result = callWithArguments(func, params);
+        calls.push(`${name}(${params.join(", ")}) = ${result}`);
+      }
+    }
+    return calls;
+  }
+
+  for (const fname of testFiles) {
+    it(`Optimized ${fname} gives the same results`, async () => {
+      const [reference, ...optimized] = await forEachOptimizationLevel(
+        async (optimizationLevel) => {
+          const d = await compileWithOptions({ optimizationLevel }, fname);
+          return callExports(d.compiled);
+        }
+      );
+      expect(reference.length).toBeGreaterThan(0);
+      for (const calls of optimized) {
+        expect(calls).toStrictEqual(reference);
+      }
+    });
+  }
+});
@@ -0,0 +1,79 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+import { preinitializeModule } from "../core/emitter.preinit";
+
+describe(`Pre-initialization`, () => {
+  it(`Table is computed on compilation time`, async () => {
+    const d = await compileWithOptions<{
+      crc32(data_addr: number, data_len: number): number;
+    }>(
+      { optimizationLevel: 2, preinit: ["crc32_init_table"] },
+      "emitter.crc32.c"
+    );
+
+    // No crc32_init_table call here
+    const data_pos = d.compiled._debug_get_heap_offset();
+    "lol".split("").forEach((c, i) => (d.mem8[data_pos + i] = c.charCodeAt(0)));
+    expect(d.compiled.crc32(data_pos, 3)).toBe(0x18edb14d);
+    expect(d.compiled._debug_get_esp()).toBe(d.compiled.__stack_pointer.value);
+  });
+
+  it(`Snapshots exported memory`, async () => {
+    const d = await compileWithOptions<{
+      crc32(data_addr: number, data_len: number): number;
+    }>(
+      {
+        optimizationLevel: 2,
+        preinit: ["crc32_init_table"],
+        exportMemory: true,
+        heapSize: 16,
+      },
+      "emitter.crc32.c"
+    );
+    const data_pos = d.compiled._debug_get_heap_offset();
+    "lol".split("").forEach((c, i) => (d.mem8[data_pos + i] = c.charCodeAt(0)));
+    expect(d.compiled.crc32(data_pos, 3)).toBe(0x18edb14d);
+  });
+
+  it(`Keeps maximum of imported memory`, async () => {
+    const d = await compileWithOptions<{
+      crc32(data_addr: number, data_len: number): number;
+    }>(
+      {
+        optimizationLevel: 2,
+        preinit: ["crc32_init_table"],
+        maxMemoryPages: 4,
+      },
+      "emitter.crc32.c"
+    );
+    const data_pos = d.compiled._debug_get_heap_offset();
+    "lol".split("").forEach((c, i) => (d.mem8[data_pos + i] = c.charCodeAt(0)));
+    expect(d.compiled.crc32(data_pos, 3)).toBe(0x18edb14d);
+    expect(d.memory.grow(0)).toBeLessThanOrEqual(4);
+    expect(() => d.memory.grow(4)).toThrow();
+  });
+
+  it(`Snapshot replaces data segments`, async () => {
+    const emitted = emitWithOptions({}, "emitter.crc32.c");
+    const module = await preinitializeModule(emitted.module, [
+      "crc32_init_table",
+    ]);
+    const size = (data: typeof module.data) =>
+      data.reduce((sum, segment) => sum + segment.bytes.length, 0);
+    // Table of 256 uint32 values
+    expect(size(module.data) - size(emitted.module.data)).toBeGreaterThan(
+      1000
+    );
+    expect(module.data[0]).toStrictEqual(emitted.module.data[0]);
+  });
+
+  it(`Throws on unknown initializer`, async () => {
+    const emitted = emitWithOptions({}, "emitter.crc32.c");
+    let message = "";
+    try {
+      await preinitializeModule(emitted.module, ["not_existing"]);
+    } catch (e) {
+      message = e.message;
+    }
+    expect(message).toContain("not exported");
+  });
+});
@@ -0,0 +1,42 @@
+import { emitWithOptions } from "./funcs";
+import { printModuleWat } from "../core/emitter.module.wat";
+import { EmitterOptions } from "../core/emitter";
+
+async function parseWat(options: EmitterOptions, fname: string) {
+  const wabt = await import("wabt").then((wabt1) => wabt1.default());
+  const text = printModuleWat(emitWithOptions(options, fname).module).join(
+    "\n"
+  );
+  const wasmModule = wabt.parseWat(`${fname}.wat`, text, {
+    bulk_memory: true,
+    multi_value: true,
+    simd: true,
+    tail_call: true,
+  });
+  try {
+    wasmModule.validate();
+    return wasmModule.toBinary({}).buffer;
+  } finally {
+    wasmModule.destroy();
+  }
+}
+
+describe(`Text format`, () => {
+  it(`Prints valid module`, async () => {
+    const binary = await parseWat({ optimizationLevel: 2 }, "emitter24.c");
+    expect(WebAssembly.validate(binary)).toBe(true);
+  });
+
+  it(`Prints imports before defined memory`, async () => {
+    const binary = await parseWat(
+      { exportMemory: true, importStackPointer: true, instrument: "time" },
+      "emitter24.c"
+    );
+    expect(WebAssembly.validate(binary)).toBe(true);
+    const imports = WebAssembly.Module.imports(new WebAssembly.Module(binary));
+    expect(imports.map((item) => item.name)).toStrictEqual([
+      "__stack_pointer",
+      "_prof_now",
+    ]);
+  });
+});
@@ -1,5 +1,5 @@
-import { STACK_SIZE } from "../core/emitter.memory";
-import { compile } from "./funcs";
+import { STACK_SIZE, ESP_INITIAL_VALUE } from "../core/emitter.memory";
+import { compile, compileWithOptions } from "./funcs";
 
 describe(`Emits and compiles`, () => {
   it(`Func2 returns 41`, async () => {
@@ -25,6 +25,26 @@ describe(`Emits and compiles`, () => {
     expect(d.compiled.counter()).toBe(4);
   });
 
+  it(`Stack pointer is an exported global`, async () => {
+    const d = await compile<{}>("emitter1.c");
+    expect(d.compiled.__stack_pointer.value).toBe(ESP_INITIAL_VALUE);
+    expect(d.compiled._debug_get_esp()).toBe(ESP_INITIAL_VALUE);
+  });
+
+  it(`Stack pointer can be imported`, async () => {
+    const d = await compileWithOptions<{
+      return_const(): number;
+    }>({ importStackPointer: true }, "emitter1.c");
+    if (!d.stackPointer) {
+      throw new Error("Stack pointer must be created");
+    }
+    expect(d.compiled._debug_get_esp()).toBe(ESP_INITIAL_VALUE);
+    d.stackPointer.value = ESP_INITIAL_VALUE - 16;
+    expect(d.compiled._debug_get_esp()).toBe(ESP_INITIAL_VALUE - 16);
+    expect(d.compiled.return_const()).toBe(41);
+    expect(d.stackPointer.value).toBe(ESP_INITIAL_VALUE - 16);
+  });
+
   it(`_debug_get_heap_offset`, async () => {
     const d = await compile<{}>("emitter1.c");
     expect(d.compiled._debug_get_heap_offset()).toBeGreaterThan(STACK_SIZE);
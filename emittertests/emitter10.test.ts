@@ -0,0 +1,69 @@
+import { compile, emitWithOptions } from "./funcs";
+import { Scanner } from "../core/scanner";
+import { createScannerFunc } from "../core/scanner.func";
+import { readTranslationUnit } from "../core/parser";
+import { emit } from "../core/emitter";
+
+describe(`Switch`, () => {
+  it(`Switch statements work`, async () => {
+    const d = await compile<{
+      dense(x: number): number;
+      sparse(x: number): number;
+      fallthrough(x: number): number;
+      count_in_loop(n: number): number;
+    }>("emitter10.c");
+
+    expect([0, 1, 2, 3, 4, 5, 6, -1].map(d.compiled.dense)).toStrictEqual([
+      10,
+      11,
+      23,
+      23,
+      99,
+      15,
+      99,
+      99,
+    ]);
+    expect(
+      [1, 100, 1000, 5000, 70000, 123456, 0, 99, 101, 200000].map(
+        d.compiled.sparse
+      )
+    ).toStrictEqual([1, 2, 3, 4, 5, 6, 0, 0, 0, 0]);
+    expect([1, 2, 3, 4].map(d.compiled.fallthrough)).toStrictEqual([
+      111,
+      100,
+      1000,
+      110,
+    ]);
+    expect(d.compiled.count_in_loop(7)).toBe(103);
+  });
+
+  it(`Dense switch uses jump table`, () => {
+    for (const optimizationLevel of [0, 2] as const) {
+      const emitted = emitWithOptions({ optimizationLevel }, "emitter10.c");
+      const bodies = emitted.module.functions.map((func) => func.body);
+      const tables = bodies.map(
+        (body) =>
+          body.filter((instruction) => instruction.op === "br_table").length
+      );
+      // Only "dense" and a switch in "count_in_loop" are dense
+      expect(tables.reduce((a, b) => a + b, 0)).toBe(2);
+    }
+  });
+
+  it(`Long long case label is not truncated`, () => {
+    const source = `
+int check(int x)
+{
+  switch (x)
+  {
+  case 5000000000LL:
+    return 1;
+  }
+  return 0;
+}
+`;
+    expect(() =>
+      emit(readTranslationUnit(new Scanner(createScannerFunc(source))), {})
+    ).toThrow("Case label must be an int constant");
+  });
+});
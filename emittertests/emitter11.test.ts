@@ -0,0 +1,54 @@
+import { compile, emitWithOptions } from "./funcs";
+
+describe(`Initializers`, () => {
+  it(`Arrays are initialized`, async () => {
+    const d = await compile<{
+      get_sbox(i: number): number;
+      get_prime(i: number): number;
+      primes_count(): number;
+      get_matrix(i: number, j: number): number;
+      get_partial(i: number, j: number): number;
+      apply(op: number, x: number): number;
+      next_id(): number;
+      local_small(i: number, x: number): number;
+      local_big(i: number): number;
+    }>("emitter11.c");
+
+    expect(d.compiled.get_sbox(0)).toBe(0x63);
+    expect(d.compiled.get_sbox(15)).toBe(0x76);
+    expect(d.compiled.get_prime(5)).toBe(13);
+    expect(d.compiled.primes_count()).toBe(6);
+    expect(d.compiled.get_matrix(1, 1)).toBe(4);
+    expect(d.compiled.get_matrix(2, 0)).toBe(5);
+    expect(d.compiled.get_matrix(2, 1)).toBe(6);
+    expect(d.compiled.get_partial(0, 0)).toBe(1);
+    expect(d.compiled.get_partial(0, 1)).toBe(0);
+    expect(d.compiled.get_partial(1, 1)).toBe(3);
+    expect(d.compiled.get_partial(3, 3)).toBe(0);
+    expect(d.compiled.apply(0, 3)).toBe(9);
+    expect(d.compiled.apply(1, 3)).toBe(27);
+
+    expect(d.compiled.next_id()).toBe(101);
+    expect(d.compiled.next_id()).toBe(102);
+
+    expect(d.compiled.local_small(0, 5)).toBe(10);
+    expect(d.compiled.local_small(1, 5)).toBe(5);
+    expect(d.compiled.local_small(2, 5)).toBe(30);
+    expect(d.compiled.local_small(3, 5)).toBe(0);
+    expect(d.compiled.local_big(0)).toBe(210 - 1 + 100);
+    // Local is initialized again on every call
+    expect(d.compiled.local_big(19)).toBe(210 - 20 + 100);
+  });
+
+  it(`Global tables are data segments`, () => {
+    const emitted = emitWithOptions({}, "emitter11.c");
+    expect(
+      emitted.module.data.some(
+        (segment) =>
+          segment.bytes.length === 16 &&
+          segment.bytes[0] === 0x63 &&
+          segment.bytes[15] === 0x76
+      )
+    ).toBe(true);
+  });
+});
@@ -0,0 +1,70 @@
+import { compileWithOptions } from "./funcs";
+
+interface LongLongExports {
+  fnv1a(length: number): bigint;
+  mul(a: bigint, b: bigint): bigint;
+  div_signed(a: bigint, b: bigint): bigint;
+  less_signed(a: bigint, b: bigint): number;
+  less_unsigned(a: bigint, b: bigint): number;
+  widen_unsigned(x: number): bigint;
+  widen_signed(x: number): bigint;
+  high_part(x: bigint): number;
+  shift_left(n: number): bigint;
+  shift_right_signed(x: bigint, n: number): bigint;
+  get_power(i: number): bigint;
+  address_taken(value: bigint): bigint;
+  sum_to(n: number): bigint;
+  is_zero(x: bigint): number;
+  negate(x: bigint): bigint;
+  binary_mask(): bigint;
+}
+
+/** BigInt literals need es2020 target, so values are parsed from strings */
+const n = (value: string) => BigInt(value);
+
+function checkLongLong(d: LongLongExports) {
+  // FNV-1a of "hello", JS gets signed values so they are converted back
+  expect(BigInt.asUintN(64, d.fnv1a(5))).toBe(n("0xa430d84680aabd0b"));
+  expect(BigInt.asUintN(64, d.fnv1a(0))).toBe(n("0xcbf29ce484222325"));
+
+  expect(d.mul(n("0xffffffff"), n("0x100000001"))).toBe(n("-1"));
+  expect(d.mul(n("3000000000"), n("3000000000"))).toBe(
+    n("9000000000000000000")
+  );
+  expect(d.div_signed(n("-100"), n("7"))).toBe(n("-14"));
+  expect(d.less_signed(n("-1"), n("1"))).toBe(1);
+  expect(d.less_unsigned(n("-1"), n("1"))).toBe(0);
+
+  expect(d.widen_unsigned(-1)).toBe(n("0xffffffff"));
+  expect(d.widen_signed(-1)).toBe(n("-1"));
+  expect(d.high_part(n("0x1234567800000000"))).toBe(0x12345678);
+
+  expect(d.shift_left(40)).toBe(n("0x10000000000"));
+  expect(d.shift_right_signed(n("-256"), 4)).toBe(n("-16"));
+
+  expect(d.get_power(3)).toBe(n("1000000000000"));
+  expect(d.address_taken(n("41"))).toBe(n("42"));
+  expect(d.sum_to(100)).toBe(n("5050"));
+  expect(d.is_zero(n("0"))).toBe(1);
+  expect(d.is_zero(n("0x10000000000"))).toBe(0);
+  expect(d.negate(n("5"))).toBe(n("-5"));
+  expect(BigInt.asUintN(64, d.binary_mask())).toBe(n("0x8000000000000003"));
+}
+
+describe(`Long long`, () => {
+  it(`Uses 64-bits registers`, async () => {
+    const d = await compileWithOptions<LongLongExports & WebAssembly.Exports>(
+      { optimizationLevel: 2 },
+      "emitter12.c"
+    );
+    checkLongLong(d.compiled);
+  });
+
+  it(`Works without optimizations`, async () => {
+    const d = await compileWithOptions<LongLongExports & WebAssembly.Exports>(
+      { optimizationLevel: 0 },
+      "emitter12.c"
+    );
+    checkLongLong(d.compiled);
+  });
+});
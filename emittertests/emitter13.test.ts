@@ -0,0 +1,74 @@
+import { compileWithOptions } from "./funcs";
+
+interface FloatExports {
+  set_sample(i: number, value: number): void;
+  mean(count: number): number;
+  filter(i: number): number;
+  scaled(x: number): number;
+  hypot_squared(x: number, y: number): number;
+  mixed(a: number, b: number, c: number): number;
+  to_int(x: number): number;
+  to_signed(x: number): number;
+  to_long_long(x: number): bigint;
+  from_signed(x: number): number;
+  from_unsigned(x: number): number;
+  demote(x: number): number;
+  less(a: number, b: number): number;
+  is_zero(x: number): number;
+  negate(x: number): number;
+  increment(x: number): number;
+  pointer_average(): number;
+  pick(condition: number, a: number, b: number): number;
+  exponent(): number;
+}
+
+function checkFloats(d: FloatExports) {
+  d.set_sample(0, 1);
+  d.set_sample(1, 2);
+  d.set_sample(2, 4);
+  expect(d.mean(3)).toBe(7 / 3);
+  expect(d.filter(0)).toBe(0.25 * 1 + 0.5 * 2 + 0.25 * 4);
+
+  expect(d.scaled(2)).toBe(3);
+  expect(d.hypot_squared(3, 4)).toBe(25);
+  expect(d.mixed(1, 0.5, 3)).toBe(2.5);
+
+  expect(d.to_int(3.9)).toBe(3);
+  // Ints are unsigned by default, so negative values are saturated
+  expect(d.to_int(-3.9)).toBe(0);
+  expect(d.to_signed(-3.9)).toBe(-3);
+  expect(d.to_signed(1e20)).toBe(2147483647);
+  expect(d.to_long_long(1e12)).toBe(BigInt("1000000000000"));
+  expect(d.from_signed(-1)).toBe(-1);
+  expect(d.from_unsigned(-1)).toBe(4294967295);
+  expect(d.demote(0.1)).toBe(Math.fround(0.1));
+
+  expect(d.less(1.5, 2)).toBe(1);
+  expect(d.less(2, 1.5)).toBe(0);
+  expect(d.is_zero(0)).toBe(1);
+  expect(d.is_zero(0.1)).toBe(0);
+  expect(d.negate(2.5)).toBe(-2.5);
+  expect(d.increment(2.5)).toBe(3.5);
+  expect(d.pointer_average()).toBe(1.5);
+  expect(d.pick(1, 0.5, 2)).toBe(0.5);
+  expect(d.pick(0, 0.5, 2)).toBe(2);
+  expect(d.exponent()).toBe(1500.2);
+}
+
+describe(`Floating types`, () => {
+  it(`Uses f32 and f64 registers`, async () => {
+    const d = await compileWithOptions<FloatExports & WebAssembly.Exports>(
+      { optimizationLevel: 2 },
+      "emitter13.c"
+    );
+    checkFloats(d.compiled);
+  });
+
+  it(`Works without optimizations`, async () => {
+    const d = await compileWithOptions<FloatExports & WebAssembly.Exports>(
+      { optimizationLevel: 0 },
+      "emitter13.c"
+    );
+    checkFloats(d.compiled);
+  });
+});
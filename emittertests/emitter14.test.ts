@@ -0,0 +1,118 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+
+interface VectorExports {
+  get_bytes(): number;
+  get_words(): number;
+  get_state(): number;
+  xor_buffers(dst: number, a: number, b: number, n: number): void;
+  add_bytes(dst: number, a: number, n: number): void;
+  fill(dst: number, value: number, n: number): void;
+  add_words(dst: number, a: number, n: number): void;
+  mix_words(dst: number, a: number, n: number, k: number): void;
+  add_round_key(): void;
+  running_sum(dst: number, n: number): void;
+}
+
+interface Compiled {
+  compiled: VectorExports;
+  mem8: Uint8Array;
+}
+
+function compileVariant(simd: boolean) {
+  return compileWithOptions<VectorExports & WebAssembly.Exports>(
+    { optimizationLevel: 2, simd },
+    "emitter14.c"
+  );
+}
+
+/** Fills globals with the same pseudo-random data in both modules */
+function seed(variants: Compiled[]) {
+  for (const d of variants) {
+    let x = 12345;
+    const start = d.compiled.get_bytes();
+    const end = d.compiled.get_words() + 256 * 4;
+    for (let i = Math.min(start, d.compiled.get_words()); i < end; i++) {
+      x = (Math.imul(x, 1103515245) + 12345) >>> 0;
+      d.mem8[i] = x >>> 24;
+    }
+  }
+}
+
+function snapshot(d: Compiled) {
+  const bytes = d.compiled.get_bytes();
+  const words = d.compiled.get_words();
+  const state = d.compiled.get_state();
+  return [
+    ...Array.from(d.mem8.slice(bytes, bytes + 512)),
+    ...Array.from(d.mem8.slice(words, words + 1024)),
+    ...Array.from(d.mem8.slice(state, state + 16)),
+  ];
+}
+
+describe(`Loop vectorization`, () => {
+  it(`Uses SIMD instructions only when requested`, () => {
+    const countVectorInstructions = (simd: boolean) => {
+      const emitted = emitWithOptions(
+        { optimizationLevel: 2, simd },
+        "emitter14.c"
+      );
+      return emitted.module.functions.reduce(
+        (sum, func) =>
+          sum +
+          func.body.filter((instruction) => instruction.op === "v128.load")
+            .length,
+        0
+      );
+    };
+    expect(countVectorInstructions(false)).toBe(0);
+    expect(countVectorInstructions(true)).toBeGreaterThan(0);
+
+    const statistics = emitWithOptions(
+      { optimizationLevel: 2, simd: true },
+      "emitter14.c"
+    ).optimizationStatistics;
+    const vectorizer = statistics.find(
+      (pass) => pass.name === "loop-vectorization"
+    );
+    // Running sum have dependency between iterations
+    expect(vectorizer && vectorizer.counters["vectorized-loops"]).toBe(6);
+  });
+
+  it(`Gives the same results as scalar code`, async () => {
+    const scalar = await compileVariant(false);
+    const vector = await compileVariant(true);
+    const variants = [scalar, vector];
+
+    const lengths = [0, 1, 3, 15, 16, 17, 31, 32, 33, 100];
+    const run = (
+      f: (d: VectorExports, bytes: number, words: number) => void
+    ) => {
+      seed(variants);
+      for (const d of variants) {
+        f(d.compiled, d.compiled.get_bytes(), d.compiled.get_words());
+      }
+      expect(snapshot(vector)).toStrictEqual(snapshot(scalar));
+    };
+
+    for (const n of lengths) {
+      run((d, bytes) => d.xor_buffers(bytes, bytes + 128, bytes + 256, n));
+      // In place and overlapping arrays
+      run((d, bytes) => d.xor_buffers(bytes, bytes, bytes + 256, n));
+      run((d, bytes) => d.xor_buffers(bytes + 1, bytes, bytes + 256, n));
+      run((d, bytes) => d.xor_buffers(bytes + 8, bytes + 16, bytes, n));
+
+      run((d, bytes) => d.add_bytes(bytes, bytes + 200, n));
+      run((d, bytes) => d.add_bytes(bytes + 3, bytes, n));
+      run((d, bytes) => d.fill(bytes + 5, 0x1ab, n));
+
+      run((d, _, words) => d.add_words(words, words + 400, n));
+      run((d, _, words) => d.add_words(words + 4, words, n));
+      run((d, _, words) => d.mix_words(words, words + 512, n, 0x9e3779b9));
+      run((d, _, words) => d.running_sum(words, n));
+    }
+    // Signed bound is not vectorized when it is negative
+    run((d, _, words) => d.mix_words(words, words + 512, -5, 3));
+
+    run((d) => d.add_round_key());
+  });
+});
@@ -0,0 +1,91 @@
+import { compileWithOptions } from "./funcs";
+
+interface SimdExports {
+  get_buffer(): number;
+  xor_block(dst: number, a: number, b: number): void;
+  lanes_i32(a: number, b: number): number;
+  byte_signed(x: number): number;
+  byte_unsigned(x: number): number;
+  short_mul(a: number, b: number): number;
+  wide(a: bigint, b: bigint): bigint;
+  floats(a: number, b: number): number;
+  doubles(a: number, b: number): number;
+  reverse_shuffle(dst: number, src: number): void;
+  interleave(dst: number, a: number, b: number): void;
+  reverse_swizzle(dst: number, src: number): void;
+  bitwise(a: number, b: number, mask: number): number;
+  in_memory(a: number): number;
+  pick(condition: number, a: number, b: number): number;
+  inlined_vector_local(a: number): number;
+}
+
+interface Compiled {
+  compiled: SimdExports;
+  mem8: Uint8Array;
+}
+
+function range(from: number) {
+  return Array.from({ length: 16 }, (_, i) => from + i);
+}
+
+function checkSimd({ compiled: d, mem8 }: Compiled) {
+  expect(d.lanes_i32(3, 5)).toBe(45 + 65 * 1000);
+  expect(d.byte_signed(100)).toBe(-56);
+  expect(d.byte_unsigned(0)).toBe(255 + 7 * 1000);
+  expect(d.short_mul(3, 300)).toBe(((300 * 300) % 65536) - 1 + 8);
+  // Lanes are wrapped modulo 2^64
+  expect(d.wide(BigInt(3), BigInt("4294967297"))).toBe(BigInt("8589934591"));
+  expect(d.floats(1.5, 3)).toBe(5.5);
+  expect(d.doubles(2, 3)).toBe(3 * 3 + 1.5 - 2 + (2 * 2 + 1.5 - 2));
+  expect(d.bitwise(0x0f0f, 0x3c3c, 0xff00)).toBe(
+    (0x0f00 | 0x003c) ^ 0x0c0c ^ 0x3f3f ^ 0x0303 ^ ~0x0f0f
+  );
+  expect(d.in_memory(5)).toBe(10 + 3 + 16);
+  expect(d.pick(1, 7, 9)).toBe(7);
+  expect(d.pick(0, 7, 9)).toBe(9);
+  // Helper with v128 local is inlined on level 2
+  expect(d.inlined_vector_local(5)).toBe(5 * 3 + 6 * 3);
+
+  const buffer = d.get_buffer();
+  const a = buffer;
+  const b = buffer + 16;
+  const dst = buffer + 32;
+  mem8.set(range(0), a);
+  mem8.set(range(100), b);
+
+  d.xor_block(dst, a, b);
+  expect(Array.from(mem8.slice(dst, dst + 16))).toEqual(
+    range(0).map((x, i) => x ^ (100 + i))
+  );
+
+  d.reverse_shuffle(dst, a);
+  expect(Array.from(mem8.slice(dst, dst + 16))).toEqual(range(0).reverse());
+
+  d.reverse_swizzle(dst, b);
+  expect(Array.from(mem8.slice(dst, dst + 16))).toEqual(range(100).reverse());
+
+  d.interleave(dst, a, b);
+  expect(Array.from(mem8.slice(dst, dst + 16))).toEqual(
+    range(0)
+      .slice(0, 8)
+      .reduce<number[]>((acc, x) => [...acc, x, x + 100], [])
+  );
+}
+
+describe(`SIMD builtins`, () => {
+  it(`Uses v128 registers`, async () => {
+    const d = await compileWithOptions<SimdExports & WebAssembly.Exports>(
+      { optimizationLevel: 2 },
+      "emitter15.c"
+    );
+    checkSimd(d);
+  });
+
+  it(`Works without optimizations`, async () => {
+    const d = await compileWithOptions<SimdExports & WebAssembly.Exports>(
+      { optimizationLevel: 0 },
+      "emitter15.c"
+    );
+    checkSimd(d);
+  });
+});
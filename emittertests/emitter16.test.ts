@@ -0,0 +1,84 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+
+interface MemoryExports {
+  get_buffer(): number;
+  copy(dst: number, src: number, n: number): void;
+  move(dst: number, src: number, n: number): void;
+  fill(dst: number, value: number, n: number): void;
+  copy_returned(dst: number, src: number, n: number): number;
+  fill_and_copy(dst: number, src: number, n: number): number;
+  copy_words(): number;
+  zero_initialized(k: number): number;
+  template_initialized(k: number): number;
+}
+
+interface Compiled {
+  compiled: MemoryExports;
+  mem8: Uint8Array;
+}
+
+function checkMemory({ compiled: d, mem8 }: Compiled) {
+  const buffer = d.get_buffer();
+  const read = (from: number, n: number) =>
+    Array.from(mem8.slice(buffer + from, buffer + from + n));
+  for (let i = 0; i < 256; i++) {
+    mem8[buffer + i] = i;
+  }
+
+  d.copy(buffer + 100, buffer, 10);
+  expect(read(100, 10)).toEqual([0, 1, 2, 3, 4, 5, 6, 7, 8, 9]);
+
+  // Both memcpy and memmove are fine with overlapping regions
+  d.move(buffer + 2, buffer, 6);
+  expect(read(0, 8)).toEqual([0, 1, 0, 1, 2, 3, 4, 5]);
+  d.move(buffer, buffer + 2, 6);
+  expect(read(0, 8)).toEqual([0, 1, 2, 3, 4, 5, 4, 5]);
+
+  d.fill(buffer + 3, 0x1ab, 4);
+  expect(read(2, 6)).toEqual([2, 0xab, 0xab, 0xab, 0xab, 5]);
+  d.fill(buffer, 0, 0);
+  expect(read(0, 1)).toEqual([0]);
+
+  expect(d.copy_returned(buffer + 20, buffer + 3, 3)).toBe(buffer + 20);
+  expect(read(20, 3)).toEqual([0xab, 0xab, 0xab]);
+  expect(d.fill_and_copy(buffer + 30, buffer + 40, 2)).toBe(buffer + 30);
+  expect(read(29, 4)).toEqual([29, 7, 7, 32]);
+  expect(read(40, 3)).toEqual([7, 7, 42]);
+
+  expect(d.copy_words()).toBe(31 * 31);
+
+  expect(d.zero_initialized(5)).toBe(5);
+  // Frame is reused, so stale values must be zeroed
+  expect(d.zero_initialized(6)).toBe(6);
+
+  expect(d.template_initialized(100)).toBe(1 + 12 + 100);
+}
+
+describe(`Bulk memory`, () => {
+  it(`Lowers memcpy, memmove and memset into bulk memory instructions`, () => {
+    const emitted = emitWithOptions({ optimizationLevel: 2 }, "emitter16.c");
+    const ops = emitted.module.functions.reduce<string[]>(
+      (all, func) => [...all, ...func.body.map((instruction) => instruction.op)],
+      []
+    );
+    expect(ops.filter((op) => op === "memory.copy").length).toBe(6);
+    expect(ops.filter((op) => op === "memory.fill").length).toBe(4);
+    expect(ops.filter((op) => op === "call").length).toBe(0);
+  });
+
+  it(`Copies and fills memory`, async () => {
+    const d = await compileWithOptions<MemoryExports & WebAssembly.Exports>(
+      { optimizationLevel: 2 },
+      "emitter16.c"
+    );
+    checkMemory(d);
+  });
+
+  it(`Works without optimizations`, async () => {
+    const d = await compileWithOptions<MemoryExports & WebAssembly.Exports>(
+      { optimizationLevel: 0 },
+      "emitter16.c"
+    );
+    checkMemory(d);
+  });
+});
@@ -0,0 +1,129 @@
+import { compileWithOptions } from "./funcs";
+
+interface MallocExports {
+  malloc(n: number): number;
+  free(p: number): void;
+  calloc(count: number, size: number): number;
+  realloc(p: number, n: number): number;
+  malloc_stats_in_use(): number;
+  malloc_stats_peak(): number;
+  malloc_stats_allocations(): number;
+  malloc_stats_heap_size(): number;
+  _debug_get_heap_offset(): number;
+  sum_of_ranges(count: number, n: number): number;
+  grow_range(n: number): number;
+  zeroed_sum(n: number): number;
+}
+
+function compileWithMalloc(optimizationLevel: 0 | 2) {
+  return compileWithOptions<MallocExports & WebAssembly.Exports>(
+    { optimizationLevel, runtime: ["malloc"], maxMemoryPages: 1000 },
+    "emitter17.c"
+  );
+}
+
+function sumOfRange(n: number) {
+  return (n * (n - 1)) / 2;
+}
+
+function checkPrograms(d: MallocExports) {
+  let expected = 0;
+  for (let i = 0; i < 16; i++) {
+    expected += sumOfRange(100 + i);
+  }
+  expect(d.sum_of_ranges(16, 100)).toBe(expected);
+  expect(d.grow_range(1000)).toBe(sumOfRange(1000));
+  expect(d.zeroed_sum(500)).toBe(0);
+
+  expect(d.malloc_stats_allocations()).toBe(0);
+  expect(d.malloc_stats_in_use()).toBe(0);
+  expect(d.malloc_stats_peak()).toBeGreaterThan(1000 * 4);
+}
+
+describe(`Malloc runtime`, () => {
+  it(`Runs programs which allocate memory`, async () => {
+    const d = await compileWithMalloc(2);
+    checkPrograms(d.compiled);
+  });
+
+  it(`Works without optimizations`, async () => {
+    const d = await compileWithMalloc(0);
+    checkPrograms(d.compiled);
+  });
+
+  it(`Reuses small blocks`, async () => {
+    const d = (await compileWithMalloc(2)).compiled;
+    const heapBegin = d._debug_get_heap_offset();
+
+    const a = d.malloc(10);
+    const b = d.malloc(12);
+    const c = d.malloc(100);
+    for (const p of [a, b, c]) {
+      expect(p).toBeGreaterThanOrEqual(heapBegin);
+      expect(p % 8).toBe(0);
+    }
+    expect(new Set([a, b, c]).size).toBe(3);
+    expect(d.malloc_stats_allocations()).toBe(3);
+
+    d.free(b);
+    d.free(a);
+    expect(d.malloc(9)).toBe(a);
+    expect(d.malloc(11)).toBe(b);
+    d.free(0);
+  });
+
+  it(`Coalesces large blocks`, async () => {
+    const d = (await compileWithMalloc(2)).compiled;
+    const a = d.malloc(1000);
+    const b = d.malloc(1000);
+    const c = d.malloc(1000);
+    const heapSize = d.malloc_stats_heap_size();
+
+    d.free(a);
+    d.free(b);
+    // Both freed blocks are merged
+    expect(d.malloc(2000)).toBe(a);
+    expect(d.malloc_stats_heap_size()).toBe(heapSize);
+
+    // The last block goes back into the heap top
+    d.free(c);
+    expect(d.malloc_stats_heap_size()).toBeLessThan(heapSize);
+  });
+
+  it(`Resizes blocks`, async () => {
+    const { compiled: d, memory } = await compileWithMalloc(2);
+    const p = d.malloc(300);
+    new Uint8Array(memory.buffer).fill(7, p, p + 300);
+    // The last block is resized in place
+    expect(d.realloc(p, 600)).toBe(p);
+
+    const other = d.malloc(300);
+    const moved = d.realloc(p, 2000);
+    expect(moved).not.toBe(p);
+    expect(moved).not.toBe(other);
+    const mem8 = new Uint8Array(memory.buffer);
+    expect(Array.from(mem8.slice(moved, moved + 300))).toEqual(
+      new Array(300).fill(7)
+    );
+
+    const zeroed = d.calloc(100, 4);
+    expect(Array.from(new Uint8Array(memory.buffer, zeroed, 400))).toEqual(
+      new Array(400).fill(0)
+    );
+    expect(d.calloc(0x10000, 0x10000)).toBe(0);
+  });
+
+  it(`Grows memory`, async () => {
+    const { compiled: d, memory } = await compileWithMalloc(2);
+    const pages = memory.buffer.byteLength / 0x10000;
+
+    const p = d.malloc(pages * 0x10000);
+    expect(p).not.toBe(0);
+    expect(memory.buffer.byteLength).toBeGreaterThan(p + pages * 0x10000 - 1);
+
+    // More than memory maximum
+    expect(d.malloc(0x70000000)).toBe(0);
+    expect(d.malloc(0xfffffff0)).toBe(0);
+    expect(d.malloc(100)).not.toBe(0);
+  });
+});
@@ -0,0 +1,86 @@
+import { compileWithOptions } from "./funcs";
+import { ArenaExports, createRequestArena } from "../core/runtime.arena";
+
+interface RequestExports extends ArenaExports {
+  handle_request(arena: number, seed: number): number;
+  malloc_stats_heap_size(): number;
+  malloc_stats_in_use(): number;
+  arena_use_chunk(n: number): number;
+}
+
+function compileWithArena(optimizationLevel: 0 | 2) {
+  return compileWithOptions<RequestExports & WebAssembly.Exports>(
+    { optimizationLevel, runtime: ["arena"] },
+    "emitter18.c"
+  );
+}
+
+describe(`Arena runtime`, () => {
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Handles requests with level ${optimizationLevel}`, async () => {
+      const d = (await compileWithArena(optimizationLevel)).compiled;
+      const requests = createRequestArena(d, 4096);
+
+      expect(requests.handle((arena) => d.handle_request(arena, 1))).toBe(
+        100 + 5000 + 10
+      );
+      const heapSize = d.malloc_stats_heap_size();
+
+      for (let seed = 2; seed < 10; seed++) {
+        expect(
+          requests.handle((arena) => {
+            const result = d.handle_request(arena, seed);
+            expect(d.arena_used(arena)).toBe((100 + 5000 + 10) * 4);
+            return result;
+          })
+        ).toBe(100 + 5000 + 10 + (seed - 1) * 3);
+      }
+      expect(d.arena_used(requests.arena)).toBe(0);
+      // Chunks are reused after reset
+      expect(d.malloc_stats_heap_size()).toBe(heapSize);
+
+      requests.destroy();
+      expect(d.malloc_stats_in_use()).toBe(0);
+    });
+  }
+
+  it(`Resets arena when request fails`, async () => {
+    const d = (await compileWithArena(2)).compiled;
+    const requests = createRequestArena(d);
+    expect(() =>
+      requests.handle((arena) => {
+        d.arena_alloc(arena, 100);
+        throw new Error("Request failed");
+      })
+    ).toThrow("Request failed");
+    expect(d.arena_used(requests.arena)).toBe(0);
+  });
+
+  it(`Allocates aligned blocks in chunks`, async () => {
+    const d = (await compileWithArena(2)).compiled;
+    const arena = d.arena_create(64);
+    const first = d.arena_alloc(arena, 3);
+    expect(first % 8).toBe(0);
+    expect(d.arena_alloc(arena, 5)).toBe(first + 8);
+
+    // Does not fit into the first chunk
+    const big = d.arena_alloc(arena, 1000);
+    expect(big).not.toBe(0);
+    expect(big % 8).toBe(0);
+
+    d.arena_reset(arena);
+    expect(d.arena_alloc(arena, 1)).toBe(first);
+    expect(d.arena_alloc(arena, 0x7ff00001)).toBe(0);
+    d.arena_destroy(arena);
+  });
+
+  it(`Keeps internal names of runtime out of user namespace`, async () => {
+    const d = (await compileWithArena(2)).compiled;
+    expect(d.arena_use_chunk(2)).toBe(7);
+    const requests = createRequestArena(d);
+    expect(requests.handle((arena) => d.handle_request(arena, 1))).toBe(
+      100 + 5000 + 10
+    );
+    expect(d.arena_use_chunk(3)).toBe(10);
+  });
+});
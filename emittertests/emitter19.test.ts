@@ -0,0 +1,60 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+
+interface RecursionExports {
+  sum_to(n: number, acc: number): number;
+  indirect_sum(n: number): number;
+  sum_with_frame(n: number, acc: number): number;
+  widened_sum(n: number): bigint;
+}
+
+const DEEP = 1000000;
+const DEEP_SUM = ((DEEP * (DEEP + 1)) / 2) % 2 ** 32;
+
+function countOps(tailCalls: boolean, op: string) {
+  const emitted = emitWithOptions(
+    { optimizationLevel: 2, tailCalls },
+    "emitter19.c"
+  );
+  return emitted.module.functions.reduce(
+    (sum, func) =>
+      sum + func.body.filter((instruction) => instruction.op === op).length,
+    0
+  );
+}
+
+describe(`Tail calls`, () => {
+  it(`Uses return_call only when requested`, () => {
+    expect(countOps(false, "return_call")).toBe(0);
+    expect(countOps(false, "return_call_indirect")).toBe(0);
+    // Function with a frame is not changed. Call through "step" is
+    //  guarded, so both its branches are tail calls
+    expect(countOps(true, "return_call")).toBe(3);
+    expect(countOps(true, "return_call_indirect")).toBe(1);
+  });
+
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Runs deep recursion with level ${optimizationLevel}`, async () => {
+      const d = (
+        await compileWithOptions<RecursionExports & WebAssembly.Exports>(
+          { optimizationLevel, tailCalls: true },
+          "emitter19.c"
+        )
+      ).compiled;
+      expect(d.sum_to(DEEP, 0)).toBe(DEEP_SUM);
+      expect(d.indirect_sum(DEEP)).toBe(DEEP_SUM);
+      expect(d.sum_with_frame(1000, 0)).toBe(500500);
+      expect(d.widened_sum(100)).toBe(BigInt(5050));
+    });
+  }
+
+  it(`Grows stack without tail calls`, async () => {
+    const d = (
+      await compileWithOptions<RecursionExports & WebAssembly.Exports>(
+        { optimizationLevel: 2 },
+        "emitter19.c"
+      )
+    ).compiled;
+    expect(d.sum_to(1000, 0)).toBe(500500);
+    expect(() => d.sum_to(DEEP, 0)).toThrow(RangeError);
+  });
+});
@@ -0,0 +1,76 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+
+interface StructExports {
+  make_point(x: number, y: number): number[];
+  divide(a: number, b: number): number[];
+  divide_packed(a: number, b: number): number;
+  quotient(a: number, b: number): number;
+  swap(x: number, y: number): number[];
+  make_mixed(c: number): [number, bigint, number];
+  mixed_sum(c: number): number;
+  rect_area(w: number, h: number): number;
+  fill_points(n: number): number;
+  last_point(n: number): number[];
+  list_sum(): number;
+  nested_copy(): number;
+}
+
+function emitFunction(name: string) {
+  const emitted = emitWithOptions({ optimizationLevel: 2 }, "emitter20.c");
+  const func = emitted.module.functions.find(
+    (func) => func.exportName === name
+  );
+  if (!func) {
+    throw new Error(`No function ${name}`);
+  }
+  return func;
+}
+
+describe(`Small structs`, () => {
+  it(`Returns small structs as multiple values`, () => {
+    expect(emitFunction("divide").results).toStrictEqual(["i32", "i32"]);
+    expect(emitFunction("make_mixed").results).toStrictEqual([
+      "i32",
+      "i64",
+      "f64",
+    ]);
+  });
+
+  it(`Keeps small structs out of memory`, () => {
+    for (const name of ["make_point", "divide", "divide_packed", "quotient"]) {
+      const func = emitFunction(name);
+      expect(
+        func.body.filter((instruction) => /(load|store)/.test(instruction.op))
+      ).toStrictEqual([]);
+    }
+  });
+
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Runs with level ${optimizationLevel}`, async () => {
+      const d = (
+        await compileWithOptions<StructExports & WebAssembly.Exports>(
+          { optimizationLevel },
+          "emitter20.c"
+        )
+      ).compiled;
+
+      expect(d.make_point(3, 4)).toStrictEqual([3, 4]);
+      expect(d.divide(17, 5)).toStrictEqual([3, 2]);
+      expect(d.divide_packed(17, 5)).toBe(3002);
+      expect(d.quotient(17, 5)).toBe(3);
+      expect(d.swap(1, 2)).toStrictEqual([2, 1]);
+      expect(d.make_mixed(7)).toStrictEqual([
+        7,
+        BigInt("7000000000000"),
+        1.75,
+      ]);
+      expect(d.mixed_sum(7)).toBe(7000000000008.75);
+      expect(d.rect_area(3, 4)).toBe(3 * 4 + 16);
+      expect(d.fill_points(4)).toBe(103 + 9 + 3 + 10);
+      expect(d.last_point(4)).toStrictEqual([3, 10]);
+      expect(d.list_sum()).toBe(6);
+      // Inner copy is done while outer one waits for its value
+      expect(d.nested_copy()).toBe(3734);
+    });
+  }
+});
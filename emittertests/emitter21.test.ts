@@ -0,0 +1,84 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+
+interface DispatchExports {
+  call_const(x: number): number;
+  call_handler(index: number, x: number): number;
+  call_second(x: number): number;
+  call_local(x: number): number;
+  set_mode(mode: number): void;
+  call_current(x: number): number;
+  fire_event(x: number): void;
+  set_any(index: number): void;
+  call_any(x: number): number;
+  call_pointer(h: number, x: number): number;
+}
+
+function countOps(name: string, op: string) {
+  const emitted = emitWithOptions({}, "emitter21.c");
+  const func = emitted.module.functions.find(
+    (func) => func.exportName === name
+  );
+  if (!func) {
+    throw new Error(`No function ${name}`);
+  }
+  return func.body.filter((instruction) => instruction.op === op).length;
+}
+
+describe(`Devirtualization`, () => {
+  it(`Calls known targets directly`, () => {
+    for (const name of [
+      "call_const",
+      "call_second",
+      "call_local",
+      "fire_event",
+    ]) {
+      expect(countOps(name, "call_indirect")).toBe(0);
+    }
+    expect(countOps("call_local", "call")).toBe(2);
+  });
+
+  it(`Guards calls with few possible targets`, () => {
+    expect(countOps("call_handler", "call")).toBe(4);
+    expect(countOps("call_handler", "call_indirect")).toBe(1);
+    expect(countOps("call_current", "call")).toBe(2);
+    expect(countOps("call_any", "call")).toBe(4);
+  });
+
+  it(`Keeps call_indirect for unknown pointers`, () => {
+    expect(countOps("call_pointer", "call")).toBe(0);
+    expect(countOps("call_pointer", "call_indirect")).toBe(1);
+  });
+
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Runs with level ${optimizationLevel}`, async () => {
+      const d = (
+        await compileWithOptions<DispatchExports & WebAssembly.Exports>(
+          { optimizationLevel },
+          "emitter21.c"
+        )
+      ).compiled;
+
+      expect(d.call_const(5)).toBe(6);
+      expect(d.call_handler(0, 5)).toBe(6);
+      expect(d.call_handler(1, 5)).toBe(10);
+      expect(d.call_handler(2, 5)).toBe(-5);
+      expect(d.call_handler(3, 5)).toBe(25);
+      expect(d.call_second(7)).toBe(14);
+      expect(d.call_local(7)).toBe(16);
+
+      // Guard falls back to call_indirect, so null pointer still traps
+      expect(() => d.call_current(5)).toThrow(WebAssembly.RuntimeError);
+      d.set_mode(1);
+      expect(d.call_current(5)).toBe(-5);
+      d.fire_event(0);
+      expect(d.call_current(5)).toBe(10);
+
+      d.set_any(3);
+      expect(d.call_any(4)).toBe(16);
+      d.set_any(0);
+      expect(d.call_any(4)).toBe(5);
+      // Functions are in table in order of definition, 2 is "twice"
+      expect(d.call_pointer(2, 4)).toBe(8);
+    });
+  }
+});
@@ -0,0 +1,70 @@
+import { compileWithOptions, emitWithOptions } from "./funcs";
+import { getMemoryLayout } from "../core/emitter.memory";
+
+interface MemoryExports {
+  fill(n: number): number;
+  depth(n: number): number;
+  grow_memory(): number;
+}
+
+const PAGE_SIZE = 0x10000;
+
+describe(`Memory size`, () => {
+  it(`Computes minimum pages`, () => {
+    const emitted = emitWithOptions({}, "emitter22.c");
+    // Stack, heap begin word and 200000 bytes buffer
+    expect(emitted.module.memory.minPages).toBe(5);
+    expect(emitted.module.memory.maxPages).toBe(null);
+    expect(emitted.memoryUsage.globalsSize).toBe(200000);
+
+    expect(
+      emitWithOptions({ stackSize: 0x1000 }, "emitter22.c").module.memory
+        .minPages
+    ).toBe(4);
+    expect(
+      emitWithOptions({ heapSize: 0x20000 }, "emitter22.c").module.memory
+        .minPages
+    ).toBe(7);
+  });
+
+  it(`Rejects wrong sizes`, () => {
+    expect(() => getMemoryLayout(100)).toThrow();
+    expect(() =>
+      emitWithOptions({ exportMemory: true, maxMemoryPages: 2 }, "emitter22.c")
+    ).toThrow();
+  });
+
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Uses stack of given size with level ${optimizationLevel}`, async () => {
+      const d = await compileWithOptions<MemoryExports & WebAssembly.Exports>(
+        { optimizationLevel, stackSize: 0x1000 },
+        "emitter22.c"
+      );
+      expect(d.compiled._debug_get_esp()).toBe(0x1004);
+      expect(d.compiled.fill(200000)).toBe(63);
+      expect(d.compiled.depth(100)).toBe(100);
+      expect(() => d.compiled.depth(1000)).toThrow();
+    });
+  }
+
+  it(`Exports own memory`, async () => {
+    const d = await compileWithOptions<MemoryExports & WebAssembly.Exports>(
+      { optimizationLevel: 2, exportMemory: true },
+      "emitter22.c"
+    );
+    expect(d.compiled.memory).toBe(d.memory);
+    expect(d.memory.buffer.byteLength).toBe(5 * PAGE_SIZE);
+    expect(d.compiled.fill(200000)).toBe(63);
+    // Maximum is the same as minimum
+    expect(d.compiled.grow_memory()).toBe(-1);
+  });
+
+  it(`Grows exported memory up to maximum`, async () => {
+    const d = await compileWithOptions<MemoryExports & WebAssembly.Exports>(
+      { optimizationLevel: 2, exportMemory: true, maxMemoryPages: 6 },
+      "emitter22.c"
+    );
+    expect(d.compiled.grow_memory()).toBe(5);
+    expect(d.compiled.grow_memory()).toBe(-1);
+  });
+});
@@ -0,0 +1,64 @@
+import { emitWithOptions } from "./funcs";
+import { encodeModuleBinaryWithSourceMap } from "../core/emitter.module.binary";
+import { findSourceLocation } from "../core/emitter.sourcemap";
+
+interface DebugExports {
+  depth(n: number): number;
+}
+
+async function instantiateWithSourceMap() {
+  // Memory is exported, so module have no imports
+  const emitted = emitWithOptions(
+    { stackSize: 0x1000, exportMemory: true },
+    "emitter22.c"
+  );
+  const { binary, sourceMap } = encodeModuleBinaryWithSourceMap(
+    emitted.module,
+    { sourceMapUrl: "emitter22.wasm.map", sourceFileName: "emitter22.c" }
+  );
+  const module = await WebAssembly.compile(binary);
+  const instance = await WebAssembly.instantiate(module, {});
+  return {
+    module,
+    sourceMap,
+    exports: (instance.exports as unknown) as DebugExports,
+  };
+}
+
+function getTrapStack(f: () => void) {
+  try {
+    f();
+  } catch (e) {
+    return `${e.stack}`;
+  }
+  throw new Error("Expecting trap");
+}
+
+describe(`Debug information`, () => {
+  it(`Have names of functions in stack traces`, async () => {
+    const { exports } = await instantiateWithSourceMap();
+    const stack = getTrapStack(() => exports.depth(1000));
+    // Trap is in the innermost call
+    expect(stack).toMatch(/^RuntimeError.*\n\s+at depth \(/);
+  });
+
+  it(`Maps trap offset into the source line`, async () => {
+    const { module, sourceMap, exports } = await instantiateWithSourceMap();
+    expect(
+      WebAssembly.Module.customSections(module, "sourceMappingURL").length
+    ).toBe(1);
+    expect(WebAssembly.Module.customSections(module, "name").length).toBe(1);
+
+    const stack = getTrapStack(() => exports.depth(1000));
+    const match = stack.match(/at depth \(.*:0x([0-9a-f]+)\)/);
+    if (!match) {
+      throw new Error(`No offset in stack ${stack}`);
+    }
+    const location = findSourceLocation(
+      sourceMap.mappings,
+      parseInt(match[1], 16)
+    );
+    // Stack is over when values[0] is written
+    expect(location).toStrictEqual({ line: 17, pos: 3 });
+  });
+});
@@ -0,0 +1,104 @@
+import { compileWithOptions, CompileOptions } from "./funcs";
+import {
+  ProfileEntry,
+  ProfileExports,
+  readProfile,
+  formatProfile,
+} from "../core/runtime.profile";
+
+interface InstrumentedExports extends ProfileExports {
+  sum_squares(n: number): number;
+  fib(n: number): number;
+  countdown(n: number): number;
+  busy(n: number): number;
+}
+
+function compileInstrumented(options: CompileOptions) {
+  return compileWithOptions<InstrumentedExports & WebAssembly.Exports>(
+    options,
+    "emitter24.c"
+  );
+}
+
+function getCalls(profile: ProfileEntry[]) {
+  const calls: Record<string, number> = {};
+  profile.forEach((entry) => (calls[entry.name] = entry.calls));
+  return calls;
+}
+
+describe(`Instrumentation`, () => {
+  for (const optimizationLevel of [0, 2] as const) {
+    it(`Counts calls with level ${optimizationLevel}`, async () => {
+      // Inlined square keeps its counter, tail calls are not used
+      const d = await compileInstrumented({
+        optimizationLevel,
+        instrument: "calls",
+        tailCalls: true,
+      });
+      expect(d.compiled.sum_squares(10)).toBe(285);
+      expect(d.compiled.fib(10)).toBe(55);
+      expect(d.compiled.countdown(100)).toBe(0);
+      expect(d.compiled.sum_squares(3)).toBe(5);
+
+      const profile = readProfile(d.memory, d.compiled);
+      expect(getCalls(profile)).toStrictEqual({
+        square: 13,
+        sum_squares: 2,
+        fib: 177,
+        countdown: 101,
+      });
+      // No timer, so sorted by calls
+      expect(profile[0].name).toBe("fib");
+      expect(profile[0].inclusiveTime).toBe(0);
+
+      const table = formatProfile(profile);
+      expect(table.length).toBe(5);
+      expect(table[0]).toContain("calls");
+      expect(table[1]).toContain("177");
+
+      d.compiled._prof_reset();
+      expect(readProfile(d.memory, d.compiled)).toStrictEqual([]);
+      expect(d.compiled.fib(3)).toBe(2);
+      expect(getCalls(readProfile(d.memory, d.compiled))).toStrictEqual({
+        fib: 5,
+      });
+    });
+  }
+
+  it(`Measures time with imported timer`, async () => {
+    // Every call of timer takes one unit of time
+    let time = 0;
+    const d = await compileInstrumented({
+      optimizationLevel: 2,
+      instrument: "time",
+      profileTimer: () => time++,
+    });
+    expect(d.compiled.busy(5)).toBe(5 + 30);
+
+    const profile = readProfile(d.memory, d.compiled);
+    expect(getCalls(profile)).toStrictEqual({
+      busy: 1,
+      fib: 15,
+      sum_squares: 1,
+      square: 5,
+    });
+    const busy = profile.filter((entry) => entry.name === "busy")[0];
+    // Busy started first and finished last
+    expect(busy.inclusiveTime).toBe(time - 1);
+    const exclusiveSum = profile.reduce(
+      (sum, entry) => sum + entry.exclusiveTime,
+      0
+    );
+    expect(exclusiveSum).toBe(busy.inclusiveTime);
+    for (const entry of profile) {
+      expect(entry.exclusiveTime).toBeGreaterThan(0);
+      expect(entry.inclusiveTime).toBeGreaterThanOrEqual(entry.exclusiveTime);
+    }
+    expect(profile[0].name).toBe("fib");
+  });
+
+  it(`Does not instrument by default`, async () => {
+    const d = await compileInstrumented({ optimizationLevel: 2 });
+    expect(d.compiled._prof_dump).toBe(undefined);
+  });
+});
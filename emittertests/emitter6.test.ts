@@ -6,6 +6,7 @@ describe(`Emits and compiles`, () => {
     const d = await compile<{
       compare_eq(x: number, y: number): number;
       factor(x: number): number;
+      factor_on_stack(x: number): number;
       op_u(type: number, x: number, y: number): number;
       op_s(type: number, x: number, y: number): number;
       conditional(cond: number, left: number, right: number): number;
@@ -17,6 +18,7 @@ describe(`Emits and compiles`, () => {
 
     expect(m.factor(3)).toBe(6);
     expect(m.factor(5)).toBe(2 * 3 * 4 * 5);
+    expect(m.factor_on_stack(5)).toBe(2 * 3 * 4 * 5);
 
     expect(m.op_u(9, 0, 0)).toBe(-1);
 
@@ -64,17 +66,17 @@ describe(`Emits and compiles`, () => {
     const d = await compile<{
       compare_eq(x: number, y: number): number;
       factor(x: number): number;
+      factor_on_stack(x: number): number;
       op_u(type: number, x: number, y: number): number;
       op_s(type: number, x: number, y: number): number;
       conditional(cond: number, left: number, right: number): number;
     }>("emitter6.c");
     const m = d.compiled;
 
-    // We know that factor functions uses 4 bytes on stack frame
-    // This is current implementation because we do not do any optimizations
-    // For example, function params can be accessed directly in WebAssembly
-    m.factor(Math.floor(STACK_SIZE / 4));
+    // We know that factor_on_stack function uses 4 bytes on stack frame
+    // because address of its parameter is taken
+    m.factor_on_stack(Math.floor(STACK_SIZE / 4));
 
-    expect(() => m.factor(Math.floor(STACK_SIZE / 4) + 10)).toThrow();
+    expect(() => m.factor_on_stack(Math.floor(STACK_SIZE / 4) + 10)).toThrow();
   });
 });
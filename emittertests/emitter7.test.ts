@@ -0,0 +1,53 @@
+import { compileWithOptions } from "./funcs";
+
+describe(`Emits and compiles`, () => {
+  it(`Variables in WebAssembly locals`, async () => {
+    const d = await compileWithOptions<{
+      sum_to(n: number): number;
+      char_overflow(n: number): number;
+      signed_char_param(c: number): number;
+      assign_chain(x: number): number;
+      strlen_local(s: number): number;
+      mixed(x: number, y: number): number;
+    }>({ optimizationLevel: 2, heapSize: 0x100 }, "emitter7.c");
+    const m = d.compiled;
+
+    expect(m.sum_to(10)).toBe(55);
+    expect(m.sum_to(0)).toBe(0);
+
+    expect(m.char_overflow(3)).toBe(253);
+    expect(m.char_overflow(6)).toBe(0);
+    expect(m.char_overflow(10)).toBe(4);
+
+    expect(m.signed_char_param(5)).toBe(5);
+    expect(m.signed_char_param(255)).toBe(-1);
+    expect(m.signed_char_param(0x180)).toBe(-128);
+
+    expect(m.assign_chain(4)).toBe(10);
+
+    // Heap reservation is free memory after globals
+    const stringAddress = m._debug_get_heap_offset();
+    d.mem8.set([0x41, 0x42, 0x43, 0], stringAddress);
+    expect(m.strlen_local(stringAddress)).toBe(3);
+
+    const espBefore = m._debug_get_esp();
+    expect(m.mixed(1, 2)).toBe(21);
+    expect(m._debug_get_esp()).toBe(espBefore);
+  });
+
+  it(`Frameless functions do not touch stack pointer`, async () => {
+    const d = await compileWithOptions<{
+      sum_to(n: number): number;
+      mixed(x: number, y: number): number;
+    }>({ importStackPointer: true }, "emitter7.c");
+    if (!d.stackPointer) {
+      throw new Error("Stack pointer must be created");
+    }
+    // Any frame allocation will wrap address and trap
+    d.stackPointer.value = 0;
+    expect(d.compiled.sum_to(10)).toBe(55);
+    expect(d.stackPointer.value).toBe(0);
+
+    expect(() => d.compiled.mixed(1, 2)).toThrow();
+  });
+});
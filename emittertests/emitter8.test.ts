@@ -0,0 +1,44 @@
+import { compile, compileWithOptions, emitWithOptions } from "./funcs";
+
+describe(`Tree shaking`, () => {
+  it(`Exports only public functions`, async () => {
+    const d = await compile<{
+      apply(selector: number, x: number): number;
+      sum_of_squares(a: number, b: number): number;
+    }>("emitter8.c");
+
+    expect(d.compiled.apply(0, 10)).toBe(11);
+    expect(d.compiled.apply(1, 10)).toBe(20);
+    expect(d.compiled.sum_of_squares(3, 4)).toBe(25);
+
+    expect(Object.keys(d.compiled)).not.toContain("square");
+    expect(Object.keys(d.compiled)).not.toContain("add_one");
+    expect(Object.keys(d.compiled)).toContain("unused_public");
+  });
+
+  it(`Drops unreachable functions and keeps only address-taken in table`, () => {
+    const emitted = emitWithOptions({}, "emitter8.c");
+    const names = emitted.module.functions.map((func) => func.comment || "");
+    expect(names.some((name) => name.indexOf("never_called") !== -1)).toBe(
+      false
+    );
+    // Trap function and two functions which are used via pointer
+    expect(emitted.module.table.length).toBe(3);
+  });
+
+  it(`Uses explicit exports list as entry points`, async () => {
+    const d = await compileWithOptions<{
+      sum_of_squares(a: number, b: number): number;
+    }>({ exports: ["sum_of_squares"] }, "emitter8.c");
+    expect(d.compiled.sum_of_squares(1, 2)).toBe(5);
+    expect(Object.keys(d.compiled)).not.toContain("apply");
+    expect(Object.keys(d.compiled)).not.toContain("unused_public");
+
+    const emitted = emitWithOptions({ exports: ["sum_of_squares"] }, "emitter8.c");
+    expect(emitted.module.table.length).toBe(1);
+
+    expect(() => emitWithOptions({ exports: ["nope"] }, "emitter8.c")).toThrow(
+      /nope/
+    );
+  });
+});
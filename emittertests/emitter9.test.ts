@@ -0,0 +1,54 @@
+import { compile, emitWithOptions } from "./funcs";
+
+describe(`Inlining`, () => {
+  it(`Inlined functions work`, async () => {
+    const d = await compile<{
+      multiply_by_x(value: number, times: number): number;
+      sum3(a: number, b: number, c: number): number;
+      factorial(n: number): number;
+    }>("emitter9.c");
+
+    expect(d.compiled.multiply_by_x(0x57, 1)).toBe(0xae);
+    expect(d.compiled.multiply_by_x(0x57, 2)).toBe(0x47);
+    expect(d.compiled.multiply_by_x(0x57, 4)).toBe(0x07);
+    expect(d.compiled.sum3(1, 20, 300)).toBe(321);
+    expect(d.compiled.factorial(5)).toBe(120);
+  });
+
+  it(`Small and inline functions are inlined, recursion is not`, () => {
+    const emitted = emitWithOptions({ optimizationLevel: 2 }, "emitter9.c");
+    const inliner = emitted.optimizationStatistics.find(
+      (pass) => pass.name === "inliner"
+    );
+    expect(inliner && inliner.counters["inlined-calls"]).toBe(3);
+    // Static xtime and add are not needed anymore
+    expect(inliner && inliner.counters["removed-functions"]).toBe(2);
+
+    const factorial = emitted.module.functions.find(
+      (func) => func.exportName === "factorial"
+    );
+    expect(
+      factorial && factorial.body.some((instruction) => instruction.op === "call")
+    ).toBe(true);
+  });
+
+  it(`Budget limits inlining`, () => {
+    const notInlined = emitWithOptions(
+      { optimizationLevel: 2, inlineBudget: 0 },
+      "emitter9.c"
+    );
+    expect(
+      notInlined.optimizationStatistics.some((pass) => pass.name === "inliner")
+    ).toBe(false);
+
+    // Only "inline" function fits into budget
+    const onlyInlineSpecified = emitWithOptions(
+      { optimizationLevel: 2, inlineBudget: 5 },
+      "emitter9.c"
+    );
+    const inliner = onlyInlineSpecified.optimizationStatistics.find(
+      (pass) => pass.name === "inliner"
+    );
+    expect(inliner && inliner.counters["inlined-calls"]).toBe(1);
+  });
+});
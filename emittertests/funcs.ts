@@ -1,8 +1,20 @@
 import fs from "fs";
-import { createScannerFunc } from "../core/scanner.func";
 import { Scanner } from "../core/scanner";
 import { readTranslationUnit } from "../core/parser";
-import { emit } from "../core/emitter";
+import { emit, EmitterOptions } from "../core/emitter";
+import { printModuleWat } from "../core/emitter.module.wat";
+import { encodeModuleBinary } from "../core/emitter.module.binary";
+import { preinitializeModule } from "../core/emitter.preinit";
+import {
+  getMemoryLayout,
+  STACK_POINTER_EXTERNAL_NAME,
+} from "../core/emitter.memory";
+import {
+  RuntimeLibrary,
+  createScannerFuncWithRuntime,
+} from "../core/runtime";
+import { createProfileImports } from "../core/runtime.profile";
+import { OptimizationLevel } from "../core/emitter.ir.passmanager";
 import pad from "pad";
 
 function writeErrorInfo(e: any) {
@@ -21,76 +33,123 @@ function writeErrorInfo(e: any) {
 interface DebugHelpersExports {
   _debug_get_esp: () => number;
   _debug_get_heap_offset: () => number;
+  __stack_pointer: WebAssembly.Global;
 }
 
-export async function compile<E extends WebAssembly.Exports>(
-  ...fnames: string[]
-) {
+export interface CompileOptions extends EmitterOptions {
+  /** Exported functions which are called on compilation time */
+  preinit?: string[];
+  /** Runtime libraries which are compiled together with sources */
+  runtime?: RuntimeLibrary[];
+  /** Timer for instrumented module, default is performance.now */
+  profileTimer?: () => number;
+}
+
+export function emitWithOptions(options: CompileOptions, ...fnames: string[]) {
   const fdata = fnames
     .map((fname) => fs.readFileSync(__dirname + "/../test/" + fname).toString())
     .join("\n");
 
-  try {
-    const scanner = new Scanner(createScannerFunc(fdata));
-
-    const unit = readTranslationUnit(scanner);
-
-    const emitted = emit(unit);
-
-    const wabt = await import("wabt").then((wabt1) => wabt1.default());
+  const scanner = new Scanner(
+    createScannerFuncWithRuntime(
+      fdata,
+      options.runtime || [],
+      getMemoryLayout(options.stackSize)
+    )
+  );
 
-    // This file name is only for debug purposes
-    const inputWat = "main";
-    const inputData = emitted.moduleCode.join("\n");
+  const unit = readTranslationUnit(scanner);
 
-    const wasmModule = (() => {
-      try {
-        const wasmModule1 = wabt.parseWat(inputWat, inputData);
-        return wasmModule1;
-      } catch (e) {
-        console.info(
-          emitted.moduleCode
-            .map((line, id) => `${pad(4, `${id + 1}`, "0")}  ${line}`)
-            .join("\n")
-        );
+  return emit(unit, options);
+}
 
-        console.info(e);
-        throw e;
-      }
-    })();
+export async function compile<E extends WebAssembly.Exports>(
+  ...fnames: string[]
+) {
+  return compileWithOptions<E>({}, ...fnames);
+}
 
-    const wasmdata = wasmModule.toBinary({
-      log: true,
-    });
+/** Optimizer regression tests compare results with the first level */
+export const OPTIMIZATION_LEVELS: OptimizationLevel[] = [0, 2];
 
-    // console.info("======== running ==== ");
+/** Calls callback for every level one by one and returns all results */
+export async function forEachOptimizationLevel<T>(
+  callback: (optimizationLevel: OptimizationLevel) => Promise<T>
+): Promise<T[]> {
+  const results: T[] = [];
+  for (const optimizationLevel of OPTIMIZATION_LEVELS) {
+    results.push(await callback(optimizationLevel));
+  }
+  return results;
+}
 
-    //console.info(wasmdata.log);
+export async function compileWithOptions<E extends WebAssembly.Exports>(
+  options: CompileOptions,
+  ...fnames: string[]
+) {
+  try {
+    const emitted = emitWithOptions(options, ...fnames);
+    if (options.preinit) {
+      emitted.module = await preinitializeModule(
+        emitted.module,
+        options.preinit
+      );
+    }
 
-    const SHOW = false;
-    if (SHOW) {
+    const printWat = () =>
       console.info(
-        emitted.moduleCode
+        printModuleWat(emitted.module)
           .map((line, id) => `${pad(4, `${id + 1}`, "0")}  ${line}`)
           .join("\n")
       );
+
+    const wasmdata = encodeModuleBinary(emitted.module);
+
+    const SHOW = false;
+    if (SHOW) {
+      printWat();
     }
 
-    const module = await WebAssembly.compile(wasmdata.buffer);
+    const module = await (async () => {
+      try {
+        return await WebAssembly.compile(wasmdata);
+      } catch (e) {
+        printWat();
+        console.info(e);
+        throw e;
+      }
+    })();
 
-    // const esp = new WebAssembly.Global({ value: "i32", mutable: true }, 0);
-    const memory = new WebAssembly.Memory({
-      // Should be enough to save STACK_SIZE + globals
-      // Reminder: units here are pages which are 64KB each
-      initial: 100,
-      maximum: 1000,
-    });
+    const stackPointer = options.importStackPointer
+      ? new WebAssembly.Global(
+          { value: "i32", mutable: true },
+          getMemoryLayout(options.stackSize).espInitialValue
+        )
+      : null;
+    // Emitter knows how many pages are needed for stack and globals
+    const memoryLimits = emitted.module.memory;
+    const importedMemory = memoryLimits.importFrom
+      ? new WebAssembly.Memory({
+          initial: memoryLimits.minPages,
+          ...(memoryLimits.maxPages !== null
+            ? { maximum: memoryLimits.maxPages }
+            : {}),
+        })
+      : null;
 
     const instance = await WebAssembly.instantiate(module, {
-      js: { memory: memory },
+      js: {
+        ...createProfileImports(options.profileTimer),
+        ...(importedMemory ? { memory: importedMemory } : {}),
+        ...(stackPointer
+          ? { [STACK_POINTER_EXTERNAL_NAME]: stackPointer }
+          : {}),
+      },
     });
 
     const compiled = instance.exports as E & DebugHelpersExports;
+    const memory =
+      importedMemory || (instance.exports.memory as WebAssembly.Memory);
 
     const mem32 = new Uint32Array(memory.buffer);
 
@@ -98,10 +157,12 @@ export async function compile<E extends WebAssembly.Exports>(
 
     return {
       warnings: emitted.warnings,
+      memoryUsage: emitted.memoryUsage,
       compiled,
       memory,
       mem32,
       mem8,
+      stackPointer,
     };
   } catch (e) {
     writeErrorInfo(e);
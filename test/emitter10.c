@@ -0,0 +1,94 @@
+int dense(int x)
+{
+  switch (x)
+  {
+  case 0:
+    return 10;
+  case 1:
+    return 11;
+  case 2:
+  case 3:
+    return 23;
+  case 5:
+    return 15;
+  default:
+    return 99;
+  }
+  return 0;
+}
+
+int sparse(int x)
+{
+  int result = 0;
+  switch (x)
+  {
+  case 1:
+    result = 1;
+    break;
+  case 100:
+    result = 2;
+    break;
+  case 1000:
+    result = 3;
+    break;
+  case 5000:
+    result = 4;
+    break;
+  case 70000:
+    result = 5;
+    break;
+  case 123456:
+    result = 6;
+    break;
+  }
+  return result;
+}
+
+int fallthrough(int x)
+{
+  int result = 0;
+  switch (x)
+  {
+  case 1:
+    result = result + 1;
+  default:
+    result = result + 10;
+  case 2:
+    result = result + 100;
+    break;
+  case 3:
+    result = result + 1000;
+  }
+  return result;
+}
+
+/** Counts odd values, "continue" inside switch goes to the loop */
+int count_in_loop(int n)
+{
+  int count = 0;
+  int i = 0;
+  while (i < n)
+  {
+    i++;
+    switch (i & 3)
+    {
+    case 0:
+    case 2:
+      continue;
+    case 1:
+      count = count + 1;
+      break;
+    case 3:
+      switch (i)
+      {
+      case 3:
+        count = count + 100;
+        break;
+      default:
+        count = count + 1;
+      }
+      break;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,79 @@
+typedef unsigned char uint8_t;
+
+const uint8_t sbox[16] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76};
+
+int primes[] = {2, 3, 5, 7, 11, 13};
+
+// Inner braces are optional
+int matrix[3][2] = {{1, 2}, {3, 4}, 5, 6};
+
+int partial[4][4] = {{1}, {2, 3}};
+
+int square(int x)
+{
+  return x * x;
+}
+
+int cube(int x)
+{
+  return x * x * x;
+}
+
+int (*operations[2])(int) = {square, cube};
+
+int get_sbox(int i)
+{
+  return sbox[i];
+}
+
+int get_prime(int i)
+{
+  return primes[i];
+}
+
+int primes_count()
+{
+  return sizeof(primes) / sizeof(primes[0]);
+}
+
+int get_matrix(int i, int j)
+{
+  return matrix[i][j];
+}
+
+int get_partial(int i, int j)
+{
+  return partial[i][j];
+}
+
+int apply(int op, int x)
+{
+  return (*operations[op])(x);
+}
+
+int next_id()
+{
+  static int id = 100;
+  id++;
+  return id;
+}
+
+int local_small(int i, int x)
+{
+  int values[4] = {10, x, 30};
+  return values[i];
+}
+
+int local_big(int i)
+{
+  int values[20] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+  int sum = 0;
+  values[i] = 100;
+  for (int j = 0; j < 20; j++)
+  {
+    sum = sum + values[j];
+  }
+  return sum;
+}
@@ -0,0 +1,114 @@
+typedef unsigned long long uint64_t;
+typedef signed long long int64_t;
+
+const unsigned char message[5] = {'h', 'e', 'l', 'l', 'o'};
+
+uint64_t fnv_offset = 14695981039346656037ULL;
+
+uint64_t powers[4] = {1, 1000, 1000000, 1000000000000LL};
+
+uint64_t fnv1a(int length)
+{
+  uint64_t hash = fnv_offset;
+  int i = 0;
+  while (i < length)
+  {
+    hash = hash ^ message[i];
+    hash = hash * 1099511628211ULL;
+    i++;
+  }
+  return hash;
+}
+
+uint64_t mul(uint64_t a, uint64_t b)
+{
+  return a * b;
+}
+
+int64_t div_signed(int64_t a, int64_t b)
+{
+  return a / b;
+}
+
+int less_signed(int64_t a, int64_t b)
+{
+  return a < b;
+}
+
+int less_unsigned(uint64_t a, uint64_t b)
+{
+  return a < b;
+}
+
+uint64_t widen_unsigned(unsigned int x)
+{
+  return x;
+}
+
+int64_t widen_signed(signed int x)
+{
+  return x;
+}
+
+int high_part(uint64_t x)
+{
+  return (int)(x >> 32);
+}
+
+uint64_t shift_left(int n)
+{
+  return 1LL << n;
+}
+
+int64_t shift_right_signed(int64_t x, int n)
+{
+  return x >> n;
+}
+
+uint64_t get_power(int i)
+{
+  return powers[i];
+}
+
+void set_by_pointer(uint64_t *p, uint64_t value)
+{
+  *p = value;
+}
+
+uint64_t address_taken(uint64_t value)
+{
+  uint64_t x = 0;
+  set_by_pointer(&x, value + 1);
+  return x;
+}
+
+uint64_t sum_to(int n)
+{
+  long long int sum = 0;
+  long long counter = 0;
+  while (counter < n)
+  {
+    counter++;
+    sum = sum + counter;
+  }
+  return sum;
+}
+
+int is_zero(uint64_t x)
+{
+  if (x)
+  {
+    return 0;
+  }
+  return !x;
+}
+
+uint64_t negate(uint64_t x)
+{
+  return -x;
+}
+
+uint64_t binary_mask()
+{
+  return 0b1000000000000000000000000000000000000000000000000000000000000011ULL;
+}
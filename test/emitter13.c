@@ -0,0 +1,127 @@
+const double coefficients[3] = {0.25, 0.5, 0.25};
+
+float scale = 1.5f;
+
+double samples[8];
+
+double mean(int count)
+{
+  double sum = 0;
+  int i = 0;
+  while (i < count)
+  {
+    sum = sum + samples[i];
+    i++;
+  }
+  return sum / count;
+}
+
+void set_sample(int i, double value)
+{
+  samples[i] = value;
+}
+
+double filter(int i)
+{
+  return coefficients[0] * samples[i] +
+         coefficients[1] * samples[i + 1] +
+         coefficients[2] * samples[i + 2];
+}
+
+float scaled(float x)
+{
+  return x * scale;
+}
+
+double hypot_squared(double x, double y)
+{
+  return x * x + y * y;
+}
+
+double mixed(int a, float b, double c)
+{
+  return a + b * c;
+}
+
+int to_int(double x)
+{
+  return x;
+}
+
+signed int to_signed(double x)
+{
+  return (signed int)x;
+}
+
+long long to_long_long(double x)
+{
+  return (long long)x;
+}
+
+double from_signed(signed int x)
+{
+  return x;
+}
+
+double from_unsigned(unsigned int x)
+{
+  return x;
+}
+
+float demote(double x)
+{
+  return x;
+}
+
+int less(double a, double b)
+{
+  return a < b;
+}
+
+int is_zero(double x)
+{
+  if (x)
+  {
+    return 0;
+  }
+  return !x;
+}
+
+double negate(double x)
+{
+  return -x;
+}
+
+double increment(double x)
+{
+  x++;
+  return x;
+}
+
+double average_by_pointer(double *values, int count)
+{
+  double sum = 0.0;
+  int i = 0;
+  while (i < count)
+  {
+    sum = sum + values[i];
+    i++;
+  }
+  return sum / (double)count;
+}
+
+double pointer_average()
+{
+  double local[4] = {1.0, 2.0, 3.5, -0.5};
+  return average_by_pointer(&local[0], 4);
+}
+
+double pick(int condition, float a, double b)
+{
+  return condition ? a : b;
+}
+
+double exponent()
+{
+  return 1.5e3 + 2E-1;
+}
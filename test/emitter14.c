@@ -0,0 +1,82 @@
+typedef unsigned char uint8_t;
+typedef unsigned int uint32_t;
+
+uint8_t bytes[512];
+uint32_t words[256];
+
+uint8_t state[16];
+const uint8_t round_key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                               0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+
+uint8_t *get_bytes()
+{
+  return &bytes[0];
+}
+
+uint32_t *get_words()
+{
+  return &words[0];
+}
+
+uint8_t *get_state()
+{
+  return &state[0];
+}
+
+void xor_buffers(uint8_t *dst, uint8_t *a, uint8_t *b, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    dst[i] = a[i] ^ b[i];
+  }
+}
+
+void add_bytes(uint8_t *dst, uint8_t *a, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    dst[i] = dst[i] + a[i] - 3;
+  }
+}
+
+void fill(uint8_t *dst, uint8_t value, int n)
+{
+  for (int i = 0; i < n; i++)
+  {
+    dst[i] = value;
+  }
+}
+
+void add_words(uint32_t *dst, uint32_t *a, int n)
+{
+  int i = 0;
+  while (i < n)
+  {
+    dst[i] = dst[i] + a[i];
+    i++;
+  }
+}
+
+void mix_words(uint32_t *dst, uint32_t *a, signed int n, uint32_t k)
+{
+  for (signed int i = 0; i < n; i++)
+  {
+    dst[i] = ((a[i] << 3) ^ (a[i] >> 5)) * k | 1;
+  }
+}
+
+void add_round_key()
+{
+  for (int i = 0; i < 16; i++)
+  {
+    state[i] = state[i] ^ round_key[i];
+  }
+}
+
+void running_sum(uint32_t *dst, int n)
+{
+  for (int i = 1; i < n; i++)
+  {
+    dst[i] = dst[i] + dst[i - 1];
+  }
+}
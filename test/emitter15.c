@@ -0,0 +1,166 @@
+typedef unsigned char uint8_t;
+
+uint8_t buffer[64];
+
+v128_t saved;
+
+const uint8_t reverse_indexes[16] = {15, 14, 13, 12, 11, 10, 9, 8,
+                                     7, 6, 5, 4, 3, 2, 1, 0};
+
+uint8_t *get_buffer()
+{
+  return &buffer[0];
+}
+
+void xor_block(uint8_t *dst, uint8_t *a, uint8_t *b)
+{
+  v128_t x = __builtin_wasm_v128_load(a);
+  v128_t y = __builtin_wasm_v128_load(b);
+  __builtin_wasm_v128_store(dst, __builtin_wasm_v128_xor(x, y));
+}
+
+v128_t add_twice(v128_t a, v128_t b)
+{
+  return __builtin_wasm_i32x4_add(__builtin_wasm_i32x4_add(a, b), b);
+}
+
+int lanes_i32(int a, int b)
+{
+  v128_t x = __builtin_wasm_i32x4_splat(a);
+  x = __builtin_wasm_i32x4_replace_lane(x, 2, b);
+  v128_t y = add_twice(x, __builtin_wasm_i32x4_splat(1));
+  y = __builtin_wasm_i32x4_mul(y, __builtin_wasm_i32x4_splat(10));
+  y = __builtin_wasm_i32x4_sub(y, __builtin_wasm_i32x4_splat(5));
+  return __builtin_wasm_i32x4_extract_lane(y, 0) +
+         __builtin_wasm_i32x4_extract_lane(y, 2) * 1000;
+}
+
+signed int byte_signed(int x)
+{
+  v128_t v = __builtin_wasm_i8x16_splat(x);
+  v = __builtin_wasm_i8x16_add(v, v);
+  return __builtin_wasm_i8x16_extract_lane_s(v, 5);
+}
+
+int byte_unsigned(int x)
+{
+  v128_t v = __builtin_wasm_i8x16_splat(x);
+  v = __builtin_wasm_i8x16_sub(v, __builtin_wasm_i8x16_splat(1));
+  v = __builtin_wasm_i8x16_replace_lane(v, 3, 7);
+  return __builtin_wasm_i8x16_extract_lane_u(v, 15) +
+         __builtin_wasm_i8x16_extract_lane_u(v, 3) * 1000;
+}
+
+signed int short_mul(int a, int b)
+{
+  v128_t x = __builtin_wasm_i16x8_splat(a);
+  x = __builtin_wasm_i16x8_replace_lane(x, 7, b);
+  x = __builtin_wasm_i16x8_mul(x, x);
+  x = __builtin_wasm_i16x8_add(x, __builtin_wasm_i16x8_splat(1));
+  x = __builtin_wasm_i16x8_sub(x, __builtin_wasm_i16x8_splat(2));
+  return __builtin_wasm_i16x8_extract_lane_s(x, 7) +
+         __builtin_wasm_i16x8_extract_lane_u(x, 0);
+}
+
+long long wide(long long a, long long b)
+{
+  v128_t x = __builtin_wasm_i64x2_splat(a);
+  x = __builtin_wasm_i64x2_replace_lane(x, 1, b);
+  x = __builtin_wasm_i64x2_mul(x, x);
+  x = __builtin_wasm_i64x2_add(x, __builtin_wasm_i64x2_splat(1));
+  x = __builtin_wasm_i64x2_sub(x, __builtin_wasm_i64x2_splat(a));
+  return __builtin_wasm_i64x2_extract_lane(x, 1);
+}
+
+float floats(float a, float b)
+{
+  v128_t x = __builtin_wasm_f32x4_splat(a);
+  x = __builtin_wasm_f32x4_replace_lane(x, 3, b);
+  x = __builtin_wasm_f32x4_mul(x, __builtin_wasm_f32x4_splat(2.0f));
+  x = __builtin_wasm_f32x4_add(x, __builtin_wasm_f32x4_splat(0.5f));
+  x = __builtin_wasm_f32x4_sub(x, __builtin_wasm_f32x4_splat(1.0f));
+  return __builtin_wasm_f32x4_extract_lane(x, 3);
+}
+
+double doubles(double a, double b)
+{
+  v128_t x = __builtin_wasm_f64x2_splat(a);
+  x = __builtin_wasm_f64x2_replace_lane(x, 0, b);
+  x = __builtin_wasm_f64x2_mul(x, x);
+  x = __builtin_wasm_f64x2_add(x, __builtin_wasm_f64x2_splat(1.5));
+  x = __builtin_wasm_f64x2_sub(x, __builtin_wasm_f64x2_splat(a));
+  return __builtin_wasm_f64x2_extract_lane(x, 0) +
+         __builtin_wasm_f64x2_extract_lane(x, 1);
+}
+
+void reverse_shuffle(uint8_t *dst, uint8_t *src)
+{
+  v128_t x = __builtin_wasm_v128_load(src);
+  x = __builtin_wasm_i8x16_shuffle(x, x, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6,
+                                   5, 4, 3, 2, 1, 0);
+  __builtin_wasm_v128_store(dst, x);
+}
+
+void interleave(uint8_t *dst, uint8_t *a, uint8_t *b)
+{
+  v128_t x = __builtin_wasm_v128_load(a);
+  v128_t y = __builtin_wasm_v128_load(b);
+  __builtin_wasm_v128_store(
+      dst, __builtin_wasm_i8x16_shuffle(x, y, 0, 16, 1, 17, 2, 18, 3, 19, 4,
+                                        20, 5, 21, 6, 22, 7, 23));
+}
+
+void reverse_swizzle(uint8_t *dst, uint8_t *src)
+{
+  v128_t indexes = __builtin_wasm_v128_load(&reverse_indexes[0]);
+  __builtin_wasm_v128_store(
+      dst, __builtin_wasm_i8x16_swizzle(__builtin_wasm_v128_load(src),
+                                        indexes));
+}
+
+int bitwise(int a, int b, int mask)
+{
+  v128_t x = __builtin_wasm_i32x4_splat(a);
+  v128_t y = __builtin_wasm_i32x4_splat(b);
+  v128_t m = __builtin_wasm_i32x4_splat(mask);
+  v128_t selected = __builtin_wasm_v128_bitselect(x, y, m);
+  v128_t both = __builtin_wasm_v128_and(x, y);
+  v128_t any = __builtin_wasm_v128_or(x, y);
+  v128_t without = __builtin_wasm_v128_andnot(x, y);
+  v128_t inverted = __builtin_wasm_v128_not(x);
+  return __builtin_wasm_i32x4_extract_lane(selected, 0) ^
+         __builtin_wasm_i32x4_extract_lane(both, 1) ^
+         __builtin_wasm_i32x4_extract_lane(any, 2) ^
+         __builtin_wasm_i32x4_extract_lane(without, 3) ^
+         __builtin_wasm_i32x4_extract_lane(inverted, 0);
+}
+
+int in_memory(int a)
+{
+  v128_t local = __builtin_wasm_i32x4_splat(a);
+  v128_t *pointer = &local;
+  *pointer = __builtin_wasm_i32x4_add(*pointer, *pointer);
+  saved = __builtin_wasm_i32x4_replace_lane(local, 1, 3);
+  return __builtin_wasm_i32x4_extract_lane(saved, 0) +
+         __builtin_wasm_i32x4_extract_lane(saved, 1) + (int)sizeof(v128_t);
+}
+
+int pick(int condition, int a, int b)
+{
+  v128_t x = condition ? __builtin_wasm_i32x4_splat(a)
+                       : __builtin_wasm_i32x4_splat(b);
+  return __builtin_wasm_i32x4_extract_lane(x, 3);
+}
+
+static int lane_total(int a)
+{
+  v128_t x = __builtin_wasm_i32x4_splat(a);
+  x = __builtin_wasm_i32x4_replace_lane(x, 1, a * 2);
+  return __builtin_wasm_i32x4_extract_lane(x, 0) +
+         __builtin_wasm_i32x4_extract_lane(x, 1);
+}
+
+int inlined_vector_local(int a)
+{
+  return lane_total(a) + lane_total(a + 1);
+}
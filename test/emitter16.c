@@ -0,0 +1,71 @@
+typedef unsigned char uint8_t;
+
+uint8_t buffer[256];
+
+int words[32];
+
+uint8_t *get_buffer()
+{
+  return &buffer[0];
+}
+
+void copy(uint8_t *dst, uint8_t *src, int n)
+{
+  memcpy(dst, src, n);
+}
+
+void move(uint8_t *dst, uint8_t *src, int n)
+{
+  memmove(dst, src, n);
+}
+
+void fill(uint8_t *dst, int value, int n)
+{
+  memset(dst, value, n);
+}
+
+uint8_t *copy_returned(uint8_t *dst, uint8_t *src, int n)
+{
+  return memcpy(dst, src, n);
+}
+
+uint8_t *fill_and_copy(uint8_t *dst, uint8_t *src, int n)
+{
+  uint8_t *p;
+  p = memcpy(dst, memset(src, 7, n), n);
+  return p;
+}
+
+int copy_words()
+{
+  int local[32];
+  int i = 0;
+  while (i < 32)
+  {
+    words[i] = i * i;
+    i++;
+  }
+  memcpy(&local[0], &words[0], sizeof(local));
+  memset(&words[0], 0, sizeof(words));
+  return local[31] + words[31];
+}
+
+int zero_initialized(int k)
+{
+  int local[64] = {0};
+  local[k] = k;
+  int sum = 0;
+  int i = 0;
+  while (i < 64)
+  {
+    sum = sum + local[i];
+    i++;
+  }
+  return sum;
+}
+
+int template_initialized(int k)
+{
+  int local[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, k};
+  return local[0] + local[11] + local[12] + local[13] + local[15];
+}
@@ -0,0 +1,68 @@
+int *make_range(int n)
+{
+  int *values = malloc(n * sizeof(int));
+  int i = 0;
+  while (i < n)
+  {
+    values[i] = i;
+    i++;
+  }
+  return values;
+}
+
+int sum(int *values, int n)
+{
+  int result = 0;
+  int i = 0;
+  while (i < n)
+  {
+    result = result + values[i];
+    i++;
+  }
+  return result;
+}
+
+int sum_of_ranges(int count, int n)
+{
+  int *lists[16];
+  int i = 0;
+  while (i < count)
+  {
+    lists[i] = make_range(n + i);
+    i++;
+  }
+  int result = 0;
+  i = 0;
+  while (i < count)
+  {
+    result = result + sum(lists[i], n + i);
+    free(lists[i]);
+    i++;
+  }
+  return result;
+}
+
+int grow_range(int n)
+{
+  int *values = make_range(1);
+  int size = 1;
+  while (size < n)
+  {
+    values = realloc(values, (size + 1) * sizeof(int));
+    values[size] = size;
+    size++;
+  }
+  int result = sum(values, n);
+  free(values);
+  return result;
+}
+
+int zeroed_sum(int n)
+{
+  int *dirty = make_range(n);
+  free(dirty);
+  int *values = calloc(n, sizeof(int));
+  int result = sum(values, n);
+  free(values);
+  return result;
+}
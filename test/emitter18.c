@@ -0,0 +1,27 @@
+int *parse_numbers(void *arena, int count, int seed)
+{
+  int *numbers = arena_alloc(arena, count * sizeof(int));
+  int i = 0;
+  while (i < count)
+  {
+    numbers[i] = seed + i;
+    i++;
+  }
+  return numbers;
+}
+
+int handle_request(void *arena, int seed)
+{
+  int *a = parse_numbers(arena, 100, seed);
+  int *b = parse_numbers(arena, 5000, seed);
+  int *c = parse_numbers(arena, 10, seed);
+  return a[99] + b[4999] + c[9];
+}
+
+int heap_top = 5;
+
+int arena_use_chunk(int n)
+{
+  heap_top = heap_top + n;
+  return heap_top;
+}
@@ -0,0 +1,42 @@
+int sum_to(int n, int acc)
+{
+  if (n == 0)
+  {
+    return acc;
+  }
+  return sum_to(n - 1, acc + n);
+}
+
+int (*step)(int n, int acc);
+
+int step_sum(int n, int acc)
+{
+  if (n == 0)
+  {
+    return acc;
+  }
+  return (*step)(n - 1, acc + n);
+}
+
+int indirect_sum(int n)
+{
+  step = &step_sum;
+  return step_sum(n, 0);
+}
+
+int sum_with_frame(int n, int acc)
+{
+  int values[2];
+  values[0] = n;
+  values[1] = acc;
+  if (n == 0)
+  {
+    return acc;
+  }
+  return sum_with_frame(values[0] - 1, values[1] + n);
+}
+
+long long widened_sum(int n)
+{
+  return sum_to(n, 0);
+}
@@ -0,0 +1,130 @@
+struct point
+{
+  int x, y;
+};
+
+struct divmod
+{
+  unsigned int quot;
+  unsigned int rem;
+};
+
+struct point make_point(int x, int y)
+{
+  struct point p;
+  p.x = x;
+  p.y = y;
+  return p;
+}
+
+struct divmod divide(unsigned int a, unsigned int b)
+{
+  struct divmod result = {a / b, a % b};
+  return result;
+}
+
+unsigned int divide_packed(unsigned int a, unsigned int b)
+{
+  struct divmod result = divide(a, b);
+  return result.quot * 1000 + result.rem;
+}
+
+unsigned int quotient(unsigned int a, unsigned int b)
+{
+  return divide(a, b).quot;
+}
+
+struct point swap(int x, int y)
+{
+  return make_point(y, x);
+}
+
+typedef struct
+{
+  char c;
+  long long big;
+  double d;
+} mixed_t;
+
+mixed_t make_mixed(int c)
+{
+  mixed_t m;
+  m.c = c;
+  m.big = c;
+  m.big = m.big * 1000000000000;
+  m.d = c / 4.0;
+  return m;
+}
+
+double mixed_sum(int c)
+{
+  mixed_t m = make_mixed(c);
+  return m.c + m.big + m.d;
+}
+
+struct rect
+{
+  struct point min;
+  struct point max;
+};
+
+int rect_area(int w, int h)
+{
+  struct rect r;
+  r.min = make_point(1, 2);
+  r.max = make_point(1 + w, 2 + h);
+  return (r.max.x - r.min.x) * (r.max.y - r.min.y) + sizeof(struct rect);
+}
+
+struct point points[4];
+
+int fill_points(int n)
+{
+  int i = 0;
+  while (i < n)
+  {
+    points[i] = make_point(i, i * i);
+    i = i + 1;
+  }
+  struct point *last = &points[n - 1];
+  struct point copy = *last;
+  copy.x = copy.x + 100;
+  last->y = last->y + 1;
+  return copy.x + copy.y + points[n - 1].x + points[n - 1].y;
+}
+
+struct point last_point(int n)
+{
+  return points[n - 1];
+}
+
+struct node
+{
+  int value;
+  struct node *next;
+};
+
+int list_sum()
+{
+  struct node c = {3, 0};
+  struct node b = {2, &c};
+  struct node a = {1, &b};
+  struct node *n = &a;
+  int sum = 0;
+  while (n)
+  {
+    sum = sum + n->value;
+    n = n->next;
+  }
+  return sum;
+}
+
+int nested_copy()
+{
+  struct point a = {0, 0};
+  struct point b = {0, 0};
+  struct point *pa = &a;
+  struct point *pb = &b;
+  *pa = make_point((*pb = make_point(3, 4)).x, 7);
+  return a.x * 1000 + a.y * 100 + b.x * 10 + b.y;
+}
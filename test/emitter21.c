@@ -0,0 +1,95 @@
+int add_one(int x)
+{
+  return x + 1;
+}
+
+int twice(int x)
+{
+  return x * 2;
+}
+
+int negate(int x)
+{
+  return 0 - x;
+}
+
+static int square(int x)
+{
+  return x * x;
+}
+
+typedef int (*handler_t)(int);
+
+int (*const increment)(int) = &add_one;
+
+int call_const(int x)
+{
+  return (*increment)(x);
+}
+
+const handler_t handlers[4] = {&add_one, &twice, &negate, square};
+
+int call_handler(int index, int x)
+{
+  return (*handlers[index])(x);
+}
+
+int call_second(int x)
+{
+  return (*handlers[1])(x);
+}
+
+int call_local(int x)
+{
+  handler_t h;
+  h = &twice;
+  return (*h)(x) + (*h)(1);
+}
+
+handler_t current;
+
+void set_mode(int mode)
+{
+  if (mode)
+  {
+    current = &negate;
+  }
+  else
+  {
+    current = &twice;
+  }
+}
+
+int call_current(int x)
+{
+  return (*current)(x);
+}
+
+void notify(int x)
+{
+  set_mode(x);
+}
+
+void (*const on_event)(int) = &notify;
+
+void fire_event(int x)
+{
+  (*on_event)(x);
+}
+
+handler_t any;
+
+void set_any(int index)
+{
+  any = handlers[index];
+}
+
+int call_any(int x)
+{
+  return (*any)(x);
+}
+
+int call_pointer(handler_t h, int x)
+{
+  return (*h)(x);
+}
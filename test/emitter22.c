@@ -0,0 +1,28 @@
+char buffer[200000];
+
+int fill(int n)
+{
+  int i = 0;
+  while (i < n)
+  {
+    buffer[i] = i;
+    i = i + 1;
+  }
+  return buffer[n - 1];
+}
+
+int depth(int n)
+{
+  int values[4];
+  values[0] = n;
+  if (n == 0)
+  {
+    return 0;
+  }
+  return 1 + depth(values[0] - 1);
+}
+
+int grow_memory()
+{
+  return __builtin_wasm_memory_grow(1);
+}
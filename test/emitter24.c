@@ -0,0 +1,39 @@
+static int square(int x)
+{
+  return x * x;
+}
+
+int sum_squares(int n)
+{
+  int sum = 0;
+  int i = 0;
+  while (i < n)
+  {
+    sum = sum + square(i);
+    i = i + 1;
+  }
+  return sum;
+}
+
+int fib(int n)
+{
+  if (n < 2)
+  {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+int countdown(int n)
+{
+  if (n == 0)
+  {
+    return 0;
+  }
+  return countdown(n - 1);
+}
+
+int busy(int n)
+{
+  return fib(n) + sum_squares(n);
+}
@@ -15,6 +15,20 @@ int factor(int i)
   }
 }
 
+/** Same as factor, but parameter lives on the shadow stack because its address is taken */
+int factor_on_stack(int i)
+{
+  int *p = &i;
+  if (*p == 1)
+  {
+    return i;
+  }
+  else
+  {
+    return i * factor_on_stack(i - 1);
+  }
+}
+
 int op_s(int type, signed int x, signed int y)
 {
   if (type == 0)
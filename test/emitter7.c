@@ -0,0 +1,62 @@
+int sum_to(int n)
+{
+  int sum = 0;
+  for (int i = 1; i <= n; i++)
+  {
+    sum = sum + i;
+  }
+  return sum;
+}
+
+/** Char in a WebAssembly local must overflow like char in memory */
+int char_overflow(int n)
+{
+  unsigned char c = 250;
+  while (n > 0)
+  {
+    c++;
+    n--;
+  }
+  return c;
+}
+
+int signed_char_param(signed char c)
+{
+  return c;
+}
+
+int assign_chain(int x)
+{
+  int a;
+  int b;
+  a = b = x + 1;
+  return a + b;
+}
+
+/** Pointer parameter is in a local, pointed data is in memory */
+int strlen_local(char *s)
+{
+  int len = 0;
+  while (*s)
+  {
+    s++;
+    len++;
+  }
+  return len;
+}
+
+void swap(int *a, int *b)
+{
+  int t = *a;
+  *a = *b;
+  *b = t;
+}
+
+/** Address-taken locals stay in memory, others are locals */
+int mixed(int x, int y)
+{
+  int counter = 0;
+  swap(&x, &y);
+  counter = x * 10 + y;
+  return counter;
+}
@@ -0,0 +1,39 @@
+static int square(int x)
+{
+  return x * x;
+}
+
+static int never_called(int x)
+{
+  return square(x) + 1;
+}
+
+static int add_one(int x)
+{
+  return x + 1;
+}
+
+static int twice(int x)
+{
+  return x + x;
+}
+
+int apply(int selector, int x)
+{
+  int (*f)(int) = &add_one;
+  if (selector)
+  {
+    f = &twice;
+  }
+  return (*f)(x);
+}
+
+int sum_of_squares(int a, int b)
+{
+  return square(a) + square(b);
+}
+
+int unused_public(int x)
+{
+  return x;
+}
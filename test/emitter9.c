@@ -0,0 +1,38 @@
+static inline int xtime(int x)
+{
+  int shifted = (x << 1) & 255;
+  if (x & 128)
+  {
+    shifted = shifted ^ 27;
+  }
+  return shifted;
+}
+
+static int add(int a, int b)
+{
+  return a + b;
+}
+
+int multiply_by_x(int value, int times)
+{
+  while (times > 0)
+  {
+    value = xtime(value);
+    times--;
+  }
+  return value;
+}
+
+int sum3(int a, int b, int c)
+{
+  return add(add(a, b), c);
+}
+
+int factorial(int n)
+{
+  if (n <= 1)
+  {
+    return 1;
+  }
+  return n * factorial(n - 1);
+}
@@ -2,6 +2,7 @@ import { Scanner } from "../core/scanner";
 import { createScannerFunc } from "../core/scanner.func";
 import { readTranslationUnit } from "../core/parser";
 import { emit } from "../core/emitter";
+import { printModuleWat } from "../core/emitter.module.wat";
 import pad from "pad";
 import { writeAst } from "./ast";
 
@@ -37,7 +38,7 @@ export function getComliledOutput(input: string) {
 
     write(" ");
     write("=== WebAssembly text ===");
-    emitted.moduleCode.forEach((line) => write(line));
+    printModuleWat(emitted.module).forEach((line) => write(line));
   } catch (e) {
     const err = {
       name: e.name,